@@ -0,0 +1,288 @@
+#include "bench_array.h"
+#include "../include/datoviz/array.h"
+#include "../include/datoviz/builtin_visuals.h"
+#include "../include/datoviz/graphics.h"
+#include "../include/datoviz/scene.h"
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define BENCH_ARRAY_ITEMS   10000000
+#define BENCH_ARRAY_REPEATS 5
+
+#define BENCH_VISUAL_PROPS   64
+#define BENCH_VISUAL_ITEMS   1000
+#define BENCH_VISUAL_REPEATS 1000
+
+#define BENCH_TEXT_LABELS 1000000
+
+
+
+/*************************************************************************************************/
+/*  Array column copy                                                                            */
+/*************************************************************************************************/
+
+static const char* SIMD_NAMES[] = {"scalar", "sse2", "avx2"};
+
+// Run a column copy several times and print the best throughput, counting the bytes read and
+// written.
+static void _column_run(
+    const char* name, DvzArray* arr, VkDeviceSize offset, VkDeviceSize col_size,
+    uint32_t data_item_count, const void* data, DvzDataType source_dtype,
+    DvzDataType target_dtype, VkDeviceSize bytes)
+{
+    double best = 1e9, t = 0;
+    for (uint32_t r = 0; r < BENCH_ARRAY_REPEATS; r++)
+    {
+        t = bench_now();
+        dvz_array_column(
+            arr, offset, col_size, 0, arr->item_count, data_item_count, data, //
+            source_dtype, target_dtype, DVZ_ARRAY_COPY_SINGLE, 1);
+        best = MIN(best, bench_now() - t);
+    }
+    printf(
+        "%-24s %-6s %8.2f ms  %6.2f GB/s\n", name, SIMD_NAMES[dvz_simd_level()], best * 1e3,
+        bytes / best * 1e-9);
+}
+
+
+
+int bench_array_column(TestContext* context)
+{
+    const uint32_t n = BENCH_ARRAY_ITEMS;
+    DvzArray arr = dvz_array_struct(n, sizeof(DvzGraphicsMarkerVertex));
+    dvec3* pos = calloc(n, sizeof(dvec3));
+    float* size = calloc(n, sizeof(float));
+    cvec4* color = calloc(n, sizeof(cvec4));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        RANDN_POS(pos[i]);
+        size[i] = i;
+        color[i][0] = i % 256;
+    }
+    float constant = 10;
+
+    DvzSimdLevel max_level = dvz_simd_level();
+    for (int32_t level = (int32_t)max_level; level >= 0; level--)
+    {
+        dvz_simd_set_level((DvzSimdLevel)level);
+
+        // dvec3 to vec3 cast, interleaved in vertex records.
+        _column_run(
+            "dvec3 -> vec3 (vertex)", &arr, offsetof(DvzGraphicsMarkerVertex, pos),
+            sizeof(dvec3), n, pos, DVZ_DTYPE_DVEC3, DVZ_DTYPE_VEC3,
+            n * (sizeof(dvec3) + sizeof(vec3)));
+
+        // Same dtype, interleaved in vertex records.
+        _column_run(
+            "cvec4 (vertex)", &arr, offsetof(DvzGraphicsMarkerVertex, color), sizeof(cvec4), n,
+            color, DVZ_DTYPE_CVEC4, DVZ_DTYPE_CVEC4, 2 * n * sizeof(cvec4));
+        _column_run(
+            "float (vertex)", &arr, offsetof(DvzGraphicsMarkerVertex, size), sizeof(float), n,
+            size, DVZ_DTYPE_FLOAT, DVZ_DTYPE_FLOAT, 2 * n * sizeof(float));
+
+        // Constant broadcast.
+        _column_run(
+            "float constant (vertex)", &arr, offsetof(DvzGraphicsMarkerVertex, size),
+            sizeof(float), 1, &constant, DVZ_DTYPE_FLOAT, DVZ_DTYPE_FLOAT, n * sizeof(float));
+    }
+    dvz_simd_set_level(max_level);
+
+    FREE(pos);
+    FREE(size);
+    FREE(color);
+    dvz_array_destroy(&arr);
+    return 0;
+}
+
+
+
+/*************************************************************************************************/
+/*  Visual baking                                                                                */
+/*************************************************************************************************/
+
+int bench_visual_bake(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    DvzVisual visual = dvz_visual(canvas);
+    dvz_visual_builtin(&visual, DVZ_VISUAL_MARKER, 0);
+
+    const uint32_t n = BENCH_ARRAY_ITEMS;
+    dvec3* pos = calloc(n, sizeof(dvec3));
+    cvec4* color = calloc(n, sizeof(cvec4));
+    float* size = calloc(n, sizeof(float));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        RANDN_POS(pos[i]);
+        RAND_COLOR(color[i]);
+        size[i] = 5 + 45 * dvz_rand_float();
+    }
+    dvz_visual_data(&visual, DVZ_PROP_POS, 0, n, pos);
+    dvz_visual_data(&visual, DVZ_PROP_COLOR, 0, n, color);
+    dvz_visual_data(&visual, DVZ_PROP_MARKER_SIZE, 0, n, size);
+
+    // Bytes read from the props and written to the vertex buffer.
+    VkDeviceSize bytes = n * (sizeof(dvec3) + sizeof(cvec4) + sizeof(float)) +
+                         n * sizeof(DvzGraphicsMarkerVertex);
+
+    // Only time the bake callback, not the upload to the GPU.
+    DvzVisualDataEvent ev = {0};
+    double best = 0, t = 0;
+    for (uint32_t threads = 1; threads <= 8; threads *= 2)
+    {
+        dvz_app_threads(app, threads);
+        best = 1e9;
+        for (uint32_t r = 0; r < BENCH_ARRAY_REPEATS; r++)
+        {
+            t = bench_now();
+            visual.callback_bake(&visual, ev);
+            best = MIN(best, bench_now() - t);
+        }
+        printf(
+            "bake %d markers (%s, %d threads)  %8.2f ms  %6.2f GB/s\n", n,
+            SIMD_NAMES[dvz_simd_level()], threads, best * 1e3, bytes / best * 1e-9);
+    }
+
+    FREE(pos);
+    FREE(color);
+    FREE(size);
+    dvz_visual_destroy(&visual);
+    TEST_END
+}
+
+
+
+// Bake and fill a small visual with many props, where the prop and source lookups dominate.
+int bench_visual_props(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzScene* scene = dvz_scene(canvas, 1, 1);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_PANZOOM, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_MARKER, 0);
+
+    // Extra props, not attached to any source, as in visuals with many parameters.
+    for (uint32_t i = 0; i < BENCH_VISUAL_PROPS; i++)
+        dvz_visual_prop(visual, DVZ_PROP_RANGE, i, DVZ_DTYPE_VEC2, DVZ_SOURCE_TYPE_NONE, 0);
+    uint32_t n_props = visual->props.count;
+
+    const uint32_t n = BENCH_VISUAL_ITEMS;
+    dvec3* pos = calloc(n, sizeof(dvec3));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        RANDN_POS(pos[i]);
+    }
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, n, pos);
+    dvz_app_run(app, 1);
+    dvz_gpu_wait(gpu);
+
+    // Lookups of all props.
+    DvzPropType* types = calloc(n_props, sizeof(DvzPropType));
+    uint32_t* idxs = calloc(n_props, sizeof(uint32_t));
+    uint32_t k = 0;
+    DvzContainerIterator iter = dvz_container_iterator(&visual->props);
+    while (iter.item != NULL)
+    {
+        types[k] = ((DvzProp*)iter.item)->prop_type;
+        idxs[k++] = ((DvzProp*)iter.item)->prop_idx;
+        dvz_container_iter(&iter);
+    }
+    double t = bench_now();
+    for (uint32_t r = 0; r < BENCH_VISUAL_REPEATS; r++)
+    {
+        for (uint32_t i = 0; i < n_props; i++)
+            AT(dvz_prop_get(visual, types[i], idxs[i]) != NULL);
+    }
+    double lookup = (bench_now() - t) / (BENCH_VISUAL_REPEATS * n_props);
+
+    // Bake callback.
+    DvzVisualDataEvent ev = {0};
+    t = bench_now();
+    for (uint32_t r = 0; r < BENCH_VISUAL_REPEATS; r++)
+        visual->callback_bake(visual, ev);
+    double bake = (bench_now() - t) / BENCH_VISUAL_REPEATS;
+
+    // Fill callback, recorded many times in the same command buffer.
+    DvzCommands* cmds = &canvas->cmds_render;
+    DvzViewport viewport = dvz_panel_viewport(panel);
+    dvz_visual_fill_begin(canvas, cmds, 0);
+    t = bench_now();
+    for (uint32_t r = 0; r < BENCH_VISUAL_REPEATS; r++)
+        dvz_visual_fill_event(visual, (VkClearColorValue){0}, cmds, 0, viewport, NULL);
+    double fill = (bench_now() - t) / BENCH_VISUAL_REPEATS;
+    dvz_visual_fill_end(canvas, cmds, 0);
+
+    printf(
+        "visual with %d props  lookup %8.2f ns  bake %8.2f us  fill %8.2f us\n", n_props,
+        lookup * 1e9, bake * 1e6, fill * 1e6);
+
+    FREE(types);
+    FREE(idxs);
+    FREE(pos);
+    dvz_scene_destroy(scene);
+    TEST_END
+}
+
+
+
+/*************************************************************************************************/
+/*  Text baking                                                                                  */
+/*************************************************************************************************/
+
+// Bake one label per point for a large scatter plot, one string at a time and in bulk.
+int bench_graphics_text(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzGraphics* graphics = dvz_graphics_builtin(canvas, DVZ_GRAPHICS_TEXT, 0);
+
+    const uint32_t n = BENCH_TEXT_LABELS;
+    char* strings = calloc(n, 16);
+    DvzGraphicsTextItem* items = calloc(n, sizeof(DvzGraphicsTextItem));
+    uint32_t glyph_count = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        snprintf(&strings[16 * i], 16, "pt %d", i);
+        items[i].string = &strings[16 * i];
+        items[i].font_size = 12;
+        RANDN_POS(items[i].vertex.pos);
+        glyph_count += strlen(items[i].string);
+    }
+
+    DvzArray vertices = dvz_array_struct(0, sizeof(DvzGraphicsTextVertex));
+    VkDeviceSize bytes = 4 * glyph_count * sizeof(DvzGraphicsTextVertex);
+    double best = 0, t = 0;
+    for (uint32_t bulk = 0; bulk <= 1; bulk++)
+    {
+        best = 1e9;
+        for (uint32_t r = 0; r < BENCH_ARRAY_REPEATS; r++)
+        {
+            DvzGraphicsData data = dvz_graphics_data(graphics, &vertices, NULL, NULL);
+            t = bench_now();
+            dvz_graphics_alloc(&data, glyph_count);
+            if (bulk)
+                dvz_graphics_append_text(&data, n, items);
+            else
+                for (uint32_t i = 0; i < n; i++)
+                    dvz_graphics_append(&data, &items[i]);
+            best = MIN(best, bench_now() - t);
+            AT(data.current_idx == glyph_count);
+        }
+        printf(
+            "bake %d labels, %d glyphs (%s)  %8.2f ms  %6.2f GB/s\n", n, glyph_count,
+            bulk ? "bulk" : "append", best * 1e3, bytes / best * 1e-9);
+    }
+
+    dvz_array_destroy(&vertices);
+    FREE(items);
+    FREE(strings);
+    TEST_END
+}
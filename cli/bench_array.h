@@ -0,0 +1,20 @@
+#ifndef DVZ_ARRAY_BENCH_HEADER
+#define DVZ_ARRAY_BENCH_HEADER
+
+
+#include "utils.h"
+
+
+
+/*************************************************************************************************/
+/*  Array column copy                                                                            */
+/*************************************************************************************************/
+
+int bench_array_column(TestContext* context);
+int bench_visual_bake(TestContext* context);
+int bench_visual_props(TestContext* context);
+int bench_graphics_text(TestContext* context);
+
+
+
+#endif
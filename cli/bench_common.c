@@ -0,0 +1,204 @@
+#include "bench_common.h"
+#include "../include/datoviz/common.h"
+#include "../include/datoviz/fifo.h"
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define BENCH_FIFO_ITEMS      1000000
+#define BENCH_CONTAINER_ITEMS 100000
+#define BENCH_CONTAINER_ITERS 100
+
+
+
+/*************************************************************************************************/
+/*  FIFO queue                                                                                   */
+/*************************************************************************************************/
+
+typedef struct BenchFifoItem BenchFifoItem;
+typedef struct BenchFifoProducer BenchFifoProducer;
+
+struct BenchFifoItem
+{
+    double enqueued; // time at which the item was enqueued
+};
+
+struct BenchFifoProducer
+{
+    DvzFifo* fifo;
+    uint32_t count;
+    BenchFifoItem* items;
+};
+
+
+
+static void* _fifo_producer(void* arg)
+{
+    BenchFifoProducer* producer = arg;
+    ASSERT(producer != NULL);
+    for (uint32_t i = 0; i < producer->count; i++)
+    {
+        producer->items[i].enqueued = bench_now();
+        dvz_fifo_enqueue(producer->fifo, &producer->items[i]);
+    }
+    return NULL;
+}
+
+
+
+// Run the producers in background threads and consume the items in the calling thread, polling
+// the queue like the frame loop does.
+static void _fifo_run(DvzFifo* fifo, uint32_t n_producers, const char* name)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(n_producers > 0);
+    uint32_t per_producer = BENCH_FIFO_ITEMS / n_producers;
+    uint32_t total = per_producer * n_producers;
+
+    BenchFifoItem* items = calloc(total, sizeof(BenchFifoItem));
+    double* latencies = calloc(total, sizeof(double));
+    BenchFifoProducer* producers = calloc(n_producers, sizeof(BenchFifoProducer));
+    pthread_t* threads = calloc(n_producers, sizeof(pthread_t));
+
+    double start = bench_now();
+    for (uint32_t k = 0; k < n_producers; k++)
+    {
+        producers[k].fifo = fifo;
+        producers[k].count = per_producer;
+        producers[k].items = &items[k * per_producer];
+        pthread_create(&threads[k], NULL, _fifo_producer, &producers[k]);
+    }
+
+    BenchFifoItem* item = NULL;
+    uint32_t received = 0;
+    while (received < total)
+    {
+        item = dvz_fifo_dequeue(fifo, false);
+        if (item == NULL)
+            continue;
+        latencies[received++] = bench_now() - item->enqueued;
+    }
+    double elapsed = bench_now() - start;
+    for (uint32_t k = 0; k < n_producers; k++)
+        pthread_join(threads[k], NULL);
+
+    qsort(latencies, total, sizeof(double), compare_double);
+    printf(
+        "%-6s %2d producer(s)  %8.2f Mitems/s   latency p50 %8.2f us   p99 %8.2f us\n", //
+        name, n_producers, total / elapsed * 1e-6, latencies[total / 2] * 1e6,
+        latencies[(uint32_t)(.99 * (total - 1))] * 1e6);
+
+    FREE(threads);
+    FREE(producers);
+    FREE(latencies);
+    FREE(items);
+}
+
+
+
+int bench_fifo(TestContext* context)
+{
+    uint32_t producers[] = {1, 2, 8};
+    DvzFifo fifo = {0};
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        fifo = dvz_fifo(DVZ_MAX_FIFO_CAPACITY);
+        _fifo_run(&fifo, producers[i], "mutex");
+        dvz_fifo_destroy(&fifo);
+
+        if (producers[i] == 1)
+        {
+            fifo = dvz_fifo_lockfree(DVZ_MAX_FIFO_CAPACITY, DVZ_FIFO_MODE_SPSC);
+            _fifo_run(&fifo, producers[i], "spsc");
+            dvz_fifo_destroy(&fifo);
+        }
+
+        fifo = dvz_fifo_lockfree(DVZ_MAX_FIFO_CAPACITY, DVZ_FIFO_MODE_MPSC);
+        _fifo_run(&fifo, producers[i], "mpsc");
+        dvz_fifo_destroy(&fifo);
+    }
+    return 0;
+}
+
+
+
+/*************************************************************************************************/
+/*  Container                                                                                    */
+/*************************************************************************************************/
+
+typedef struct BenchContainerItem BenchContainerItem;
+
+struct BenchContainerItem
+{
+    DvzObject obj;
+    double value;
+};
+
+
+
+int bench_container(TestContext* context)
+{
+    const uint32_t n = BENCH_CONTAINER_ITEMS;
+    DvzContainer container = dvz_container(1, sizeof(BenchContainerItem), 0);
+    BenchContainerItem** items = calloc(n, sizeof(BenchContainerItem*));
+
+    // Allocation, with the resizes.
+    double start = bench_now();
+    for (uint32_t i = 0; i < n; i++)
+    {
+        items[i] = dvz_container_alloc(&container);
+        items[i]->value = i;
+        dvz_obj_created(&items[i]->obj);
+    }
+    double elapsed = bench_now() - start;
+    printf("alloc    %8.2f ns/item\n", elapsed / n * 1e9);
+
+    // Iteration over all items, as in the per-frame loops.
+    double sum = 0;
+    start = bench_now();
+    for (uint32_t k = 0; k < BENCH_CONTAINER_ITERS; k++)
+    {
+        DvzContainerIterator iter = dvz_container_iterator(&container);
+        while (iter.item != NULL)
+        {
+            sum += ((BenchContainerItem*)iter.item)->value;
+            dvz_container_iter(&iter);
+        }
+    }
+    elapsed = bench_now() - start;
+    printf("iter     %8.2f ns/item\n", elapsed / (n * BENCH_CONTAINER_ITERS) * 1e9);
+    AT(sum == BENCH_CONTAINER_ITERS * .5 * n * (n - 1));
+
+    // Churn: destroy one object and allocate a new one, with a full container.
+    start = bench_now();
+    uint32_t j = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        j = (i * 7919) % n;
+        dvz_obj_destroyed(&items[j]->obj);
+        items[j] = dvz_container_alloc(&container);
+        dvz_obj_created(&items[j]->obj);
+    }
+    elapsed = bench_now() - start;
+    printf("churn    %8.2f ns/item   capacity %d\n", elapsed / n * 1e9, container.capacity);
+
+    // The iteration frees the memory of the destroyed objects that have not been reused.
+    uint32_t count = 0;
+    DvzContainerIterator iter = dvz_container_iterator(&container);
+    while (iter.item != NULL)
+    {
+        count++;
+        dvz_container_iter(&iter);
+    }
+    AT(count == n);
+    AT(container.count == n);
+
+    for (uint32_t i = 0; i < n; i++)
+        dvz_obj_destroyed(&items[i]->obj);
+    dvz_container_destroy(&container);
+    FREE(items);
+    return 0;
+}
@@ -0,0 +1,25 @@
+#ifndef DVZ_COMMON_BENCH_HEADER
+#define DVZ_COMMON_BENCH_HEADER
+
+
+#include "utils.h"
+
+
+
+/*************************************************************************************************/
+/*  FIFO queue                                                                                   */
+/*************************************************************************************************/
+
+int bench_fifo(TestContext* context);
+
+
+
+/*************************************************************************************************/
+/*  Container                                                                                    */
+/*************************************************************************************************/
+
+int bench_container(TestContext* context);
+
+
+
+#endif
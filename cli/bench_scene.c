@@ -0,0 +1,432 @@
+#include "bench_scene.h"
+#include "../include/datoviz/builtin_visuals.h"
+#include "../include/datoviz/scene.h"
+
+#if !OS_WIN32
+#include <sys/resource.h>
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define BENCH_SCENE_WIDTH  1920
+#define BENCH_SCENE_HEIGHT 1080
+#define BENCH_SCENE_FRAMES 100
+
+#define BENCH_SCENE_POINTS      10000000
+#define BENCH_SCENE_PATHS       100
+#define BENCH_SCENE_SEGMENTS    1000000
+#define BENCH_SCENE_IMAGE_W     3840
+#define BENCH_SCENE_IMAGE_H     2160
+#define BENCH_SCENE_VOLUME      256
+#define BENCH_SCENE_GRID        8
+#define BENCH_SCENE_GRID_POINTS 10000
+
+static const char* PHASE_NAMES[] = {"frame", "events", "scene", "transfers", "refill", "submit"};
+
+
+
+/*************************************************************************************************/
+/*  Utils                                                                                        */
+/*************************************************************************************************/
+
+typedef struct BenchScene BenchScene;
+
+struct BenchScene
+{
+    DvzApp* app;
+    DvzGpu* gpu;
+    DvzCanvas* canvas;
+    DvzScene* scene;
+};
+
+
+
+// Number of frames to render, from the DVZ_BENCH_FRAMES environment variable.
+static uint32_t _bench_frames(void)
+{
+    const char* env = getenv("DVZ_BENCH_FRAMES");
+    int frames = env != NULL ? atoi(env) : 0;
+    return frames > 0 ? (uint32_t)frames : BENCH_SCENE_FRAMES;
+}
+
+
+
+// Scale a scene size by the DVZ_BENCH_SCALE factor, to run the suite on slow software drivers.
+static uint32_t _bench_scale(uint32_t n)
+{
+    const char* env = getenv("DVZ_BENCH_SCALE");
+    double scale = env != NULL ? atof(env) : 1;
+    if (scale <= 0)
+        scale = 1;
+    return MAX(1, (uint32_t)round(n * scale));
+}
+
+
+
+// Peak resident memory of the process, in bytes. Each benchmark runs in its own process, see
+// bench() in main.c.
+static double _bench_peak_memory(void)
+{
+#if OS_WIN32
+    return 0;
+#else
+    struct rusage usage = {0};
+    getrusage(RUSAGE_SELF, &usage);
+#if OS_MACOS
+    return usage.ru_maxrss;
+#else
+    return usage.ru_maxrss * 1024.0;
+#endif
+#endif
+}
+
+
+
+static double _percentile(double* sorted, uint32_t n, double q)
+{
+    ASSERT(sorted != NULL);
+    ASSERT(n > 0);
+    return sorted[(uint32_t)round(q * (n - 1))];
+}
+
+
+
+static BenchScene _bench_scene(uint32_t n_rows, uint32_t n_cols)
+{
+    BenchScene bs = {0};
+    bs.app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    bs.gpu = dvz_gpu(bs.app, 0);
+    bs.canvas = dvz_canvas(bs.gpu, BENCH_SCENE_WIDTH, BENCH_SCENE_HEIGHT, 0);
+    bs.scene = dvz_scene(bs.canvas, n_rows, n_cols);
+    return bs;
+}
+
+
+
+// Release the scene of a benchmark whose data could not be allocated, which may happen with a
+// large DVZ_BENCH_SCALE.
+static int _bench_scene_abort(BenchScene* bs, uint32_t items)
+{
+    ASSERT(bs != NULL);
+    log_error("unable to allocate the data of %d items", items);
+    dvz_scene_destroy(bs->scene);
+    dvz_app_destroy(bs->app);
+    return 1;
+}
+
+
+
+static void _bench_json(
+    FILE* f, const char* name, BenchScene* bs, uint32_t items, //
+    uint32_t frames, double first, double* times, double* phases)
+{
+    double mean = 0;
+    for (uint32_t i = 0; i < frames; i++)
+        mean += times[i];
+    mean /= frames;
+
+    fprintf(f, "{\"name\": \"%s\", ", name);
+    fprintf(f, "\"gpu\": \"%s\", ", bs->gpu->device_properties.deviceName);
+    fprintf(
+        f, "\"width\": %d, \"height\": %d, \"items\": %d, \"frames\": %d, ", //
+        BENCH_SCENE_WIDTH, BENCH_SCENE_HEIGHT, items, frames);
+    fprintf(f, "\"first_frame_ms\": %.3f, ", first * 1e3);
+    fprintf(
+        f,
+        "\"frame_ms\": {\"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, "
+        "\"max\": %.3f}, ",
+        mean * 1e3, _percentile(times, frames, .5) * 1e3, _percentile(times, frames, .9) * 1e3,
+        _percentile(times, frames, .99) * 1e3, times[frames - 1] * 1e3);
+    fprintf(f, "\"phase_ms\": {");
+    for (uint32_t k = 0; k < DVZ_FRAME_PHASE_COUNT; k++)
+        fprintf(
+            f, "\"%s\": %.3f%s", PHASE_NAMES[k], phases[k] / frames * 1e3,
+            k < DVZ_FRAME_PHASE_COUNT - 1 ? ", " : "");
+    fprintf(f, "}, \"peak_memory_mb\": %.1f}\n", _bench_peak_memory() / (1024.0 * 1024.0));
+}
+
+
+
+// Render the scene for a fixed number of frames and report the frame time percentiles, the mean
+// CPU time of each frame phase, and the peak memory. The first frame, which uploads the data and
+// records all command buffers, is reported separately.
+static int _bench_scene_run(BenchScene* bs, const char* name, uint32_t items)
+{
+    ASSERT(bs != NULL);
+    ASSERT(bs->canvas != NULL);
+    DvzCanvas* canvas = bs->canvas;
+
+    uint32_t frames = _bench_frames();
+    double* times = calloc(frames, sizeof(double));
+    double phases[DVZ_FRAME_PHASE_COUNT] = {0};
+
+    double t = bench_now();
+    dvz_app_run(bs->app, 1);
+    double first = bench_now() - t;
+
+    for (uint32_t i = 0; i < frames; i++)
+    {
+        t = bench_now();
+        dvz_app_run(bs->app, 1);
+        times[i] = bench_now() - t;
+        for (uint32_t k = 0; k < DVZ_FRAME_PHASE_COUNT; k++)
+            phases[k] += canvas->phase_time[k];
+    }
+    qsort(times, frames, sizeof(double), compare_double);
+
+    _bench_json(stdout, name, bs, items, frames, first, times, phases);
+
+    // Append the results to a JSON Lines file.
+    const char* path = getenv("DVZ_BENCH_JSON");
+    if (path != NULL)
+    {
+        FILE* f = fopen(path, "a");
+        if (f != NULL)
+        {
+            _bench_json(f, name, bs, items, frames, first, times, phases);
+            fclose(f);
+        }
+        else
+            log_error("unable to open %s", path);
+    }
+
+    FREE(times);
+    dvz_scene_destroy(bs->scene);
+    return dvz_app_destroy(bs->app);
+}
+
+
+
+/*************************************************************************************************/
+/*  Scene benchmarks                                                                             */
+/*************************************************************************************************/
+
+int bench_scene_points(TestContext* context)
+{
+    BenchScene bs = _bench_scene(1, 1);
+    DvzPanel* panel = dvz_scene_panel(bs.scene, 0, 0, DVZ_CONTROLLER_PANZOOM, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+
+    const uint32_t n = _bench_scale(BENCH_SCENE_POINTS);
+    dvec3* pos = calloc(n, sizeof(dvec3));
+    cvec4* color = calloc(n, sizeof(cvec4));
+    if (pos == NULL || color == NULL)
+    {
+        FREE(pos);
+        FREE(color);
+        return _bench_scene_abort(&bs, n);
+    }
+    for (uint32_t i = 0; i < n; i++)
+    {
+        RANDN_POS(pos[i]);
+        RAND_COLOR(color[i]);
+    }
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, n, pos);
+    dvz_visual_data(visual, DVZ_PROP_COLOR, 0, n, color);
+    dvz_visual_data(visual, DVZ_PROP_MARKER_SIZE, 0, 1, (float[]){2});
+
+    int res = _bench_scene_run(&bs, "scene_points", n);
+    FREE(pos);
+    FREE(color);
+    return res;
+}
+
+
+
+// Same scene, with float32 positions and colors interleaved in an external buffer borrowed by
+// the props instead of being copied. Compare the peak memory with bench_scene_points on 100M
+// points with `DVZ_BENCH_SCALE=10 ./datoviz bench scene_points`, which runs both benchmarks, each
+// in its own process.
+int bench_scene_points_borrow(TestContext* context)
+{
+    BenchScene bs = _bench_scene(1, 1);
+    DvzPanel* panel = dvz_scene_panel(bs.scene, 0, 0, DVZ_CONTROLLER_PANZOOM, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+
+    typedef struct
+    {
+        vec3 pos;
+        cvec4 color;
+    } _point;
+
+    const uint32_t n = _bench_scale(BENCH_SCENE_POINTS);
+    _point* points = calloc(n, sizeof(_point));
+    if (points == NULL)
+        return _bench_scene_abort(&bs, n);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        RANDN_POS(points[i].pos);
+        RAND_COLOR(points[i].color);
+    }
+    dvz_visual_data_borrow(
+        visual, DVZ_PROP_POS, 0, n, DVZ_DTYPE_VEC3, sizeof(_point), points[0].pos, NULL, NULL);
+    dvz_visual_data_borrow(
+        visual, DVZ_PROP_COLOR, 0, n, DVZ_DTYPE_CVEC4, sizeof(_point), points[0].color, NULL,
+        NULL);
+    dvz_visual_data(visual, DVZ_PROP_MARKER_SIZE, 0, 1, (float[]){2});
+
+    int res = _bench_scene_run(&bs, "scene_points_borrow", n);
+    FREE(points);
+    return res;
+}
+
+
+
+int bench_scene_paths(TestContext* context)
+{
+    BenchScene bs = _bench_scene(1, 1);
+    DvzPanel* panel = dvz_scene_panel(bs.scene, 0, 0, DVZ_CONTROLLER_PANZOOM, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_PATH, 0);
+
+    const uint32_t n_paths = BENCH_SCENE_PATHS;
+    const uint32_t n_points = MAX(2, _bench_scale(BENCH_SCENE_SEGMENTS) / n_paths + 1);
+    const uint32_t n = n_paths * n_points;
+    dvec3* points = calloc(n, sizeof(dvec3));
+    cvec4* colors = calloc(n, sizeof(cvec4));
+    uint32_t* lengths = calloc(n_paths, sizeof(uint32_t));
+    double t = 0, h = 0;
+    uint32_t k = 0;
+    for (uint32_t i = 0; i < n_paths; i++)
+    {
+        h = -.9 + 1.8 * i / (double)(n_paths - 1);
+        lengths[i] = n_points;
+        for (uint32_t j = 0; j < n_points; j++)
+        {
+            t = -1 + 2 * j / (double)(n_points - 1);
+            points[k][0] = .9 * t;
+            points[k][1] = h + .02 * dvz_rand_normal();
+            dvz_colormap_scale(DVZ_CMAP_VIRIDIS, i, 0, n_paths - 1, colors[k]);
+            k++;
+        }
+    }
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, n, points);
+    dvz_visual_data(visual, DVZ_PROP_COLOR, 0, n, colors);
+    dvz_visual_data(visual, DVZ_PROP_LENGTH, 0, n_paths, lengths);
+    dvz_visual_data(visual, DVZ_PROP_LINE_WIDTH, 0, 1, (float[]){2});
+
+    int res = _bench_scene_run(&bs, "scene_paths", n - n_paths);
+    FREE(points);
+    FREE(colors);
+    FREE(lengths);
+    return res;
+}
+
+
+
+int bench_scene_image(TestContext* context)
+{
+    BenchScene bs = _bench_scene(1, 1);
+    DvzPanel* panel = dvz_scene_panel(bs.scene, 0, 0, DVZ_CONTROLLER_PANZOOM, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_IMAGE, 0);
+
+    // Top left, top right, bottom right, bottom left
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, 1, (dvec3[]){{-1, +1, 0}});
+    dvz_visual_data(visual, DVZ_PROP_POS, 1, 1, (dvec3[]){{+1, +1, 0}});
+    dvz_visual_data(visual, DVZ_PROP_POS, 2, 1, (dvec3[]){{+1, -1, 0}});
+    dvz_visual_data(visual, DVZ_PROP_POS, 3, 1, (dvec3[]){{-1, -1, 0}});
+    dvz_visual_data(visual, DVZ_PROP_TEXCOORDS, 0, 1, (vec2[]){{0, 0}});
+    dvz_visual_data(visual, DVZ_PROP_TEXCOORDS, 1, 1, (vec2[]){{1, 0}});
+    dvz_visual_data(visual, DVZ_PROP_TEXCOORDS, 2, 1, (vec2[]){{1, 1}});
+    dvz_visual_data(visual, DVZ_PROP_TEXCOORDS, 3, 1, (vec2[]){{0, 1}});
+
+    const uint32_t width = BENCH_SCENE_IMAGE_W, height = BENCH_SCENE_IMAGE_H;
+    const VkDeviceSize size = width * height * sizeof(cvec4);
+    uint8_t* pixels = calloc(size, 1);
+    for (VkDeviceSize i = 0; i < size; i++)
+        pixels[i] = dvz_rand_byte();
+    DvzTexture* texture = dvz_ctx_texture(
+        bs.gpu->context, 2, (uvec3){width, height, 1}, VK_FORMAT_R8G8B8A8_UNORM);
+    dvz_upload_texture(bs.canvas, texture, DVZ_ZERO_OFFSET, DVZ_ZERO_OFFSET, size, pixels);
+    dvz_visual_texture(visual, DVZ_SOURCE_TYPE_IMAGE, 0, texture);
+
+    int res = _bench_scene_run(&bs, "scene_image", width * height);
+    FREE(pixels);
+    return res;
+}
+
+
+
+int bench_scene_volume(TestContext* context)
+{
+    BenchScene bs = _bench_scene(1, 1);
+    DvzPanel* panel = dvz_scene_panel(bs.scene, 0, 0, DVZ_CONTROLLER_ARCBALL, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_VOLUME, 0);
+
+    const uint32_t n = _bench_scale(BENCH_SCENE_VOLUME);
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, 1, (dvec3[]){{-.5, -.5, -.5}});
+    dvz_visual_data(visual, DVZ_PROP_POS, 1, 1, (dvec3[]){{+.5, +.5, +.5}});
+    dvz_visual_data(visual, DVZ_PROP_TEXCOORDS, 0, 1, (vec3[]){{0, 0, 0}});
+    dvz_visual_data(visual, DVZ_PROP_TEXCOORDS, 1, 1, (vec3[]){{1, 1, 1}});
+    dvz_visual_data(visual, DVZ_PROP_LENGTH, 0, 1, (vec3[]){{1, 1, 1}});
+    dvz_visual_data(visual, DVZ_PROP_COLORMAP, 0, 1, (DvzColormap[]){DVZ_CMAP_BONE});
+
+    // Concentric shells.
+    const VkDeviceSize count = (VkDeviceSize)n * n * n;
+    uint16_t* voxels = calloc(count, sizeof(uint16_t));
+    double x = 0, y = 0, z = 0;
+    VkDeviceSize idx = 0;
+    for (uint32_t k = 0; k < n; k++)
+    {
+        for (uint32_t j = 0; j < n; j++)
+        {
+            for (uint32_t i = 0; i < n; i++)
+            {
+                x = i / (double)n - .5, y = j / (double)n - .5, z = k / (double)n - .5;
+                voxels[idx++] = (uint16_t)(32767.5 * (1 + cos(40 * sqrt(x * x + y * y + z * z))));
+            }
+        }
+    }
+    DvzTexture* texture =
+        dvz_ctx_texture(bs.gpu->context, 3, (uvec3){n, n, n}, VK_FORMAT_R16_UNORM);
+    dvz_texture_filter(texture, DVZ_FILTER_MAG, VK_FILTER_LINEAR);
+    dvz_upload_texture(
+        bs.canvas, texture, DVZ_ZERO_OFFSET, DVZ_ZERO_OFFSET, count * sizeof(uint16_t), voxels);
+    dvz_visual_texture(
+        visual, DVZ_SOURCE_TYPE_COLOR_TEXTURE, 0, bs.gpu->context->color_texture.texture);
+    dvz_visual_texture(visual, DVZ_SOURCE_TYPE_VOLUME, 0, texture);
+
+    int res = _bench_scene_run(&bs, "scene_volume", (uint32_t)count);
+    FREE(voxels);
+    return res;
+}
+
+
+
+int bench_scene_grid(TestContext* context)
+{
+    const uint32_t n_rows = BENCH_SCENE_GRID, n_cols = BENCH_SCENE_GRID;
+    BenchScene bs = _bench_scene(n_rows, n_cols);
+
+    const uint32_t n = _bench_scale(BENCH_SCENE_GRID_POINTS);
+    dvec3* pos = calloc(n, sizeof(dvec3));
+    cvec4* color = calloc(n, sizeof(cvec4));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        RANDN_POS(pos[i]);
+        RAND_COLOR(color[i]);
+    }
+
+    // One panel with 2D axes and a marker visual per grid cell.
+    DvzPanel* panel = NULL;
+    DvzVisual* visual = NULL;
+    for (uint32_t i = 0; i < n_rows; i++)
+    {
+        for (uint32_t j = 0; j < n_cols; j++)
+        {
+            panel = dvz_scene_panel(bs.scene, i, j, DVZ_CONTROLLER_AXES_2D, 0);
+            visual = dvz_scene_visual(panel, DVZ_VISUAL_MARKER, 0);
+            dvz_visual_data(visual, DVZ_PROP_POS, 0, n, pos);
+            dvz_visual_data(visual, DVZ_PROP_COLOR, 0, n, color);
+            dvz_visual_data(visual, DVZ_PROP_MARKER_SIZE, 0, 1, (float[]){5});
+        }
+    }
+
+    int res = _bench_scene_run(&bs, "scene_grid", n_rows * n_cols * n);
+    FREE(pos);
+    FREE(color);
+    return res;
+}
@@ -0,0 +1,27 @@
+#ifndef DVZ_SCENE_BENCH_HEADER
+#define DVZ_SCENE_BENCH_HEADER
+
+
+#include "utils.h"
+
+
+
+/*************************************************************************************************/
+/*  Headless scene benchmarks                                                                    */
+/*************************************************************************************************/
+
+int bench_scene_points(TestContext* context);
+
+int bench_scene_points_borrow(TestContext* context);
+
+int bench_scene_paths(TestContext* context);
+
+int bench_scene_image(TestContext* context);
+
+int bench_scene_volume(TestContext* context);
+
+int bench_scene_grid(TestContext* context);
+
+
+
+#endif
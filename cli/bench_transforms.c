@@ -0,0 +1,112 @@
+#include "bench_transforms.h"
+#include "../include/datoviz/transforms.h"
+#include "../src/transforms_utils.h"
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define BENCH_TRANSFORMS_REPEATS 3
+
+
+
+/*************************************************************************************************/
+/*  Data normalization                                                                           */
+/*************************************************************************************************/
+
+static const char* SIMD_NAMES[] = {"scalar", "sse2", "avx2"};
+
+// Previous implementation: new output array, per-item matrix transform, and a separate
+// bounding box pass.
+static DvzBox _transform_pos_baseline(DvzBox box, DvzArray* pos_in, DvzArray* pos_out)
+{
+    *pos_out = dvz_array(pos_in->item_count, pos_in->dtype);
+    DvzTransform tr = _transform_interp(box, DVZ_BOX_NDC);
+    _transform_array(&tr, pos_in, pos_out);
+
+    DvzBox bounds = DVZ_BOX_INF;
+    dvec3* pos = NULL;
+    for (uint32_t i = 0; i < pos_in->item_count; i++)
+    {
+        pos = (dvec3*)dvz_array_item(pos_in, i);
+        for (uint32_t j = 0; j < 3; j++)
+        {
+            bounds.p0[j] = MIN(bounds.p0[j], (*pos)[j]);
+            bounds.p1[j] = MAX(bounds.p1[j], (*pos)[j]);
+        }
+    }
+    return bounds;
+}
+
+
+
+static void _print_run(const char* name, uint32_t n, VkDeviceSize bytes, double best)
+{
+    printf(
+        "%-28s %9d points  %8.2f ms  %8.1f Mpts/s  %6.2f GB/s\n", name, n, best * 1e3,
+        n / best * 1e-6, bytes / best * 1e-9);
+}
+
+
+
+int bench_transform_pos(TestContext* context)
+{
+    DvzWorkers workers = dvz_workers(0);
+    DvzSimdLevel max_level = dvz_simd_level();
+    DvzBox box = {{-1, -1, -1}, {1, 1, 1}};
+    char name[64] = {0};
+    double best = 0, t = 0;
+
+    for (uint32_t n = 1000000; n <= 100000000; n *= 10)
+    {
+        DvzArray pos_in = dvz_array(n, DVZ_DTYPE_DVEC3);
+        dvec3* pos = (dvec3*)pos_in.data;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            RANDN_POS(pos[i]);
+        }
+        DvzArray pos_out = {0};
+        // Bytes read and written.
+        VkDeviceSize bytes = 2 * (VkDeviceSize)n * sizeof(dvec3);
+
+        // Previous implementation.
+        best = 1e9;
+        for (uint32_t r = 0; r < BENCH_TRANSFORMS_REPEATS; r++)
+        {
+            t = bench_now();
+            _transform_pos_baseline(box, &pos_in, &pos_out);
+            best = MIN(best, bench_now() - t);
+            dvz_array_destroy(&pos_out);
+        }
+        _print_run("baseline", n, bytes, best);
+
+        // Fused kernel, reusing the output array, for each SIMD level and thread count.
+        for (int32_t level = 0; level <= (int32_t)max_level; level++)
+        {
+            dvz_simd_set_level((DvzSimdLevel)level);
+            for (uint32_t threads = 1; threads <= workers.thread_count; threads *= 2)
+            {
+                dvz_workers_resize(&workers, threads);
+                best = 1e9;
+                for (uint32_t r = 0; r < BENCH_TRANSFORMS_REPEATS; r++)
+                {
+                    t = bench_now();
+                    dvz_transform_normalize(&workers, box, &pos_in, &pos_out);
+                    best = MIN(best, bench_now() - t);
+                }
+                snprintf(name, sizeof(name), "fused %s, %d threads", SIMD_NAMES[level], threads);
+                _print_run(name, n, bytes, best);
+            }
+            dvz_workers_resize(&workers, 0);
+        }
+        dvz_simd_set_level(max_level);
+
+        dvz_array_destroy(&pos_in);
+        dvz_array_destroy(&pos_out);
+    }
+
+    dvz_workers_destroy(&workers);
+    return 0;
+}
@@ -0,0 +1,17 @@
+#ifndef DVZ_TRANSFORMS_BENCH_HEADER
+#define DVZ_TRANSFORMS_BENCH_HEADER
+
+
+#include "utils.h"
+
+
+
+/*************************************************************************************************/
+/*  Data normalization                                                                           */
+/*************************************************************************************************/
+
+int bench_transform_pos(TestContext* context);
+
+
+
+#endif
@@ -1,6 +1,13 @@
 #include <datoviz/datoviz.h>
 #include <unistd.h>
+#if !OS_WIN32
+#include <sys/wait.h>
+#endif
 
+#include "bench_array.h"
+#include "bench_common.h"
+#include "bench_scene.h"
+#include "bench_transforms.h"
 #include "test_array.h"
 #include "test_builtin_visuals.h"
 #include "test_canvas.h"
@@ -24,6 +31,8 @@ static TestCase TEST_CASES[] = {
 
     // common tests
     CASE_FIXTURE_NONE(test_container),
+    CASE_FIXTURE_NONE(test_hash_table),
+    CASE_FIXTURE_NONE(test_alloc),
 
     // vklite2
     CASE_FIXTURE_NONE(test_vklite_app),            //
@@ -33,6 +42,7 @@ static TestCase TEST_CASES[] = {
     CASE_FIXTURE_NONE(test_vklite_commands),       //
     CASE_FIXTURE_NONE(test_vklite_buffer_1),       //
     CASE_FIXTURE_NONE(test_vklite_buffer_resize),  //
+    CASE_FIXTURE_NONE(test_vklite_memory),         //
     CASE_FIXTURE_NONE(test_vklite_compute),        //
     CASE_FIXTURE_NONE(test_vklite_push),           //
     CASE_FIXTURE_NONE(test_vklite_images),         //
@@ -46,33 +56,42 @@ static TestCase TEST_CASES[] = {
     CASE_FIXTURE_NONE(test_shader_compile),        //
 
     // context
-    CASE_FIXTURE_NONE(test_fifo_1),      //
-    CASE_FIXTURE_NONE(test_fifo_2),      //
-    CASE_FIXTURE_NONE(test_fifo_3),      //
-    CASE_FIXTURE_NONE(test_default_app), //
+    CASE_FIXTURE_NONE(test_fifo_1),                //
+    CASE_FIXTURE_NONE(test_fifo_2),                //
+    CASE_FIXTURE_NONE(test_fifo_3),                //
+    CASE_FIXTURE_NONE(test_fifo_lockfree),         //
+    CASE_FIXTURE_NONE(test_default_app),           //
+    CASE_FIXTURE_NONE(test_context_buffers_churn), //
 
     // canvas
-    CASE_FIXTURE_NONE(test_canvas_transfer_buffer),  //
-    CASE_FIXTURE_NONE(test_canvas_transfer_texture), //
-    CASE_FIXTURE_NONE(test_canvas_1),                //
-    CASE_FIXTURE_NONE(test_canvas_2),                //
-    CASE_FIXTURE_NONE(test_canvas_3),                //
-    CASE_FIXTURE_NONE(test_canvas_4),                //
-    CASE_FIXTURE_NONE(test_canvas_5),                //
-    CASE_FIXTURE_NONE(test_canvas_6),                //
-    CASE_FIXTURE_NONE(test_canvas_7),                //
-    CASE_FIXTURE_NONE(test_canvas_8),                //
-    CASE_FIXTURE_NONE(test_canvas_depth),            //
-    CASE_FIXTURE_NONE(test_canvas_append),           //
-    CASE_FIXTURE_NONE(test_canvas_particles),        //
-    CASE_FIXTURE_NONE(test_canvas_offscreen),        //
-    CASE_FIXTURE_NONE(test_canvas_gui_1),            //
-    CASE_FIXTURE_NONE(test_canvas_screencast),       //
+    CASE_FIXTURE_NONE(test_canvas_transfer_buffer),     //
+    CASE_FIXTURE_NONE(test_canvas_transfer_texture),    //
+    CASE_FIXTURE_NONE(test_canvas_transfer_staging),    //
+    CASE_FIXTURE_NONE(test_canvas_transfer_coalesce),   //
+    CASE_FIXTURE_NONE(test_canvas_1),                   //
+    CASE_FIXTURE_NONE(test_canvas_2),                   //
+    CASE_FIXTURE_NONE(test_canvas_3),                   //
+    CASE_FIXTURE_NONE(test_canvas_4),                   //
+    CASE_FIXTURE_NONE(test_canvas_5),                   //
+    CASE_FIXTURE_NONE(test_canvas_6),                   //
+    CASE_FIXTURE_NONE(test_canvas_7),                   //
+    CASE_FIXTURE_NONE(test_canvas_8),                   //
+    CASE_FIXTURE_NONE(test_canvas_depth),               //
+    CASE_FIXTURE_NONE(test_canvas_append),              //
+    CASE_FIXTURE_NONE(test_canvas_particles),           //
+    CASE_FIXTURE_NONE(test_canvas_offscreen),           //
+    CASE_FIXTURE_NONE(test_canvas_gui_1),               //
+    CASE_FIXTURE_NONE(test_canvas_screencast),          //
+    CASE_FIXTURE_NONE(test_canvas_screencast_readback), //
+    CASE_FIXTURE_NONE(test_canvas_video),               //
+    CASE_FIXTURE_NONE(test_canvas_profile),             //
 
     // graphics
-    CASE_FIXTURE_NONE(test_graphics_dynamic), //
-    CASE_FIXTURE_NONE(test_graphics_3D),      //
-    CASE_FIXTURE_NONE(test_graphics_depth),   //
+    CASE_FIXTURE_NONE(test_graphics_dynamic),        //
+    CASE_FIXTURE_NONE(test_graphics_3D),             //
+    CASE_FIXTURE_NONE(test_graphics_depth),          //
+    CASE_FIXTURE_NONE(test_graphics_pipeline_cache), //
+    CASE_FIXTURE_NONE(test_graphics_registry),       //
 
     CASE_FIXTURE_NONE(test_graphics_point),          //
     CASE_FIXTURE_NONE(test_graphics_line),           //
@@ -89,41 +108,51 @@ static TestCase TEST_CASES[] = {
     // generate marker screenshots:
     CASE_FIXTURE_NONE(test_graphics_marker_screenshots), //
 
-    CASE_FIXTURE_NONE(test_graphics_segment),    //
-    CASE_FIXTURE_NONE(test_graphics_path),       //
-    CASE_FIXTURE_NONE(test_graphics_text),       //
-    CASE_FIXTURE_NONE(test_graphics_image_1),    //
-    CASE_FIXTURE_NONE(test_graphics_image_cmap), //
+    CASE_FIXTURE_NONE(test_graphics_segment),     //
+    CASE_FIXTURE_NONE(test_graphics_path),        //
+    CASE_FIXTURE_NONE(test_graphics_text),        //
+    CASE_FIXTURE_NONE(test_graphics_text_bulk),   //
+    CASE_FIXTURE_NONE(test_graphics_glyph_atlas), //
+    CASE_FIXTURE_NONE(test_graphics_image_1),     //
+    CASE_FIXTURE_NONE(test_graphics_image_cmap),  //
 
     CASE_FIXTURE_NONE(test_graphics_volume_1),     //
     CASE_FIXTURE_NONE(test_graphics_volume_slice), //
     CASE_FIXTURE_NONE(test_graphics_mesh),         //
 
     // transforms
-    CASE_FIXTURE_NONE(test_transforms_1), //
-    CASE_FIXTURE_NONE(test_transforms_2), //
-    CASE_FIXTURE_NONE(test_transforms_3), //
-    CASE_FIXTURE_NONE(test_transforms_4), //
-    CASE_FIXTURE_NONE(test_transforms_5), //
+    CASE_FIXTURE_NONE(test_transforms_1),         //
+    CASE_FIXTURE_NONE(test_transforms_2),         //
+    CASE_FIXTURE_NONE(test_transforms_3),         //
+    CASE_FIXTURE_NONE(test_transforms_4),         //
+    CASE_FIXTURE_NONE(test_transforms_5),         //
+    CASE_FIXTURE_NONE(test_transforms_normalize), //
+    CASE_FIXTURE_NONE(test_transforms_split),     //
 
     // array
-    CASE_FIXTURE_NONE(test_array_1),    //
-    CASE_FIXTURE_NONE(test_array_2),    //
-    CASE_FIXTURE_NONE(test_array_3),    //
-    CASE_FIXTURE_NONE(test_array_4),    //
-    CASE_FIXTURE_NONE(test_array_5),    //
-    CASE_FIXTURE_NONE(test_array_6),    //
-    CASE_FIXTURE_NONE(test_array_7),    //
-    CASE_FIXTURE_NONE(test_array_cast), //
-    CASE_FIXTURE_NONE(test_array_mvp),  //
-    CASE_FIXTURE_NONE(test_array_3D),   //
+    CASE_FIXTURE_NONE(test_array_1),           //
+    CASE_FIXTURE_NONE(test_array_2),           //
+    CASE_FIXTURE_NONE(test_array_3),           //
+    CASE_FIXTURE_NONE(test_array_4),           //
+    CASE_FIXTURE_NONE(test_array_5),           //
+    CASE_FIXTURE_NONE(test_array_6),           //
+    CASE_FIXTURE_NONE(test_array_7),           //
+    CASE_FIXTURE_NONE(test_array_cast),        //
+    CASE_FIXTURE_NONE(test_array_column_simd), //
+    CASE_FIXTURE_NONE(test_array_pixels),      //
+    CASE_FIXTURE_NONE(test_array_mvp),         //
+    CASE_FIXTURE_NONE(test_array_borrow),      //
+    CASE_FIXTURE_NONE(test_array_3D),          //
 
     // visuals
-    CASE_FIXTURE_NONE(test_visuals_1), //
-    CASE_FIXTURE_NONE(test_visuals_2), //
-    CASE_FIXTURE_NONE(test_visuals_3), //
-    CASE_FIXTURE_NONE(test_visuals_4), //
-    CASE_FIXTURE_NONE(test_visuals_5), //
+    CASE_FIXTURE_NONE(test_visuals_1),            //
+    CASE_FIXTURE_NONE(test_visuals_2),            //
+    CASE_FIXTURE_NONE(test_visuals_3),            //
+    CASE_FIXTURE_NONE(test_visuals_4),            //
+    CASE_FIXTURE_NONE(test_visuals_5),            //
+    CASE_FIXTURE_NONE(test_visuals_bake_threads), //
+    CASE_FIXTURE_NONE(test_visuals_lookup),       //
+    CASE_FIXTURE_NONE(test_visuals_stream),       //
 
     // interact
     CASE_FIXTURE_NONE(test_interact_1),       //
@@ -160,19 +189,57 @@ static TestCase TEST_CASES[] = {
     CASE_FIXTURE_NONE(test_axes_1), //
     CASE_FIXTURE_NONE(test_axes_2), //
     CASE_FIXTURE_NONE(test_axes_3), //
+    CASE_FIXTURE_NONE(test_axes_4), //
 
     // scene
-    CASE_FIXTURE_NONE(test_scene_0),        //
-    CASE_FIXTURE_NONE(test_scene_1),        //
-    CASE_FIXTURE_NONE(test_scene_mesh),     //
-    CASE_FIXTURE_NONE(test_scene_axes),     //
-    CASE_FIXTURE_NONE(test_scene_logistic), //
+    CASE_FIXTURE_NONE(test_scene_0),             //
+    CASE_FIXTURE_NONE(test_scene_1),             //
+    CASE_FIXTURE_NONE(test_scene_mesh),          //
+    CASE_FIXTURE_NONE(test_scene_axes),          //
+    CASE_FIXTURE_NONE(test_scene_logistic),      //
+    CASE_FIXTURE_NONE(test_scene_transform_gpu), //
+    CASE_FIXTURE_NONE(test_scene_box),           //
+    CASE_FIXTURE_NONE(test_scene_stream_box),    //
+    CASE_FIXTURE_NONE(test_scene_refill),        //
+    CASE_FIXTURE_NONE(test_scene_batch),         //
 
 };
 static uint32_t N_TESTS = sizeof(TEST_CASES) / sizeof(TestCase);
 
 
 
+/*************************************************************************************************/
+/*  List of benchmarks                                                                           */
+/*************************************************************************************************/
+
+static TestCase BENCH_CASES[] = {
+
+    // common benchmarks
+    CASE_FIXTURE_NONE(bench_fifo),      //
+    CASE_FIXTURE_NONE(bench_container), //
+
+    // array benchmarks
+    CASE_FIXTURE_NONE(bench_array_column),  //
+    CASE_FIXTURE_NONE(bench_visual_bake),   //
+    CASE_FIXTURE_NONE(bench_visual_props),  //
+    CASE_FIXTURE_NONE(bench_graphics_text), //
+
+    // transforms benchmarks
+    CASE_FIXTURE_NONE(bench_transform_pos), //
+
+    // headless scene benchmarks
+    CASE_FIXTURE_NONE(bench_scene_points),        //
+    CASE_FIXTURE_NONE(bench_scene_points_borrow), //
+    CASE_FIXTURE_NONE(bench_scene_paths),         //
+    CASE_FIXTURE_NONE(bench_scene_image),         //
+    CASE_FIXTURE_NONE(bench_scene_volume),        //
+    CASE_FIXTURE_NONE(bench_scene_grid),          //
+
+};
+static uint32_t N_BENCHS = sizeof(BENCH_CASES) / sizeof(TestCase);
+
+
+
 /*************************************************************************************************/
 /*  Tests utils                                                                                  */
 /*************************************************************************************************/
@@ -293,6 +360,49 @@ static int test(int argc, char** argv)
     return res;
 }
 
+// Run a benchmark in a child process, so that the peak memory it reports is its own.
+static int bench_launcher(TestCase bench_case)
+{
+    ASSERT(bench_case.function != NULL);
+#if OS_WIN32
+    return bench_case.function(NULL);
+#else
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        log_error("unable to fork the benchmark %s", bench_case.name);
+        return 1;
+    }
+    if (pid == 0)
+    {
+        int res = bench_case.function(NULL);
+        fflush(stdout);
+        _exit(res == 0 ? 0 : 1);
+    }
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0)
+        return 1;
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+#endif
+}
+
+static int bench(int argc, char** argv)
+{
+    // argv: bench, <name>
+    // NOTE: only the JSON results are written to stdout.
+    int res = 0;
+    for (uint32_t i = 0; i < N_BENCHS; i++)
+    {
+        if (argc == 1 || strstr(BENCH_CASES[i].name, argv[1]) != NULL)
+        {
+            fprintf(stderr, "--- %s\n", BENCH_CASES[i].name);
+            res += bench_launcher(BENCH_CASES[i]) == 0 ? 0 : 1;
+        }
+    }
+    return res;
+}
+
 static int info(int argc, char** argv)
 {
     DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);
@@ -323,7 +433,7 @@ int main(int argc, char** argv)
     log_set_level_env();
     if (argc <= 1)
     {
-        log_error("specify a command: info, demo, test");
+        log_error("specify a command: info, demo, test, bench");
         return 1;
     }
     ASSERT(argc >= 2);
@@ -331,5 +441,6 @@ int main(int argc, char** argv)
     SWITCH_CLI_ARG(info)
     SWITCH_CLI_ARG(test)
     SWITCH_CLI_ARG(demo)
+    SWITCH_CLI_ARG(bench)
     return res;
 }
@@ -256,6 +256,118 @@ int test_array_cast(TestContext* context)
 
 
 
+typedef struct TestVertexCast TestVertexCast;
+struct TestVertexCast
+{
+    vec3 pos;
+    float size;
+    cvec4 color;
+};
+
+int test_array_column_simd(TestContext* context)
+{
+    const uint32_t n = 1001; // not a multiple of the SIMD width
+    DvzArray arr = dvz_array_struct(n, sizeof(TestVertexCast));
+    DvzArray flat = dvz_array(n, DVZ_DTYPE_VEC3);
+    dvec3* pos = calloc(n, sizeof(dvec3));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        pos[i][0] = i + .1;
+        pos[i][1] = -1.0 / (i + 1);
+        pos[i][2] = 1e6 * i;
+    }
+    cvec4 color = {1, 2, 3, 4};
+    TestVertexCast* item = NULL;
+
+    // All SIMD levels must give the same result as the scalar cast.
+    DvzSimdLevel max_level = dvz_simd_level();
+    for (int32_t level = (int32_t)max_level; level >= 0; level--)
+    {
+        dvz_simd_set_level((DvzSimdLevel)level);
+        dvz_array_clear(&arr);
+        dvz_array_clear(&flat);
+
+        // Cast interleaved in records.
+        dvz_array_column(
+            &arr, offsetof(TestVertexCast, pos), sizeof(dvec3), 0, n, n, pos, DVZ_DTYPE_DVEC3,
+            DVZ_DTYPE_VEC3, DVZ_ARRAY_COPY_SINGLE, 1);
+        // Constant broadcast.
+        dvz_array_column(
+            &arr, offsetof(TestVertexCast, color), sizeof(cvec4), 0, n, 1, color,
+            DVZ_DTYPE_CVEC4, DVZ_DTYPE_CVEC4, DVZ_ARRAY_COPY_SINGLE, 1);
+        // Contiguous cast.
+        dvz_array_column(
+            &flat, 0, sizeof(dvec3), 0, n, n, pos, DVZ_DTYPE_DVEC3, DVZ_DTYPE_VEC3,
+            DVZ_ARRAY_COPY_SINGLE, 1);
+
+        for (uint32_t i = 0; i < n; i++)
+        {
+            item = dvz_array_item(&arr, i);
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                AT(item->pos[k] == (float)pos[i][k]);
+                AT(((vec3*)flat.data)[i][k] == (float)pos[i][k]);
+            }
+            AT(item->size == 0);
+            AT(memcmp(item->color, color, sizeof(cvec4)) == 0);
+        }
+    }
+    dvz_simd_set_level(max_level);
+
+    FREE(pos);
+    dvz_array_destroy(&arr);
+    dvz_array_destroy(&flat);
+    return 0;
+}
+
+
+
+int test_array_pixels(TestContext* context)
+{
+    const uint32_t n = 1001; // not a multiple of the SIMD width
+    uint8_t* bgra = calloc(n, 4);
+    for (uint32_t i = 0; i < 4 * n; i++)
+        bgra[i] = (uint8_t)(i * 7 + 3);
+    uint8_t* out = calloc(n, 4);
+    uint8_t* src = NULL;
+    uint8_t* dst = NULL;
+
+    // All SIMD levels must give the same result as the scalar conversion.
+    DvzSimdLevel max_level = dvz_simd_level();
+    for (int32_t level = (int32_t)max_level; level >= 0; level--)
+    {
+        dvz_simd_set_level((DvzSimdLevel)level);
+        for (uint32_t swizzle = 0; swizzle < 2; swizzle++)
+        {
+            for (uint32_t n_out = 3; n_out <= 4; n_out++)
+            {
+                memset(out, 0, 4 * n);
+                dvz_array_pixels(out, bgra, n, swizzle, n_out == 4);
+                for (uint32_t i = 0; i < n; i++)
+                {
+                    src = &bgra[4 * i];
+                    dst = &out[n_out * i];
+                    AT(dst[0] == src[swizzle ? 2 : 0]);
+                    AT(dst[1] == src[1]);
+                    AT(dst[2] == src[swizzle ? 0 : 2]);
+                    if (n_out == 4)
+                        AT(dst[3] == 255);
+                }
+                // Nothing must be written past the last RGB pixel.
+                for (uint32_t i = n_out * n; i < 4 * n; i++)
+                    AT(out[i] == 0);
+            }
+        }
+    }
+    dvz_simd_set_level(max_level);
+
+    FREE(bgra);
+    FREE(out);
+    return 0;
+}
+
+
+
 typedef struct _mvp _mvp;
 struct _mvp
 {
@@ -302,6 +414,68 @@ int test_array_mvp(TestContext* context)
 
 
 
+static void _release(void* data, void* user_data)
+{
+    ASSERT(user_data != NULL);
+    *((void**)user_data) = data;
+}
+
+
+
+int test_array_borrow(TestContext* context)
+{
+    // Interleaved external buffer.
+    typedef struct
+    {
+        vec3 pos;
+        cvec4 color;
+    } _vertex;
+    const uint32_t n = 5;
+    _vertex vertices[5] = {0};
+    for (uint32_t i = 0; i < n; i++)
+    {
+        vertices[i].pos[0] = i;
+        vertices[i].pos[1] = 10 * i;
+        vertices[i].color[3] = 255;
+    }
+
+    void* released = NULL;
+    DvzArray arr = dvz_array_borrow(
+        n, DVZ_DTYPE_VEC3, sizeof(_vertex), vertices[0].pos, _release, &released);
+    AT(arr.borrowed);
+    AT(arr.data == vertices[0].pos);
+    AT(dvz_array_stride(&arr) == sizeof(_vertex));
+    AT(dvz_array_item(&arr, 3) == vertices[3].pos);
+
+    // The copy is packed and owns its data.
+    DvzArray arr_copy = dvz_array_copy(&arr);
+    AT(!arr_copy.borrowed);
+    AT(arr_copy.data != arr.data);
+    AT(dvz_array_stride(&arr_copy) == sizeof(vec3));
+    AT(arr_copy.buffer_size == n * sizeof(vec3));
+    AT(((vec3*)arr_copy.data)[4][1] == 40);
+
+    // Strided copy to a column of a record array.
+    DvzArray rec = dvz_array_struct(n, sizeof(vec4));
+    dvz_array_column_strided(
+        &rec, 0, sizeof(vec3), sizeof(_vertex), 0, n, n, arr.data, 0, 0, DVZ_ARRAY_COPY_SINGLE,
+        1);
+    AT(((vec4*)rec.data)[2][0] == 2);
+    AT(((vec4*)rec.data)[2][1] == 20);
+
+    // The borrowed buffer is released, not freed.
+    dvz_array_destroy(&arr_copy);
+    AT(released == NULL);
+    dvz_array_destroy(&arr);
+    AT(released == vertices[0].pos);
+    AT(arr.data == NULL);
+
+    dvz_array_destroy(&rec);
+    return 0;
+}
+
+
+
 int test_array_3D(TestContext* context)
 {
     DvzArray arr = dvz_array_3D(2, 2, 3, 1, DVZ_DTYPE_CHAR);
@@ -18,7 +18,10 @@ int test_array_5(TestContext* context);
 int test_array_6(TestContext* context);
 int test_array_7(TestContext* context);
 int test_array_cast(TestContext* context);
+int test_array_column_simd(TestContext* context);
+int test_array_pixels(TestContext* context);
 int test_array_mvp(TestContext* context);
+int test_array_borrow(TestContext* context);
 int test_array_3D(TestContext* context);
 
 
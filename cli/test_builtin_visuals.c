@@ -1,5 +1,6 @@
 #include "test_builtin_visuals.h"
 #include "../include/datoviz/builtin_visuals.h"
+#include "../include/datoviz/glyphs.h"
 #include "../include/datoviz/interact.h"
 #include "../include/datoviz/mesh.h"
 #include "../src/interact_utils.h"
@@ -388,13 +389,13 @@ int test_visuals_axes_2D_1(TestContext* context)
     INIT;
     dvz_canvas_clear_color(canvas, 1, 1, 1);
 
-    DvzFontAtlas* atlas = &gpu->context->font_atlas;
-    ASSERT(strlen(atlas->font_str) > 0);
+    DvzGlyphAtlas* atlas = dvz_ctx_glyph_atlas(gpu->context);
+    ASSERT(atlas->texture != NULL);
 
     DvzVisual visual = dvz_visual(canvas);
     dvz_visual_builtin(&visual, DVZ_VISUAL_AXES_2D, DVZ_AXES_COORD_X);
 
-    // Font atlas texture.
+    // Glyph atlas texture.
     dvz_visual_texture(&visual, DVZ_SOURCE_TYPE_FONT_ATLAS, 0, atlas->texture);
 
     // Prepare the data.
@@ -425,8 +426,6 @@ int test_visuals_axes_2D_1(TestContext* context)
 
     // Text params.
     DvzGraphicsTextParams params = {0};
-    params.grid_size[0] = (int32_t)atlas->rows;
-    params.grid_size[1] = (int32_t)atlas->cols;
     params.tex_size[0] = (int32_t)atlas->width;
     params.tex_size[1] = (int32_t)atlas->height;
     dvz_visual_data_source(&visual, DVZ_SOURCE_TYPE_PARAM, 0, 0, 1, 1, &params);
@@ -485,8 +484,8 @@ int test_visuals_axes_2D_update(TestContext* context)
     INIT;
     dvz_canvas_clear_color(canvas, 1, 1, 1);
 
-    DvzFontAtlas* atlas = &gpu->context->font_atlas;
-    ASSERT(strlen(atlas->font_str) > 0);
+    DvzGlyphAtlas* atlas = dvz_ctx_glyph_atlas(gpu->context);
+    ASSERT(atlas->texture != NULL);
 
     DvzVisual visual = dvz_visual(canvas);
 
@@ -526,8 +525,6 @@ int test_visuals_axes_2D_update(TestContext* context)
 
     // Text params.
     DvzGraphicsTextParams params = {0};
-    params.grid_size[0] = (int32_t)atlas->rows;
-    params.grid_size[1] = (int32_t)atlas->cols;
     params.tex_size[0] = (int32_t)atlas->width;
     params.tex_size[1] = (int32_t)atlas->height;
     dvz_visual_data_source(&visual, DVZ_SOURCE_TYPE_PARAM, 0, 0, 1, 1, &params);
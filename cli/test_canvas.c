@@ -102,6 +102,122 @@ int test_canvas_transfer_texture(TestContext* context)
 
 
 
+typedef struct TestStaging TestStaging;
+struct TestStaging
+{
+    DvzBufferRegions br;
+    uint8_t* data;
+};
+
+static void _staging_callback(DvzCanvas* canvas, DvzEvent ev)
+{
+    TestStaging* ts = (TestStaging*)ev.user_data;
+    ASSERT(ts != NULL);
+
+    // Upload several small chunks per frame, while the event loop is running.
+    uint64_t idx = ev.u.f.idx;
+    if (idx >= 16)
+        return;
+    for (uint32_t i = 0; i < 4; i++)
+        dvz_upload_buffers(canvas, ts->br, (idx * 4 + i) * 16, 16, &ts->data[(idx * 4 + i) * 16]);
+}
+
+int test_canvas_transfer_staging(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    VkDeviceSize size = 16 * 64;
+    TestStaging ts = {0};
+    ts.br = dvz_ctx_buffers(gpu->context, DVZ_BUFFER_TYPE_VERTEX, 1, size);
+    ts.data = calloc(size, sizeof(uint8_t));
+    for (uint32_t i = 0; i < size; i++)
+        ts.data[i] = (uint8_t)(i % 256);
+
+    dvz_event_callback(canvas, DVZ_EVENT_FRAME, 0, DVZ_EVENT_MODE_SYNC, _staging_callback, &ts);
+    dvz_app_run(app, 20);
+
+    // All uploads went through the staging ring.
+    DvzTransferStats stats = dvz_transfer_stats(canvas);
+    log_debug(
+        "%d uploads, %s staged, %d submissions, %d stalls avoided, %d stalls", //
+        stats.uploads, pretty_size(stats.bytes_staged), stats.submissions,
+        stats.stalls_avoided, stats.stalls);
+    AT(stats.uploads == 64);
+    AT(stats.bytes_staged == size);
+    AT(stats.submissions == 16);
+    AT(stats.stalls_avoided == 64);
+
+    // The 4 adjacent uploads of each frame are merged in a single copy.
+    AT(stats.copies == 16);
+    AT(stats.merged == 48);
+    AT(stats.dropped == 0);
+
+    // Download the buffer.
+    uint8_t* data2 = calloc(size, sizeof(uint8_t));
+    dvz_download_buffers(canvas, ts.br, 0, size, data2);
+    dvz_app_run(app, 3);
+    AT(memcmp(data2, ts.data, size) == 0);
+
+    FREE(ts.data);
+    FREE(data2);
+    TEST_END
+}
+
+
+
+static void _coalesce_callback(DvzCanvas* canvas, DvzEvent ev)
+{
+    TestStaging* ts = (TestStaging*)ev.user_data;
+    ASSERT(ts != NULL);
+    if (ev.u.f.idx != 0)
+        return;
+
+    // These two uploads are fully overwritten by the third one.
+    dvz_upload_buffers(canvas, ts->br, 0, 64, &ts->data[256]);
+    dvz_upload_buffers(canvas, ts->br, 16, 16, &ts->data[512]);
+    dvz_upload_buffers(canvas, ts->br, 0, 64, &ts->data[0]);
+    // This one is adjacent and is merged with the previous one.
+    dvz_upload_buffers(canvas, ts->br, 64, 64, &ts->data[64]);
+}
+
+int test_canvas_transfer_coalesce(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    VkDeviceSize size = 1024;
+    TestStaging ts = {0};
+    ts.br = dvz_ctx_buffers(gpu->context, DVZ_BUFFER_TYPE_VERTEX, 1, size);
+    ts.data = calloc(size, sizeof(uint8_t));
+    for (uint32_t i = 0; i < size; i++)
+        ts.data[i] = (uint8_t)(i % 251);
+
+    dvz_event_callback(canvas, DVZ_EVENT_FRAME, 0, DVZ_EVENT_MODE_SYNC, _coalesce_callback, &ts);
+    dvz_app_run(app, 3);
+
+    DvzTransferStats stats = dvz_transfer_stats(canvas);
+    AT(stats.uploads == 4);
+    AT(stats.dropped == 2);
+    AT(stats.merged == 1);
+    AT(stats.copies == 1);
+    AT(stats.bytes_staged == 128);
+
+    // Only the last uploads should be visible.
+    uint8_t* data2 = calloc(128, sizeof(uint8_t));
+    dvz_download_buffers(canvas, ts.br, 0, 128, data2);
+    dvz_app_run(app, 3);
+    AT(memcmp(data2, ts.data, 128) == 0);
+
+    FREE(ts.data);
+    FREE(data2);
+    TEST_END
+}
+
+
+
 /*************************************************************************************************/
 /*  Canvas 1                                                                                     */
 /*************************************************************************************************/
@@ -1252,3 +1368,122 @@ int test_canvas_screencast(TestContext* context)
     dvz_app_run(app, N_FRAMES);
     TEST_END
 }
+
+
+
+typedef struct _ReadbackState _ReadbackState;
+struct _ReadbackState
+{
+    uint64_t count;
+    uint64_t next_idx;
+    bool ok;
+};
+
+static void _readback_callback(DvzCanvas* canvas, DvzEvent ev)
+{
+    _ReadbackState* state = (_ReadbackState*)ev.user_data;
+    ASSERT(state != NULL);
+    log_debug("readback frame #%d", ev.u.sc.idx);
+
+    // The raw image is borrowed from the staging buffer, and the frames come in order.
+    state->ok &= (ev.u.sc.flags & DVZ_SCREENCAST_FLAGS_RAW) != 0;
+    state->ok &= ev.u.sc.rgba != NULL;
+    state->ok &= ev.u.sc.width == canvas->screencast->width;
+    state->ok &= ev.u.sc.height == canvas->screencast->height;
+    state->ok &= ev.u.sc.idx >= state->next_idx;
+    state->next_idx = ev.u.sc.idx + 1;
+    state->count++;
+}
+
+int test_canvas_screencast_readback(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    _ReadbackState state = {.ok = true};
+    dvz_event_callback(
+        canvas, DVZ_EVENT_SCREENCAST, 0, DVZ_EVENT_MODE_SYNC, _readback_callback, &state);
+
+    dvz_screencast_readback(canvas, 1. / 60, 2, DVZ_SCREENCAST_FLAGS_RAW);
+    ASSERT(canvas->screencast != NULL);
+    AT(canvas->screencast->slot_count == 2);
+
+    dvz_app_run(app, N_FRAMES);
+    AT(state.ok);
+
+    // Every grabbed frame is either delivered or still in one of the slots.
+    DvzScreencast* sc = canvas->screencast;
+    AT(state.count <= sc->frame_idx);
+    AT(sc->frame_idx - state.count <= sc->slot_count);
+
+    // Destroying the screencast delivers the frames still in flight, in order.
+    // NOTE: a frame grabbed after the last render submission is never copied.
+    uint64_t grabbed = sc->frame_idx;
+    dvz_screencast_destroy(canvas);
+    AT(canvas->screencast == NULL);
+    AT(state.ok);
+    AT(state.count + 1 >= grabbed);
+    TEST_END
+}
+
+
+
+int test_canvas_video(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/video.mp4", ARTIFACTS_DIR);
+    dvz_canvas_video(canvas, 30, 10000000, path, true);
+
+    // Without ffmpeg support, there is no video.
+    if (canvas->screencast == NULL)
+    {
+        TEST_END
+    }
+
+    // The render loop waits for the encoder, so that the encoder queue never drops frames.
+    dvz_canvas_video_policy(canvas, 2, DVZ_VIDEO_POLICY_BLOCK);
+
+    dvz_app_run(app, N_FRAMES);
+    DvzVideoStats stats = dvz_canvas_video_stats(canvas);
+    log_debug(
+        "%d frame(s) encoded, %d in the queue, latency %.1f ms", (int)stats.encoded,
+        stats.queue_depth, 1000 * stats.latency);
+    // With the blocking policy, the frame buffers are recycled once encoded, so that frames
+    // beyond the queue capacity are only captured after earlier frames have been encoded.
+    AT(stats.encoded > 0);
+    AT(stats.queue_depth <= 2);
+    AT(stats.dropped == canvas->screencast->dropped);
+    AT(stats.latency <= stats.latency_max);
+
+    dvz_canvas_stop(canvas);
+    TEST_END
+}
+
+
+
+int test_canvas_profile(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    dvz_canvas_profile(canvas, 64);
+    ASSERT(canvas->profiler != NULL);
+    dvz_event_callback(canvas, DVZ_EVENT_FRAME, 0, DVZ_EVENT_MODE_SYNC, _frame_callback, NULL);
+
+    dvz_app_run(app, 10);
+    DvzProfiler* prof = canvas->profiler;
+    AT(prof->count > 0);
+    AT(prof->frame_idx > 0);
+    AT(canvas->phase_time[DVZ_FRAME_PHASE_FRAME] > 0);
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/profile.json", ARTIFACTS_DIR);
+    AT(dvz_canvas_profile_dump(canvas, path) == 0);
+    TEST_END
+}
@@ -12,6 +12,8 @@
 
 int test_canvas_transfer_buffer(TestContext* context);
 int test_canvas_transfer_texture(TestContext* context);
+int test_canvas_transfer_staging(TestContext* context);
+int test_canvas_transfer_coalesce(TestContext* context);
 int test_canvas_1(TestContext* context);
 int test_canvas_2(TestContext* context);
 int test_canvas_3(TestContext* context);
@@ -26,6 +28,9 @@ int test_canvas_particles(TestContext* context);
 int test_canvas_offscreen(TestContext* context);
 int test_canvas_gui_1(TestContext* context);
 int test_canvas_screencast(TestContext* context);
+int test_canvas_screencast_readback(TestContext* context);
+int test_canvas_video(TestContext* context);
+int test_canvas_profile(TestContext* context);
 
 
 
@@ -1,4 +1,5 @@
 #include "test_common.h"
+#include "../include/datoviz/alloc.h"
 #include "../include/datoviz/common.h"
 
 
@@ -81,11 +82,11 @@ int test_container(TestContext* context)
             obj = iter.item;
             AT(obj != NULL);
             // log_info("%d", obj);
+            // The objects are iterated in the order of the dense array.
             if (i == 0)
-                AT(obj->x == 3);
-            if (i == 1)
-                //     DBG(obj->x);
                 AT(obj->x == 2);
+            if (i == 1)
+                AT(obj->x == 3);
             if (i == 2)
                 AT(obj->x == 4);
             i++;
@@ -94,9 +95,24 @@ int test_container(TestContext* context)
         ASSERT(i == 3);
     }
 
+    // A destroyed object is freed when the iteration reaches it, without skipping the others.
+    dvz_obj_destroyed(&c->obj);
+    {
+        DvzContainerIterator iter = dvz_container_iterator(&container);
+        uint32_t i = 0;
+        while (iter.item != NULL)
+        {
+            AT(iter.item == b || iter.item == d);
+            i++;
+            dvz_container_iter(&iter);
+        }
+        AT(i == 2);
+        AT(container.count == 2);
+        AT(container.items[0] == NULL);
+    }
+
     // Destroy all objects.
     dvz_obj_destroyed(&b->obj);
-    dvz_obj_destroyed(&c->obj);
     dvz_obj_destroyed(&d->obj);
 
     // Free all memory. This function will fail if there is at least one object not destroyed.
@@ -106,6 +122,211 @@ int test_container(TestContext* context)
 
 
 
+int test_hash_table(TestContext* context)
+{
+    DvzHashTable table = {0};
+    uint64_t value = 0;
+    AT(!dvz_hash_table_get(&table, 0, &value));
+
+    // Many keys, so that the table is resized several times.
+    const uint32_t n = 1000;
+    for (uint32_t i = 0; i < n; i++)
+        AT(dvz_hash_table_set(&table, (uint64_t)i << 32, 10 * i));
+    AT(table.count == n);
+    AT(2 * table.count <= table.capacity);
+
+    // An existing key is not overwritten.
+    AT(!dvz_hash_table_set(&table, 0, 1));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        AT(dvz_hash_table_get(&table, (uint64_t)i << 32, &value));
+        AT(value == 10 * i);
+    }
+    AT(!dvz_hash_table_get(&table, 1, &value));
+    AT(!dvz_hash_table_get(&table, (uint64_t)n << 32, NULL));
+
+    // Removing half of the keys keeps the other ones reachable.
+    AT(!dvz_hash_table_remove(&table, 1));
+    for (uint32_t i = 0; i < n; i += 2)
+        AT(dvz_hash_table_remove(&table, (uint64_t)i << 32));
+    AT(table.count == n / 2);
+    for (uint32_t i = 0; i < n; i++)
+        AT(dvz_hash_table_get(&table, (uint64_t)i << 32, NULL) == (i % 2 == 1));
+    AT(dvz_hash_table_set(&table, 0, 1));
+    AT(dvz_hash_table_get(&table, 0, &value));
+    AT(value == 1);
+
+    dvz_hash_table_destroy(&table);
+    AT(table.capacity == 0);
+    AT(!dvz_hash_table_get(&table, 0, &value));
+    return 0;
+}
+
+
+
+/*************************************************************************************************/
+/*  Region allocator                                                                             */
+/*************************************************************************************************/
+
+#define TEST_ALLOC_REGIONS 256
+
+// Check that the blocks are contiguous, aligned, that there are no consecutive free blocks, and
+// that the free lists contain all free blocks.
+static bool _alloc_valid(DvzAlloc* alloc)
+{
+    VkDeviceSize end = 0;
+    uint32_t count = 0, free_count = 0, prev = DVZ_ALLOC_NONE;
+    DvzAllocBlock* block = NULL;
+    for (uint32_t i = alloc->first; i != DVZ_ALLOC_NONE; i = block->next)
+    {
+        block = &alloc->blocks[i];
+        if (block->offset != end || block->prev != prev)
+            return false;
+        if (block->offset % alloc->alignment != 0)
+            return false;
+        if (prev != DVZ_ALLOC_NONE && !block->used && !alloc->blocks[prev].used)
+            return false;
+        end += block->size;
+        prev = i;
+        count++;
+    }
+    for (uint32_t fl = 0; fl < DVZ_ALLOC_FL_COUNT; fl++)
+        for (uint32_t sl = 0; sl < DVZ_ALLOC_SL_COUNT; sl++)
+            for (uint32_t i = alloc->free_lists[fl][sl]; i != DVZ_ALLOC_NONE;
+                 i = alloc->blocks[i].next_free)
+            {
+                if (alloc->blocks[i].used)
+                    return false;
+                free_count++;
+            }
+    return end == alloc->size && prev == alloc->last && count == alloc->count &&
+           free_count == alloc->free_blocks && count == free_count + alloc->used_blocks;
+}
+
+int test_alloc(TestContext* context)
+{
+    DvzAlloc alloc = dvz_alloc(1024, 64);
+    VkDeviceSize resized = 0, offset = 0;
+
+    // Aligned allocations.
+    VkDeviceSize a = dvz_alloc_new(&alloc, 10, &resized);
+    AT(a == 0);
+    AT(resized == 0);
+    AT(dvz_alloc_size(&alloc, a) == 64);
+
+    VkDeviceSize b = dvz_alloc_new(&alloc, 100, &resized);
+    AT(b == 64);
+    VkDeviceSize c = dvz_alloc_new(&alloc, 64, &resized);
+    AT(c == 192);
+
+    // Reuse freed space.
+    dvz_alloc_free(&alloc, b);
+    AT(dvz_alloc_size(&alloc, b) == 0);
+    b = dvz_alloc_new(&alloc, 64, &resized);
+    AT(b == 64);
+
+    // Enlarge the managed range.
+    VkDeviceSize d = dvz_alloc_new(&alloc, 2000, &resized);
+    AT(d == 256);
+    AT(resized == 4096);
+    AT(alloc.size == 4096);
+
+    // Resize the last region in-place.
+    AT(dvz_alloc_resize(&alloc, d, 3000, &resized) == d);
+    AT(resized == 0);
+
+    // Resize a region that cannot grow in-place.
+    VkDeviceSize e = dvz_alloc_resize(&alloc, b, 200, &resized);
+    AT(e != b);
+    dvz_alloc_free(&alloc, b);
+    AT(_alloc_valid(&alloc));
+
+    dvz_alloc_free(&alloc, a);
+    dvz_alloc_free(&alloc, c);
+    dvz_alloc_free(&alloc, d);
+    dvz_alloc_free(&alloc, e);
+    DvzAllocStats stats = dvz_alloc_stats(&alloc);
+    AT(stats.used == 0);
+    AT(stats.used_blocks == 0);
+    AT(stats.free_blocks == 1);
+
+    // Aligned allocations that never enlarge the managed range.
+    VkDeviceSize f = 0, g = 0;
+    AT(dvz_alloc_fit(&alloc, 10, 1, &f));
+    AT(f == 0);
+    AT(dvz_alloc_fit(&alloc, 10, 1024, &g));
+    AT(g == 1024);
+    AT(_alloc_valid(&alloc));
+    // The padding before the aligned region is still available.
+    AT(dvz_alloc_fit(&alloc, 500, 1, &offset));
+    AT(offset == 64);
+    AT(!dvz_alloc_fit(&alloc, 8192, 1, &offset));
+    AT(alloc.size == 4096);
+    dvz_alloc_free(&alloc, f);
+    dvz_alloc_free(&alloc, g);
+    dvz_alloc_free(&alloc, offset);
+    AT(dvz_alloc_stats(&alloc).used == 0);
+
+    // Churn: random allocations, resizes, and frees.
+    VkDeviceSize offsets[TEST_ALLOC_REGIONS] = {0};
+    bool live[TEST_ALLOC_REGIONS] = {0};
+    VkDeviceSize peak = 0, max_live = 0;
+    uint32_t k = 0;
+    srand(0);
+    for (uint32_t i = 0; i < 50000; i++)
+    {
+        k = (uint32_t)rand() % TEST_ALLOC_REGIONS;
+        if (!live[k])
+        {
+            offsets[k] = dvz_alloc_new(&alloc, 1 + (uint32_t)rand() % 512, NULL);
+            live[k] = true;
+        }
+        else if (rand() % 2 == 0)
+        {
+            dvz_alloc_free(&alloc, offsets[k]);
+            live[k] = false;
+        }
+        else
+        {
+            offset = dvz_alloc_resize(&alloc, offsets[k], 1 + (uint32_t)rand() % 512, NULL);
+            if (offset != offsets[k])
+                dvz_alloc_free(&alloc, offsets[k]);
+            offsets[k] = offset;
+        }
+        peak = MAX(peak, alloc.size);
+    }
+    AT(_alloc_valid(&alloc));
+
+    // The peak size should remain bounded: at most 256 live regions of 512 bytes each.
+    max_live = TEST_ALLOC_REGIONS * 512;
+    log_debug("peak allocator size %s", pretty_size(peak));
+    AT(peak <= 4 * max_live);
+
+    // Compaction of all live regions.
+    VkDeviceSize movable[TEST_ALLOC_REGIONS] = {0};
+    VkDeviceSize moved[TEST_ALLOC_REGIONS] = {0};
+    uint32_t n = 0;
+    for (k = 0; k < TEST_ALLOC_REGIONS; k++)
+        if (live[k])
+            movable[n++] = offsets[k];
+    stats = dvz_alloc_stats(&alloc);
+    VkDeviceSize used = stats.used;
+    dvz_alloc_compact(&alloc, n, movable, moved, 1024);
+    AT(_alloc_valid(&alloc));
+    stats = dvz_alloc_stats(&alloc);
+    AT(stats.used == used);
+    AT(stats.end == used);
+    AT(stats.used_blocks == n);
+    AT(stats.free_blocks <= 1);
+    for (uint32_t i = 0; i < n; i++)
+        AT(dvz_alloc_size(&alloc, moved[i]) > 0);
+
+    dvz_alloc_destroy(&alloc);
+    return 0;
+}
+
+
+
 /*************************************************************************************************/
 /*  FIFO queue                                                                                   */
 /*************************************************************************************************/
@@ -232,3 +453,82 @@ int test_fifo_3(TestContext* context)
     dvz_fifo_destroy(&fifo);
     return 0;
 }
+
+
+
+#define TEST_FIFO_PRODUCERS 4
+#define TEST_FIFO_ITEMS     10000
+
+static void* _fifo_producer(void* arg)
+{
+    DvzFifo* fifo = arg;
+    uint32_t* numbers = fifo->user_data;
+    ASSERT(numbers != NULL);
+    for (uint32_t i = 0; i < TEST_FIFO_ITEMS; i++)
+        dvz_fifo_enqueue(fifo, &numbers[i]);
+    return NULL;
+}
+
+
+
+int test_fifo_lockfree(TestContext* context)
+{
+    uint32_t* numbers = calloc(TEST_FIFO_ITEMS, sizeof(uint32_t));
+    for (uint32_t i = 0; i < TEST_FIFO_ITEMS; i++)
+        numbers[i] = i;
+
+    // Single producer: the queue grows well beyond DVZ_MAX_FIFO_CAPACITY.
+    DvzFifo fifo = dvz_fifo_lockfree(8, DVZ_FIFO_MODE_SPSC);
+    AT(fifo.is_empty);
+    AT(dvz_fifo_dequeue(&fifo, false) == NULL);
+    for (uint32_t i = 0; i < 1000; i++)
+        dvz_fifo_enqueue(&fifo, &numbers[i]);
+    AT(!fifo.is_empty);
+    AT(dvz_fifo_size(&fifo) == 1000);
+    uint32_t* n = NULL;
+    for (uint32_t i = 0; i < 500; i++)
+    {
+        n = dvz_fifo_dequeue(&fifo, false);
+        AT(n != NULL && *n == i);
+    }
+    dvz_fifo_discard(&fifo, 10);
+    AT(dvz_fifo_size(&fifo) == 10);
+    n = dvz_fifo_dequeue(&fifo, false);
+    AT(*n == 990);
+    dvz_fifo_reset(&fifo);
+    AT(dvz_fifo_size(&fifo) == 0);
+    AT(fifo.is_empty);
+    dvz_fifo_destroy(&fifo);
+
+    // Multiple producers: all items are dequeued, in order for each producer.
+    fifo = dvz_fifo_lockfree(8, DVZ_FIFO_MODE_MPSC);
+    fifo.user_data = numbers;
+    pthread_t threads[TEST_FIFO_PRODUCERS] = {0};
+    for (uint32_t k = 0; k < TEST_FIFO_PRODUCERS; k++)
+        pthread_create(&threads[k], NULL, _fifo_producer, &fifo);
+
+    // The item values are the same for all producers, so the sum of the dequeued values is
+    // known, and each value is dequeued once per producer.
+    uint32_t* counts = calloc(TEST_FIFO_ITEMS, sizeof(uint32_t));
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < TEST_FIFO_PRODUCERS * TEST_FIFO_ITEMS; i++)
+    {
+        n = dvz_fifo_dequeue(&fifo, true);
+        AT(n != NULL);
+        sum += *n;
+        counts[*n]++;
+    }
+    for (uint32_t k = 0; k < TEST_FIFO_PRODUCERS; k++)
+        pthread_join(threads[k], NULL);
+    AT(sum == (uint64_t)TEST_FIFO_PRODUCERS * TEST_FIFO_ITEMS * (TEST_FIFO_ITEMS - 1) / 2);
+    for (uint32_t i = 0; i < TEST_FIFO_ITEMS; i++)
+        AT(counts[i] == TEST_FIFO_PRODUCERS);
+    AT(dvz_fifo_size(&fifo) == 0);
+    AT(dvz_fifo_dequeue(&fifo, false) == NULL);
+    AT(fifo.is_empty);
+    dvz_fifo_destroy(&fifo);
+
+    FREE(counts);
+    FREE(numbers);
+    return 0;
+}
@@ -11,6 +11,15 @@
 /*************************************************************************************************/
 
 int test_container(TestContext* context);
+int test_hash_table(TestContext* context);
+
+
+
+/*************************************************************************************************/
+/*  Region allocator                                                                             */
+/*************************************************************************************************/
+
+int test_alloc(TestContext* context);
 
 
 
@@ -21,6 +30,7 @@ int test_container(TestContext* context);
 int test_fifo_1(TestContext* context);
 int test_fifo_2(TestContext* context);
 int test_fifo_3(TestContext* context);
+int test_fifo_lockfree(TestContext* context);
 
 
 
@@ -1,5 +1,6 @@
 #include "test_graphics.h"
 #include "../include/datoviz/colormaps.h"
+#include "../include/datoviz/glyphs.h"
 #include "../include/datoviz/graphics.h"
 #include "../include/datoviz/mesh.h"
 #include "../src/interact_utils.h"
@@ -753,12 +754,10 @@ int test_graphics_text(TestContext* context)
     const char str[] = "Hello world!";
     const uint32_t offset = strlen(str);
 
-    // Font atlas
-    DvzFontAtlas* atlas = &gpu->context->font_atlas;
+    // Glyph atlas
+    DvzGlyphAtlas* atlas = dvz_ctx_glyph_atlas(gpu->context);
 
     DvzGraphicsTextParams params = {0};
-    params.grid_size[0] = (int32_t)atlas->rows;
-    params.grid_size[1] = (int32_t)atlas->cols;
     params.tex_size[0] = (int32_t)atlas->width;
     params.tex_size[1] = (int32_t)atlas->height;
 
@@ -801,6 +800,9 @@ int test_graphics_text(TestContext* context)
 
     END_DATA
 
+    // Upload the glyphs rasterized when adding the strings.
+    dvz_glyph_atlas_upload(atlas, canvas);
+
     tg.br_params =
         dvz_ctx_buffers(gpu->context, DVZ_BUFFER_TYPE_UNIFORM, 1, sizeof(DvzGraphicsTextParams));
     dvz_upload_buffers(canvas, tg.br_params, 0, sizeof(DvzGraphicsTextParams), &params);
@@ -819,6 +821,223 @@ int test_graphics_text(TestContext* context)
 
 
 
+int test_graphics_text_bulk(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzGraphics* graphics = dvz_graphics_builtin(canvas, DVZ_GRAPHICS_TEXT, 0);
+    DvzFontAtlas* atlas = &gpu->context->font_atlas;
+
+    // The glyph table matches a search in the atlas string.
+    for (uint32_t c = 1; c < 256; c++)
+    {
+        char s[2] = {(char)c, 0};
+        AT(atlas->glyphs[c] == strcspn(atlas->font_str, s));
+    }
+
+    // Strings with glyph colors for some of them.
+    const uint32_t n = 100;
+    char strings[100][8] = {0};
+    cvec4 colors[8] = {0};
+    DvzGraphicsTextItem* items = calloc(n, sizeof(DvzGraphicsTextItem));
+    uint32_t glyph_count = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        snprintf(strings[i], 8, "%d~%c", i, (char)(32 + i));
+        items[i].string = strings[i];
+        items[i].font_size = 10 + i;
+        items[i].vertex.pos[0] = i;
+        items[i].vertex.angle = .1 * i;
+        if (i % 3 == 0)
+            items[i].glyph_colors = colors;
+        glyph_count += strlen(strings[i]);
+    }
+    for (uint32_t i = 0; i < 8; i++)
+        RAND_COLOR(colors[i])
+
+    // One item at a time.
+    DvzArray vertices = dvz_array_struct(0, sizeof(DvzGraphicsTextVertex));
+    DvzGraphicsData data = dvz_graphics_data(graphics, &vertices, NULL, NULL);
+    dvz_graphics_alloc(&data, glyph_count);
+    for (uint32_t i = 0; i < n; i++)
+        dvz_graphics_append(&data, &items[i]);
+    AT(data.current_idx == glyph_count);
+    AT(data.current_group == n);
+
+    // All items at once.
+    DvzArray vertices_bulk = dvz_array_struct(0, sizeof(DvzGraphicsTextVertex));
+    DvzGraphicsData data_bulk = dvz_graphics_data(graphics, &vertices_bulk, NULL, NULL);
+    dvz_graphics_alloc(&data_bulk, glyph_count);
+    dvz_graphics_append_text(&data_bulk, n, items);
+    AT(data_bulk.current_idx == glyph_count);
+    AT(data_bulk.current_group == n);
+
+    // Both paths give the same vertices.
+    AT(vertices_bulk.item_count == 4 * glyph_count);
+    DvzGraphicsTextVertex* vertex = vertices.data;
+    DvzGraphicsTextVertex* vertex_bulk = vertices_bulk.data;
+    for (uint32_t i = 0; i < 4 * glyph_count; i++)
+    {
+        AT(memcmp(vertex[i].pos, vertex_bulk[i].pos, sizeof(vec3)) == 0);
+        AT(memcmp(vertex[i].color, vertex_bulk[i].color, sizeof(cvec4)) == 0);
+        AT(memcmp(vertex[i].glyph_size, vertex_bulk[i].glyph_size, sizeof(vec2)) == 0);
+        AT(memcmp(vertex[i].glyph, vertex_bulk[i].glyph, sizeof(usvec4)) == 0);
+        AT(memcmp(vertex[i].glyph_shift, vertex_bulk[i].glyph_shift, sizeof(vec2)) == 0);
+        AT(memcmp(vertex[i].uv, vertex_bulk[i].uv, sizeof(vec4)) == 0);
+        AT(vertex[i].angle == vertex_bulk[i].angle);
+    }
+    AT(vertex[0].glyph[0] == '0');
+    AT(vertex[3].glyph[0] == '0');
+    AT(vertex[4].glyph[0] == '~');
+    AT(vertex[4].glyph[1] == 1);
+    AT(vertex[4].glyph[2] == 3);
+
+    // The glyphs come from the glyph atlas, laid out from left to right.
+    DvzGlyph glyph = {0};
+    AT(dvz_glyph_atlas_glyph(dvz_ctx_glyph_atlas(gpu->context), 0, '~', &glyph));
+    AT(memcmp(vertex[4].uv, glyph.uv, sizeof(vec4)) == 0);
+    AT(vertex[4].glyph_shift[0] > vertex[0].glyph_shift[0]);
+    AT(vertex[0].string_size[0] == vertex[8].string_size[0]);
+    AT(vertex[0].string_size[1] == items[0].font_size);
+
+    dvz_array_destroy(&vertices);
+    dvz_array_destroy(&vertices_bulk);
+    FREE(items);
+    TEST_END
+}
+
+
+
+int test_graphics_glyph_atlas(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzContext* ctx = gpu->context;
+
+    // UTF-8 decoding, with an invalid byte and a truncated sequence.
+    const char* str = "\xc2\xb5V \xe2\x82\xac\xf0\x9f\x98\x80\xff\xc3";
+    uint32_t expected[] = {0xB5, 'V', ' ', 0x20AC, 0x1F600, 0xFFFD, 0xFFFD, 0};
+    for (uint32_t i = 0; i < 8; i++)
+        AT(dvz_utf8_next(&str) == expected[i]);
+
+    // The packed rectangles do not overlap and the skyline covers the whole width.
+    DvzSkyline skyline = dvz_skyline(64, 64);
+    uint8_t* used = calloc(64 * 64, 1);
+    uvec2 pos = {0};
+    uint32_t w = 0, h = 0, x0 = 0;
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        w = 1 + i % 7;
+        h = 1 + (3 * i) % 11;
+        if (!dvz_skyline_pack(&skyline, w, h, pos))
+            continue;
+        AT(pos[0] + w <= 64 && pos[1] + h <= 64);
+        for (uint32_t y = pos[1]; y < pos[1] + h; y++)
+            for (uint32_t x = pos[0]; x < pos[0] + w; x++)
+                AT(used[64 * y + x]++ == 0);
+        x0 = 0;
+        for (uint32_t j = 0; j < skyline.count; j++)
+        {
+            AT(skyline.nodes[j].x == x0);
+            x0 += skyline.nodes[j].width;
+        }
+        AT(x0 == 64);
+    }
+    FREE(used);
+    dvz_skyline_destroy(&skyline);
+
+    // Glyphs added from coverage bitmaps: filled squares of increasing size.
+    DvzGlyphAtlas* atlas = dvz_ctx_glyph_atlas(ctx);
+    AT(dvz_ctx_glyph_atlas(ctx) == atlas);
+    uint8_t square[32 * 32] = {0};
+    memset(square, 255, sizeof(square));
+    DvzGlyph glyph = {0};
+    const uint32_t s = DVZ_GLYPH_SDF_SPREAD;
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        AT(dvz_glyph_atlas_insert(
+            atlas, 0, 0x400 + i, 2 * i + 1, 2 * i + 1, square, (vec2){1, 10}, 12, &glyph));
+        AT(glyph.width == 2 * i + 1 + 2 * s);
+        AT(glyph.bearing[0] == 1.0f - s);
+        AT(glyph.bearing[1] == 10.0f + s);
+
+        // The distance field is positive at the center of the glyph, negative at the border.
+        AT(atlas->pixels[(glyph.y + glyph.height / 2) * atlas->width + glyph.x + glyph.width / 2] >
+           128);
+        AT(atlas->pixels[glyph.y * atlas->width + glyph.x] < 128);
+    }
+
+    // Blank glyphs take no space in the atlas.
+    AT(dvz_glyph_atlas_insert(atlas, 0, ' ', 0, 0, NULL, (vec2){0, 0}, 6, &glyph));
+    AT(glyph.width == 0);
+    AT(glyph.advance == 6);
+
+    // Cache hits.
+    for (uint32_t i = 0; i < 16; i++)
+    {
+        AT(dvz_glyph_atlas_glyph(atlas, 0, 0x400 + i, &glyph));
+        AT(glyph.codepoint == 0x400 + i);
+        AT(glyph.uv[2] > glyph.uv[0]);
+    }
+    DvzGlyphAtlasStats stats = dvz_glyph_atlas_stats(atlas);
+    AT(stats.hits == 16);
+    AT(stats.misses == 0);
+    AT(stats.glyph_count == 17);
+    AT(stats.occupancy > 0 && stats.occupancy < 1);
+
+    // A code point that no font has, not even the builtin font, is a miss that fails.
+    AT(!dvz_glyph_atlas_glyph(atlas, 1, 0x1F600, &glyph));
+    stats = dvz_glyph_atlas_stats(atlas);
+    AT(stats.misses == 1);
+    AT(stats.failures == 1);
+
+    // The missing glyph is cached, the next lookup is a hit.
+    AT(!dvz_glyph_atlas_glyph(atlas, 1, 0x1F600, &glyph));
+    stats = dvz_glyph_atlas_stats(atlas);
+    AT(stats.hits == 17);
+    AT(stats.misses == 1);
+    AT(stats.failures == 1);
+
+    // An inserted glyph replaces the missing entry.
+    AT(dvz_glyph_atlas_insert(atlas, 1, 0x1F600, 8, 8, square, (vec2){0, 8}, 9, &glyph));
+    AT(dvz_glyph_atlas_glyph(atlas, 1, 0x1F600, &glyph));
+    AT(glyph.codepoint == 0x1F600);
+    AT(dvz_glyph_atlas_glyph(atlas, 0, 0x400, &glyph));
+    AT(glyph.codepoint == 0x400);
+
+    // Without any loaded font, the glyphs come from the builtin font.
+    AT(dvz_glyph_atlas_glyph(atlas, 0, 'A', &glyph));
+    AT(glyph.width > 2 * s);
+    AT(glyph.advance > 0);
+
+    // The first upload sends the whole atlas, the next ones only the modified rows.
+    dvz_glyph_atlas_upload(atlas, canvas);
+    stats = dvz_glyph_atlas_stats(atlas);
+    AT(stats.uploaded_bytes == atlas->width * atlas->height);
+    dvz_glyph_atlas_upload(atlas, canvas);
+    AT(dvz_glyph_atlas_stats(atlas).uploaded_bytes == stats.uploaded_bytes);
+
+    AT(dvz_glyph_atlas_insert(atlas, 0, 'x', 8, 8, square, (vec2){0, 8}, 9, &glyph));
+    dvz_glyph_atlas_upload(atlas, canvas);
+    AT(dvz_glyph_atlas_stats(atlas).uploaded_bytes - stats.uploaded_bytes ==
+       atlas->width * glyph.height);
+
+    // The texture matches the CPU copy of the atlas.
+    VkDeviceSize size = atlas->width * atlas->height;
+    uint8_t* downloaded = calloc(size, 1);
+    dvz_download_texture(
+        canvas, atlas->texture, DVZ_ZERO_OFFSET, (uvec3){atlas->width, atlas->height, 1}, size,
+        downloaded);
+    AT(memcmp(downloaded, atlas->pixels, size) == 0);
+    FREE(downloaded);
+
+    TEST_END
+}
+
+
+
 /*************************************************************************************************/
 /*  Image tests                                                                                  */
 /*************************************************************************************************/
@@ -1251,3 +1470,109 @@ int test_graphics_mesh(TestContext* context)
     SCREENSHOT("mesh")
     TEST_END
 }
+
+
+
+/*************************************************************************************************/
+/*  Pipeline cache                                                                               */
+/*************************************************************************************************/
+
+// Create all builtin graphics pipelines in a new offscreen app, return the elapsed time.
+static double _graphics_builtin_startup(const char* cache_path, bool* loaded)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    DvzClock clock = {0};
+    _clock_init(&clock);
+    *loaded = dvz_context_pipeline_cache(gpu->context, cache_path);
+    for (uint32_t type = DVZ_GRAPHICS_POINT; type < DVZ_GRAPHICS_COUNT; type++)
+        dvz_graphics_builtin(canvas, (DvzGraphicsType)type, 0);
+    double elapsed = _clock_get(&clock);
+
+    // The pipeline cache is saved when the context is destroyed.
+    dvz_app_destroy(app);
+    return elapsed;
+}
+
+int test_graphics_pipeline_cache(TestContext* context)
+{
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/pipeline_cache.bin", ARTIFACTS_DIR);
+    remove(path);
+    bool loaded = false;
+
+    // Cold start: no cache file yet.
+    double cold = _graphics_builtin_startup(path, &loaded);
+    AT(!loaded);
+    size_t size = 0;
+    uint32_t* data = dvz_read_file(path, &size);
+    AT(data != NULL);
+    AT(size > 0);
+
+    // Warm start: the cache file written by the previous run is used.
+    double warm = _graphics_builtin_startup(path, &loaded);
+    AT(loaded);
+    log_info(
+        "builtin graphics pipelines created in %.1f ms with a cold cache, %.1f ms with a warm "
+        "cache",
+        cold * 1e3, warm * 1e3);
+
+    // A corrupted cache file is discarded.
+    ((uint8_t*)data)[size - 1] ^= 0xFF;
+    FILE* f = fopen(path, "wb");
+    AT(f != NULL);
+    fwrite(data, size, 1, f);
+    fclose(f);
+    FREE(data);
+
+    _graphics_builtin_startup(path, &loaded);
+    AT(!loaded);
+
+    // The invalid cache file has been overwritten when the app was destroyed.
+    _graphics_builtin_startup(path, &loaded);
+    AT(loaded);
+
+    AT(remove(path) == 0);
+    return 0;
+}
+
+
+
+int test_graphics_registry(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* c0 = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzCanvas* c1 = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    // The same pipeline is returned for the same state, in all canvases of the GPU.
+    DvzGraphics* g0 = dvz_graphics_builtin(c0, DVZ_GRAPHICS_MARKER, 0);
+    DvzGraphics* g1 = dvz_graphics_builtin(c0, DVZ_GRAPHICS_MARKER, 0);
+    DvzGraphics* g2 = dvz_graphics_builtin(c1, DVZ_GRAPHICS_MARKER, 0);
+    AT(g0 == g1);
+    AT(g0 == g2);
+    AT(dvz_obj_is_created(&g0->obj));
+    AT(g0->shader_modules[0] != VK_NULL_HANDLE);
+
+    // A different state gives a different pipeline.
+    DvzGraphics* g3 = dvz_graphics_builtin(c0, DVZ_GRAPHICS_TRIANGLE, 0);
+    DvzGraphics* g4 =
+        dvz_graphics_builtin(c1, DVZ_GRAPHICS_TRIANGLE, DVZ_GRAPHICS_FLAGS_DEPTH_TEST_ENABLE);
+    AT(g3 != g0);
+    AT(g3 != g4);
+
+    DvzGraphicsStats stats = dvz_graphics_stats(gpu->context);
+    AT(stats.requests == 5);
+    AT(stats.created == 3);
+    AT(stats.count == 3);
+
+    // The pipelines are destroyed when they are no longer used by any canvas.
+    dvz_canvas_destroy(c0);
+    stats = dvz_graphics_stats(gpu->context);
+    AT(stats.count == 2);
+    AT(dvz_obj_is_created(&g0->obj));
+
+    TEST_END
+}
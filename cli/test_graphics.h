@@ -12,6 +12,8 @@
 int test_graphics_dynamic(TestContext* context);
 int test_graphics_3D(TestContext* context);
 int test_graphics_depth(TestContext* context);
+int test_graphics_pipeline_cache(TestContext* context);
+int test_graphics_registry(TestContext* context);
 
 // Basic graphics.
 int test_graphics_point(TestContext* context);
@@ -27,6 +29,8 @@ int test_graphics_marker_screenshots(TestContext* context);
 int test_graphics_segment(TestContext* context);
 int test_graphics_path(TestContext* context);
 int test_graphics_text(TestContext* context);
+int test_graphics_text_bulk(TestContext* context);
+int test_graphics_glyph_atlas(TestContext* context);
 int test_graphics_image_1(TestContext* context);
 int test_graphics_image_cmap(TestContext* context);
 
@@ -108,6 +108,60 @@ int test_axes_3(TestContext* context)
 
 
 
+int test_axes_4(TestContext* context)
+{
+    DvzAxesContext ctx = {0};
+    ctx.coord = DVZ_AXES_COORD_X;
+    ctx.size_viewport = 1000;
+    ctx.size_glyph = 10;
+    ctx.extensions = 1;
+
+    // Close ranges share the same cached ticks.
+    DvzAxesTicksCache cache = {0};
+    DvzAxesTicks ticks = dvz_ticks_cached(&cache, -1.03, 1.02, ctx);
+    DvzAxesTicks other = dvz_ticks_cached(&cache, -1.031, 1.021, ctx);
+    AT(cache.misses == 1);
+    AT(cache.hits == 1);
+    AT(_ticks_equal(&ticks, &other));
+    dvz_ticks_destroy(&other);
+
+    // Pan and check the shifted labels.
+    char fmt[12] = {0};
+    char label[MAX_GLYPHS_PER_TICK] = {0};
+    double w = 2.05, c = 0;
+    bool changed = false;
+    uint32_t shifts = 0;
+    for (uint32_t f = 0; f < 1000; f++)
+    {
+        c += .013;
+        changed = false;
+        if (!dvz_ticks_pan(&ticks, c - w / 2, c + w / 2, &ctx, &changed))
+        {
+            dvz_ticks_destroy(&ticks);
+            ticks = dvz_ticks_cached(&cache, c - w / 2, c + w / 2, ctx);
+            continue;
+        }
+        AT(ticks.lmin_in <= c - w / 2);
+        AT(c + w / 2 <= ticks.lmax_in);
+        if (!changed)
+            continue;
+        shifts++;
+        _get_tick_format(ticks.format, ticks.precision, fmt);
+        for (uint32_t i = 0; i < ticks.value_count; i++)
+        {
+            _tick_label(ticks.lmin_in + i * ticks.lstep, fmt, label);
+            AT(strcmp(label, &ticks.labels[i * MAX_GLYPHS_PER_TICK]) == 0);
+        }
+    }
+    AT(shifts > 0);
+
+    dvz_ticks_destroy(&ticks);
+    dvz_ticks_cache_destroy(&cache);
+    return 0;
+}
+
+
+
 /*************************************************************************************************/
 /*  Scene tests                                                                                  */
 /*************************************************************************************************/
@@ -461,3 +515,341 @@ int test_scene_logistic(TestContext* context)
     dvz_scene_destroy(scene);
     TEST_END
 }
+
+
+
+// Download the normalized positions of a visual, and compare them to the expected values.
+static int _check_pos(DvzCanvas* canvas, DvzPanel* panel, DvzVisual* visual, dvec3* pos)
+{
+    DvzSource* source = dvz_source_get(visual, DVZ_SOURCE_TYPE_VERTEX, 0);
+    DvzProp* prop = dvz_prop_get(visual, DVZ_PROP_POS, 0);
+    DvzArray* arr = &source->arr;
+    VkDeviceSize size = arr->item_count * arr->item_size;
+    uint8_t* data = calloc(size, 1);
+    dvz_download_buffers(canvas, source->u.br, 0, size, data);
+
+    DvzBox box = panel->data_coords.box;
+    float* x = NULL;
+    for (uint32_t i = 0; i < arr->item_count; i++)
+    {
+        x = (float*)(data + i * arr->item_size + prop->offset);
+        for (uint32_t j = 0; j < 3; j++)
+            AC(x[j], -1 + 2 * (pos[i][j] - box.p0[j]) / (box.p1[j] - box.p0[j]), 1e-4);
+    }
+    FREE(data);
+    return 0;
+}
+
+int test_scene_transform_gpu(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, CANVAS_FLAGS);
+
+    DvzScene* scene = dvz_scene(canvas, 1, 1);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_PANZOOM, 0);
+    DvzVisual* visual_cpu = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+    DvzVisual* visual_gpu =
+        dvz_scene_visual(panel, DVZ_VISUAL_POINT, DVZ_VISUAL_FLAGS_TRANSFORM_GPU);
+
+    // Positions far from the origin, that cannot be normalized in single precision.
+    const uint32_t N = 1000;
+    dvec3* pos = calloc(N, sizeof(dvec3));
+    for (uint32_t i = 0; i < N; i++)
+    {
+        RANDN_POS(pos[i])
+        pos[i][0] += 1e9;
+    }
+    float param = 10.0f;
+    dvz_visual_data(visual_cpu, DVZ_PROP_POS, 0, N, pos);
+    dvz_visual_data(visual_cpu, DVZ_PROP_MARKER_SIZE, 0, 1, &param);
+    dvz_visual_data(visual_gpu, DVZ_PROP_POS, 0, N, pos);
+    dvz_visual_data(visual_gpu, DVZ_PROP_MARKER_SIZE, 0, 1, &param);
+
+    dvz_app_run(app, 3);
+    AT(dvz_prop_get(visual_gpu, DVZ_PROP_POS, 0)->transform_gpu != NULL);
+    AT(dvz_prop_get(visual_cpu, DVZ_PROP_POS, 0)->transform_gpu == NULL);
+    AT(_check_pos(canvas, panel, visual_cpu, pos) == 0);
+    AT(_check_pos(canvas, panel, visual_gpu, pos) == 0);
+
+    // Extend the panel box with the CPU visual only: the positions of the GPU visual are
+    // renormalized without being uploaded again.
+    for (uint32_t i = 0; i < N; i++)
+        pos[i][1] *= 2;
+    dvz_visual_data(visual_cpu, DVZ_PROP_POS, 0, N, pos);
+    dvz_app_run(app, 3);
+    AT(_check_pos(canvas, panel, visual_cpu, pos) == 0);
+    for (uint32_t i = 0; i < N; i++)
+        pos[i][1] /= 2;
+    AT(_check_pos(canvas, panel, visual_gpu, pos) == 0);
+
+    dvz_visual_destroy(visual_cpu);
+    dvz_visual_destroy(visual_gpu);
+    dvz_scene_destroy(scene);
+    FREE(pos);
+    TEST_END
+}
+
+
+
+int test_scene_box(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, CANVAS_FLAGS);
+
+    DvzScene* scene = dvz_scene(canvas, 1, 1);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_PANZOOM, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+    DvzVisual* other = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+    DvzProp* prop = dvz_prop_get(visual, DVZ_PROP_POS, 0);
+
+    const uint32_t N = 10000;
+    dvec3* pos = calloc(N, sizeof(dvec3));
+    for (uint32_t i = 0; i < N; i++)
+    {
+        RANDN_POS(pos[i])
+    }
+    float param = 10.0f;
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, N, pos);
+    dvz_visual_data(visual, DVZ_PROP_MARKER_SIZE, 0, 1, &param);
+    dvz_visual_data(other, DVZ_PROP_POS, 0, N, pos);
+    dvz_visual_data(other, DVZ_PROP_MARKER_SIZE, 0, 1, &param);
+    dvz_app_run(app, 3);
+    AT(prop->box_valid);
+    uint64_t scanned = scene->box_scanned_total;
+    uint64_t normalized = scene->pos_normalized_total;
+
+    // Appending points only scans the new points, the other visual is not scanned again.
+    dvec3 new_pos[3] = {{10, 0, 0}, {0, -10, 0}, {0, 0, 0}};
+    dvz_visual_data_append(visual, DVZ_PROP_POS, 0, 3, new_pos);
+    AT(prop->box_valid);
+    AC(prop->box.p1[0], 10, 1e-10);
+    AC(prop->box.p0[1], -10, 1e-10);
+    dvz_app_run(app, 3);
+    AT(scene->box_scanned_total == scanned + 3);
+    AC(panel->data_coords.box.p1[0], 10, 1e-10);
+    AC(panel->data_coords.box.p0[1], -10, 1e-10);
+    // The panel box has changed, so both visuals are normalized again.
+    AT(scene->pos_normalized_total >= normalized + 2 * N + 3);
+
+    // Appending a point inside the box only scans and normalizes that point.
+    scanned = scene->box_scanned_total;
+    normalized = scene->pos_normalized_total;
+    dvz_visual_data_append(visual, DVZ_PROP_POS, 0, 1, (dvec3){0, 0, 0});
+    dvz_app_run(app, 3);
+    AT(scene->box_scanned_total == scanned + 1);
+    AT(scene->pos_normalized_total == normalized + 1);
+    AT(prop->trans_count == N + 4);
+
+    // Overwriting an interior point keeps the cached box.
+    dvz_visual_data_partial(visual, DVZ_PROP_POS, 0, N + 2, 1, 1, (dvec3){0, .1, 0});
+    AT(prop->box_valid);
+    AC(prop->box.p0[1], -10, 1e-10);
+
+    // Overwriting a point on the boundary invalidates it.
+    dvz_visual_data_partial(visual, DVZ_PROP_POS, 0, N + 1, 1, 1, (dvec3){0, 0, 0});
+    AT(!prop->box_valid);
+    dvz_app_run(app, 3);
+    AT(prop->box_valid);
+    AC(panel->data_coords.box.p1[0], 10, 1e-10);
+    AT(panel->data_coords.box.p0[1] > -10);
+
+    // Replacing all points invalidates the box.
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, N, pos);
+    AT(!prop->box_valid);
+
+    dvz_visual_destroy(visual);
+    dvz_visual_destroy(other);
+    dvz_scene_destroy(scene);
+    FREE(pos);
+    TEST_END
+}
+
+
+
+int test_scene_stream_box(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, CANVAS_FLAGS);
+
+    DvzScene* scene = dvz_scene(canvas, 1, 1);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_PANZOOM, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+    DvzVisual* other = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+    DvzProp* prop = dvz_prop_get(visual, DVZ_PROP_POS, 0);
+
+    float param = 10.0f;
+    dvec3 pos[2] = {{-1, -1, 0}, {1, 1, 0}};
+    dvz_visual_data(other, DVZ_PROP_POS, 0, 2, pos);
+    dvz_visual_data(other, DVZ_PROP_MARKER_SIZE, 0, 1, &param);
+
+    dvz_visual_stream(visual, 100);
+    dvz_visual_data(visual, DVZ_PROP_MARKER_SIZE, 0, 1, &param);
+    dvec3 streamed[2] = {{0, 0, 0}, {10, 5, 0}};
+    dvz_visual_data_append(visual, DVZ_PROP_POS, 0, 2, streamed);
+    dvz_app_run(app, 3);
+
+    // The streamed items are no longer on the CPU, but their box is kept.
+    AT(prop->arr_orig.item_count == 0);
+    AT(visual->stream->box_valid);
+    AC(visual->stream->box.p1[0], 10, 1e-10);
+    AC(panel->data_coords.box.p1[0], 10, 1e-10);
+
+    // Streamed items outside the box extend the box of the streamed items.
+    dvz_visual_data_append(visual, DVZ_PROP_POS, 0, 1, (dvec3){20, 0, 0});
+    dvz_app_run(app, 3);
+    AT(prop->arr_orig.item_count == 0);
+    AC(visual->stream->box.p1[0], 20, 1e-10);
+
+    // The panel box is recomputed when the other visual changes, and it still contains all
+    // streamed items.
+    pos[1][0] = pos[1][1] = .5;
+    dvz_visual_data(other, DVZ_PROP_POS, 0, 2, pos);
+    dvz_app_run(app, 3);
+    AC(panel->data_coords.box.p0[0], -1, 1e-10);
+    AC(panel->data_coords.box.p1[0], 20, 1e-10);
+    AC(panel->data_coords.box.p1[1], 5, 1e-10);
+
+    dvz_visual_destroy(visual);
+    dvz_visual_destroy(other);
+    dvz_scene_destroy(scene);
+    TEST_END
+}
+
+
+
+int test_scene_refill(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, CANVAS_FLAGS);
+
+    DvzScene* scene = dvz_scene(canvas, 1, 2);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_PANZOOM, 0);
+    DvzPanel* other = dvz_scene_panel(scene, 0, 1, DVZ_CONTROLLER_PANZOOM, 0);
+    DvzVisual* visual = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+    DvzVisual* visual_other = dvz_scene_visual(other, DVZ_VISUAL_POINT, 0);
+
+    const uint32_t N = 1000;
+    dvec3* pos = calloc(N, sizeof(dvec3));
+    for (uint32_t i = 0; i < N; i++)
+    {
+        RANDN_POS(pos[i])
+    }
+    float param = 10.0f;
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, N, pos);
+    dvz_visual_data(visual, DVZ_PROP_MARKER_SIZE, 0, 1, &param);
+    dvz_visual_data(visual_other, DVZ_PROP_POS, 0, N, pos);
+    dvz_visual_data(visual_other, DVZ_PROP_MARKER_SIZE, 0, 1, &param);
+    dvz_app_run(app, 10);
+
+    // Both panels have been recorded for all swapchain images.
+    uint32_t img_count = canvas->cmds_render.count;
+    uint64_t recorded = scene->cmds_recorded_total;
+    AT(recorded >= 2 * img_count);
+    for (uint32_t i = 0; i < img_count; i++)
+    {
+        AT(!panel->cmds_dirty[i]);
+        AT(!other->cmds_dirty[i]);
+    }
+
+    // Changing the number of points of one visual only re-records its panel.
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, N / 2, pos);
+    dvz_app_run(app, 10);
+    AT(scene->cmds_recorded_total == recorded + img_count);
+    AT(scene->cmds_recorded == 1);
+
+    // Growing one visual past the capacity of the shared vertex buffer recreates it: the other
+    // panel must be re-recorded too, as its command buffers bound the destroyed buffer.
+    uint64_t generation = gpu->context->buffers_generation;
+    recorded = scene->cmds_recorded_total;
+    const uint32_t n = DVZ_BUFFER_TYPE_VERTEX_SIZE / sizeof(vec3) + 1;
+    dvec3* pos_large = calloc(n, sizeof(dvec3));
+    for (uint32_t i = 0; i < n; i++)
+    {
+        RANDN_POS(pos_large[i])
+    }
+    dvz_visual_data(visual, DVZ_PROP_POS, 0, n, pos_large);
+    dvz_app_run(app, 10);
+    AT(gpu->context->buffers_generation > generation);
+    AT(canvas->buffers_generation == gpu->context->buffers_generation);
+    AT(scene->cmds_recorded_total >= recorded + 2 * img_count);
+    for (uint32_t i = 0; i < img_count; i++)
+    {
+        AT(!panel->cmds_dirty[i]);
+        AT(!other->cmds_dirty[i]);
+    }
+
+    // The other panel keeps drawing from the new buffer without being re-recorded again.
+    recorded = scene->cmds_recorded_total;
+    dvz_app_run(app, 10);
+    AT(scene->cmds_recorded_total == recorded);
+
+    dvz_visual_destroy(visual);
+    dvz_visual_destroy(visual_other);
+    dvz_scene_destroy(scene);
+    FREE(pos);
+    FREE(pos_large);
+    TEST_END
+}
+
+
+
+int test_scene_batch(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzContext* ctx = gpu->context;
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, CANVAS_FLAGS);
+
+    DvzScene* scene = dvz_scene(canvas, 1, 1);
+    DvzPanel* panel = dvz_scene_panel(scene, 0, 0, DVZ_CONTROLLER_PANZOOM, 0);
+    dvz_panel_batch(panel, true);
+
+    // The visuals share their uniform buffers, so that they can be drawn in a single batch.
+    DvzBufferRegions br_params =
+        dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_UNIFORM, 1, sizeof(DvzGraphicsPointParams));
+    DvzBufferRegions br_viewport =
+        dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_UNIFORM, 1, sizeof(DvzViewport));
+
+    const uint32_t n_visuals = 8;
+    const uint32_t N = 100;
+    dvec3* pos = calloc(N, sizeof(dvec3));
+    float param = 10.0f;
+    DvzVisual* visuals[8] = {0};
+    for (uint32_t i = 0; i < n_visuals; i++)
+    {
+        visuals[i] = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+        dvz_visual_buffer(visuals[i], DVZ_SOURCE_TYPE_PARAM, 0, br_params);
+        dvz_visual_buffer(visuals[i], DVZ_SOURCE_TYPE_VIEWPORT, 0, br_viewport);
+        for (uint32_t j = 0; j < N; j++)
+        {
+            RANDN_POS(pos[j])
+        }
+        dvz_visual_data(visuals[i], DVZ_PROP_POS, 0, N, pos);
+        dvz_visual_data(visuals[i], DVZ_PROP_MARKER_SIZE, 0, 1, &param);
+    }
+    dvz_app_run(app, 10);
+    AT(panel->batched == n_visuals);
+
+    // A visual with its own uniform buffers is drawn on its own, after the batch.
+    DvzVisual* single = dvz_scene_visual(panel, DVZ_VISUAL_POINT, 0);
+    dvz_visual_data(single, DVZ_PROP_POS, 0, N, pos);
+    dvz_visual_data(single, DVZ_PROP_MARKER_SIZE, 0, 1, &param);
+    dvz_app_run(app, 10);
+    AT(panel->batched == n_visuals);
+
+    // Without batching, every visual is drawn on its own.
+    dvz_panel_batch(panel, false);
+    dvz_app_run(app, 10);
+    AT(canvas->cmds_render.draw_count[0] >= n_visuals);
+
+    for (uint32_t i = 0; i < n_visuals; i++)
+        dvz_visual_destroy(visuals[i]);
+    dvz_visual_destroy(single);
+    dvz_scene_destroy(scene);
+    FREE(pos);
+    TEST_END
+}
@@ -12,12 +12,18 @@
 int test_axes_1(TestContext* context);
 int test_axes_2(TestContext* context);
 int test_axes_3(TestContext* context);
+int test_axes_4(TestContext* context);
 
 int test_scene_0(TestContext* context);
 int test_scene_1(TestContext* context);
 int test_scene_mesh(TestContext* context);
 int test_scene_axes(TestContext* context);
 int test_scene_logistic(TestContext* context);
+int test_scene_transform_gpu(TestContext* context);
+int test_scene_box(TestContext* context);
+int test_scene_stream_box(TestContext* context);
+int test_scene_refill(TestContext* context);
+int test_scene_batch(TestContext* context);
 
 
 
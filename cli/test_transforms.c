@@ -215,3 +215,147 @@ int test_transforms_5(TestContext* context)
 
     TEST_END
 }
+
+
+
+int test_transforms_normalize(TestContext* context)
+{
+    // More than one chunk, and not a multiple of the SIMD width.
+    const uint32_t n = 2 * DVZ_TRANSFORM_CHUNK_SIZE + 3;
+    DvzBox box = {{-10, 0, 1}, {10, 100, 2}};
+    DvzDataType dtypes[] = {DVZ_DTYPE_DOUBLE, DVZ_DTYPE_DVEC2, DVZ_DTYPE_DVEC3,
+                            DVZ_DTYPE_FLOAT,  DVZ_DTYPE_VEC2,  DVZ_DTYPE_VEC3};
+    DvzWorkers workers = dvz_workers(4);
+    DvzSimdLevel max_level = dvz_simd_level();
+
+    for (uint32_t d = 0; d < 6; d++)
+    {
+        DvzArray pos_in = dvz_array(n, dtypes[d]);
+        bool is_double = d < 3;
+        uint32_t c = (uint32_t)pos_in.item_size / (is_double ? sizeof(double) : sizeof(float));
+        double x = 0, y = 0;
+        for (uint32_t i = 0; i < n * c; i++)
+        {
+            x = box.p0[i % c] + (box.p1[i % c] - box.p0[i % c]) * dvz_rand_float();
+            if (is_double)
+                ((double*)pos_in.data)[i] = x;
+            else
+                ((float*)pos_in.data)[i] = (float)x;
+        }
+
+        // Scalar, serial reference.
+        DvzArray pos_ref = {0};
+        dvz_simd_set_level(DVZ_SIMD_NONE);
+        DvzBox bounds_ref = dvz_transform_normalize(NULL, box, &pos_in, &pos_ref);
+        AT(pos_ref.item_count == n);
+        AT(pos_ref.dtype == dtypes[d]);
+        for (uint32_t j = 0; j < 3; j++)
+        {
+            AT(bounds_ref.p0[j] >= (j < c ? box.p0[j] : 0));
+            AT(bounds_ref.p1[j] <= (j < c ? box.p1[j] : 0));
+        }
+        for (uint32_t i = 0; i < n * c; i++)
+        {
+            x = is_double ? ((double*)pos_in.data)[i] : ((float*)pos_in.data)[i];
+            y = is_double ? ((double*)pos_ref.data)[i] : ((float*)pos_ref.data)[i];
+            AC(y, -1 + 2 * (x - box.p0[i % c]) / (box.p1[i % c] - box.p0[i % c]), 1e-5);
+        }
+
+        // Bounding boxes of two complementary ranges.
+        DvzBox b0 = dvz_box_bounding_range(NULL, &pos_in, 0, n / 3);
+        DvzBox b1 = dvz_box_bounding_range(NULL, &pos_in, n / 3, n - n / 3);
+        for (uint32_t j = 0; j < 3; j++)
+        {
+            AT(MIN(b0.p0[j], b1.p0[j]) == bounds_ref.p0[j]);
+            AT(MAX(b0.p1[j], b1.p1[j]) == bounds_ref.p1[j]);
+        }
+
+        // All SIMD levels and thread counts must give exactly the same result. The output
+        // array is reused.
+        DvzArray pos_out = {0};
+        for (int32_t level = (int32_t)max_level; level >= 0; level--)
+        {
+            dvz_simd_set_level((DvzSimdLevel)level);
+            for (uint32_t threads = 1; threads <= 4; threads *= 2)
+            {
+                dvz_workers_resize(&workers, threads);
+                DvzBox bounds = dvz_transform_normalize(&workers, box, &pos_in, &pos_out);
+                AT(memcmp(pos_out.data, pos_ref.data, n * pos_in.item_size) == 0);
+                AT(memcmp(&bounds, &bounds_ref, sizeof(DvzBox)) == 0);
+                bounds = dvz_box_bounding(&workers, &pos_in);
+                AT(memcmp(&bounds, &bounds_ref, sizeof(DvzBox)) == 0);
+            }
+        }
+        dvz_simd_set_level(max_level);
+
+        // Strided positions borrowed from an interleaved buffer.
+        VkDeviceSize stride = pos_in.item_size + 8;
+        uint8_t* buf = (uint8_t*)calloc(n, stride);
+        for (uint32_t i = 0; i < n; i++)
+            memcpy(buf + i * stride, dvz_array_item(&pos_in, i), pos_in.item_size);
+        DvzArray pos_strided = dvz_array_borrow(n, dtypes[d], stride, buf, NULL, NULL);
+        DvzBox bounds = dvz_transform_normalize(&workers, box, &pos_strided, &pos_out);
+        AT(memcmp(pos_out.data, pos_ref.data, n * pos_in.item_size) == 0);
+        AT(memcmp(&bounds, &bounds_ref, sizeof(DvzBox)) == 0);
+        bounds = dvz_box_bounding_range(NULL, &pos_strided, n / 3, n - n / 3);
+        AT(memcmp(&bounds, &b1, sizeof(DvzBox)) == 0);
+        dvz_array_destroy(&pos_strided);
+        FREE(buf);
+
+        dvz_array_destroy(&pos_in);
+        dvz_array_destroy(&pos_ref);
+        dvz_array_destroy(&pos_out);
+    }
+
+    dvz_workers_destroy(&workers);
+    return 0;
+}
+
+
+
+int test_transforms_split(TestContext* context)
+{
+    // Small range far from the origin, that cannot be normalized with single-precision floats.
+    const uint32_t n = 2 * DVZ_TRANSFORM_CHUNK_SIZE + 3;
+    DvzDataCoords coords = {0};
+    coords.transform = DVZ_TRANSFORM_CARTESIAN;
+    coords.box = (DvzBox){{1e9, -1e6, 0}, {1e9 + 1, -1e6 + 1e-2, 1}};
+    DvzWorkers workers = dvz_workers(4);
+
+    DvzArray pos_in = dvz_array(n, DVZ_DTYPE_DVEC3);
+    double* x = (double*)pos_in.data;
+    for (uint32_t i = 0; i < 3 * n; i++)
+        x[i] = coords.box.p0[i % 3] +
+               (coords.box.p1[i % 3] - coords.box.p0[i % 3]) * dvz_rand_float();
+
+    DvzArray split = {0};
+    DvzBox bounds = dvz_transform_split(&workers, &pos_in, &split);
+    AT(split.item_count == n);
+    AT(split.item_size == 6 * sizeof(float));
+    DvzBox bounds_ref = dvz_box_bounding(NULL, &pos_in);
+    AT(memcmp(&bounds, &bounds_ref, sizeof(DvzBox)) == 0);
+
+    // Same arithmetic as the compute shader, in single precision.
+    DvzTransformParams params = dvz_transform_params(coords);
+    AT(params.transform == DVZ_TRANSFORM_CARTESIAN);
+    float* s = (float*)split.data;
+    float y = 0;
+    double y_ref = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        for (uint32_t j = 0; j < 3; j++)
+        {
+            AC((double)s[6 * i + j] + (double)s[6 * i + 3 + j], x[3 * i + j], 1e-5);
+            y = ((s[6 * i + j] - params.center_hi[j]) + (s[6 * i + 3 + j] - params.center_lo[j])) *
+                params.scale[j];
+            y_ref = -1 + 2 * (x[3 * i + j] - coords.box.p0[j]) /
+                             (coords.box.p1[j] - coords.box.p0[j]);
+            AC(y, y_ref, 1e-4);
+        }
+    }
+
+    dvz_array_destroy(&pos_in);
+    dvz_array_destroy(&split);
+    dvz_workers_destroy(&workers);
+    return 0;
+}
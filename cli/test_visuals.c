@@ -1,4 +1,5 @@
 #include "test_visuals.h"
+#include "../include/datoviz/builtin_visuals.h"
 #include "../include/datoviz/visuals.h"
 #include "../src/visuals_utils.h"
 #include "utils.h"
@@ -366,3 +367,206 @@ int test_visuals_5(TestContext* context)
     dvz_visual_destroy(&visual);
     TEST_END
 }
+
+
+
+// Bake the vertex source with a given number of threads and return a copy of the baked array.
+static DvzArray _bake_threads(DvzVisual* visual, uint32_t thread_count)
+{
+    ASSERT(visual != NULL);
+    dvz_app_threads(visual->canvas->app, thread_count);
+    visual->callback_bake(visual, (DvzVisualDataEvent){0});
+    DvzSource* source = dvz_source_get(visual, DVZ_SOURCE_TYPE_VERTEX, 0);
+    ASSERT(source != NULL);
+    return dvz_array_copy(&source->arr);
+}
+
+static int _bake_threads_identical(DvzVisual* visual)
+{
+    DvzArray serial = _bake_threads(visual, 1);
+    ASSERT(serial.item_count > DVZ_BAKE_PARALLEL_THRESHOLD);
+    int res = 0;
+    for (uint32_t thread_count = 2; thread_count <= 8; thread_count *= 2)
+    {
+        DvzArray parallel = _bake_threads(visual, thread_count);
+        if (parallel.item_count != serial.item_count ||
+            memcmp(parallel.data, serial.data, serial.buffer_size) != 0)
+            res = 1;
+        dvz_array_destroy(&parallel);
+    }
+    dvz_array_destroy(&serial);
+    return res;
+}
+
+int test_visuals_bake_threads(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    const uint32_t N = 300000;
+    dvec3* pos = calloc(2 * N, sizeof(dvec3));
+    cvec4* color = calloc(N, sizeof(cvec4));
+    float* size = calloc(N, sizeof(float));
+    for (uint32_t i = 0; i < N; i++)
+    {
+        RANDN_POS(pos[2 * i]);
+        RANDN_POS(pos[2 * i + 1]);
+        RAND_COLOR(color[i]);
+        size[i] = 5 + 45 * dvz_rand_float();
+    }
+
+    // Marker visual: cast and DPI-scaled props.
+    {
+        DvzVisual visual = dvz_visual(canvas);
+        dvz_visual_builtin(&visual, DVZ_VISUAL_MARKER, 0);
+        dvz_visual_data(&visual, DVZ_PROP_POS, 0, N, pos);
+        dvz_visual_data(&visual, DVZ_PROP_COLOR, 0, N, color);
+        dvz_visual_data(&visual, DVZ_PROP_MARKER_SIZE, 0, N, size);
+        AT(_bake_threads_identical(&visual) == 0);
+        dvz_visual_destroy(&visual);
+    }
+
+    // Line visual: repeated props, with fewer colors than segments.
+    {
+        DvzVisual visual = dvz_visual(canvas);
+        dvz_visual_builtin(&visual, DVZ_VISUAL_LINE, 0);
+        dvz_visual_data(&visual, DVZ_PROP_POS, 0, N, pos);
+        dvz_visual_data(&visual, DVZ_PROP_POS, 1, N, &pos[N]);
+        dvz_visual_data(&visual, DVZ_PROP_COLOR, 0, N / 3, color);
+        AT(_bake_threads_identical(&visual) == 0);
+        dvz_visual_destroy(&visual);
+    }
+
+    FREE(pos);
+    FREE(color);
+    FREE(size);
+    TEST_END
+}
+
+
+
+int test_visuals_lookup(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+
+    DvzVisual visual = dvz_visual(canvas);
+    dvz_visual_builtin(&visual, DVZ_VISUAL_AXES_2D, 0);
+
+    // Sources, by index and by pipeline.
+    DvzSource* vertex0 = dvz_source_get(&visual, DVZ_SOURCE_TYPE_VERTEX, 0);
+    DvzSource* vertex1 = dvz_source_get(&visual, DVZ_SOURCE_TYPE_VERTEX, 1);
+    AT(vertex0 != NULL);
+    AT(vertex1 != NULL);
+    AT(vertex0->source_idx == 0);
+    AT(vertex1->source_idx == 1);
+    AT(dvz_source_get(&visual, DVZ_SOURCE_TYPE_VERTEX, 2) == NULL);
+    AT(_get_pipeline_source(&visual, DVZ_SOURCE_TYPE_VERTEX, 1) == vertex1);
+    AT(_get_pipeline_source(&visual, DVZ_SOURCE_TYPE_INDEX, 1) == NULL);
+
+    // Many props, so that the lookup table is resized several times.
+    const uint32_t n = 100;
+    for (uint32_t i = 0; i < n; i++)
+        dvz_visual_prop(&visual, DVZ_PROP_RANGE, i, DVZ_DTYPE_VEC2, DVZ_SOURCE_TYPE_NONE, 0);
+    AT(visual.prop_lookup.count == visual.props.count);
+    AT(2 * visual.prop_lookup.count <= visual.prop_lookup.capacity);
+
+    // Every prop is found with its type and index.
+    DvzProp* prop = NULL;
+    DvzContainerIterator iter = dvz_container_iterator(&visual.props);
+    while (iter.item != NULL)
+    {
+        prop = iter.item;
+        AT(dvz_prop_get(&visual, prop->prop_type, prop->prop_idx) == prop);
+        dvz_container_iter(&iter);
+    }
+    AT(dvz_prop_get(&visual, DVZ_PROP_RANGE, n) == NULL);
+    AT(dvz_prop_get(&visual, DVZ_PROP_POS, DVZ_AXES_LEVEL_COUNT) == NULL);
+
+    dvz_visual_destroy(&visual);
+    TEST_END
+}
+
+
+
+int test_visuals_stream(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_OFFSCREEN);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzCanvas* canvas = dvz_canvas(gpu, TEST_WIDTH, TEST_HEIGHT, 0);
+    DvzVisual visual = dvz_visual(canvas);
+    _marker_visual(&visual);
+
+    // Ring buffer with room for 8 items.
+    const uint32_t H = 8;
+    dvz_visual_stream(&visual, H);
+    AT(visual.stream != NULL);
+    AT(visual.stream->capacity == H);
+    AT(!visual.stream->mirror);
+
+    dvec3 pos[5] = {0};
+    cvec4 color = {255, 0, 0, 255};
+    dvz_visual_data(&visual, DVZ_PROP_COLOR, 0, 1, color);
+
+    // Append 3 batches of 5 items: the last batch wraps around the end of the ring buffer.
+    double x = 0;
+    for (uint32_t k = 0; k < 3; k++)
+    {
+        for (uint32_t i = 0; i < 5; i++)
+            pos[i][0] = x++;
+        dvz_visual_data_append(&visual, DVZ_PROP_POS, 0, 5, pos);
+        dvz_visual_update(&visual, canvas->viewport, (DvzDataCoords){0}, NULL);
+        dvz_app_run(app, 3);
+
+        // Only the appended items have been kept on the CPU.
+        AT(dvz_prop_get(&visual, DVZ_PROP_POS, 0)->arr_orig.item_count == 0);
+    }
+
+    // 15 items have been appended, the first 7 ones have been overwritten.
+    DvzVisualStream* stream = visual.stream;
+    AT(stream->head == 7);
+    AT(stream->count == H);
+    AT(stream->draws[0].firstVertex == 7);
+    AT(stream->draws[0].vertexCount == 1);
+    AT(stream->draws[1].firstVertex == 0);
+    AT(stream->draws[1].vertexCount == 7);
+
+    DvzVisualStreamStats stats = dvz_visual_stream_stats(&visual);
+    AT(stats.uploads == 3);
+    AT(stats.items == 15);
+    AT(stats.discarded == 7);
+    AT(stats.bytes == 15 * sizeof(DvzVertex));
+
+    // Check the contents of the ring buffer: items 8 to 14 then item 7.
+    DvzSource* source = dvz_source_get(&visual, DVZ_SOURCE_TYPE_VERTEX, 0);
+    DvzVertex vertices[8] = {0};
+    dvz_download_buffers(canvas, source->u.br, 0, H * sizeof(DvzVertex), vertices);
+    dvz_app_run(app, 3);
+    for (uint32_t i = 0; i < H; i++)
+    {
+        AC(vertices[i].pos[0], (i < 7 ? 8 + i : 7), 1e-6);
+        AT(vertices[i].color[0] == 255);
+    }
+
+    // Appending more items than the history only keeps the last ones.
+    dvec3 many[20] = {0};
+    for (uint32_t i = 0; i < 20; i++)
+        many[i][0] = 100 + i;
+    dvz_visual_data_append(&visual, DVZ_PROP_POS, 0, 20, many);
+    dvz_visual_update(&visual, canvas->viewport, (DvzDataCoords){0}, NULL);
+    dvz_app_run(app, 3);
+    stats = dvz_visual_stream_stats(&visual);
+    AT(stats.items == 35);
+    AT(stats.discarded == 7 + 20);
+    AT(stream->count == H);
+
+    dvz_download_buffers(canvas, source->u.br, 0, H * sizeof(DvzVertex), vertices);
+    dvz_app_run(app, 3);
+    for (uint32_t i = 0; i < H; i++)
+        AC(vertices[(stream->draws[0].firstVertex + i) % H].pos[0], (112 + i), 1e-6);
+
+    dvz_visual_destroy(&visual);
+    TEST_END
+}
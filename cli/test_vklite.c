@@ -195,6 +195,86 @@ int test_vklite_buffer_resize(TestContext* context)
 
 
 
+int test_vklite_memory(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    dvz_gpu_queue(gpu, 0, DVZ_QUEUE_RENDER);
+    dvz_gpu_create(gpu, 0);
+
+    // Many small buffers share a few memory blocks.
+    const uint32_t n = 1000;
+    DvzBuffer* buffers = calloc(n, sizeof(DvzBuffer));
+    uint8_t data[64] = {0};
+    uint8_t data2[64] = {0};
+    for (uint32_t i = 0; i < n; i++)
+    {
+        buffers[i] = dvz_buffer(gpu);
+        dvz_buffer_size(&buffers[i], 64 + 64 * (i % 10));
+        dvz_buffer_usage(
+            &buffers[i], VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+        dvz_buffer_memory(
+            &buffers[i],
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        dvz_buffer_queue_access(&buffers[i], 0);
+        dvz_buffer_create(&buffers[i]);
+        AT(buffers[i].allocation.block_idx != UINT32_MAX);
+        AT(buffers[i].allocation.offset % DVZ_MEMORY_MIN_SIZE_CLASS == 0);
+
+        memset(data, (int)i, sizeof(data));
+        dvz_buffer_upload(&buffers[i], 0, sizeof(data), data);
+    }
+    DvzMemoryStats stats = dvz_gpu_memory_stats(gpu, DVZ_MEMORY_TYPE_ALL);
+    AT(stats.alloc_count == n);
+    AT(stats.block_count == 1);
+    AT(stats.dedicated_count == 0);
+
+    // The regions do not overlap.
+    for (uint32_t i = 0; i < n; i++)
+    {
+        memset(data, (int)i, sizeof(data));
+        dvz_buffer_download(&buffers[i], 0, sizeof(data2), data2);
+        AT(memcmp(data, data2, sizeof(data)) == 0);
+    }
+
+    // Images are suballocated too, large images get a dedicated allocation.
+    DvzImages images = dvz_images(gpu, VK_IMAGE_TYPE_2D, 2);
+    dvz_images_format(&images, VK_FORMAT_R8G8B8A8_UNORM);
+    dvz_images_size(&images, 16, 16, 1);
+    dvz_images_tiling(&images, VK_IMAGE_TILING_OPTIMAL);
+    dvz_images_usage(&images, VK_IMAGE_USAGE_SAMPLED_BIT);
+    dvz_images_memory(&images, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    dvz_images_queue_access(&images, 0);
+    dvz_images_create(&images);
+    AT(images.allocations[0].block_idx != UINT32_MAX);
+    AT(images.allocations[0].memory == images.allocations[1].memory);
+    dvz_images_resize(&images, 4096, 4096, 1);
+    AT(images.allocations[0].block_idx == UINT32_MAX);
+    AT(dvz_gpu_memory_stats(gpu, DVZ_MEMORY_TYPE_ALL).dedicated_count == 2);
+    dvz_images_destroy(&images);
+
+    // Free every other buffer: the freed ranges fragment the block.
+    for (uint32_t i = 0; i < n; i += 2)
+        dvz_buffer_destroy(&buffers[i]);
+    stats = dvz_gpu_memory_stats(gpu, DVZ_MEMORY_TYPE_ALL);
+    AT(stats.alloc_count == n / 2);
+    AT(stats.dedicated_count == 0);
+    AT(stats.free_ranges >= n / 2);
+    AT(stats.fragmentation > 0);
+    dvz_gpu_memory_print(gpu);
+
+    for (uint32_t i = 1; i < n; i += 2)
+        dvz_buffer_destroy(&buffers[i]);
+    stats = dvz_gpu_memory_stats(gpu, DVZ_MEMORY_TYPE_ALL);
+    AT(stats.alloc_count == 0);
+    AT(stats.used == 0);
+
+    FREE(buffers);
+    TEST_END
+}
+
+
+
 int test_vklite_compute(TestContext* context)
 {
     DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);
@@ -688,3 +768,72 @@ int test_default_app(TestContext* context)
 
     TEST_END
 }
+
+
+
+int test_context_buffers_churn(TestContext* context)
+{
+    DvzApp* app = dvz_app(DVZ_BACKEND_GLFW);
+    DvzGpu* gpu = dvz_gpu(app, 0);
+    DvzContext* ctx = dvz_context(gpu, NULL);
+
+    DvzBufferType type = DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE;
+    DvzBuffer* buffer = dvz_container_get(&ctx->buffers, type);
+    VkDeviceSize initial_size = buffer->size;
+    const VkDeviceSize size = 64 * 1024;
+
+    // Repeatedly allocate and free regions: freed space must be reused.
+    DvzBufferRegions br[16] = {0};
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        for (uint32_t j = 0; j < 16; j++)
+            br[j] = dvz_ctx_buffers(ctx, type, 1, size * (1 + (i + j) % 3));
+        for (uint32_t j = 0; j < 16; j++)
+            dvz_ctx_buffers_free(ctx, &br[j]);
+    }
+    AT(buffer->size == initial_size);
+    AT(dvz_ctx_buffers_stats(ctx, type).used == 0);
+
+    // Allocate regions, free every other one, and fill the remaining ones with data.
+    DvzBufferRegions* regions[8] = {0};
+    uint8_t data[256] = {0};
+    uint8_t data2[256] = {0};
+    for (uint32_t j = 0; j < 16; j++)
+        br[j] = dvz_ctx_buffers(ctx, type, 1, size);
+    for (uint32_t j = 0; j < 16; j++)
+    {
+        if (j % 2 == 0)
+        {
+            dvz_ctx_buffers_free(ctx, &br[j]);
+            continue;
+        }
+        memset(data, (int)j, sizeof(data));
+        dvz_buffer_upload(buffer, br[j].offsets[0], sizeof(data), data);
+        regions[j / 2] = &br[j];
+    }
+    DvzAllocStats stats = dvz_ctx_buffers_stats(ctx, type);
+    AT(stats.used == 8 * size);
+    AT(stats.end == 16 * size);
+
+    // Compaction: the regions are moved, the data is kept.
+    dvz_ctx_buffers_compact(ctx, type, 8, regions, 0, NULL);
+    stats = dvz_ctx_buffers_stats(ctx, type);
+    AT(stats.end == 8 * size);
+    AT(buffer->size == initial_size);
+    for (uint32_t j = 1; j < 16; j += 2)
+    {
+        memset(data, (int)j, sizeof(data));
+        dvz_buffer_download(buffer, br[j].offsets[0], sizeof(data2), data2);
+        AT(memcmp(data, data2, sizeof(data)) == 0);
+    }
+
+    // Resizing a region that cannot grow in-place moves it and keeps its data.
+    VkDeviceSize offset = br[1].offsets[0];
+    dvz_ctx_buffers_resize(ctx, &br[1], 2 * size);
+    AT(br[1].offsets[0] != offset);
+    memset(data, 1, sizeof(data));
+    dvz_buffer_download(buffer, br[1].offsets[0], sizeof(data2), data2);
+    AT(memcmp(data, data2, sizeof(data)) == 0);
+
+    TEST_END
+}
@@ -17,6 +17,7 @@ int test_vklite_swapchain(TestContext* context);
 int test_vklite_commands(TestContext* context);
 int test_vklite_buffer_1(TestContext* context);
 int test_vklite_buffer_resize(TestContext* context);
+int test_vklite_memory(TestContext* context);
 int test_vklite_compute(TestContext* context);
 int test_vklite_push(TestContext* context);
 int test_vklite_images(TestContext* context);
@@ -46,6 +47,7 @@ int test_context_transfer_async_thread(TestContext* context);
 int test_context_download(TestContext* context);
 
 int test_default_app(TestContext* context);
+int test_context_buffers_churn(TestContext* context);
 
 
 
@@ -338,6 +338,21 @@ static void print_end(int index, int res)
         printf("\x1b[31mThere were no tests.\x1b[0m\n");
 }
 
+static double bench_now()
+{
+    // Monotonic time in seconds, for the benchmarks.
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int compare_double(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
 
 
 /*************************************************************************************************/
@@ -88,8 +88,7 @@ static void add_stream(
     c->gop_size = 12; /* emit one intra frame every twelve frames at most */
     c->pix_fmt = AV_PIX_FMT_YUV420P;
 
-    // TODO: the current implementation is serial and makes poor use of multicore CPUs.
-    // What should be done is to separate the send frame/write frame logic.
+    // NOTE: the canvas feeds the encoder from a dedicated thread, see dvz_canvas_video().
     c->thread_count = NUM_THREADS;
     c->thread_type = FF_THREAD_FRAME;
 
@@ -215,6 +214,42 @@ static void close_stream(AVFormatContext* oc, OutputStream* ost)
     sws_freeContext(ost->sws_ctx);
 }
 
+// Convert one horizontal slice of the input image to YUV420P, with its own scaling context.
+static void convert_slice(void* user_data, uint32_t idx)
+{
+    Video* video = (Video*)user_data;
+    ASSERT(video != NULL);
+    ASSERT(idx < video->slice_count);
+    AVCodecContext* c = video->ost->enc;
+    AVFrame* frame = video->ost->frame;
+
+    int y0 = (int)idx * video->slice_height;
+    int h = MIN(video->slice_height, c->height - y0);
+    ASSERT(h > 0);
+
+    if (!video->sws[idx])
+    {
+        video->sws[idx] = sws_getContext(
+            c->width, h, video->bgra ? AV_PIX_FMT_BGRA : AV_PIX_FMT_RGBA, c->width, h,
+            c->pix_fmt, SCALE_FLAGS, NULL, NULL, NULL);
+        if (!video->sws[idx])
+        {
+            fprintf(stderr, "Could not initialize the conversion context\n");
+            return;
+        }
+    }
+
+    // The slice heights are even so that the chroma rows are not shared between slices.
+    const uint8_t* inData[1] = {video->input + 4 * (int64_t)c->width * y0};
+    int inLinesize[1] = {4 * c->width};
+    uint8_t* outData[3] = {
+        frame->data[0] + y0 * frame->linesize[0],
+        frame->data[1] + (y0 / 2) * frame->linesize[1],
+        frame->data[2] + (y0 / 2) * frame->linesize[2],
+    };
+    sws_scale(video->sws[idx], inData, inLinesize, 0, h, outData, frame->linesize);
+}
+
 // Public functions.
 Video* init_video(const char* filename, int width, int height, int fps, int bitrate)
 {
@@ -292,12 +327,22 @@ void create_video(Video* video)
 
     ost->oc = oc;
     video->ost = ost;
+
+    // Colour conversion slices.
+    video->workers = dvz_workers(0);
+    video->slice_count = CLIP(video->workers.thread_count, 1, VIDEO_MAX_SLICES);
+    int n = (int)video->slice_count;
+    video->slice_height = ((video->height + n - 1) / n + 1) & ~1;
+    video->slice_count = (uint32_t)((video->height + video->slice_height - 1) / video->slice_height);
+    ASSERT(video->slice_count <= VIDEO_MAX_SLICES);
 }
 
-void add_frame(Video* video, uint8_t* image)
+void add_frame(Video* video, uint8_t* image) { add_frame_at(video, image, video->ost->next_pts); }
+
+void add_frame_at(Video* video, uint8_t* image, int64_t pts)
 {
     OutputStream* ost = video->ost;
-    AVCodecContext* c = ost->enc;
+    ASSERT(pts >= ost->next_pts);
 
     /* when we pass a frame to the encoder, it may keep a reference to it
      * internally; make sure we do not overwrite it here */
@@ -306,25 +351,16 @@ void add_frame(Video* video, uint8_t* image)
         fprintf(stderr, "Could not write the frame\n");
     }
 
-    if (!ost->sws_ctx)
-    {
-        ost->sws_ctx = sws_getContext(
-            c->width, c->height, AV_PIX_FMT_RGBA, c->width, c->height, c->pix_fmt, SCALE_FLAGS,
-            NULL, NULL, NULL);
-        if (!ost->sws_ctx)
-        {
-            fprintf(stderr, "Could not initialize the conversion context\n");
-        }
-    }
     video->image = ost->frame->data[0];
     video->linesize = ost->frame->linesize[0];
-    // RGB to YUV420P
-    const uint8_t* inData[1] = {image};
-    int inLinesize[1] = {4 * c->width};
-    sws_scale(
-        ost->sws_ctx, inData, inLinesize, 0, c->height, ost->frame->data, ost->frame->linesize);
-
-    ost->frame->pts = ost->next_pts++;
+    // RGB to YUV420P, one slice per thread
+    video->input = image;
+    dvz_workers_run(&video->workers, video->slice_count, convert_slice, video);
+    video->input = NULL;
+
+    // NOTE: skipped timestamps keep the video in sync with the canvas when frames are dropped.
+    ost->frame->pts = pts;
+    ost->next_pts = pts + 1;
     video->frame = ost->frame;
 
     write_video_frame(video);
@@ -342,6 +378,9 @@ void end_video(Video* video)
 
     /* Close each codec. */
     close_stream(oc, video->ost);
+    for (uint32_t i = 0; i < video->slice_count; i++)
+        sws_freeContext(video->sws[i]);
+    dvz_workers_destroy(&video->workers);
 
     if (!(oc->oformat->flags & AVFMT_NOFILE))
         /* Close the output file. */
@@ -368,6 +407,8 @@ void create_video(Video* video) { return; }
 
 void add_frame(Video* video, uint8_t* image) {}
 
+void add_frame_at(Video* video, uint8_t* image, int64_t pts) {}
+
 void end_video(Video* video) {}
 
 #endif
@@ -8,7 +8,10 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define SCALE_FLAGS SWS_BICUBIC
+#include "../include/datoviz/workers.h"
+
+#define SCALE_FLAGS       SWS_BICUBIC
+#define VIDEO_MAX_SLICES  8
 
 typedef struct AVStream AVStream;
 typedef struct AVCodecContext AVCodecContext;
@@ -41,6 +44,16 @@ struct Video
     int linesize;
     uint8_t* image;
     AVFrame* frame;
+
+    // Input images: RGBA by default, or BGRA straight from the swapchain.
+    bool bgra;
+
+    // The colour conversion is split in horizontal slices converted in parallel.
+    DvzWorkers workers;
+    uint32_t slice_count;
+    int slice_height;
+    const uint8_t* input;
+    struct SwsContext* sws[VIDEO_MAX_SLICES];
 };
 
 Video* init_video(const char* filename, int width, int height, int fps, int bitrate);
@@ -49,6 +62,8 @@ void create_video(Video* video);
 
 void add_frame(Video* video, uint8_t* image);
 
+void add_frame_at(Video* video, uint8_t* image, int64_t pts);
+
 void end_video(Video* video);
 
 #endif
@@ -0,0 +1,212 @@
+/*************************************************************************************************/
+/*  Standalone region allocator, used to suballocate GPU buffers and device memory               */
+/*************************************************************************************************/
+
+#ifndef DVZ_ALLOC_HEADER
+#define DVZ_ALLOC_HEADER
+
+#include <vulkan/vulkan.h>
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_ALLOC_DEFAULT_BLOCKS 64
+#define DVZ_ALLOC_NONE           UINT32_MAX // null block index
+
+// Size classes of the free lists: the first level is the position of the most significant bit of
+// the size, the second level splits each power of 2 range in DVZ_ALLOC_SL_COUNT linear classes.
+#define DVZ_ALLOC_SL_LOG2  4
+#define DVZ_ALLOC_SL_COUNT (1 << DVZ_ALLOC_SL_LOG2)
+#define DVZ_ALLOC_FL_COUNT 64
+
+
+
+/*************************************************************************************************/
+/*  Type definitions                                                                             */
+/*************************************************************************************************/
+
+typedef struct DvzAlloc DvzAlloc;
+typedef struct DvzAllocBlock DvzAllocBlock;
+typedef struct DvzAllocStats DvzAllocStats;
+
+
+
+/*************************************************************************************************/
+/*  Structs                                                                                      */
+/*************************************************************************************************/
+
+struct DvzAllocBlock
+{
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    bool used;
+    uint32_t prev, next;           // neighbor blocks in the managed range
+    uint32_t prev_free, next_free; // neighbor blocks in the free list of the size class
+};
+
+
+
+// Two-level segregated fit allocator (TLSF): allocating, resizing and freeing a region take
+// constant time, whatever the number of regions.
+struct DvzAlloc
+{
+    VkDeviceSize alignment; // all offsets and sizes are multiple of this alignment
+    VkDeviceSize size;      // total size of the managed range, typically the GPU buffer size
+
+    // Pool of blocks, referred to by their index. The blocks in use, used or free, form a list
+    // of contiguous blocks covering the whole range [0, size), with no two consecutive free
+    // blocks. The other entries of the pool are chained with `next` from `pool`.
+    uint32_t count;
+    uint32_t capacity;
+    DvzAllocBlock* blocks;
+    uint32_t first, last, pool;
+
+    // Free lists of each size class, with bitmaps of the non-empty lists.
+    uint64_t fl_bitmap;
+    uint32_t sl_bitmap[DVZ_ALLOC_FL_COUNT];
+    uint32_t free_lists[DVZ_ALLOC_FL_COUNT][DVZ_ALLOC_SL_COUNT];
+
+    // Index of the used block at each allocated offset.
+    DvzHashTable used;
+
+    VkDeviceSize used_size;
+    uint32_t used_blocks, free_blocks;
+};
+
+
+
+struct DvzAllocStats
+{
+    VkDeviceSize size;         // total size of the managed range
+    VkDeviceSize used;         // total size of the allocated blocks
+    VkDeviceSize end;          // end of the last allocated block
+    VkDeviceSize largest_free; // size of the largest free block
+    uint32_t used_blocks;      // number of allocated blocks
+    uint32_t free_blocks;      // number of free blocks (a measure of fragmentation)
+};
+
+
+
+/*************************************************************************************************/
+/*  Allocator                                                                                    */
+/*************************************************************************************************/
+
+/**
+ * Create a region allocator.
+ *
+ * @param size initial size of the managed range
+ * @param alignment alignment of all allocated offsets and sizes (0 or 1 for no alignment)
+ * @returns the allocator
+ */
+DVZ_EXPORT DvzAlloc dvz_alloc(VkDeviceSize size, VkDeviceSize alignment);
+
+/**
+ * Allocate a new region.
+ *
+ * A free block large enough is found in constant time in the free list of the smallest size class
+ * fitting the region. If there is none, the managed range is enlarged to the next power of 2 and
+ * the new size is returned in `resized`. It is then up to the caller to resize the underlying
+ * resource.
+ *
+ * @param alloc the allocator
+ * @param req_size the requested size, in bytes
+ * @param[out] resized the new size of the managed range if it had to be enlarged, 0 otherwise
+ * @returns the offset of the allocated region
+ */
+DVZ_EXPORT VkDeviceSize
+dvz_alloc_new(DvzAlloc* alloc, VkDeviceSize req_size, VkDeviceSize* resized);
+
+/**
+ * Allocate a new region with a given offset alignment, without enlarging the managed range.
+ *
+ * @param alloc the allocator
+ * @param req_size the requested size, in bytes
+ * @param alignment the required alignment of the offset, in addition to the allocator's one
+ * @param[out] offset the offset of the allocated region
+ * @returns whether a free block was large enough for the region
+ */
+DVZ_EXPORT bool dvz_alloc_fit(
+    DvzAlloc* alloc, VkDeviceSize req_size, VkDeviceSize alignment, VkDeviceSize* offset);
+
+/**
+ * Resize an allocated region.
+ *
+ * The region is resized in-place when possible. Otherwise, a new region is allocated and its
+ * offset is returned: the old region is *not* freed, the caller should copy its contents to the
+ * new region and then call `dvz_alloc_free()` on the old offset.
+ *
+ * @param alloc the allocator
+ * @param offset the offset of the allocated region
+ * @param new_size the new size of the region, in bytes
+ * @param[out] resized the new size of the managed range if it had to be enlarged, 0 otherwise
+ * @returns the offset of the resized region
+ */
+DVZ_EXPORT VkDeviceSize dvz_alloc_resize(
+    DvzAlloc* alloc, VkDeviceSize offset, VkDeviceSize new_size, VkDeviceSize* resized);
+
+/**
+ * Free an allocated region.
+ *
+ * @param alloc the allocator
+ * @param offset the offset of the allocated region
+ */
+DVZ_EXPORT void dvz_alloc_free(DvzAlloc* alloc, VkDeviceSize offset);
+
+/**
+ * Return the size of an allocated region.
+ *
+ * @param alloc the allocator
+ * @param offset the offset of the allocated region
+ * @returns the size of the region, or 0 if there is no allocated region at this offset
+ */
+DVZ_EXPORT VkDeviceSize dvz_alloc_size(DvzAlloc* alloc, VkDeviceSize offset);
+
+/**
+ * Compact the allocated regions towards the beginning of the managed range.
+ *
+ * Only the regions passed in `offsets` are moved, all other allocated regions are kept in place.
+ * The managed range is then trimmed to the smallest power of 2 larger than both `min_size` and
+ * the end of the last allocated region.
+ *
+ * @param alloc the allocator
+ * @param count the number of regions that can be moved
+ * @param offsets the offsets of the regions that can be moved
+ * @param[out] new_offsets the new offsets of these regions
+ * @param min_size the minimum size of the managed range after compaction
+ * @returns the new size of the managed range
+ */
+DVZ_EXPORT VkDeviceSize dvz_alloc_compact(
+    DvzAlloc* alloc, uint32_t count, const VkDeviceSize* offsets, VkDeviceSize* new_offsets,
+    VkDeviceSize min_size);
+
+/**
+ * Return statistics about the allocator.
+ *
+ * @param alloc the allocator
+ * @returns the statistics
+ */
+DVZ_EXPORT DvzAllocStats dvz_alloc_stats(DvzAlloc* alloc);
+
+/**
+ * Destroy an allocator.
+ *
+ * @param alloc the allocator
+ */
+DVZ_EXPORT void dvz_alloc_destroy(DvzAlloc* alloc);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
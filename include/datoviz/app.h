@@ -18,6 +18,7 @@
 #include <vulkan/vulkan.h>
 
 #include "common.h"
+#include "workers.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -78,6 +79,16 @@ static inline double _clock_get(DvzClock* clock)
 
 
 
+static inline double _clock_now(void)
+{
+    // Monotonic time in seconds, used to measure short durations such as the frame phases.
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+
+
 static inline void _clock_set(DvzClock* clock)
 {
     // Typically called at every frame.
@@ -115,6 +126,7 @@ struct DvzApp
 
     // Threads.
     DvzThread timer_thread;
+    DvzWorkers workers; // worker pool used for parallel CPU work such as visual baking
 };
 
 
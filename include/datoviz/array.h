@@ -16,6 +16,9 @@
 
 typedef struct DvzArray DvzArray;
 
+// Called when an array no longer uses a borrowed buffer.
+typedef void (*DvzArrayRelease)(void* data, void* user_data);
+
 
 
 /*************************************************************************************************/
@@ -81,6 +84,16 @@ typedef enum
 
 
 
+// SIMD instruction sets used by the array copy kernels.
+typedef enum
+{
+    DVZ_SIMD_NONE,
+    DVZ_SIMD_SSE2,
+    DVZ_SIMD_AVX2,
+} DvzSimdLevel;
+
+
+
 /*************************************************************************************************/
 /*  Structs                                                                                      */
 /*************************************************************************************************/
@@ -95,6 +108,12 @@ struct DvzArray
     VkDeviceSize buffer_size;
     void* data;
 
+    // Read-only external buffer, not freed with the array, see dvz_array_borrow().
+    bool borrowed;
+    VkDeviceSize stride; // bytes between consecutive items of a borrowed buffer, 0 if packed
+    DvzArrayRelease release;
+    void* release_data;
+
     // 3D arrays
     uint32_t ndims; // 1, 2, or 3
     uvec3 shape;    // only for 3D arrays
@@ -102,6 +121,94 @@ struct DvzArray
 
 
 
+/*************************************************************************************************/
+/*  Copy kernels                                                                                 */
+/*************************************************************************************************/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Return the SIMD instruction set used by the array copy kernels.
+ *
+ * The instruction set is detected at runtime on the first call.
+ *
+ * @returns the SIMD level
+ */
+DVZ_EXPORT DvzSimdLevel dvz_simd_level(void);
+
+/**
+ * Limit the SIMD instruction set used by the array copy kernels, for testing and benchmarking.
+ *
+ * @param max_level the maximum SIMD level to use
+ * @returns the SIMD level that will be used
+ */
+DVZ_EXPORT DvzSimdLevel dvz_simd_set_level(DvzSimdLevel max_level);
+
+/**
+ * Copy items between two strided buffers.
+ *
+ * @param dst the destination buffer
+ * @param dst_stride the stride in the destination buffer, in bytes
+ * @param src the source buffer
+ * @param src_stride the stride in the source buffer, in bytes (0 to repeat the same item)
+ * @param item_size the size of each item, in bytes
+ * @param count the number of items to copy
+ */
+DVZ_EXPORT void dvz_array_copy_strided(
+    void* dst, VkDeviceSize dst_stride, const void* src, VkDeviceSize src_stride,
+    VkDeviceSize item_size, uint32_t count);
+
+/**
+ * Copy the same item to a strided buffer.
+ *
+ * @param dst the destination buffer
+ * @param dst_stride the stride in the destination buffer, in bytes
+ * @param item the item to copy
+ * @param item_size the size of the item, in bytes
+ * @param count the number of copies
+ */
+DVZ_EXPORT void dvz_array_fill_strided(
+    void* dst, VkDeviceSize dst_stride, const void* item, VkDeviceSize item_size, uint32_t count);
+
+/**
+ * Cast items between two strided buffers.
+ *
+ * The double to float casts (scalars, dvec2 and dvec3) use SIMD instructions when available.
+ *
+ * @param dst the destination buffer
+ * @param dst_stride the stride in the destination buffer, in bytes
+ * @param target_dtype the target dtype
+ * @param src the source buffer
+ * @param src_stride the stride in the source buffer, in bytes
+ * @param source_dtype the source dtype
+ * @param count the number of items to cast
+ */
+DVZ_EXPORT void dvz_array_cast_strided(
+    void* dst, VkDeviceSize dst_stride, DvzDataType target_dtype, //
+    const void* src, VkDeviceSize src_stride, DvzDataType source_dtype, uint32_t count);
+
+/**
+ * Convert 4-byte BGRA or RGBA pixels to packed RGB or RGBA pixels, with an opaque alpha channel.
+ *
+ * This is used to read back swapchain images. SIMD instructions are used when available.
+ *
+ * @param dst the destination buffer, with 3 or 4 bytes per pixel
+ * @param src the source buffer, with 4 bytes per pixel
+ * @param count the number of pixels
+ * @param swizzle whether to swap the red and blue channels (BGRA to RGBA)
+ * @param has_alpha whether the destination buffer has an alpha channel
+ */
+DVZ_EXPORT void dvz_array_pixels(
+    uint8_t* dst, const uint8_t* src, uint32_t count, bool swizzle, bool has_alpha);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+
 /*************************************************************************************************/
 /*  Utils                                                                                        */
 /*************************************************************************************************/
@@ -236,6 +343,15 @@ static uint32_t _get_components(DvzDataType dtype)
 
 
 
+// Number of bytes between two consecutive items of an array.
+static inline VkDeviceSize dvz_array_stride(DvzArray* array)
+{
+    ASSERT(array != NULL);
+    return array->stride > 0 ? array->stride : array->item_size;
+}
+
+
+
 /*************************************************************************************************/
 /*  Functions                                                                                    */
 /*************************************************************************************************/
@@ -285,6 +401,22 @@ static DvzArray dvz_array(uint32_t item_count, DvzDataType dtype)
 static DvzArray dvz_array_copy(DvzArray* arr)
 {
     DvzArray arr_new = *arr; // struct copy
+
+    // The copy of a borrowed array is a packed array owning its data.
+    if (arr->borrowed)
+    {
+        arr_new.borrowed = false;
+        arr_new.stride = 0;
+        arr_new.release = NULL;
+        arr_new.release_data = NULL;
+        arr_new.buffer_size = arr->item_count * arr->item_size;
+        arr_new.data = malloc(arr_new.buffer_size);
+        dvz_array_copy_strided(
+            arr_new.data, arr->item_size, arr->data, dvz_array_stride(arr), arr->item_size,
+            arr->item_count);
+        return arr_new;
+    }
+
     arr_new.data = malloc(arr->buffer_size);
     memcpy(arr_new.data, arr->data, arr->buffer_size);
     return arr_new;
@@ -331,6 +463,40 @@ static DvzArray dvz_array_wrap(uint32_t item_count, DvzDataType dtype, void* dat
 
 
 
+/**
+ * Create a read-only 1D array borrowing an existing, possibly strided, memory buffer.
+ *
+ * As with `dvz_array_wrap()`, the data is not copied. But the buffer still belongs to the caller:
+ * it is not freed when the array is destroyed, the release callback is called instead. The
+ * buffer must remain valid and must not be freed until then. The array cannot be resized or
+ * modified, use `dvz_array_copy()` to get a packed array owning its data.
+ *
+ * @param item_count number of elements in the passed buffer
+ * @param dtype the data type of the array
+ * @param stride the number of bytes between two consecutive elements, 0 if they are packed
+ * @param data the buffer
+ * @param release the function called when the array is destroyed, may be NULL
+ * @param user_data the second argument passed to the release function
+ * @returns the array borrowing the buffer
+ */
+static DvzArray dvz_array_borrow(
+    uint32_t item_count, DvzDataType dtype, VkDeviceSize stride, const void* data,
+    DvzArrayRelease release, void* user_data)
+{
+    DvzArray arr = dvz_array(0, dtype); // do not allocate underlying buffer
+    ASSERT(stride == 0 || stride >= arr.item_size);
+    arr.item_count = item_count;
+    arr.buffer_size = item_count * arr.item_size;
+    arr.data = (void*)data;
+    arr.borrowed = true;
+    arr.stride = stride == arr.item_size ? 0 : stride;
+    arr.release = release;
+    arr.release_data = user_data;
+    return arr;
+}
+
+
+
 /**
  * Create a 1D record array with heterogeneous data type.
  *
@@ -411,6 +577,7 @@ _repeat_last(uint32_t old_item_count, VkDeviceSize item_size, void* data, uint32
 static void dvz_array_resize(DvzArray* array, uint32_t item_count)
 {
     ASSERT(array != NULL);
+    ASSERT(!array->borrowed);
     ASSERT(item_count > 0);
     ASSERT(array->item_size > 0);
 
@@ -470,6 +637,7 @@ static void dvz_array_resize(DvzArray* array, uint32_t item_count)
 static void dvz_array_clear(DvzArray* array)
 {
     ASSERT(array != NULL);
+    ASSERT(!array->borrowed);
     memset(array->data, 0, array->buffer_size);
 }
 
@@ -492,6 +660,7 @@ static void dvz_array_reshape(DvzArray* array, uint32_t width, uint32_t height,
     ASSERT(array != NULL);
     ASSERT(width > 0);
     ASSERT(height > 0);
+    ASSERT(!array->borrowed);
     ASSERT(depth > 0);
     uint32_t item_count = width * height * depth;
 
@@ -524,6 +693,7 @@ static void dvz_array_reshape(DvzArray* array, uint32_t width, uint32_t height,
 static void dvz_array_insert(DvzArray* array, uint32_t offset, uint32_t size, void* insert)
 {
     ASSERT(array != NULL);
+    ASSERT(!array->borrowed);
 
     // Size of the chunk to move to make place for the inserted buffer.
     VkDeviceSize chunk1_size = (array->item_count - offset) * array->item_size;
@@ -607,6 +777,7 @@ static void dvz_array_data(
     uint32_t data_item_count, const void* data)
 {
     ASSERT(array != NULL);
+    ASSERT(!array->borrowed);
     ASSERT(data_item_count > 0);
     ASSERT(array->data != NULL);
     if (data == NULL)
@@ -689,7 +860,7 @@ static inline void* dvz_array_item(DvzArray* array, uint32_t idx)
 {
     ASSERT(array != NULL);
     idx = CLIP(idx, 0, array->item_count - 1);
-    return (void*)((int64_t)array->data + (int64_t)(idx * array->item_size));
+    return (void*)((int64_t)array->data + (int64_t)(idx * dvz_array_stride(array)));
 }
 
 
@@ -712,6 +883,21 @@ static inline void _cast(DvzDataType target_dtype, void* dst, DvzDataType source
         ((vec3*)dst)[0][1] = ((dvec3*)src)[0][1];
         ((vec3*)dst)[0][2] = ((dvec3*)src)[0][2];
     }
+    else if (source_dtype == DVZ_DTYPE_FLOAT && target_dtype == DVZ_DTYPE_DOUBLE)
+    {
+        ((dvec3*)dst)[0][0] = ((vec3*)src)[0][0];
+    }
+    else if (source_dtype == DVZ_DTYPE_VEC2 && target_dtype == DVZ_DTYPE_DVEC2)
+    {
+        ((dvec3*)dst)[0][0] = ((vec3*)src)[0][0];
+        ((dvec3*)dst)[0][1] = ((vec3*)src)[0][1];
+    }
+    else if (source_dtype == DVZ_DTYPE_VEC3 && target_dtype == DVZ_DTYPE_DVEC3)
+    {
+        ((dvec3*)dst)[0][0] = ((vec3*)src)[0][0];
+        ((dvec3*)dst)[0][1] = ((vec3*)src)[0][1];
+        ((dvec3*)dst)[0][2] = ((vec3*)src)[0][2];
+    }
     else
         log_error("unknown casting dtypes %d %d", source_dtype, target_dtype);
 }
@@ -719,15 +905,12 @@ static inline void _cast(DvzDataType target_dtype, void* dst, DvzDataType source
 
 
 /**
- * Copy data into the column of a record array.
- *
- * This function is used by the default visual baking function, which copies to the vertex buffer
- * (corresponding to a record array with as many fields as GLSL attributes in the vertex shader)
- * the user-specified visual props (data for the individual elements).
+ * Copy strided data into the column of a record array.
  *
  * @param array the array
  * @param offset the offset within the array, in bytes
- * @param col_size stride in the source array, in bytes
+ * @param col_size size of each source element, in bytes
+ * @param src_stride number of bytes between two consecutive source elements
  * @param first_item first element in the array to be overwritten
  * @param item_count number of elements to write
  * @param data_item_count number of elements in `data`
@@ -737,77 +920,104 @@ static inline void _cast(DvzDataType target_dtype, void* dst, DvzDataType source
  * @param copy_type the type of copy
  * @param reps the number of repeats for each copied element
  */
-static void dvz_array_column(
+static void dvz_array_column_strided(
     DvzArray* array, VkDeviceSize offset, VkDeviceSize col_size, //
+    VkDeviceSize src_stride,                                     //
     uint32_t first_item, uint32_t item_count,                    //
     uint32_t data_item_count, const void* data,                  //
     DvzDataType source_dtype, DvzDataType target_dtype,          //
     DvzArrayCopyType copy_type, uint32_t reps)                   //
 {
     ASSERT(array != NULL);
+    ASSERT(!array->borrowed);
     ASSERT(data_item_count > 0);
     ASSERT(array->data != NULL);
     ASSERT(data != NULL);
     ASSERT(item_count > 0);
     ASSERT(first_item + item_count <= array->item_count);
 
-    VkDeviceSize src_offset = 0;
-    VkDeviceSize src_stride = col_size;
-
-    VkDeviceSize dst_offset = offset;
     VkDeviceSize dst_stride = array->item_size;
-
-    void* dst = array->data;
-    const void* src = data;
-
-    ASSERT(src != NULL);
-    ASSERT(dst != NULL);
     ASSERT(src_stride > 0);
     ASSERT(dst_stride > 0);
-    ASSERT(item_count > 0);
 
     log_trace(
-        "copy src offset %d stride %d, dst offset %d stride %d, item size %d count %d", //
-        src_offset, src_stride, dst_offset, dst_stride, col_size, item_count);
+        "copy src stride %d, dst offset %d stride %d, item size %d count %d", //
+        src_stride, offset, dst_stride, col_size, item_count);
+
+    uint8_t* dst = (uint8_t*)array->data + first_item * dst_stride + offset;
+    const uint8_t* src = (const uint8_t*)data;
+
+    bool cast = source_dtype != target_dtype &&  //
+                source_dtype != DVZ_DTYPE_NONE && //
+                target_dtype != DVZ_DTYPE_NONE;
+    // Size of each copied item in the array.
+    VkDeviceSize item_size = cast ? _get_dtype_size(target_dtype) : col_size;
+
+    // Only the first item of every group of `reps` items is copied from the source data, the
+    // other ones are either repeated (REPEAT copy) or left unchanged (SINGLE copy).
+    reps = MAX(reps, 1);
+    uint32_t groups = (item_count + reps - 1) / reps;
+    VkDeviceSize group_stride = dst_stride * reps;
+
+    // Copy or cast the source items.
+    uint32_t n = MIN(groups, data_item_count);
+    if (cast)
+        dvz_array_cast_strided(dst, group_stride, target_dtype, src, src_stride, source_dtype, n);
+    else
+        dvz_array_copy_strided(dst, group_stride, src, src_stride, col_size, n);
 
-    int64_t src_byte = (int64_t)src + (int64_t)src_offset;
-    int64_t dst_byte = (int64_t)dst + (int64_t)(first_item * dst_stride) + (int64_t)dst_offset;
+    // The remaining groups get the last source item.
+    if (n < groups)
+        dvz_array_fill_strided(
+            dst + n * group_stride, group_stride, dst + (n - 1) * group_stride, item_size,
+            groups - n);
 
-    uint32_t j = 0; // j: src index
-    uint32_t m = 0;
-    bool skip = false;
-    for (uint32_t i = 0; i < item_count; i++) // i: dst index
+    // Repeat the first item of each group.
+    if (copy_type != DVZ_ARRAY_COPY_SINGLE && reps > 1)
     {
-        if (reps > 1)
-            m = i % reps;
-        // Determine whether the current item copy should be skipped.
-        skip = copy_type == DVZ_ARRAY_COPY_SINGLE && reps > 1 && m > 0;
-
-        // NOTE: this function is not optimized and might benefit from being refactored.
-
-        // Copy the current item, unless we are in SINGLE copy mode
-        if (!skip)
+        uint32_t count = 0;
+        for (uint32_t g = 0; g < groups; g++)
         {
-            if (source_dtype == target_dtype ||   //
-                source_dtype == DVZ_DTYPE_NONE || //
-                target_dtype == DVZ_DTYPE_NONE)   //
-                memcpy((void*)dst_byte, (void*)src_byte, col_size);
-            else
-            {
-                _cast(target_dtype, (void*)dst_byte, source_dtype, (void*)src_byte);
-            }
+            count = MIN(reps, item_count - g * reps) - 1;
+            if (count > 0)
+                dvz_array_fill_strided(
+                    dst + (g * reps + 1) * dst_stride, dst_stride, dst + g * group_stride,
+                    item_size, count);
         }
+    }
+}
 
-        // Advance the source pointer, unless we are in SINGLE copy mode
-        skip = reps > 1 && m < reps - 1;
-        if (j < data_item_count - 1 && !skip)
-        {
-            src_byte += (int64_t)src_stride;
-            j++;
-        }
 
-        dst_byte += (int64_t)dst_stride;
-    }
+
+/**
+ * Copy data into the column of a record array.
+ *
+ * This function is used by the default visual baking function, which copies to the vertex buffer
+ * (corresponding to a record array with as many fields as GLSL attributes in the vertex shader)
+ * the user-specified visual props (data for the individual elements).
+ *
+ * @param array the array
+ * @param offset the offset within the array, in bytes
+ * @param col_size stride in the source array, in bytes
+ * @param first_item first element in the array to be overwritten
+ * @param item_count number of elements to write
+ * @param data_item_count number of elements in `data`
+ * @param data the buffer containing the data to copy
+ * @param source_dtype the source dtype (only used when casting)
+ * @param target_dtype the target dtype (only used when casting)
+ * @param copy_type the type of copy
+ * @param reps the number of repeats for each copied element
+ */
+static void dvz_array_column(
+    DvzArray* array, VkDeviceSize offset, VkDeviceSize col_size, //
+    uint32_t first_item, uint32_t item_count,                    //
+    uint32_t data_item_count, const void* data,                  //
+    DvzDataType source_dtype, DvzDataType target_dtype,          //
+    DvzArrayCopyType copy_type, uint32_t reps)                   //
+{
+    dvz_array_column_strided(
+        array, offset, col_size, col_size, first_item, item_count, data_item_count, data,
+        source_dtype, target_dtype, copy_type, reps);
 }
 
 
@@ -831,7 +1041,7 @@ static void dvz_array_print(DvzArray* array)
 /**
  * Destroy an array.
  *
- * This function frees the allocated underlying data buffer.
+ * This function frees the allocated underlying data buffer, or releases the borrowed buffer.
  *
  * @param array the array to destroy
  */
@@ -841,6 +1051,13 @@ static void dvz_array_destroy(DvzArray* array)
     if (!dvz_obj_is_created(&array->obj))
         return;
     dvz_obj_destroyed(&array->obj);
+    if (array->borrowed)
+    {
+        if (array->release != NULL)
+            array->release(array->data, array->release_data);
+        array->data = NULL;
+        return;
+    }
     FREE(array->data) //
 }
 
@@ -25,19 +25,30 @@ static const char DVZ_FONT_ATLAS_STRING[] =
 
 
 
+// Fill the table of the glyph indices of all character codes. The characters missing from the
+// atlas map to the index following the last glyph.
+static void _font_atlas_glyphs(DvzFontAtlas* atlas)
+{
+    ASSERT(atlas != NULL);
+    ASSERT(atlas->font_str != NULL);
+    size_t n = strlen(atlas->font_str);
+    ASSERT(n > 0);
+    ASSERT(n < 256);
+    memset(atlas->glyphs, (int)n, sizeof(atlas->glyphs));
+    // The first occurrence of a character in the atlas string wins.
+    for (size_t i = n; i > 0; i--)
+        atlas->glyphs[(uint8_t)atlas->font_str[i - 1]] = (uint8_t)(i - 1);
+}
+
+
+
 static size_t _font_atlas_glyph(DvzFontAtlas* atlas, const char* str, uint32_t idx)
 {
     ASSERT(atlas != NULL);
     ASSERT(atlas->rows > 0);
     ASSERT(atlas->cols > 0);
     ASSERT(str != NULL);
-    ASSERT(strlen(str) > 0);
-    ASSERT(idx < strlen(str));
-    ASSERT(atlas->font_str != NULL);
-    ASSERT(strlen(atlas->font_str) > 0);
-
-    char c[2] = {str[idx], 0};
-    return strcspn(atlas->font_str, c);
+    return atlas->glyphs[(uint8_t)str[idx]];
 }
 
 
@@ -89,6 +100,7 @@ static DvzFontAtlas dvz_font_atlas(DvzContext* ctx)
     // TODO: parameters
     atlas.font_str = DVZ_FONT_ATLAS_STRING;
     ASSERT(strlen(atlas.font_str) > 0);
+    _font_atlas_glyphs(&atlas);
     atlas.cols = 16;
     atlas.rows = 6;
 
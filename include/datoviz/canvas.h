@@ -8,6 +8,7 @@
 #include "context.h"
 #include "fifo.h"
 #include "keycode.h"
+#include "profiler.h"
 #include "transfers.h"
 #include "vklite.h"
 
@@ -41,6 +42,10 @@ extern "C" {
 #define DVZ_DEFAULT_COMMANDS_TRANSFER 0
 #define DVZ_DEFAULT_COMMANDS_RENDER   1
 #define DVZ_MAX_FRAMES_IN_FLIGHT      2
+#define DVZ_SCREENCAST_SLOTS          3
+#define DVZ_MAX_SCREENCAST_SLOTS      8
+#define DVZ_VIDEO_QUEUE_SIZE          4
+#define DVZ_MAX_VIDEO_FRAMES          32
 
 
 
@@ -125,6 +130,21 @@ typedef enum
 
 
 
+// Frame phases, timed on the CPU at every frame.
+// NOTE: the scene phase is nested within the events phase (scene FRAME callback).
+typedef enum
+{
+    DVZ_FRAME_PHASE_FRAME,     // whole dvz_canvas_frame()
+    DVZ_FRAME_PHASE_EVENTS,    // INTERACT, FRAME and TIMER callbacks
+    DVZ_FRAME_PHASE_SCENE,     // scene updates (controllers, visual data, bounding boxes)
+    DVZ_FRAME_PHASE_TRANSFERS, // dvz_process_transfers()
+    DVZ_FRAME_PHASE_REFILL,    // command buffer refill
+    DVZ_FRAME_PHASE_SUBMIT,    // whole dvz_canvas_frame_submit()
+    DVZ_FRAME_PHASE_COUNT,
+} DvzFramePhase;
+
+
+
 // Transfer status.
 typedef enum
 {
@@ -156,6 +176,25 @@ typedef enum
 
 
 
+// Screencast flags.
+typedef enum
+{
+    DVZ_SCREENCAST_FLAGS_NONE = 0x0000,
+    DVZ_SCREENCAST_FLAGS_ALPHA = 0x0001, // RGBA instead of RGB images
+    DVZ_SCREENCAST_FLAGS_RAW = 0x0002,   // borrowed images in the swapchain format, no conversion
+} DvzScreencastFlags;
+
+
+
+// Video policy when the encoder lags behind the canvas.
+typedef enum
+{
+    DVZ_VIDEO_POLICY_DROP,  // drop the new frames while the frame queue is full
+    DVZ_VIDEO_POLICY_BLOCK, // block the render loop until a frame has been encoded
+} DvzVideoPolicy;
+
+
+
 /*************************************************************************************************/
 /*  Event system                                                                                 */
 /*************************************************************************************************/
@@ -259,8 +298,12 @@ typedef union DvzEventUnion DvzEventUnion;
 typedef void (*DvzEventCallback)(DvzCanvas*, DvzEvent);
 typedef struct DvzEventCallbackRegister DvzEventCallbackRegister;
 
+typedef struct DvzScreencastSlot DvzScreencastSlot;
 typedef struct DvzScreencast DvzScreencast;
 typedef struct DvzPendingRefill DvzPendingRefill;
+typedef struct DvzVideoFrame DvzVideoFrame;
+typedef struct DvzVideoStats DvzVideoStats;
+typedef struct DvzVideo DvzVideo;
 
 // Forward declarations.
 typedef struct DvzGui DvzGui;
@@ -427,7 +470,8 @@ struct DvzScreencastEvent
     double interval;
     uint32_t width;
     uint32_t height;
-    uint8_t* rgba;
+    int flags;     // the image is borrowed and must not be freed with DVZ_SCREENCAST_FLAGS_RAW
+    uint8_t* rgba; // RGB(A) image, or 4-byte pixels in the swapchain format in raw mode
 };
 
 
@@ -439,6 +483,7 @@ struct DvzRefillEvent
     DvzCommands* cmds[32];
     DvzViewport viewport;
     VkClearColorValue clear_color;
+    bool invalidate; // whether cached secondary command buffers must be re-recorded as well
 };
 
 
@@ -510,30 +555,96 @@ struct DvzEventCallbackRegister
 /*  Misc structs                                                                                 */
 /*************************************************************************************************/
 
+struct DvzScreencastSlot
+{
+    DvzBuffer staging; // host-visible buffer, permanently mapped
+    DvzCommands cmds;  // one copy command buffer per swapchain image
+    DvzSemaphores semaphore;
+    DvzFences fence;
+    DvzScreencastStatus status;
+    uint64_t frame_idx;
+    double interval;
+};
+
+
+
 struct DvzScreencast
 {
     DvzObject obj;
     bool is_active;
 
-    bool has_alpha;
+    int flags;
     DvzCanvas* canvas;
-    DvzCommands cmds;
-    DvzSemaphores semaphore;
-    DvzFences fence;
-    DvzImages staging;
+    uint32_t width;
+    uint32_t height;
+
+    // Readback ring: the slots are filled and delivered in frame order.
+    uint32_t slot_count;
+    DvzScreencastSlot slots[DVZ_MAX_SCREENCAST_SLOTS];
+    uint32_t head; // next slot to fill
+    uint32_t tail; // next slot to deliver
+
     DvzSubmit submit;
     uint64_t frame_idx;
+    uint64_t dropped; // number of frames dropped because all slots were busy, or never copied
     DvzClock clock;
-    DvzScreencastStatus status;
     void* user_data;
 };
 
 
 
+struct DvzVideoFrame
+{
+    uint8_t* pixels; // recycled frame buffer
+    uint64_t idx;    // screencast frame index, used as presentation timestamp
+    double time;     // readback time
+};
+
+
+
+struct DvzVideoStats
+{
+    uint64_t encoded;     // number of encoded frames
+    uint64_t dropped;     // number of frames dropped by the screencast or the frame queue
+    uint32_t queue_depth; // number of frames waiting to be encoded
+    double latency;       // average delay between readback and end of encoding, in seconds
+    double latency_max;   // maximum delay between readback and end of encoding, in seconds
+};
+
+
+
+// Frames are encoded in a dedicated thread. The render loop copies the screencast images into
+// recycled frame buffers, taken from the pool and sent to the encoder through the queue.
+struct DvzVideo
+{
+    DvzObject obj;
+    void* encoder; // only accessed by the encoder thread once it has started
+    DvzVideoPolicy policy;
+
+    uint32_t frame_count;
+    VkDeviceSize frame_size;
+    DvzVideoFrame frames[DVZ_MAX_VIDEO_FRAMES];
+    DvzFifo queue; // frames to encode
+    DvzFifo pool;  // free frames
+
+    DvzThread thread;     // encoder thread
+    pthread_mutex_t lock; // protects the stats
+    DvzClock clock;
+    DvzVideoStats stats;
+    double latency_sum;
+};
+
+
+
 struct DvzPendingRefill
 {
     bool completed[DVZ_MAX_SWAPCHAIN_IMAGES];
     atomic(DvzRefillStatus, status);
+
+    // Set by dvz_canvas_to_refill(), then propagated to all swapchain images that have yet to
+    // discard their cached secondary command buffers.
+    atomic(bool, invalidate);
+    bool invalidated[DVZ_MAX_SWAPCHAIN_IMAGES];
 };
 
 
@@ -577,6 +688,7 @@ struct DvzCanvas
     double fps, efps;
     double max_delay; // used to compute the effective frames per second (eFPS)
     double max_delay_roll[10];
+    double phase_time[DVZ_FRAME_PHASE_COUNT]; // CPU time of each phase in the last frame
 
     // Renderpasses.
     DvzRenderpass renderpass;         // default renderpass
@@ -596,11 +708,18 @@ struct DvzCanvas
     // Other command buffers.
     DvzContainer commands;
 
-    // Graphics pipelines.
+    // Custom graphics pipelines.
     DvzContainer graphics;
 
+    // Builtin graphics pipelines requested by this canvas, released when it is destroyed.
+    uint32_t graphics_ref_count;
+    uint32_t graphics_ref_capacity;
+    DvzGraphics** graphics_refs;
+
     // Data transfers.
     DvzFifo transfers;
+    DvzTransferPool transfer_pool;
+    DvzStagingRing staging;
 
     // Event callbacks, running in the background thread, may be slow, for end-users.
     uint32_t callbacks_count;
@@ -608,7 +727,6 @@ struct DvzCanvas
 
     // Event queue.
     DvzFifo event_queue;
-    DvzEvent events[DVZ_MAX_FIFO_CAPACITY];
     DvzThread event_thread;
     bool enable_lock;
     atomic(DvzEventType, event_processing);
@@ -623,6 +741,8 @@ struct DvzCanvas
 
     DvzScreencast* screencast;
     DvzPendingRefill refills;
+    uint64_t buffers_generation; // last seen generation of the context default buffers
+    DvzProfiler* profiler; // NULL unless profiling is enabled
 
     DvzViewport viewport;
     DvzScene* scene;
@@ -785,10 +905,23 @@ DVZ_EXPORT void dvz_event_callback(
 /**
  * Trigger a canvas refill at the next frame.
  *
+ * All command buffers are re-recorded, including the cached secondary command buffers.
+ *
  * @param canvas the canvas
  */
 DVZ_EXPORT void dvz_canvas_to_refill(DvzCanvas* canvas);
 
+/**
+ * Refill the command buffers at the next frame, keeping the cached secondary command buffers.
+ *
+ * The REFILL callbacks are responsible for re-recording the secondary command buffers they have
+ * invalidated themselves, for example the scene re-records the panels marked with
+ * `dvz_panel_to_refill()`.
+ *
+ * @param canvas the canvas
+ */
+DVZ_EXPORT void dvz_canvas_to_refill_cached(DvzCanvas* canvas);
+
 /**
  * Close the canvas at the next frame.
  *
@@ -810,11 +943,12 @@ DVZ_EXPORT void dvz_canvas_to_close(DvzCanvas* canvas);
  * - screenshots,
  * - video records (requires ffmpeg)
  *
- * This command creates a host-coherent GPU image with the same size as the current framebuffer
- * size.
+ * This command creates a ring of host-visible staging buffers with the same size as the current
+ * framebuffer size.
  *
  * If the interval is non-zero, the canvas will raise periodic SCREENCAST events every  `interval`
- * seconds. The event payload will contain a pointer to the grabbed framebuffer image.
+ * seconds. The event payload will contain a pointer to the grabbed framebuffer image, that must be
+ * freed by the callback.
  *
  * @param canvas the canvas
  * @param interval screencast events interval
@@ -822,9 +956,31 @@ DVZ_EXPORT void dvz_canvas_to_close(DvzCanvas* canvas);
  */
 DVZ_EXPORT void dvz_screencast(DvzCanvas* canvas, double interval, bool has_alpha);
 
+/**
+ * Prepare the canvas for a screencast with an asynchronous readback ring.
+ *
+ * Each grabbed frame is copied by the GPU into one of `slot_count` host-cached staging buffers,
+ * and the SCREENCAST event is raised a few frames later, once the copy fence is signaled, without
+ * ever blocking the render loop. Frames are dropped when all slots are still in flight.
+ *
+ * With `DVZ_SCREENCAST_FLAGS_RAW`, the event payload points directly to the staging buffer, in the
+ * swapchain format (typically BGRA). This pointer is only valid during the SYNC callback and must
+ * not be freed. Otherwise, the image is converted to RGB(A) in a new buffer that the callback must
+ * free.
+ *
+ * @param canvas the canvas
+ * @param interval screencast events interval
+ * @param slot_count the number of staging buffers
+ * @param flags the screencast flags
+ */
+DVZ_EXPORT void
+dvz_screencast_readback(DvzCanvas* canvas, double interval, uint32_t slot_count, int flags);
+
 /**
  * Destroy the screencast.
  *
+ * The copies in flight are waited for, and their SCREENCAST events are raised in frame order.
+ *
  * @param canvas the canvas
  */
 DVZ_EXPORT void dvz_screencast_destroy(DvzCanvas* canvas);
@@ -832,9 +988,8 @@ DVZ_EXPORT void dvz_screencast_destroy(DvzCanvas* canvas);
 /**
  * Make a screenshot.
  *
- * This function creates a screencast if there isn't one already. It is implemented with hard
- * synchronization commands so this command should *not* be used for creating many successive
- * screenshots. For that, one should register a SCREENCAST event callback.
+ * This function waits for the GPU to be idle, so it should *not* be used for creating many
+ * successive screenshots. For that, one should register a SCREENCAST event callback.
  *
  * !!! important
  *     The caller MUST free the output pointer.
@@ -876,6 +1031,29 @@ DVZ_EXPORT void dvz_screenshot_file(DvzCanvas* canvas, const char* png_path);
 DVZ_EXPORT void
 dvz_canvas_video(DvzCanvas* canvas, int framerate, int bitrate, const char* path, bool record);
 
+/**
+ * Set the frame queue size and the backpressure policy of the video encoder.
+ *
+ * The canvas frames are encoded in a background thread. Up to `queue_size` frames may wait to be
+ * encoded, when the encoder is slower than the canvas. Then, new frames are either dropped, or
+ * the render loop waits for the encoder. This function must be called after `dvz_canvas_video()`
+ * and before the first frame is recorded.
+ *
+ * @param canvas the canvas
+ * @param queue_size the maximum number of frames waiting to be encoded
+ * @param policy what to do when the frame queue is full
+ */
+DVZ_EXPORT void
+dvz_canvas_video_policy(DvzCanvas* canvas, uint32_t queue_size, DvzVideoPolicy policy);
+
+/**
+ * Get the statistics of the video encoder.
+ *
+ * @param canvas the canvas
+ * @returns the number of encoded and dropped frames, the queue depth and the encoding latency
+ */
+DVZ_EXPORT DvzVideoStats dvz_canvas_video_stats(DvzCanvas* canvas);
+
 /**
  * Pause the live video screencast.
  *
@@ -893,6 +1071,34 @@ DVZ_EXPORT void dvz_canvas_stop(DvzCanvas* canvas);
 
 
 
+/*************************************************************************************************/
+/*  Profiling                                                                                    */
+/*************************************************************************************************/
+
+/**
+ * Enable the frame profiler.
+ *
+ * The profiler records the CPU time of the main phases of each frame, the GPU time of the render
+ * and transfer submissions, and per-frame counters (uploaded bytes, draw calls, refills), in a
+ * ring buffer. Profiling is also enabled when the `DVZ_PROFILE` environment variable is set to
+ * the path of the Chrome trace file written when the canvas is destroyed.
+ *
+ * @param canvas the canvas
+ * @param capacity the maximum number of events kept in the ring buffer (0: default)
+ */
+DVZ_EXPORT void dvz_canvas_profile(DvzCanvas* canvas, uint32_t capacity);
+
+/**
+ * Write the profiler events as a Chrome trace-event JSON file.
+ *
+ * @param canvas the canvas
+ * @param path the path to the JSON file
+ * @returns 0 if the file was successfully written
+ */
+DVZ_EXPORT int dvz_canvas_profile_dump(DvzCanvas* canvas, const char* path);
+
+
+
 /*************************************************************************************************/
 /*  Mouse and keyboard                                                                           */
 /*************************************************************************************************/
@@ -238,6 +238,7 @@ typedef struct DvzMVP DvzMVP;
 typedef struct DvzObject DvzObject;
 typedef struct DvzContainer DvzContainer;
 typedef struct DvzContainerIterator DvzContainerIterator;
+typedef struct DvzHashTable DvzHashTable;
 typedef struct DvzThread DvzThread;
 
 typedef void* (*DvzThreadCallback)(void*);
@@ -260,13 +261,21 @@ struct DvzObject
 
 
 
+// The objects are allocated on the heap and their pointers are stored in slots with stable
+// indices. The occupied slots are also listed contiguously in the dense array, and the free slots
+// in a stack, so that allocation and iteration do not scan the whole capacity.
 struct DvzContainer
 {
-    uint32_t count;
+    uint32_t count; // number of occupied slots
     uint32_t capacity;
     DvzObjectType type;
-    void** items;
+    void** items; // one pointer per slot, NULL if the slot is free
     size_t item_size;
+
+    uint32_t* dense;     // indices of the occupied slots, the first count are valid
+    uint32_t* positions; // position of each occupied slot in the dense array
+    uint32_t* free;      // stack of free slots
+    uint32_t free_count;
 };
 
 
@@ -274,12 +283,23 @@ struct DvzContainer
 struct DvzContainerIterator
 {
     DvzContainer* container;
-    uint32_t idx;
+    uint32_t idx; // position of the next item in the dense array
     void* item;
 };
 
 
 
+// Open-addressing hash table with linear probing, mapping 64-bit keys to 64-bit values.
+struct DvzHashTable
+{
+    uint32_t capacity; // power of 2, 0 before the first insertion
+    uint32_t count;
+    uint64_t* keys; // DVZ_HASH_TABLE_EMPTY for the empty slots
+    uint64_t* values;
+};
+
+
+
 struct DvzThread
 {
     DvzObject obj;
@@ -373,13 +393,19 @@ static DvzContainer dvz_container(uint32_t count, size_t item_size, DvzObjectTyp
     container.capacity = dvz_next_pow2(count);
     ASSERT(container.capacity > 0);
     container.items = (void**)calloc(container.capacity, sizeof(void*));
+    container.dense = (uint32_t*)calloc(container.capacity, sizeof(uint32_t));
+    container.positions = (uint32_t*)calloc(container.capacity, sizeof(uint32_t));
+    container.free = (uint32_t*)calloc(container.capacity, sizeof(uint32_t));
     // NOTE: we shouldn't rely on calloc() initializing pointer values to NULL as it is not
     // guaranteed that NULL is represented by 0 bits.
     // https://stackoverflow.com/a/22624643/1595060
     for (uint32_t i = 0; i < container.capacity; i++)
     {
         container.items[i] = NULL;
+        // The free slots are popped in increasing order.
+        container.free[i] = container.capacity - 1 - i;
     }
+    container.free_count = container.capacity;
     return container;
 }
 
@@ -403,8 +429,19 @@ static void dvz_container_delete_if_destroyed(DvzContainer* container, uint32_t
         // log_trace("delete container item #%d", idx);
         FREE(container->items[idx]);
         container->items[idx] = NULL;
+
+        // Move the last occupied slot to the position of the deleted one in the dense array.
+        ASSERT(container->count > 0);
+        uint32_t pos = container->positions[idx];
+        ASSERT(pos < container->count);
+        ASSERT(container->dense[pos] == idx);
+        uint32_t last = container->dense[container->count - 1];
+        container->dense[pos] = last;
+        container->positions[last] = pos;
         container->count--;
-        ASSERT(container->count < UINT32_MAX);
+
+        ASSERT(container->free_count < container->capacity);
+        container->free[container->free_count++] = idx;
     }
 }
 
@@ -421,47 +458,50 @@ static void* dvz_container_alloc(DvzContainer* container)
     ASSERT(container != NULL);
     ASSERT(container->capacity > 0);
     ASSERT(container->items != NULL);
-    uint32_t available_slot = UINT32_MAX;
 
-    // Free the memory of destroyed objects and find the first available slot.
-    for (uint32_t i = 0; i < container->capacity; i++)
+    // The objects are destroyed without notifying the container. When there is no free slot
+    // left, free the memory of the destroyed objects. The container is resized if less than an
+    // eighth of the slots could be reclaimed, so that the cost of this scan is amortized.
+    if (container->free_count == 0)
     {
-        dvz_container_delete_if_destroyed(container, i);
-        // Find first slot with empty pointer, to use for new allocation.
-        if (container->items[i] == NULL && available_slot == UINT32_MAX)
-            available_slot = i;
-    }
+        for (uint32_t i = container->count; i > 0; i--)
+            dvz_container_delete_if_destroyed(container, container->dense[i - 1]);
 
-    // If no slot, need to reallocate container.
-    if (available_slot == UINT32_MAX)
-    {
-        log_trace("reallocate container up to %d items", 2 * container->capacity);
-        void** _new =
-            (void**)realloc(container->items, 2 * container->capacity * container->item_size);
-        ASSERT(_new != NULL);
-        container->items = _new;
-
-        ASSERT(container->items != NULL);
-        // Initialize newly-allocated pointers to NULL.
-        for (uint32_t i = container->capacity; i < 2 * container->capacity; i++)
+        if (container->free_count == 0 || container->free_count < container->capacity / 8)
         {
-            container->items[i] = NULL;
+            uint32_t capacity = 2 * container->capacity;
+            log_trace("reallocate container up to %d items", capacity);
+            void** _new = (void**)realloc(container->items, capacity * sizeof(void*));
+            ASSERT(_new != NULL);
+            container->items = _new;
+            REALLOC(container->dense, capacity * sizeof(uint32_t));
+            REALLOC(container->positions, capacity * sizeof(uint32_t));
+            REALLOC(container->free, capacity * sizeof(uint32_t));
+
+            // Initialize newly-allocated pointers to NULL, and mark the new slots as free.
+            for (uint32_t i = container->capacity; i < capacity; i++)
+            {
+                container->items[i] = NULL;
+                container->free[container->free_count++] = capacity - 1 - (i - container->capacity);
+            }
+            ASSERT(container->items[container->capacity] == NULL);
+            ASSERT(container->items[capacity - 1] == NULL);
+            // Update the container capacity.
+            container->capacity = capacity;
         }
-        ASSERT(container->items[container->capacity] == NULL);
-        ASSERT(container->items[2 * container->capacity - 1] == NULL);
-        // Return the first empty slot of the newly-allocated container.
-        available_slot = container->capacity;
-        // Update the container capacity.
-        container->capacity *= 2;
     }
-    ASSERT(available_slot < UINT32_MAX);
+    ASSERT(container->free_count > 0);
+    uint32_t available_slot = container->free[--container->free_count];
+    ASSERT(available_slot < container->capacity);
     ASSERT(container->items[available_slot] == NULL);
 
     // Memory allocation on the heap and store the pointer in the container.
     // log_trace("container allocates new item #%d", available_slot);
     container->items[available_slot] = calloc(1, container->item_size);
-    container->count++;
     ASSERT(container->items[available_slot] != NULL);
+    container->dense[container->count] = available_slot;
+    container->positions[available_slot] = container->count;
+    container->count++;
 
     // Initialize the DvzObject field.
     DvzObject* obj = (DvzObject*)container->items[available_slot];
@@ -489,6 +529,9 @@ static void* dvz_container_get(DvzContainer* container, uint32_t idx)
 /**
  * Continue an already-started loop iteration on a container.
  *
+ * The iteration order is unspecified. The objects allocated during the iteration may or may not
+ * be visited.
+ *
  * @param container the container
  * @returns a pointer to the next object in the container, or NULL at the end
  */
@@ -497,21 +540,18 @@ static void dvz_container_iter(DvzContainerIterator* iterator)
     ASSERT(iterator != NULL);
     DvzContainer* container = iterator->container;
     ASSERT(container != NULL);
-    if (container->items == NULL || container->capacity == 0 || container->count == 0)
-        return;
-    if (iterator->idx >= container->capacity)
-        return;
-    ASSERT(iterator->idx <= container->capacity - 1);
-    for (uint32_t i = iterator->idx; i < container->capacity; i++)
+    uint32_t slot = 0;
+    while (container->items != NULL && iterator->idx < container->count)
     {
-        dvz_container_delete_if_destroyed(container, i);
-        if (container->items[i] != NULL)
+        slot = container->dense[iterator->idx];
+        dvz_container_delete_if_destroyed(container, slot);
+        if (container->items[slot] != NULL)
         {
-            iterator->idx = i + 1;
-            // log_info("item %d: %d", i, container->items[i]);
-            iterator->item = container->items[i];
+            iterator->idx++;
+            iterator->item = container->items[slot];
             return;
         }
+        // Otherwise, the last occupied slot has been moved to the current position.
     }
     // End the outer loop, reset the internal idx.
     iterator->idx = 0;
@@ -554,31 +594,34 @@ static void dvz_container_destroy(DvzContainer* container)
     // log_trace("container destroy");
     // Check all elements have been destroyed, and free them if necessary.
     DvzObject* item = NULL;
-    for (uint32_t i = 0; i < container->capacity; i++)
+    uint32_t slot = 0;
+    while (container->count > 0)
     {
-        if (container->items[i] != NULL)
+        // log_trace("deleting container item #%d", slot);
+        // When destroying the container, ensure that all objects have been destroyed first.
+        // NOTE: only works if every item has a DvzObject as first struct field.
+        slot = container->dense[container->count - 1];
+        item = (DvzObject*)container->items[slot];
+        ASSERT(item != NULL);
+        dvz_container_delete_if_destroyed(container, slot);
+        // Also deallocate objects allocated/initialized, but not created/destroyed.
+        if (container->items[slot] != NULL)
         {
-            // log_trace("deleting container item #%d", i);
-            // When destroying the container, ensure that all objects have been destroyed first.
-            // NOTE: only works if every item has a DvzObject as first struct field.
-            item = (DvzObject*)container->items[i];
-            dvz_container_delete_if_destroyed(container, i);
-            // Also deallocate objects allocated/initialized, but not created/destroyed.
-            if (container->items[i] != NULL)
-            {
-                ASSERT(item->status <= DVZ_OBJECT_STATUS_INIT);
-                ASSERT(item->status != DVZ_OBJECT_STATUS_DESTROYED);
-                FREE(container->items[i]);
-                container->items[i] = NULL;
-                container->count--;
-                ASSERT(container->count < UINT32_MAX);
-            }
-            ASSERT(container->items[i] == NULL);
+            ASSERT(item->status <= DVZ_OBJECT_STATUS_INIT);
+            ASSERT(item->status != DVZ_OBJECT_STATUS_DESTROYED);
+            FREE(container->items[slot]);
+            container->items[slot] = NULL;
+            container->count--;
         }
+        ASSERT(container->items[slot] == NULL);
     }
     ASSERT(container->count == 0);
     // log_trace("free container items");
     FREE(container->items);
+    FREE(container->dense);
+    FREE(container->positions);
+    FREE(container->free);
+    container->free_count = 0;
     container->capacity = 0;
 }
 
@@ -596,6 +639,182 @@ static void dvz_container_destroy(DvzContainer* container)
 
 
 
+/*************************************************************************************************/
+/*  Hash table                                                                                   */
+/*************************************************************************************************/
+
+#define DVZ_HASH_TABLE_EMPTY            UINT64_MAX // reserved key marking the empty slots
+#define DVZ_HASH_TABLE_DEFAULT_CAPACITY 16
+
+
+
+// First slot probed for a key, with Fibonacci hashing.
+static inline uint32_t _hash_table_slot(DvzHashTable* table, uint64_t key)
+{
+    ASSERT(table != NULL);
+    ASSERT(table->capacity > 0);
+    return (uint32_t)((key * 11400714819323198485ull) >> 32) & (table->capacity - 1);
+}
+
+
+
+/**
+ * Look up a key in a hash table.
+ *
+ * @param table the hash table
+ * @param key the key, which must not be DVZ_HASH_TABLE_EMPTY
+ * @param[out] value the value associated to the key, if found
+ * @returns whether the key was found
+ */
+static bool dvz_hash_table_get(DvzHashTable* table, uint64_t key, uint64_t* value)
+{
+    ASSERT(table != NULL);
+    ASSERT(key != DVZ_HASH_TABLE_EMPTY);
+    if (table->capacity == 0)
+        return false;
+    uint32_t mask = table->capacity - 1;
+    // The table is never full, so there is always an empty slot to end the probing.
+    for (uint32_t i = _hash_table_slot(table, key);; i = (i + 1) & mask)
+    {
+        if (table->keys[i] == DVZ_HASH_TABLE_EMPTY)
+            return false;
+        if (table->keys[i] == key)
+        {
+            if (value != NULL)
+                *value = table->values[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+
+
+// Insert a value if the key is not already present, without resizing the table.
+static bool _hash_table_insert(DvzHashTable* table, uint64_t key, uint64_t value)
+{
+    ASSERT(table != NULL);
+    ASSERT(table->count < table->capacity);
+    uint32_t mask = table->capacity - 1;
+    uint32_t i = _hash_table_slot(table, key);
+    for (; table->keys[i] != DVZ_HASH_TABLE_EMPTY; i = (i + 1) & mask)
+    {
+        if (table->keys[i] == key)
+            return false;
+    }
+    table->keys[i] = key;
+    table->values[i] = value;
+    table->count++;
+    return true;
+}
+
+
+
+static void _hash_table_resize(DvzHashTable* table, uint32_t capacity)
+{
+    ASSERT(table != NULL);
+    ASSERT(capacity > table->capacity);
+    ASSERT((capacity & (capacity - 1)) == 0);
+
+    DvzHashTable old = *table;
+    table->capacity = capacity;
+    table->count = 0;
+    table->keys = (uint64_t*)malloc(capacity * sizeof(uint64_t));
+    table->values = (uint64_t*)calloc(capacity, sizeof(uint64_t));
+    for (uint32_t i = 0; i < capacity; i++)
+        table->keys[i] = DVZ_HASH_TABLE_EMPTY;
+
+    // Rehash the existing entries.
+    for (uint32_t i = 0; i < old.capacity; i++)
+    {
+        if (old.keys[i] != DVZ_HASH_TABLE_EMPTY)
+            _hash_table_insert(table, old.keys[i], old.values[i]);
+    }
+    FREE(old.keys);
+    FREE(old.values);
+}
+
+
+
+/**
+ * Insert a value in a hash table if its key is not already present.
+ *
+ * The table grows to keep its load factor below 1/2.
+ *
+ * @param table the hash table, zero-initialized before the first insertion
+ * @param key the key, which must not be DVZ_HASH_TABLE_EMPTY
+ * @param value the value
+ * @returns whether the value was inserted
+ */
+static bool dvz_hash_table_set(DvzHashTable* table, uint64_t key, uint64_t value)
+{
+    ASSERT(table != NULL);
+    ASSERT(key != DVZ_HASH_TABLE_EMPTY);
+    if (2 * (table->count + 1) > table->capacity)
+        _hash_table_resize(
+            table, table->capacity > 0 ? 2 * table->capacity : DVZ_HASH_TABLE_DEFAULT_CAPACITY);
+    return _hash_table_insert(table, key, value);
+}
+
+
+
+/**
+ * Remove a key from a hash table.
+ *
+ * @param table the hash table
+ * @param key the key, which must not be DVZ_HASH_TABLE_EMPTY
+ * @returns whether the key was found
+ */
+static bool dvz_hash_table_remove(DvzHashTable* table, uint64_t key)
+{
+    ASSERT(table != NULL);
+    ASSERT(key != DVZ_HASH_TABLE_EMPTY);
+    if (table->capacity == 0)
+        return false;
+    uint32_t mask = table->capacity - 1;
+    uint32_t i = _hash_table_slot(table, key);
+    for (; table->keys[i] != key; i = (i + 1) & mask)
+    {
+        if (table->keys[i] == DVZ_HASH_TABLE_EMPTY)
+            return false;
+    }
+
+    // Backward-shift deletion: the next entries of the cluster are moved back so that the empty
+    // slot does not end the probing of any of them.
+    uint32_t home = 0;
+    for (uint32_t j = (i + 1) & mask; table->keys[j] != DVZ_HASH_TABLE_EMPTY; j = (j + 1) & mask)
+    {
+        // Entries whose first probed slot is cyclically in (i, j] stay in place.
+        home = _hash_table_slot(table, table->keys[j]);
+        if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+            continue;
+        table->keys[i] = table->keys[j];
+        table->values[i] = table->values[j];
+        i = j;
+    }
+    table->keys[i] = DVZ_HASH_TABLE_EMPTY;
+    table->count--;
+    return true;
+}
+
+
+
+/**
+ * Destroy a hash table, which can then be reused as an empty table.
+ *
+ * @param table the hash table
+ */
+static void dvz_hash_table_destroy(DvzHashTable* table)
+{
+    ASSERT(table != NULL);
+    FREE(table->keys);
+    FREE(table->values);
+    table->capacity = 0;
+    table->count = 0;
+}
+
+
+
 /*************************************************************************************************/
 /*  I/O                                                                                          */
 /*************************************************************************************************/
@@ -722,6 +941,29 @@ void dvz_triangulate_polygon(
 
 
 
+#define DVZ_HASH_SEED 14695981039346656037ULL
+
+/**
+ * Update a FNV-1a hash with a byte array.
+ *
+ * @param hash the current hash, DVZ_HASH_SEED for a new hash
+ * @param data the bytes
+ * @param size the number of bytes
+ * @returns the updated hash
+ */
+static inline uint64_t dvz_hash(uint64_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+
 /*************************************************************************************************/
 /*  Random                                                                                       */
 /*************************************************************************************************/
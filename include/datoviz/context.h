@@ -5,6 +5,7 @@
 #ifndef DVZ_CONTEXT_HEADER
 #define DVZ_CONTEXT_HEADER
 
+#include "alloc.h"
 #include "colormaps.h"
 #include "common.h"
 #include "fifo.h"
@@ -33,6 +34,9 @@ extern "C" {
 #define DVZ_ZERO_OFFSET                                                                           \
     (uvec3) { 0, 0, 0 }
 
+#define DVZ_PIPELINE_CACHE_MAGIC   0x43505a44 // "DZPC"
+#define DVZ_PIPELINE_CACHE_VERSION 1
+
 
 
 /*************************************************************************************************/
@@ -65,7 +69,12 @@ typedef enum
 /*************************************************************************************************/
 
 typedef struct DvzFontAtlas DvzFontAtlas;
+typedef struct DvzGlyphAtlas DvzGlyphAtlas;
 typedef struct DvzColorTexture DvzColorTexture;
+typedef struct DvzGraphicsKey DvzGraphicsKey;
+typedef struct DvzGraphicsEntry DvzGraphicsEntry;
+typedef struct DvzGraphicsRegistry DvzGraphicsRegistry;
+typedef struct DvzGraphicsStats DvzGraphicsStats;
 
 
 
@@ -81,6 +90,7 @@ struct DvzFontAtlas
     uint8_t* font_texture;
     float glyph_width, glyph_height;
     const char* font_str;
+    uint8_t glyphs[256]; // glyph index of each character code, computed from font_str
     DvzTexture* texture;
 };
 
@@ -94,6 +104,56 @@ struct DvzColorTexture
 
 
 
+// Full state of a graphics pipeline. Two graphics with the same key can share their pipeline.
+struct DvzGraphicsKey
+{
+    DvzGraphicsType type;
+    int flags;
+    uint64_t renderpass; // hash of the attachment formats and subpasses (render pass compatibility)
+    uint32_t subpass;
+    VkPrimitiveTopology topology;
+    DvzBlendType blend_type;
+    DvzDepthTest depth_test;
+    VkPolygonMode polygon_mode;
+    VkCullModeFlags cull_mode;
+    VkFrontFace front_face;
+    uint64_t vertex;  // hash of the vertex bindings and attributes
+    uint64_t slots;   // hash of the descriptor types and push constants
+    uint64_t shaders; // hash of the shader stages and code
+};
+
+
+
+struct DvzGraphicsEntry
+{
+    DvzGraphicsKey key;
+    DvzGraphics* graphics;
+    uint32_t ref_count; // number of requests that have not been released yet
+};
+
+
+
+// Builtin graphics pipelines shared by all canvases of the GPU.
+struct DvzGraphicsRegistry
+{
+    uint32_t count;
+    uint32_t capacity;
+    DvzGraphicsEntry* entries;
+    uint64_t requests; // number of requested builtin graphics
+    uint64_t created;  // number of created pipelines
+};
+
+
+
+struct DvzGraphicsStats
+{
+    uint64_t requests; // number of requested builtin graphics
+    uint64_t created;  // number of created pipelines
+    uint32_t count;    // number of pipelines currently in use
+};
+
+
+
 struct DvzContext
 {
     DvzObject obj;
@@ -106,10 +166,24 @@ struct DvzContext
     DvzContainer samplers;
     DvzContainer textures;
     DvzContainer computes;
+    DvzContainer graphics;
+
+    // Builtin graphics pipelines, deduplicated on their full state.
+    DvzGraphicsRegistry graphics_registry;
+
+    // Suballocation of the default buffers, one allocator per buffer type.
+    DvzAlloc allocators[DVZ_BUFFER_TYPE_COUNT];
+    // Incremented every time a default buffer is recreated, when it is enlarged or compacted. The
+    // command buffers of all canvases then bind a destroyed buffer and must be refilled.
+    uint64_t buffers_generation;
 
     // Font atlas.
     DvzFontAtlas font_atlas;
+    DvzGlyphAtlas* glyph_atlas; // created on first use by dvz_ctx_glyph_atlas()
     DvzColorTexture color_texture;
+
+    // File where the pipeline cache is persisted across runs, empty if disabled.
+    char pipeline_cache_path[1024];
 };
 
 
@@ -366,6 +440,19 @@ DVZ_EXPORT DvzContext* dvz_context(DvzGpu* gpu, DvzWindow* window);
  */
 DVZ_EXPORT void dvz_context_reset(DvzContext* context);
 
+/**
+ * Set the file where the pipeline cache of the context is persisted across runs.
+ *
+ * The file is loaded immediately, and rewritten when the context is destroyed. It is deleted if
+ * it is corrupted or was written with another device or driver version. By default, the path is
+ * read from the `DVZ_PIPELINE_CACHE` environment variable when the context is created.
+ *
+ * @param context the context
+ * @param path the path to the cache file, or NULL to disable persistence
+ * @returns whether a valid pipeline cache was loaded
+ */
+DVZ_EXPORT bool dvz_context_pipeline_cache(DvzContext* context, const char* path);
+
 
 
 /*************************************************************************************************/
@@ -393,6 +480,43 @@ DVZ_EXPORT DvzBufferRegions dvz_ctx_buffers(
 DVZ_EXPORT void
 dvz_ctx_buffers_resize(DvzContext* context, DvzBufferRegions* br, VkDeviceSize new_size);
 
+/**
+ * Free a set of buffer regions so that the space can be reused by subsequent allocations.
+ *
+ * @param context the context
+ * @param br the buffer regions to free
+ */
+DVZ_EXPORT void dvz_ctx_buffers_free(DvzContext* context, DvzBufferRegions* br);
+
+/**
+ * Defragment a buffer by moving a set of buffer regions towards the beginning of the buffer.
+ *
+ * The underlying buffer is recreated with a possibly smaller size, the passed buffer regions are
+ * updated with their new offsets, and the passed bindings referring to these regions are updated.
+ * Regions that are not passed are kept in place. Command buffers referring to the buffer need to
+ * be refilled afterwards.
+ *
+ * @param context the context
+ * @param buffer_type the type of the buffer to compact
+ * @param count the number of buffer regions that can be moved
+ * @param regions pointers to the buffer regions that can be moved
+ * @param bindings_count the number of bindings to update
+ * @param bindings pointers to the bindings to update
+ * @returns the new size of the buffer, in bytes
+ */
+DVZ_EXPORT VkDeviceSize dvz_ctx_buffers_compact(
+    DvzContext* context, DvzBufferType buffer_type, uint32_t count, DvzBufferRegions** regions,
+    uint32_t bindings_count, DvzBindings** bindings);
+
+/**
+ * Return statistics about the suballocation of a default buffer.
+ *
+ * @param context the context
+ * @param buffer_type the type of the buffer
+ * @returns the allocation statistics
+ */
+DVZ_EXPORT DvzAllocStats dvz_ctx_buffers_stats(DvzContext* context, DvzBufferType buffer_type);
+
 
 
 /*************************************************************************************************/
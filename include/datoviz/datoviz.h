@@ -16,6 +16,7 @@ extern "C" {
 #include "context.h"
 #include "controls.h"
 #include "demo.h"
+#include "glyphs.h"
 #include "graphics.h"
 #include "gui.h"
 #include "interact.h"
@@ -17,7 +17,8 @@ extern "C" {
 /*  Constants                                                                                    */
 /*************************************************************************************************/
 
-#define DVZ_MAX_FIFO_CAPACITY 256
+#define DVZ_MAX_FIFO_CAPACITY     256
+#define DVZ_FIFO_MAX_SEGMENT_SIZE 65536
 
 
 
@@ -26,6 +27,23 @@ extern "C" {
 /*************************************************************************************************/
 
 typedef struct DvzFifo DvzFifo;
+typedef struct DvzFifoSlot DvzFifoSlot;
+typedef struct DvzFifoSegment DvzFifoSegment;
+typedef DvzFifoSegment* DvzFifoSegmentPtr;
+
+
+
+/*************************************************************************************************/
+/*  Enums                                                                                        */
+/*************************************************************************************************/
+
+// FIFO queue mode
+typedef enum
+{
+    DVZ_FIFO_MODE_MUTEX, // mutex-protected ring buffer, any number of producers and consumers
+    DVZ_FIFO_MODE_SPSC,  // lock-free, single producer and single consumer
+    DVZ_FIFO_MODE_MPSC,  // lock-free, multiple producers and single consumer
+} DvzFifoMode;
 
 
 
@@ -33,8 +51,32 @@ typedef struct DvzFifo DvzFifo;
 /*  FIFO queue                                                                                   */
 /*************************************************************************************************/
 
+struct DvzFifoSlot
+{
+    void* item;
+    atomic(bool, ready); // set by the producer once the item has been written
+};
+
+
+
+// In the lock-free modes, the queue is a linked list of ring segments. The producers fill the
+// last segment and append a new, larger one when it is full. The consumer reads the first segment
+// and drops it when it has been entirely consumed.
+struct DvzFifoSegment
+{
+    uint32_t capacity;
+    DvzFifoSlot* slots;
+    atomic(uint32_t, enqueued); // index of the next slot to be reserved by a producer
+    uint32_t dequeued;          // index of the next slot to be read by the consumer
+    atomic(DvzFifoSegmentPtr, next);
+    DvzFifoSegment* retired; // next segment in the list of segments waiting to be freed
+};
+
+
+
 struct DvzFifo
 {
+    DvzFifoMode mode;
     int32_t head, tail;
     int32_t capacity;
     void** items;
@@ -45,6 +87,14 @@ struct DvzFifo
 
     atomic(bool, is_processing);
     atomic(bool, is_empty);
+
+    // Lock-free modes only.
+    DvzFifoSegment* read_segment;             // only accessed by the consumer
+    atomic(DvzFifoSegmentPtr, write_segment); // shared by the producers
+    atomic(int32_t, count);                   // number of items that can be dequeued
+    atomic(int32_t, producers);               // number of producers in dvz_fifo_enqueue()
+    atomic(int32_t, waiters);                 // number of consumers blocked in dvz_fifo_dequeue()
+    DvzFifoSegment* retired;                  // consumed segments that may still be accessed
 };
 
 
@@ -56,11 +106,25 @@ struct DvzFifo
 /**
  * Create a FIFO queue.
  *
- * @param capacity the maximum size
+ * @param capacity the initial capacity, the queue is enlarged as needed
  * @returns a FIFO queue
  */
 DVZ_EXPORT DvzFifo dvz_fifo(int32_t capacity);
 
+/**
+ * Create a lock-free FIFO queue.
+ *
+ * The queue has the same API as the mutex-protected queue, but it supports a single consumer
+ * thread only (and a single producer thread in SPSC mode). `dvz_fifo_discard()` and
+ * `dvz_fifo_reset()` must be called from the consumer thread. The mutex and the condition
+ * variable are only used when the consumer blocks in `dvz_fifo_dequeue()` with `wait=true`.
+ *
+ * @param capacity the capacity of the first segment, the queue is enlarged as needed
+ * @param mode either `DVZ_FIFO_MODE_SPSC` or `DVZ_FIFO_MODE_MPSC`
+ * @returns a FIFO queue
+ */
+DVZ_EXPORT DvzFifo dvz_fifo_lockfree(int32_t capacity, DvzFifoMode mode);
+
 /**
  * Enqueue an object in a queue.
  *
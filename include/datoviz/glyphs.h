@@ -0,0 +1,267 @@
+/*************************************************************************************************/
+/*  Dynamic glyph atlas: glyphs rasterized on demand as signed distance fields                  */
+/*************************************************************************************************/
+
+#ifndef DVZ_GLYPHS_HEADER
+#define DVZ_GLYPHS_HEADER
+
+#include "context.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_GLYPH_ATLAS_SIZE 1024 // default width and height of the atlas texture
+#define DVZ_GLYPH_MAX_FONTS  8
+#define DVZ_GLYPH_SDF_SIZE   32 // pixel size at which the glyphs are rasterized
+#define DVZ_GLYPH_SDF_SPREAD 4  // distance in pixels covered by the signed distance field
+#define DVZ_GLYPH_MISSING    UINT32_MAX // cached glyph index of the missing code points
+#define DVZ_GLYPH_ASCENT     .8 // height of the line box above the baseline, relative to the size
+
+
+
+/*************************************************************************************************/
+/*  Type definitions                                                                             */
+/*************************************************************************************************/
+
+typedef struct DvzSkylineNode DvzSkylineNode;
+typedef struct DvzSkyline DvzSkyline;
+typedef struct DvzGlyph DvzGlyph;
+typedef struct DvzGlyphAtlasStats DvzGlyphAtlasStats;
+// NOTE: DvzGlyphAtlas is declared in context.h as the context owns the shared atlas.
+
+
+
+/*************************************************************************************************/
+/*  Structs                                                                                      */
+/*************************************************************************************************/
+
+// Horizontal segment of the top boundary of the packed rectangles.
+struct DvzSkylineNode
+{
+    uint32_t x, y, width;
+};
+
+
+
+// Skyline rectangle packer: the nodes cover [0, width) from left to right.
+struct DvzSkyline
+{
+    uint32_t width, height;
+    uint32_t count;
+    uint32_t capacity;
+    DvzSkylineNode* nodes;
+    uint64_t used_area; // total area of the packed rectangles
+};
+
+
+
+// Glyph metrics are in pixels at DVZ_GLYPH_SDF_SIZE, and should be scaled by
+// font_size / DVZ_GLYPH_SDF_SIZE.
+struct DvzGlyph
+{
+    uint32_t font;
+    uint32_t codepoint;
+    uint32_t x, y;          // position of the glyph bitmap in the atlas, including the spread
+    uint32_t width, height; // size of the glyph bitmap in the atlas, including the spread
+    vec4 uv;                // texture coordinates of the bitmap, (u0, v0, u1, v1)
+    vec2 bearing;           // offset of the bitmap top-left corner from the pen, y pointing up
+    float advance;          // horizontal advance to the next glyph
+};
+
+
+
+struct DvzGlyphAtlasStats
+{
+    uint64_t hits;           // glyph lookups found in the cache, including the missing glyphs
+    uint64_t misses;         // glyph lookups that required a rasterization
+    uint64_t failures;       // glyphs that could not be rasterized or did not fit in the atlas
+    uint64_t uploaded_bytes; // bytes uploaded to the atlas texture
+    uint32_t glyph_count;    // number of glyphs in the atlas
+    uint32_t font_count;     // number of loaded fonts
+    float occupancy;         // fraction of the atlas area used by the glyphs
+};
+
+
+
+struct DvzGlyphAtlas
+{
+    DvzObject obj;
+    DvzContext* context;
+
+    // Single-channel SDF pixels, kept on the CPU and uploaded to the texture when dirty.
+    uint32_t width, height;
+    uint8_t* pixels;
+    DvzSkyline skyline;
+    DvzTexture* texture;
+    bool is_full; // whether a glyph did not fit, to warn only once
+
+    // Rows covering all glyphs inserted since the last upload.
+    uint32_t dirty_min, dirty_max;
+
+    // FreeType library and faces, the fonts are searched in order for missing glyphs.
+    void* library;
+    void* faces[DVZ_GLYPH_MAX_FONTS];
+    uint32_t font_count;
+
+    // Glyph cache: (font, codepoint) keys to indices in `glyphs`, or DVZ_GLYPH_MISSING for the
+    // code points that no font has.
+    DvzHashTable cache;
+    uint32_t glyph_count;
+    uint32_t glyph_capacity;
+    DvzGlyph* glyphs;
+
+    DvzGlyphAtlasStats stats;
+};
+
+
+
+/*************************************************************************************************/
+/*  Skyline packer                                                                               */
+/*************************************************************************************************/
+
+/**
+ * Create a skyline rectangle packer.
+ *
+ * @param width the width of the packed area
+ * @param height the height of the packed area
+ * @returns the packer
+ */
+DVZ_EXPORT DvzSkyline dvz_skyline(uint32_t width, uint32_t height);
+
+/**
+ * Pack a rectangle at the lowest position where it fits.
+ *
+ * @param skyline the packer
+ * @param width the rectangle width
+ * @param height the rectangle height
+ * @param[out] pos the position of the top-left corner of the rectangle
+ * @returns whether the rectangle fitted in the packed area
+ */
+DVZ_EXPORT bool dvz_skyline_pack(DvzSkyline* skyline, uint32_t width, uint32_t height, uvec2 pos);
+
+/**
+ * Destroy a skyline packer.
+ *
+ * @param skyline the packer
+ */
+DVZ_EXPORT void dvz_skyline_destroy(DvzSkyline* skyline);
+
+
+
+/*************************************************************************************************/
+/*  Unicode                                                                                      */
+/*************************************************************************************************/
+
+/**
+ * Decode the next character of a UTF-8 string.
+ *
+ * Invalid bytes are decoded as U+FFFD.
+ *
+ * @param[in,out] str pointer to the string, advanced past the decoded character
+ * @returns the code point, or 0 at the end of the string
+ */
+DVZ_EXPORT uint32_t dvz_utf8_next(const char** str);
+
+
+
+/*************************************************************************************************/
+/*  Glyph atlas                                                                                  */
+/*************************************************************************************************/
+
+/**
+ * Create a glyph atlas.
+ *
+ * @param context the context, or NULL for an atlas without GPU texture
+ * @param width the atlas width, in pixels
+ * @param height the atlas height, in pixels
+ * @returns the glyph atlas
+ */
+DVZ_EXPORT DvzGlyphAtlas dvz_glyph_atlas(DvzContext* context, uint32_t width, uint32_t height);
+
+/**
+ * Return the glyph atlas shared by all text visuals of a context, creating it on first use.
+ *
+ * @param context the context
+ * @returns the shared glyph atlas
+ */
+DVZ_EXPORT DvzGlyphAtlas* dvz_ctx_glyph_atlas(DvzContext* context);
+
+/**
+ * Load a font file. Requires FreeType.
+ *
+ * @param atlas the glyph atlas
+ * @param path the path to a font file supported by FreeType (TTF, OTF...)
+ * @returns the font index, or -1 if the font could not be loaded
+ */
+DVZ_EXPORT int dvz_glyph_atlas_font(DvzGlyphAtlas* atlas, const char* path);
+
+/**
+ * Get a glyph, rasterizing it on a cache miss.
+ *
+ * If the font has no glyph for that code point, the other fonts are tried in order, and then the
+ * builtin monospace font of the context.
+ *
+ * @param atlas the glyph atlas
+ * @param font the font index
+ * @param codepoint the Unicode code point
+ * @param[out] glyph the glyph
+ * @returns whether the glyph is in the atlas
+ */
+DVZ_EXPORT bool
+dvz_glyph_atlas_glyph(DvzGlyphAtlas* atlas, uint32_t font, uint32_t codepoint, DvzGlyph* glyph);
+
+/**
+ * Add a glyph from an 8-bit coverage bitmap, used for glyphs rasterized outside of FreeType.
+ *
+ * @param atlas the glyph atlas
+ * @param font the font index
+ * @param codepoint the Unicode code point
+ * @param width the bitmap width
+ * @param height the bitmap height
+ * @param coverage the bitmap, one byte per pixel, row-major
+ * @param bearing the offset of the top-left corner of the bitmap from the pen position
+ * @param advance the horizontal advance to the next glyph
+ * @param[out] glyph the glyph
+ * @returns whether the glyph fitted in the atlas
+ */
+DVZ_EXPORT bool dvz_glyph_atlas_insert(
+    DvzGlyphAtlas* atlas, uint32_t font, uint32_t codepoint, uint32_t width, uint32_t height,
+    const uint8_t* coverage, vec2 bearing, float advance, DvzGlyph* glyph);
+
+/**
+ * Upload the rows of the atlas modified since the last upload.
+ *
+ * @param atlas the glyph atlas
+ * @param canvas the canvas used for the transfer
+ */
+DVZ_EXPORT void dvz_glyph_atlas_upload(DvzGlyphAtlas* atlas, DvzCanvas* canvas);
+
+/**
+ * Return the cache and occupancy statistics of a glyph atlas.
+ *
+ * @param atlas the glyph atlas
+ * @returns the statistics
+ */
+DVZ_EXPORT DvzGlyphAtlasStats dvz_glyph_atlas_stats(DvzGlyphAtlas* atlas);
+
+/**
+ * Destroy a glyph atlas. The texture is destroyed with the context.
+ *
+ * @param atlas the glyph atlas
+ */
+DVZ_EXPORT void dvz_glyph_atlas_destroy(DvzGlyphAtlas* atlas);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -251,6 +251,9 @@ struct DvzGraphicsTextVertex
     float angle;       /* string angle */
     usvec4 glyph;      /* glyph: char code, char index, string length, string index */
     uint8_t transform; /* transform enum */
+    vec2 glyph_shift;  /* glyph offset from the string top-left corner, in pixels, y down */
+    vec2 string_size;  /* string size, in pixels */
+    vec4 uv;           /* glyph texture coordinates in the glyph atlas (u0, v0, u1, v1) */
 };
 
 struct DvzGraphicsTextItem
@@ -263,8 +266,7 @@ struct DvzGraphicsTextItem
 
 struct DvzGraphicsTextParams
 {
-    ivec2 grid_size; /* font atlas grid size (rows, columns) */
-    ivec2 tex_size;  /* font atlas texture size, in pixels */
+    ivec2 tex_size; /* glyph atlas texture size, in pixels */
 };
 
 
@@ -455,14 +457,48 @@ DVZ_EXPORT void dvz_graphics_alloc(DvzGraphicsData* data, uint32_t item_count);
 DVZ_EXPORT void dvz_graphics_append(DvzGraphicsData* data, const void* item);
 
 /**
- * Create a new graphics pipeline of a given builtin type.
+ * Add many strings to a text graphics data object in a single pass.
  *
- * @param canvas the canvas holding the grahpics pipeline
+ * This is equivalent to calling `dvz_graphics_append()` on each string, without the per-item
+ * callback overhead. The data object must have been allocated with the total number of glyphs.
+ *
+ * @param data the graphics data object, of a `DVZ_GRAPHICS_TEXT` graphics
+ * @param count the number of strings
+ * @param items the text items, one per string
+ */
+DVZ_EXPORT void dvz_graphics_append_text(
+    DvzGraphicsData* data, uint32_t count, const DvzGraphicsTextItem* items);
+
+/**
+ * Get a graphics pipeline of a given builtin type.
+ *
+ * The pipelines are shared by all canvases of the GPU: an existing pipeline with the same state
+ * is returned instead of creating a new one. The request is released when the canvas is
+ * destroyed.
+ *
+ * @param canvas the canvas requesting the graphics pipeline
  * @param type the graphics type
  * @param flags the creation flags for the graphics
+ * @returns the graphics pipeline
  */
 DVZ_EXPORT DvzGraphics* dvz_graphics_builtin(DvzCanvas* canvas, DvzGraphicsType type, int flags);
 
+/**
+ * Release a request of a builtin graphics pipeline, destroying it when it is no longer used.
+ *
+ * @param context the context of the GPU
+ * @param graphics the graphics pipeline returned by `dvz_graphics_builtin()`
+ */
+DVZ_EXPORT void dvz_graphics_release(DvzContext* context, DvzGraphics* graphics);
+
+/**
+ * Return the number of builtin graphics requests and of created pipelines.
+ *
+ * @param context the context of the GPU
+ * @returns the statistics
+ */
+DVZ_EXPORT DvzGraphicsStats dvz_graphics_stats(DvzContext* context);
+
 
 
 /**
@@ -101,8 +101,18 @@ struct DvzPanel
     DvzBufferRegions br_mvp; // for the uniform buffer containing the MVP
 
     DvzController* controller;
-    DvzCommands* cmds;
     int prority_max;
+
+    // Secondary command buffers with the draw commands of the panel, one per swapchain image,
+    // only re-recorded when they have been marked as dirty.
+    DvzCommands cmds;
+    bool cmds_dirty[DVZ_MAX_SWAPCHAIN_IMAGES];
+
+    // Batching of the visuals sharing a graphics pipeline and all of their bound resources, with
+    // one region of indirect draw commands per swapchain image.
+    bool batch;
+    DvzBufferRegions br_draws;
+    uint32_t batched; // number of visuals drawn in a batch at the last recording
 };
 
 
@@ -161,6 +171,29 @@ DVZ_EXPORT DvzPanel* dvz_panel(DvzGrid* grid, uint32_t row, uint32_t col);
  */
 DVZ_EXPORT void dvz_panel_update(DvzPanel* panel);
 
+/**
+ * Re-record the command buffers of a panel, and only this panel, at the next canvas refill.
+ *
+ * @param panel the panel
+ */
+DVZ_EXPORT void dvz_panel_to_refill(DvzPanel* panel);
+
+/**
+ * Enable or disable the batching of the visuals of a panel.
+ *
+ * When enabled, consecutive visuals sharing a graphics pipeline, a vertex buffer and their bound
+ * resources are drawn with a single multi-draw indirect call. See `dvz_visual_fill_batch()`.
+ *
+ * Batching only applies to visuals that share all of their uniform buffers and textures, which
+ * must be set explicitly with `dvz_visual_buffer()` and `dvz_visual_texture()`: there is no
+ * per-draw data, so visuals with their own parameters (marker size, line width, colormap...)
+ * are drawn one by one, as when batching is disabled.
+ *
+ * @param panel the panel
+ * @param batch whether to batch the visuals
+ */
+DVZ_EXPORT void dvz_panel_batch(DvzPanel* panel, bool batch);
+
 /**
  * Set panel margins.
  *
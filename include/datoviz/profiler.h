@@ -0,0 +1,253 @@
+/*************************************************************************************************/
+/*  Frame profiler: CPU scopes, GPU timestamps and counters, exported as a Chrome trace          */
+/*************************************************************************************************/
+
+#ifndef DVZ_PROFILER_HEADER
+#define DVZ_PROFILER_HEADER
+
+#include "vklite.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_PROFILER_CAPACITY 65536
+
+
+
+/*************************************************************************************************/
+/*  Enums                                                                                        */
+/*************************************************************************************************/
+
+// Profiler event type.
+typedef enum
+{
+    DVZ_PROFILE_CPU,     // scope timed on the CPU
+    DVZ_PROFILE_GPU,     // range timed on the GPU with timestamp queries
+    DVZ_PROFILE_COUNTER, // per-frame counter
+} DvzProfileEventType;
+
+
+
+// Per-frame counters.
+typedef enum
+{
+    DVZ_PROFILE_COUNTER_UPLOAD_BYTES, // number of bytes uploaded by the transfers
+    DVZ_PROFILE_COUNTER_DRAWS,        // number of draw calls in the submitted command buffers
+    DVZ_PROFILE_COUNTER_REFILLS,      // number of refilled command buffers
+    DVZ_PROFILE_COUNTER_SECONDARIES,  // number of re-recorded secondary command buffers
+    DVZ_PROFILE_COUNTER_COUNT,
+} DvzProfileCounter;
+
+
+
+// GPU ranges timed with timestamp queries.
+typedef enum
+{
+    DVZ_PROFILE_GPU_RENDER,   // render submission
+    DVZ_PROFILE_GPU_TRANSFER, // staged transfer submission
+    DVZ_PROFILE_GPU_COUNT,
+} DvzProfileGpuRange;
+
+
+
+/*************************************************************************************************/
+/*  Type definitions                                                                             */
+/*************************************************************************************************/
+
+typedef struct DvzProfileEvent DvzProfileEvent;
+typedef struct DvzProfiler DvzProfiler;
+
+
+
+/*************************************************************************************************/
+/*  Structs                                                                                      */
+/*************************************************************************************************/
+
+struct DvzProfileEvent
+{
+    DvzProfileEventType type;
+    const char* name; // must be a static string
+    uint64_t frame_idx;
+    double start; // in seconds, since the creation of the profiler
+    double value; // duration in seconds, or counter value
+};
+
+
+
+// All profiler functions must be called from the main thread.
+struct DvzProfiler
+{
+    DvzObject obj;
+    DvzGpu* gpu;
+
+    double origin; // absolute time at the creation of the profiler
+    uint64_t frame_idx;
+
+    // Ring buffer of events, the oldest events are overwritten when it is full.
+    uint32_t capacity;
+    uint64_t count; // total number of recorded events
+    DvzProfileEvent* events;
+
+    // Counters accumulated during the current frame.
+    double counters[DVZ_PROFILE_COUNTER_COUNT];
+
+    // GPU timestamps: one pair of queries per range and per slot (swapchain image or transfer
+    // frame). The results are read without waiting, at the following frames.
+    bool has_gpu[DVZ_PROFILE_GPU_COUNT];
+    DvzQueries queries;
+    bool pending[DVZ_PROFILE_GPU_COUNT][DVZ_MAX_SWAPCHAIN_IMAGES];
+    double submitted[DVZ_PROFILE_GPU_COUNT][DVZ_MAX_SWAPCHAIN_IMAGES];
+    uint64_t submitted_frame[DVZ_PROFILE_GPU_COUNT][DVZ_MAX_SWAPCHAIN_IMAGES];
+
+    // Pre-recorded command buffers submitted before and after the render command buffers.
+    DvzCommands cmds_begin;
+    DvzCommands cmds_end;
+};
+
+
+
+/*************************************************************************************************/
+/*  Profiler                                                                                     */
+/*************************************************************************************************/
+
+/**
+ * Create a profiler.
+ *
+ * @param gpu the GPU
+ * @param capacity the maximum number of events kept in the ring buffer (0: default)
+ * @returns the profiler
+ */
+DVZ_EXPORT DvzProfiler dvz_profiler(DvzGpu* gpu, uint32_t capacity);
+
+/**
+ * Enable GPU timestamps around the render submissions.
+ *
+ * @param prof the profiler
+ * @param queue_idx the render queue index
+ * @param img_count the number of swapchain images
+ */
+DVZ_EXPORT void dvz_profiler_render(DvzProfiler* prof, uint32_t queue_idx, uint32_t img_count);
+
+/**
+ * Enable GPU timestamps in the transfer command buffers, if the queue supports them.
+ *
+ * @param prof the profiler
+ * @param queue_idx the transfer queue index
+ * @returns whether the transfer submissions can be timed
+ */
+DVZ_EXPORT bool dvz_profiler_transfer(DvzProfiler* prof, uint32_t queue_idx);
+
+/**
+ * Add an event to the ring buffer.
+ *
+ * @param prof the profiler
+ * @param type the event type
+ * @param name the event name, must be a static string
+ * @param start the absolute start time, in seconds
+ * @param value the duration in seconds, or the counter value
+ */
+DVZ_EXPORT void dvz_profiler_event(
+    DvzProfiler* prof, DvzProfileEventType type, const char* name, double start, double value);
+
+/**
+ * Start a new frame: flush the counters of the previous frame and read the available GPU
+ * timestamps.
+ *
+ * @param prof the profiler
+ * @param frame_idx the index of the new frame
+ */
+DVZ_EXPORT void dvz_profiler_frame(DvzProfiler* prof, uint64_t frame_idx);
+
+/**
+ * Record the reset of a pair of timestamp queries and the first timestamp.
+ *
+ * @param prof the profiler
+ * @param range the GPU range
+ * @param cmds the command buffers
+ * @param idx the command buffer index, also used as the query slot
+ */
+DVZ_EXPORT void dvz_profiler_gpu_begin(
+    DvzProfiler* prof, DvzProfileGpuRange range, DvzCommands* cmds, uint32_t idx);
+
+/**
+ * Record the second timestamp of a pair of queries.
+ *
+ * @param prof the profiler
+ * @param range the GPU range
+ * @param cmds the command buffers
+ * @param idx the command buffer index, also used as the query slot
+ */
+DVZ_EXPORT void dvz_profiler_gpu_end(
+    DvzProfiler* prof, DvzProfileGpuRange range, DvzCommands* cmds, uint32_t idx);
+
+/**
+ * Mark a pair of timestamp queries as submitted.
+ *
+ * @param prof the profiler
+ * @param range the GPU range
+ * @param idx the query slot
+ */
+DVZ_EXPORT void
+dvz_profiler_gpu_submitted(DvzProfiler* prof, DvzProfileGpuRange range, uint32_t idx);
+
+/**
+ * Write the events of the ring buffer as a Chrome trace-event JSON file.
+ *
+ * The file can be opened in `chrome://tracing` or https://ui.perfetto.dev.
+ *
+ * @param prof the profiler
+ * @param path the path to the JSON file
+ * @returns 0 if the file was successfully written
+ */
+DVZ_EXPORT int dvz_profiler_dump(DvzProfiler* prof, const char* path);
+
+/**
+ * Destroy a profiler.
+ *
+ * @param prof the profiler
+ */
+DVZ_EXPORT void dvz_profiler_destroy(DvzProfiler* prof);
+
+
+
+/*************************************************************************************************/
+/*  Instrumentation                                                                              */
+/*************************************************************************************************/
+
+// These helpers do nothing but a NULL check when profiling is disabled.
+
+static inline double dvz_profile_start(DvzProfiler* prof)
+{
+    return prof != NULL ? _clock_now() : 0; //
+}
+
+
+
+static inline void dvz_profile_end(DvzProfiler* prof, const char* name, double start)
+{
+    if (prof != NULL)
+        dvz_profiler_event(prof, DVZ_PROFILE_CPU, name, start, _clock_now() - start);
+}
+
+
+
+static inline void dvz_profile_count(DvzProfiler* prof, DvzProfileCounter counter, double value)
+{
+    if (prof != NULL)
+        prof->counters[counter] += value;
+}
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
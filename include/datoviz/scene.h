@@ -52,6 +52,7 @@ typedef enum
     DVZ_VISUAL_FLAGS_TRANSFORM_NONE = 0x0010,
     DVZ_VISUAL_FLAGS_TRANSFORM_BOX_INIT = 0x0020, // do not recompute the panel box whenever
                                                   // the POS prop changes
+    DVZ_VISUAL_FLAGS_TRANSFORM_GPU = 0x0040,      // normalize the POS props on the GPU
 } DvzVisualFlags;
 
 
@@ -111,6 +112,7 @@ struct DvzAxes2D
 {
     DvzAxesContext ctx[2]; // one per dimension
     DvzAxesTicks ticks[2];
+    DvzAxesTicksCache ticks_cache[2];
     DvzBox box; // box, in data coordinates, corresponding to the box showed with initial panzoom
     float font_size;
 };
@@ -161,6 +163,18 @@ struct DvzScene
 
     // FIFO queue with the pending scene updates.
     DvzFifo update_fifo;
+
+    // Number of POS items scanned to compute bounding boxes during the last frame, and in total.
+    uint64_t box_scanned;
+    uint64_t box_scanned_total;
+
+    // Number of POS items normalized or split during the last frame, and in total.
+    uint64_t pos_normalized;
+    uint64_t pos_normalized_total;
+
+    // Number of panel command buffers re-recorded during the last refill, and in total.
+    uint32_t cmds_recorded;
+    uint64_t cmds_recorded_total;
 };
 
 
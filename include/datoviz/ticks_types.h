@@ -9,6 +9,15 @@
 
 
 
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_TICKS_CACHE_SIZE    8  // number of cached tick computations per axis
+#define DVZ_TICKS_CACHE_QUANTUM 64 // number of range quantization steps per power of 2
+
+
+
 /*************************************************************************************************/
 /*  Enums                                                                                        */
 /*************************************************************************************************/
@@ -29,6 +38,8 @@ typedef enum
 
 typedef struct DvzAxesContext DvzAxesContext;
 typedef struct DvzAxesTicks DvzAxesTicks;
+typedef struct DvzAxesTicksKey DvzAxesTicksKey;
+typedef struct DvzAxesTicksCache DvzAxesTicksCache;
 typedef struct Q Q;
 
 
@@ -63,4 +74,28 @@ struct DvzAxesTicks
 
 
 
+// Key of a tick computation: quantized range and axes context.
+struct DvzAxesTicksKey
+{
+    int64_t qmin, qmax;     // range bounds, in quantization steps
+    int32_t exponent;       // the quantization step is 2^exponent / DVZ_TICKS_CACHE_QUANTUM
+    uint32_t size_viewport; // in pixels
+    uint32_t size_glyph;    // in 1/16 pixels
+    uint32_t extensions;
+};
+
+
+
+// Memoization of the tick computations of one axis, with round-robin eviction.
+struct DvzAxesTicksCache
+{
+    uint32_t count; // number of used entries
+    uint32_t next;  // next entry to evict when the cache is full
+    uint64_t hits, misses;
+    DvzAxesTicksKey keys[DVZ_TICKS_CACHE_SIZE];
+    DvzAxesTicks ticks[DVZ_TICKS_CACHE_SIZE];
+};
+
+
+
 #endif
@@ -6,10 +6,24 @@
 #define DVZ_TRANSFERS_HEADER
 
 // #include "../include/datoviz/context.h"
+#include "../include/datoviz/profiler.h"
 #include "../include/datoviz/vklite.h"
 
 
 
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_STAGING_RING_SIZE      (16 * 1024 * 1024)
+#define DVZ_STAGING_RING_ALIGNMENT 16
+
+// NOTE: twice the maximum capacity of the transfer FIFO queue, so that the pool is never
+// exhausted in practice.
+#define DVZ_TRANSFER_POOL_SIZE 512
+
+
+
 /*************************************************************************************************/
 /*  Transfer enums                                                                               */
 /*************************************************************************************************/
@@ -24,6 +38,7 @@ typedef enum
     DVZ_TRANSFER_TEXTURE_UPLOAD,
     DVZ_TRANSFER_TEXTURE_DOWNLOAD,
     DVZ_TRANSFER_TEXTURE_COPY,
+    DVZ_TRANSFER_CALLBACK,
 } DvzDataTransferType;
 
 
@@ -37,7 +52,12 @@ typedef struct DvzTransferBuffer DvzTransferBuffer;
 typedef struct DvzTransferBufferCopy DvzTransferBufferCopy;
 typedef struct DvzTransferTexture DvzTransferTexture;
 typedef struct DvzTransferTextureCopy DvzTransferTextureCopy;
+typedef struct DvzTransferCall DvzTransferCall;
 typedef union DvzTransferUnion DvzTransferUnion;
+typedef struct DvzTransferStats DvzTransferStats;
+typedef struct DvzStagingRing DvzStagingRing;
+typedef struct DvzStagedUpload DvzStagedUpload;
+typedef struct DvzTransferPool DvzTransferPool;
 
 
 
@@ -81,12 +101,24 @@ struct DvzTransferTextureCopy
 
 
 
+// Callback called in order with the other transfers, once the previous ones have completed.
+typedef void (*DvzTransferCallback)(DvzCanvas* canvas, void* user_data);
+
+struct DvzTransferCall
+{
+    DvzTransferCallback callback;
+    void* user_data;
+};
+
+
+
 union DvzTransferUnion
 {
     DvzTransferBuffer buf;
     DvzTransferTexture tex;
     DvzTransferBufferCopy buf_copy;
     DvzTransferTextureCopy tex_copy;
+    DvzTransferCall call;
 };
 
 
@@ -99,6 +131,82 @@ struct DvzTransfer
 
 
 
+struct DvzTransferPool
+{
+    uint32_t capacity;
+    DvzTransfer* items; // fixed array of transfer descriptors, allocated once
+    uint32_t free_count;
+    uint32_t* free; // stack with the indices of the free descriptors
+    pthread_mutex_t lock;
+};
+
+
+
+struct DvzStagedUpload
+{
+    DvzBuffer* buffer;
+    VkDeviceSize start, end; // range in the destination buffer
+    uint32_t order;          // position of the upload in the transfer queue
+    const void* data;
+};
+
+
+
+struct DvzTransferStats
+{
+    uint64_t uploads;        // number of uploads that went through the staging ring
+    uint64_t bytes_staged;   // total number of bytes copied to the staging ring
+    uint64_t copies;         // number of recorded copy regions
+    uint64_t merged;         // number of uploads merged with an adjacent or overlapping one
+    uint64_t dropped;        // number of uploads fully overwritten by a later one
+    uint64_t submissions;    // number of transfer command buffer submissions
+    uint64_t stalls_avoided; // number of uploads that did not wait for the GPU queues to be idle
+    uint64_t stalls;         // number of times the CPU had to wait for the GPU
+};
+
+
+
+struct DvzStagingRing
+{
+    DvzObject obj;
+    DvzGpu* gpu;
+
+    // Permanently-mapped host-visible buffer, used as a ring buffer.
+    DvzBuffer buffer;
+    VkDeviceSize head; // position of the next allocation
+    VkDeviceSize tail; // position of the oldest allocation still in use by the GPU
+    VkDeviceSize used; // number of bytes in use, including the space wasted when wrapping around
+
+    // Allocations are retired per frame in flight, once the frame's transfer fence is signaled.
+    uint32_t frame_count;
+    uint32_t cur_frame;
+    VkDeviceSize frame_size[DVZ_MAX_FRAMES_IN_FLIGHT]; // number of bytes used by each frame
+    VkDeviceSize frame_end[DVZ_MAX_FRAMES_IN_FLIGHT];  // ring position after each frame
+
+    // All copies of a frame are recorded in a single transfer command buffer.
+    DvzCommands cmds;
+    DvzFences fences;
+    DvzSemaphores semaphores;
+    // With separate queues, semaphores signaled on the render queue and waited on by the copies,
+    // so that the copies start once the previous render submissions have completed.
+    DvzSemaphores semaphores_release;
+    bool recording; // whether the command buffer of the current frame is being recorded
+    bool signaled;  // whether the next render submission needs to wait on the semaphore
+    uint32_t signaled_idx;
+    // Whether the transfer and render queues are the same queue, in which case the copies are
+    // ordered after the previous render submissions with a barrier instead of a semaphore.
+    bool same_queue;
+
+    // Scratch arrays used to batch the uploads of a frame, allocated once.
+    DvzStagedUpload* batch;
+    VkBufferCopy* copies;
+
+    DvzTransferStats stats;
+    DvzProfiler* profiler; // if not NULL, the submissions are timed with GPU timestamps
+};
+
+
+
 /*************************************************************************************************/
 /*  Transfers                                                                                    */
 /*************************************************************************************************/
@@ -143,6 +251,18 @@ DVZ_EXPORT void dvz_copy_buffers(
     DvzCanvas* canvas, DvzBufferRegions src, VkDeviceSize src_offset, //
     DvzBufferRegions dst, VkDeviceSize dst_offset, VkDeviceSize size);
 
+/**
+ * Call a function once all previously enqueued transfers have completed.
+ *
+ * This is used to run GPU commands that depend on uploaded data, such as compute passes.
+ *
+ * @param canvas the canvas
+ * @param callback the function to call from the main thread
+ * @param user_data a pointer passed to the callback
+ */
+DVZ_EXPORT void
+dvz_transfer_callback(DvzCanvas* canvas, DvzTransferCallback callback, void* user_data);
+
 /**
  * Upload data to a texture.
  *
@@ -196,6 +316,14 @@ DVZ_EXPORT void dvz_copy_texture(
  * objects while they are being used for rendering. The transfer processing function is called at a
  * deterministic time within the main event loop.
  *
+ * Uploads to non-mappable buffers go through the canvas staging ring: they are submitted to the
+ * transfer queue without waiting, and the next render submission waits on a semaphore. With a
+ * dedicated transfer queue, the copies in turn wait on a semaphore signaled on the render queue,
+ * so that they never overwrite data read by the frames in flight and the CPU never waits for them.
+ * Consecutive uploads are batched: adjacent or overlapping uploads to the same buffer are merged,
+ * uploads fully overwritten by a later one are dropped, and all copies are recorded with one
+ * VkBufferCopy array per destination buffer.
+ *
  * @param canvas the canvas
  * @param br the buffer regions to update
  * @param offset the offset within the buffer regions, in bytes
@@ -204,6 +332,64 @@ DVZ_EXPORT void dvz_copy_texture(
  */
 DVZ_EXPORT void dvz_process_transfers(DvzCanvas* canvas);
 
+/**
+ * Return the statistics of the canvas data transfers.
+ *
+ * @param canvas the canvas
+ * @returns the transfer statistics
+ */
+DVZ_EXPORT DvzTransferStats dvz_transfer_stats(DvzCanvas* canvas);
+
+
+
+/*************************************************************************************************/
+/*  Staging ring                                                                                 */
+/*************************************************************************************************/
+
+/**
+ * Create a staging ring buffer used for non-blocking uploads to non-mappable buffers.
+ *
+ * Uploads are suballocated in a ring buffer, and all copies of a given frame are recorded in a
+ * single command buffer submitted to the transfer queue. The ring space used by a frame is only
+ * reused once the transfer fence of that frame has been signaled.
+ *
+ * @param gpu the GPU
+ * @param frame_count the number of frames in flight
+ * @param size the size of the ring buffer, in bytes
+ * @returns the staging ring
+ */
+DVZ_EXPORT DvzStagingRing
+dvz_staging_ring(DvzGpu* gpu, uint32_t frame_count, VkDeviceSize size);
+
+/**
+ * Destroy a staging ring buffer.
+ *
+ * @param ring the staging ring
+ */
+DVZ_EXPORT void dvz_staging_ring_destroy(DvzStagingRing* ring);
+
+
+
+/*************************************************************************************************/
+/*  Transfer pool                                                                                */
+/*************************************************************************************************/
+
+/**
+ * Create a fixed pool of transfer descriptors, to avoid heap allocations when enqueuing
+ * transfers.
+ *
+ * @param capacity the number of transfer descriptors
+ * @returns the pool
+ */
+DVZ_EXPORT DvzTransferPool dvz_transfer_pool(uint32_t capacity);
+
+/**
+ * Destroy a pool of transfer descriptors.
+ *
+ * @param pool the pool
+ */
+DVZ_EXPORT void dvz_transfer_pool_destroy(DvzTransferPool* pool);
+
 
 
 #endif
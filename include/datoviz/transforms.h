@@ -7,6 +7,7 @@
 
 #include "array.h"
 #include "common.h"
+#include "workers.h"
 
 
 
@@ -27,6 +28,9 @@
 
 #define DVZ_TRANSFORM_CHAIN_MAX_SIZE 32
 
+// Minimum number of positions per task when normalizing positions in parallel.
+#define DVZ_TRANSFORM_CHUNK_SIZE 65536
+
 #define DVZ_TRANSFORM_MATRIX_VULKAN                                                               \
     (dmat4)                                                                                       \
     {                                                                                             \
@@ -96,6 +100,7 @@ typedef struct DvzDataCoords DvzDataCoords;
 typedef struct DvzBox DvzBox;
 typedef struct DvzTransform DvzTransform;
 typedef struct DvzTransformChain DvzTransformChain;
+typedef struct DvzTransformParams DvzTransformParams;
 
 // Forward declarations.
 typedef struct DvzPanel DvzPanel;
@@ -142,6 +147,18 @@ struct DvzTransformChain
 
 
 
+// Parameters of the GPU data normalization, with the same layout as in the compute shader.
+struct DvzTransformParams
+{
+    vec4 center_hi; // box center, high part of the double-float split
+    vec4 center_lo; // box center, low part of the double-float split
+    vec4 scale;     // NDC = scale * (pos - center)
+    int32_t transform;
+    int32_t pad[3];
+};
+
+
+
 /*************************************************************************************************/
 /*  Transposition functions                                                                      */
 /*************************************************************************************************/
@@ -196,14 +213,123 @@ MAKE_TRANSPOSE(vec3)
 /**
  * Apply a CPU builtin transformation on position data.
  *
+ * Cartesian transforms support arrays of `DOUBLE`, `DVEC2`, `DVEC3`, `FLOAT`, `VEC2`, `VEC3`
+ * values, other transforms only support `DVEC3` values.
+ *
  * @param coords the data coordinate system and bounds
- * @param pos_in input array of dvec3 values
- * @param[out] pos_out output array of dvec3 values
+ * @param pos_in input array of positions
+ * @param[out] pos_out output array, created or resized if needed to match the input array
  * @param inverse whether to use the inverse or forward transformation
  */
 DVZ_EXPORT void
 dvz_transform_pos(DvzDataCoords coords, DvzArray* pos_in, DvzArray* pos_out, bool inverse);
 
+/**
+ * Apply a CPU builtin transformation on position data, in parallel.
+ *
+ * Same as `dvz_transform_pos()`, but large arrays are split among the threads of a worker pool,
+ * and the bounding box of the input positions is computed in the same pass.
+ *
+ * @param workers the worker pool, or NULL to run on the calling thread
+ * @param coords the data coordinate system and bounds
+ * @param pos_in input array of positions
+ * @param[out] pos_out output array, created or resized if needed to match the input array
+ * @param inverse whether to use the inverse or forward transformation
+ * @returns the bounding box of the input positions
+ */
+DVZ_EXPORT DvzBox dvz_transform_pos_parallel(
+    DvzWorkers* workers, DvzDataCoords coords, DvzArray* pos_in, DvzArray* pos_out,
+    bool inverse);
+
+/**
+ * Linearly rescale positions from a box to NDC, and compute their bounding box in the same pass.
+ *
+ * @param workers the worker pool, or NULL to run on the calling thread
+ * @param box the box mapped to NDC
+ * @param pos_in input array of `DOUBLE`, `DVEC2`, `DVEC3`, `FLOAT`, `VEC2` or `VEC3` values
+ * @param[out] pos_out output array, created or resized if needed to match the input array
+ * @returns the bounding box of the input positions, missing components being set to 0
+ */
+DVZ_EXPORT DvzBox
+dvz_transform_normalize(DvzWorkers* workers, DvzBox box, DvzArray* pos_in, DvzArray* pos_out);
+
+/**
+ * Linearly rescale a range of positions from a box to NDC, and compute their bounding box.
+ *
+ * The output array is resized to match the input array, and its items outside of the range are
+ * kept, so that positions appended to an already normalized array can be normalized alone.
+ *
+ * @param workers the worker pool, or NULL to run on the calling thread
+ * @param box the box mapped to NDC
+ * @param pos_in input array of `DOUBLE`, `DVEC2`, `DVEC3`, `FLOAT`, `VEC2` or `VEC3` values
+ * @param[out] pos_out output array, created or resized if needed to match the input array
+ * @param first_item the first item of the range
+ * @param count the number of items in the range
+ * @returns the bounding box of the range of input positions, missing components being set to 0
+ */
+DVZ_EXPORT DvzBox dvz_transform_normalize_range(
+    DvzWorkers* workers, DvzBox box, DvzArray* pos_in, DvzArray* pos_out, uint32_t first_item,
+    uint32_t count);
+
+/**
+ * Split positions into pairs of floats, to be normalized on the GPU.
+ *
+ * Every position is written as 6 floats, the high parts (x, y, z) followed by the low parts,
+ * their sum approximating the original double-precision value. The bounding box of the input
+ * positions is computed in the same pass.
+ *
+ * @param workers the worker pool, or NULL to run on the calling thread
+ * @param pos_in input array of `DOUBLE`, `DVEC2`, `DVEC3`, `FLOAT`, `VEC2` or `VEC3` values
+ * @param[out] pos_out output structured array, created or resized if needed
+ * @returns the bounding box of the input positions, missing components being set to 0
+ */
+DVZ_EXPORT DvzBox dvz_transform_split(DvzWorkers* workers, DvzArray* pos_in, DvzArray* pos_out);
+
+/**
+ * Split a range of positions into pairs of floats, to be normalized on the GPU.
+ *
+ * The output array is resized to match the input array, and its items outside of the range are
+ * kept.
+ *
+ * @param workers the worker pool, or NULL to run on the calling thread
+ * @param pos_in input array of `DOUBLE`, `DVEC2`, `DVEC3`, `FLOAT`, `VEC2` or `VEC3` values
+ * @param[out] pos_out output structured array, created or resized if needed
+ * @param first_item the first item of the range
+ * @param count the number of items in the range
+ * @returns the bounding box of the range of input positions, missing components being set to 0
+ */
+DVZ_EXPORT DvzBox dvz_transform_split_range(
+    DvzWorkers* workers, DvzArray* pos_in, DvzArray* pos_out, uint32_t first_item, uint32_t count);
+
+/**
+ * Compute the parameters of the GPU data normalization.
+ *
+ * @param coords the data coordinate system and bounds
+ * @returns the parameters to pass to the compute shader
+ */
+DVZ_EXPORT DvzTransformParams dvz_transform_params(DvzDataCoords coords);
+
+/**
+ * Compute the bounding box of an array of positions.
+ *
+ * @param workers the worker pool, or NULL to run on the calling thread
+ * @param pos array of `DOUBLE`, `DVEC2`, `DVEC3`, `FLOAT`, `VEC2` or `VEC3` values
+ * @returns the bounding box, missing components being set to 0
+ */
+DVZ_EXPORT DvzBox dvz_box_bounding(DvzWorkers* workers, DvzArray* pos);
+
+/**
+ * Compute the bounding box of a range of items in an array of positions.
+ *
+ * @param workers the worker pool, or NULL to run on the calling thread
+ * @param pos array of `DOUBLE`, `DVEC2`, `DVEC3`, `FLOAT`, `VEC2` or `VEC3` values
+ * @param first_item the first item of the range
+ * @param count the number of items in the range
+ * @returns the bounding box, missing components being set to 0
+ */
+DVZ_EXPORT DvzBox
+dvz_box_bounding_range(DvzWorkers* workers, DvzArray* pos, uint32_t first_item, uint32_t count);
+
 /**
  * Convert a 3D position from a coordinate system to another.
  *
@@ -0,0 +1,150 @@
+/*************************************************************************************************/
+/*  GPU data normalization with a compute shader                                                 */
+/*************************************************************************************************/
+
+#ifndef DVZ_TRANSFORMS_GPU_HEADER
+#define DVZ_TRANSFORMS_GPU_HEADER
+
+#include "array.h"
+#include "transforms.h"
+#include "vklite.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Typedefs                                                                                     */
+/*************************************************************************************************/
+
+typedef struct DvzTransformGpuPush DvzTransformGpuPush;
+typedef struct DvzTransformGpu DvzTransformGpu;
+
+
+
+/*************************************************************************************************/
+/*  Structs                                                                                      */
+/*************************************************************************************************/
+
+// Push constants of the compute shader.
+struct DvzTransformGpuPush
+{
+    DvzTransformParams params;
+
+    uint32_t components; // number of components written for each vertex
+    uint32_t item_count; // number of vertices
+    uint32_t data_count; // number of positions
+    uint32_t reps;       // number of consecutive vertices per position
+    uint32_t single;     // if 1, only the first vertex of every group of reps vertices is written
+    uint32_t src_offset; // byte offset of the first position in the bound storage buffer range
+    uint32_t dst_offset; // byte offset of the first component in the bound vertex buffer range
+    uint32_t dst_stride; // byte stride between consecutive vertices
+};
+
+
+
+// The original positions are kept on the GPU as double-float pairs. When the data coordinates
+// change, only the push constants are updated before the compute pass rewrites the vertex buffer.
+struct DvzTransformGpu
+{
+    DvzObject obj;
+    DvzCanvas* canvas;
+
+    DvzCompute compute;
+    DvzBindings bindings;
+    DvzCommands cmds;
+    DvzFences fences; // signaled when the last compute pass has completed
+
+    DvzBufferRegions br_split; // double-float positions, in the storage buffer
+    DvzBufferRegions br_dst;   // vertex buffer region with the normalized positions
+    DvzTransformGpuPush push;
+    uint32_t pending; // number of enqueued compute passes that have not been processed yet
+};
+
+
+
+/*************************************************************************************************/
+/*  Functions                                                                                    */
+/*************************************************************************************************/
+
+/**
+ * Create a GPU data normalization pass.
+ *
+ * @param canvas the canvas
+ * @returns the GPU normalization pass
+ */
+DVZ_EXPORT DvzTransformGpu dvz_transform_gpu(DvzCanvas* canvas);
+
+/**
+ * Upload the double-float positions returned by `dvz_transform_split()`.
+ *
+ * The array must not be modified until the upload has been processed.
+ *
+ * @param tg the GPU normalization pass
+ * @param split the structured array with 6 floats per position
+ */
+DVZ_EXPORT void dvz_transform_gpu_data(DvzTransformGpu* tg, DvzArray* split);
+
+/**
+ * Upload a range of the double-float positions returned by `dvz_transform_split_range()`.
+ *
+ * The GPU buffer is resized to match the whole array, its data outside of the range being kept.
+ *
+ * @param tg the GPU normalization pass
+ * @param split the structured array with 6 floats per position
+ * @param first_item the first item of the range to upload
+ * @param count the number of items to upload
+ */
+DVZ_EXPORT void dvz_transform_gpu_data_range(
+    DvzTransformGpu* tg, DvzArray* split, uint32_t first_item, uint32_t count);
+
+/**
+ * Set the vertex buffer region where the normalized positions are written.
+ *
+ * @param tg the GPU normalization pass
+ * @param br the buffer region with the vertices
+ * @param offset the offset of the position within a vertex, in bytes
+ * @param stride the size of a vertex, in bytes
+ * @param components the number of float components of the position (1, 2 or 3)
+ * @param item_count the number of vertices
+ * @param reps the number of consecutive vertices per position
+ * @param single whether only the first vertex of every group of `reps` vertices is written
+ */
+DVZ_EXPORT void dvz_transform_gpu_target(
+    DvzTransformGpu* tg, DvzBufferRegions br, VkDeviceSize offset, VkDeviceSize stride,
+    uint32_t components, uint32_t item_count, uint32_t reps, bool single);
+
+/**
+ * Set the normalization parameters returned by `dvz_transform_params()`.
+ *
+ * @param tg the GPU normalization pass
+ * @param params the normalization parameters
+ */
+DVZ_EXPORT void dvz_transform_gpu_params(DvzTransformGpu* tg, DvzTransformParams params);
+
+/**
+ * Run the compute pass once all pending transfers have completed.
+ *
+ * Several calls before the transfers are processed result in a single compute pass, run after the
+ * transfers enqueued before the last call, with the latest target and parameters.
+ *
+ * @param tg the GPU normalization pass
+ */
+DVZ_EXPORT void dvz_transform_gpu_run(DvzTransformGpu* tg);
+
+/**
+ * Destroy a GPU data normalization pass.
+ *
+ * @param tg the GPU normalization pass
+ */
+DVZ_EXPORT void dvz_transform_gpu_destroy(DvzTransformGpu* tg);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
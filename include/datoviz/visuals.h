@@ -9,6 +9,7 @@
 #include "context.h"
 #include "graphics.h"
 #include "transforms.h"
+#include "transforms_gpu.h"
 #include "vklite.h"
 
 
@@ -21,6 +22,7 @@
 #define DVZ_MAX_VISUAL_GROUPS       1024
 #define DVZ_MAX_VISUAL_PRIORITY     4
 #define DVZ_MAX_UNIFORM_SIZE        65536
+#define DVZ_MAX_BATCH_DRAWS         64
 
 
 /*************************************************************************************************/
@@ -162,6 +164,9 @@ typedef struct DvzSource DvzSource;
 typedef struct DvzVisualFillEvent DvzVisualFillEvent;
 typedef struct DvzVisualDataEvent DvzVisualDataEvent;
 
+typedef struct DvzVisualStream DvzVisualStream;
+typedef struct DvzVisualStreamStats DvzVisualStreamStats;
+
 typedef uint32_t DvzIndex;
 
 
@@ -248,15 +253,72 @@ struct DvzProp
     DvzArray arr_trans;   // transformed data array
     DvzArray arr_staging; // optional modification made to the prop by the baking function
     // DvzArray arr_triang; // triangulated data array
+    DvzArray arr_split;   // double-float positions, for the GPU data normalization
+
+    // If set, the prop is normalized on the GPU and not copied to the source array.
+    DvzTransformGpu* transform_gpu;
+
+    // Cached bounding box of the original positions of a POS prop. It is updated on appends and
+    // partial updates, and invalidated when all positions are replaced.
+    DvzBox box;
+    bool box_valid;
+
+    // Number of leading positions of a POS prop normalized (or split, for the GPU normalization)
+    // and not modified since, so that appended positions are normalized alone.
+    uint32_t trans_count;
+    DvzDataCoords trans_coords; // coordinates used to normalize these positions
 
     DvzDataType target_dtype; // used for casting during the copy to the vertex array
     DvzArrayCopyType copy_type;
     uint32_t reps; // number of repeats when copying
+    bool streamed; // appended in streaming mode, emptied once uploaded
     // bool is_set; // whether the user has set this prop
 };
 
 
 
+/*************************************************************************************************/
+/*  Stream structs                                                                               */
+/*************************************************************************************************/
+
+struct DvzVisualStreamStats
+{
+    uint64_t items;     // number of items appended and uploaded
+    uint64_t discarded; // number of items dropped from the history
+    uint64_t bytes;     // number of bytes uploaded to the vertex buffer
+    uint64_t uploads;   // number of upload batches
+    double throughput;  // sustained number of items uploaded per second
+};
+
+
+
+// GPU-resident ring buffer with the most recent items appended to a visual.
+struct DvzVisualStream
+{
+    DvzSource* source; // the VERTEX source, its buffer is used as a ring buffer
+    uint32_t reps;     // number of vertices per item
+    uint32_t capacity; // number of vertices in the ring, excluding the mirror vertex
+    uint32_t head;     // next vertex to be written
+    uint32_t count;    // number of valid vertices in the ring
+
+    // With line strips, the first vertex is also written after the last one, so that the two
+    // draw ranges remain connected.
+    bool mirror;
+
+    // The two draw ranges, the oldest vertices come first.
+    VkDrawIndirectCommand draws[2];
+    DvzBufferRegions br_indirect;
+
+    // Bounding box of all positions streamed so far, which are no longer on the CPU once uploaded.
+    DvzBox box;
+    bool box_valid;
+
+    DvzClock clock;
+    DvzVisualStreamStats stats;
+};
+
+
+
 /*************************************************************************************************/
 /*  Visual struct                                                                                */
 /*************************************************************************************************/
@@ -296,6 +358,12 @@ struct DvzVisual
     // Props.
     DvzContainer props;
 
+    // Constant-time lookups of the sources by (type, source_idx), of the first source of each
+    // type by (type, pipeline_idx), and of the props by (type, prop_idx).
+    DvzHashTable source_lookup;
+    DvzHashTable pipeline_lookup;
+    DvzHashTable prop_lookup;
+
     // User data
     uint32_t group_count;
     uint32_t group_sizes[DVZ_MAX_VISUAL_GROUPS];
@@ -308,6 +376,15 @@ struct DvzVisual
     // GPU data
     DvzContainer bindings;
     DvzContainer bindings_comp;
+
+    // Number of POS items scanned to compute bounding boxes, since the last scene frame.
+    uint64_t box_scanned;
+
+    // Number of POS items normalized on the CPU, or split for the GPU, since the last scene frame.
+    uint64_t pos_normalized;
+
+    // Streaming mode, if set.
+    DvzVisualStream* stream;
 };
 
 
@@ -524,6 +601,63 @@ DVZ_EXPORT void dvz_visual_data_partial(
 DVZ_EXPORT void dvz_visual_data_append(
     DvzVisual* visual, DvzPropType prop_type, uint32_t prop_idx, uint32_t count, const void* data);
 
+/**
+ * Set the data of a prop from an external buffer, without copying it.
+ *
+ * The prop borrows the buffer until it is destroyed with the visual, or until its data is set
+ * again with another function; the release callback, if any, is then called. Until then, the
+ * buffer must remain valid and must not be modified, except before calling this function again
+ * with the same buffer to mark the data as changed. The items may be interleaved with other data
+ * in the buffer, `stride` being the number of bytes between two consecutive items.
+ *
+ * The dtype must be the dtype of the prop. Visuals with the default baking also accept float32
+ * positions (`DVZ_DTYPE_VEC3`), which are then not converted to double precision on the CPU.
+ * Streamed visuals are not supported.
+ *
+ * @param visual the visual
+ * @param prop_type the prop type
+ * @param prop_idx the prop index
+ * @param count the number of items in the buffer
+ * @param dtype the dtype of the items
+ * @param stride the number of bytes between two consecutive items, 0 if they are packed
+ * @param data the buffer
+ * @param release the function called when the prop no longer uses the buffer, may be NULL
+ * @param user_data the second argument passed to the release function
+ */
+DVZ_EXPORT void dvz_visual_data_borrow(
+    DvzVisual* visual, DvzPropType prop_type, uint32_t prop_idx, uint32_t count,
+    DvzDataType dtype, VkDeviceSize stride, const void* data, DvzArrayRelease release,
+    void* user_data);
+
+/**
+ * Enable the streaming mode of a visual.
+ *
+ * The vertex buffer becomes a GPU ring buffer that keeps the last `history` items. Items appended
+ * with `dvz_visual_data_append()` are uploaded once, without uploading the previous items again.
+ * Older items are overwritten on the GPU, and the visual is drawn with two indirect draw ranges,
+ * so that appending items does not require a command buffer refill.
+ *
+ * The props that are not appended are repeated for all new items. Only visuals without index
+ * buffer, with a single graphics pipeline and the default fill callback are supported. The items
+ * are normalized with the panel box at the time they are appended, and the panel box is not
+ * recomputed when items are appended. The bounding box of all streamed items is kept, so that
+ * they still count toward the panel box when it is recomputed for other visuals.
+ *
+ * Calling this function again with another history length discards all items.
+ *
+ * @param visual the visual
+ * @param history the maximum number of items drawn
+ */
+DVZ_EXPORT void dvz_visual_stream(DvzVisual* visual, uint32_t history);
+
+/**
+ * Return the statistics of a visual in streaming mode.
+ *
+ * @param visual the visual
+ * @returns the streaming statistics
+ */
+DVZ_EXPORT DvzVisualStreamStats dvz_visual_stream_stats(DvzVisual* visual);
+
 /**
  * Set partial data for a given source.
  *
@@ -599,6 +733,33 @@ DVZ_EXPORT void dvz_visual_fill_event(
     DvzVisual* visual, VkClearColorValue clear_color, DvzCommands* cmds, uint32_t cmd_idx,
     DvzViewport viewport, void* user_data);
 
+/**
+ * Call the fill callbacks of a sequence of visuals, batching their draw commands.
+ *
+ * Consecutive visuals with the default fill callback, a single graphics pipeline, non-indexed
+ * vertices in the same vertex buffer, and bindings referring to the same resources (for example
+ * uniform buffers shared with `dvz_visual_buffer()`) are drawn with a single multi-draw indirect
+ * call. The pipeline is only bound once for consecutive visuals sharing it. The other visuals
+ * are filled as usual, in order.
+ *
+ * The draw commands of a batch only differ by their vertex range: all visuals of a batch are
+ * drawn with the bindings of the first one, and there is no per-draw data indexed by the draw
+ * or instance ID. Only visuals whose uniform buffers are shared therefore end up in a batch.
+ *
+ * @param visual_count the number of visuals
+ * @param visuals the visuals, in drawing order
+ * @param clear_color the clear color
+ * @param cmds the command buffers to update
+ * @param cmd_idx the index of the command buffer to update
+ * @param viewport the viewport
+ * @param indirect mappable buffer regions, one per command buffer, each with the size of
+ *      `DVZ_MAX_BATCH_DRAWS` indirect draw commands, written immediately
+ * @returns the number of visuals drawn in a batch of at least two visuals
+ */
+DVZ_EXPORT uint32_t dvz_visual_fill_batch(
+    uint32_t visual_count, DvzVisual** visuals, VkClearColorValue clear_color, DvzCommands* cmds,
+    uint32_t cmd_idx, DvzViewport viewport, DvzBufferRegions* indirect);
+
 /**
  * Begin recording a command buffer and begin the render pass.
  *
@@ -698,6 +859,20 @@ DVZ_EXPORT uint32_t dvz_prop_size(DvzProp* prop);
 DVZ_EXPORT void* dvz_prop_item(DvzProp* prop, uint32_t prop_idx);
 
 
+/**
+ * Return the GPU data normalization pass of a POS prop, creating it if needed.
+ *
+ * Only POS props of visuals with the default baking callback, with float components and copied
+ * automatically to the VERTEX source, can be normalized on the GPU. Once this function has been
+ * called, the prop is no longer copied to the VERTEX source array.
+ *
+ * @param visual the visual
+ * @param prop the prop
+ * @returns the GPU normalization pass, or NULL if the prop must be normalized on the CPU
+ */
+DVZ_EXPORT DvzTransformGpu* dvz_prop_transform_gpu(DvzVisual* visual, DvzProp* prop);
+
+
 
 /*************************************************************************************************/
 /*  Data update                                                                                  */
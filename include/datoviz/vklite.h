@@ -23,6 +23,7 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include "alloc.h"
 #include "app.h"
 #include "common.h"
 
@@ -64,6 +65,11 @@ extern "C" {
 #define DVZ_MAX_VERTEX_BINDINGS             16
 #define DVZ_MAX_VERTEX_ATTRS                32
 
+// Device memory suballocation
+#define DVZ_MEMORY_BLOCK_SIZE     (64 * 1024 * 1024)
+#define DVZ_MEMORY_MIN_SIZE_CLASS 256
+#define DVZ_MEMORY_TYPE_ALL       UINT32_MAX
+
 
 
 /*************************************************************************************************/
@@ -71,6 +77,11 @@ extern "C" {
 /*************************************************************************************************/
 
 typedef struct DvzQueues DvzQueues;
+typedef struct DvzMemoryAlloc DvzMemoryAlloc;
+typedef struct DvzMemoryBlock DvzMemoryBlock;
+typedef struct DvzMemoryPool DvzMemoryPool;
+typedef struct DvzMemory DvzMemory;
+typedef struct DvzMemoryStats DvzMemoryStats;
 typedef struct DvzGpu DvzGpu;
 typedef struct DvzWindow DvzWindow;
 typedef struct DvzSwapchain DvzSwapchain;
@@ -90,6 +101,7 @@ typedef struct DvzBarrierImage DvzBarrierImage;
 typedef struct DvzBarrier DvzBarrier;
 typedef struct DvzSemaphores DvzSemaphores;
 typedef struct DvzFences DvzFences;
+typedef struct DvzQueries DvzQueries;
 typedef struct DvzRenderpass DvzRenderpass;
 typedef struct DvzRenderpassAttachment DvzRenderpassAttachment;
 typedef struct DvzRenderpassSubpass DvzRenderpassSubpass;
@@ -318,6 +330,66 @@ struct DvzQueues
 
 
 
+// A region of device memory bound to a buffer or an image.
+struct DvzMemoryAlloc
+{
+    VkDeviceMemory memory;
+    VkDeviceSize offset; // offset of the region within the device memory
+    VkDeviceSize size;   // size of the region, rounded up to its size class
+    uint32_t type_idx;   // memory type index
+    uint32_t pool_idx;   // 0 for linear resources (buffers), 1 for optimal-tiling images
+    uint32_t block_idx;  // UINT32_MAX for dedicated allocations
+};
+
+
+
+// A large device memory allocation shared by many resources.
+struct DvzMemoryBlock
+{
+    VkDeviceMemory memory; // VK_NULL_HANDLE if the block slot is unused
+    DvzAlloc alloc;
+    uint32_t alloc_count; // number of live regions
+    void* mmap;           // persistent mapping of host-visible blocks
+};
+
+
+
+// All blocks of a given memory type and resource kind.
+struct DvzMemoryPool
+{
+    uint32_t block_count;
+    DvzMemoryBlock* blocks;
+
+    uint32_t dedicated_count;
+    VkDeviceSize dedicated_size;
+};
+
+
+
+struct DvzMemory
+{
+    VkDeviceSize block_size[VK_MAX_MEMORY_TYPES];
+    // Linear and non-linear resources are kept in separate blocks, so that the
+    // bufferImageGranularity never needs to be taken into account within a block.
+    DvzMemoryPool pools[VK_MAX_MEMORY_TYPES][2];
+};
+
+
+
+struct DvzMemoryStats
+{
+    uint32_t block_count;      // number of memory blocks
+    uint32_t dedicated_count;  // number of dedicated allocations
+    uint32_t alloc_count;      // number of regions suballocated in the blocks
+    VkDeviceSize allocated;    // device memory allocated from the driver
+    VkDeviceSize used;         // device memory used by regions and dedicated allocations
+    VkDeviceSize largest_free; // largest free range within a block
+    uint32_t free_ranges;      // number of free ranges within the blocks
+    double fragmentation;      // 1 - largest_free / free memory in blocks, 0 if no free memory
+};
+
+
+
 struct DvzGpu
 {
     DvzObject obj;
@@ -339,6 +411,8 @@ struct DvzGpu
 
     VkPhysicalDeviceFeatures requested_features;
     VkDevice device;
+    VkPipelineCache pipeline_cache; // shared by all graphics and compute pipelines, optional
+    DvzMemory memory; // device memory suballocator
 
     DvzContext* context;
 };
@@ -390,7 +464,9 @@ struct DvzCommands
 
     uint32_t queue_idx;
     uint32_t count;
+    VkCommandBufferLevel level;
     VkCommandBuffer cmds[DVZ_MAX_COMMAND_BUFFERS_PER_SET];
+    uint32_t draw_count[DVZ_MAX_COMMAND_BUFFERS_PER_SET]; // number of recorded draw calls
 };
 
 
@@ -402,7 +478,7 @@ struct DvzBuffer
 
     DvzBufferType type;
     VkBuffer buffer;
-    VkDeviceMemory device_memory;
+    DvzMemoryAlloc allocation;
 
     // Queues that need access to the buffer.
     uint32_t queue_count;
@@ -453,7 +529,7 @@ struct DvzImages
     VkImageAspectFlags aspect;
 
     VkImage images[DVZ_MAX_IMAGES_PER_SET];
-    VkDeviceMemory memories[DVZ_MAX_IMAGES_PER_SET];
+    DvzMemoryAlloc allocations[DVZ_MAX_IMAGES_PER_SET];
     VkImageView image_views[DVZ_MAX_IMAGES_PER_SET];
 };
 
@@ -575,6 +651,10 @@ struct DvzGraphics
     uint32_t shader_count;
     VkShaderStageFlagBits shader_stages[DVZ_MAX_SHADERS_PER_GRAPHICS];
     VkShaderModule shader_modules[DVZ_MAX_SHADERS_PER_GRAPHICS];
+    uint64_t shader_hash; // hash of the shader stages and code, to compare pipelines
+    // Builtin SPIRV code, whose shader modules are only created with a new builtin pipeline.
+    const unsigned char* shader_spirv[DVZ_MAX_SHADERS_PER_GRAPHICS];
+    VkDeviceSize shader_spirv_size[DVZ_MAX_SHADERS_PER_GRAPHICS];
 
     DvzGraphicsCallback callback;
 };
@@ -652,6 +732,19 @@ struct DvzSemaphores
 
 
 
+struct DvzQueries
+{
+    DvzObject obj;
+    DvzGpu* gpu;
+
+    VkQueryType type;
+    uint32_t count;
+    VkQueryPool pool;
+    double period; // number of nanoseconds per timestamp tick
+};
+
+
+
 struct DvzRenderpassAttachment
 {
     VkImageLayout ref_layout;
@@ -782,6 +875,18 @@ DVZ_EXPORT DvzApp* dvz_app(DvzBackend backend);
  */
 DVZ_EXPORT int dvz_app_destroy(DvzApp* app);
 
+/**
+ * Set the number of threads used for parallel CPU work such as visual baking.
+ *
+ * The default is the value of the `DVZ_NUM_THREADS` environment variable if set, or the number
+ * of CPU cores.
+ *
+ * @param app the application
+ * @param thread_count the total number of threads, including the main thread (1: no
+ *      parallelism, 0: default)
+ */
+DVZ_EXPORT void dvz_app_threads(DvzApp* app, uint32_t thread_count);
+
 
 
 /*************************************************************************************************/
@@ -826,6 +931,47 @@ DVZ_EXPORT void dvz_gpu_queue(DvzGpu* gpu, uint32_t idx, DvzQueueType type);
  */
 DVZ_EXPORT void dvz_gpu_create(DvzGpu* gpu, VkSurfaceKHR surface);
 
+/**
+ * Create the pipeline cache shared by all graphics and compute pipelines of a GPU.
+ *
+ * The initial data, typically saved by a previous run, is discarded if it was produced by another
+ * device or driver. The pipelines already in the current cache are kept.
+ *
+ * @param gpu the GPU
+ * @param size the size of the initial data, in bytes (may be 0)
+ * @param data the initial data (may be NULL)
+ * @returns whether the initial data was used
+ */
+DVZ_EXPORT bool dvz_gpu_pipeline_cache(DvzGpu* gpu, size_t size, const void* data);
+
+/**
+ * Return the contents of the pipeline cache of a GPU.
+ *
+ * @param gpu the GPU
+ * @param[out] size the size of the returned data, in bytes
+ * @returns a buffer to be freed by the caller, or NULL if the GPU has no pipeline cache
+ */
+DVZ_EXPORT void* dvz_gpu_pipeline_cache_data(DvzGpu* gpu, size_t* size);
+
+/**
+ * Return statistics about the device memory allocated by the GPU.
+ *
+ * Buffers and images are suballocated in large memory blocks, one set of blocks per memory type.
+ * Resources larger than half a block get a dedicated allocation.
+ *
+ * @param gpu the GPU
+ * @param type_idx the memory type index, or DVZ_MEMORY_TYPE_ALL for all memory types
+ * @returns the statistics
+ */
+DVZ_EXPORT DvzMemoryStats dvz_gpu_memory_stats(DvzGpu* gpu, uint32_t type_idx);
+
+/**
+ * Log the device memory usage of the GPU, per memory type.
+ *
+ * @param gpu the GPU
+ */
+DVZ_EXPORT void dvz_gpu_memory_print(DvzGpu* gpu);
+
 /**
  * Wait for a queue to be idle.
  *
@@ -837,6 +983,20 @@ DVZ_EXPORT void dvz_gpu_create(DvzGpu* gpu, VkSurfaceKHR surface);
  */
 DVZ_EXPORT void dvz_queue_wait(DvzGpu* gpu, uint32_t queue_idx);
 
+/**
+ * Signal a semaphore once all commands previously submitted to a queue have completed.
+ *
+ * This submits an empty batch to the queue. Another queue can then wait on the semaphore to be
+ * ordered after these commands, without any CPU wait.
+ *
+ * @param gpu the GPU
+ * @param queue_idx the queue index
+ * @param semaphores the set of semaphores
+ * @param idx the index of the semaphore to signal
+ */
+DVZ_EXPORT void
+dvz_queue_signal(DvzGpu* gpu, uint32_t queue_idx, DvzSemaphores* semaphores, uint32_t idx);
+
 /**
  * Full synchronization on all GPUs.
  *
@@ -1031,6 +1191,16 @@ DVZ_EXPORT void dvz_swapchain_destroy(DvzSwapchain* swapchain);
  */
 DVZ_EXPORT DvzCommands dvz_commands(DvzGpu* gpu, uint32_t queue, uint32_t count);
 
+/**
+ * Create a set of secondary command buffers, to be executed within a render pass.
+ *
+ * @param gpu the GPU
+ * @param queue the queue index within the GPU
+ * @param count the number of command buffers to create
+ * @returns the set of secondary command buffers
+ */
+DVZ_EXPORT DvzCommands dvz_commands_secondary(DvzGpu* gpu, uint32_t queue, uint32_t count);
+
 /**
  * Start recording a command buffer.
  *
@@ -1039,6 +1209,15 @@ DVZ_EXPORT DvzCommands dvz_commands(DvzGpu* gpu, uint32_t queue, uint32_t count)
  */
 DVZ_EXPORT void dvz_cmd_begin(DvzCommands* cmds, uint32_t idx);
 
+/**
+ * Start recording a secondary command buffer that continues the first subpass of a render pass.
+ *
+ * @param cmds the set of secondary command buffers
+ * @param idx the index of the command buffer to begin recording on
+ * @param renderpass the render pass the command buffer will be executed in
+ */
+DVZ_EXPORT void dvz_cmd_begin_secondary(DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass);
+
 /**
  * Stop recording a command buffer.
  *
@@ -1149,6 +1328,23 @@ DVZ_EXPORT void dvz_buffer_create(DvzBuffer* buffer);
  */
 DVZ_EXPORT void dvz_buffer_resize(DvzBuffer* buffer, VkDeviceSize size, DvzCommands* cmds);
 
+/**
+ * Recreate a buffer with a new size, and copy some regions of the old buffer into the new one.
+ *
+ * This is used to shrink or defragment a buffer. Regions of the old buffer that are not copied
+ * are lost.
+ *
+ * @param buffer the buffer
+ * @param size the new buffer size, in bytes
+ * @param cmds the command buffers to use for the GPU-GPU data copy transfer
+ * @param region_count the number of regions to copy
+ * @param regions the regions to copy, with source offsets in the old buffer and destination
+ *      offsets in the new buffer
+ */
+DVZ_EXPORT void dvz_buffer_relocate(
+    DvzBuffer* buffer, VkDeviceSize size, DvzCommands* cmds, //
+    uint32_t region_count, const VkBufferCopy* regions);
+
 /**
  * Memory-map a buffer.
  *
@@ -1547,6 +1743,16 @@ DVZ_EXPORT void dvz_compute_create(DvzCompute* compute);
  */
 DVZ_EXPORT void dvz_compute_code(DvzCompute* compute, const char* code);
 
+/**
+ * Set the SPIRV code of a compute pipeline.
+ *
+ * @param compute the compute pipeline
+ * @param size the size of the SPIRV buffer, in bytes
+ * @param buffer the binary buffer with the SPIRV code
+ */
+DVZ_EXPORT void
+dvz_compute_spirv(DvzCompute* compute, VkDeviceSize size, const uint32_t* buffer);
+
 /**
  * Declare a slot for the compute pipeline.
  *
@@ -1914,6 +2120,43 @@ DVZ_EXPORT void dvz_fences_destroy(DvzFences* fences);
 
 
 
+/*************************************************************************************************/
+/*  Queries                                                                                      */
+/*************************************************************************************************/
+
+/**
+ * Create a pool of GPU queries.
+ *
+ * The queries must be reset with `dvz_cmd_reset_queries()` before they are first written.
+ *
+ * @param gpu the GPU
+ * @param type the query type, typically `VK_QUERY_TYPE_TIMESTAMP`
+ * @param count the number of queries
+ * @returns the queries
+ */
+DVZ_EXPORT DvzQueries dvz_queries(DvzGpu* gpu, VkQueryType type, uint32_t count);
+
+/**
+ * Get the results of a range of queries without waiting for the GPU.
+ *
+ * @param queries the queries
+ * @param first the index of the first query
+ * @param count the number of queries
+ * @param[out] values the query results, as raw 64-bit values
+ * @returns whether the results of all queries in the range were available
+ */
+DVZ_EXPORT bool
+dvz_queries_results(DvzQueries* queries, uint32_t first, uint32_t count, uint64_t* values);
+
+/**
+ * Destroy queries.
+ *
+ * @param queries the queries
+ */
+DVZ_EXPORT void dvz_queries_destroy(DvzQueries* queries);
+
+
+
 /*************************************************************************************************/
 /*  Renderpass                                                                                   */
 /*************************************************************************************************/
@@ -2156,6 +2399,19 @@ DVZ_EXPORT void dvz_cmd_begin_renderpass(
  */
 DVZ_EXPORT void dvz_cmd_end_renderpass(DvzCommands* cmds, uint32_t idx);
 
+/**
+ * Begin a render pass whose contents are recorded in secondary command buffers.
+ *
+ * Only `dvz_cmd_execute()` may be recorded until the end of the render pass.
+ *
+ * @param cmds the set of command buffers to record
+ * @param idx the index of the command buffer to record
+ * @param renderpass the render pass
+ * @param framebuffers the framebuffers
+ */
+DVZ_EXPORT void dvz_cmd_begin_renderpass_secondary(
+    DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass, DvzFramebuffers* framebuffers);
+
 /**
  * Launch a compute task.
  *
@@ -2230,6 +2486,19 @@ DVZ_EXPORT void dvz_cmd_bind_graphics(
     DvzCommands* cmds, uint32_t idx, DvzGraphics* graphics, //
     DvzBindings* bindings, uint32_t dynamic_idx);
 
+/**
+ * Bind the descriptor sets of a graphics pipeline, without binding the pipeline itself.
+ *
+ * @param cmds the set of command buffers to record
+ * @param idx the index of the command buffer to record
+ * @param graphics the graphics pipeline, which must be already bound
+ * @param bindings the bindings associated to the pipeline
+ * @param dynamic_idx the dynamic uniform buffer index
+ */
+DVZ_EXPORT void dvz_cmd_bind_descriptors(
+    DvzCommands* cmds, uint32_t idx, DvzGraphics* graphics, //
+    DvzBindings* bindings, uint32_t dynamic_idx);
+
 /**
  * Bind a vertex buffer.
  *
@@ -2295,6 +2564,20 @@ DVZ_EXPORT void dvz_cmd_draw_indirect(DvzCommands* cmds, uint32_t idx, DvzBuffer
 DVZ_EXPORT void
 dvz_cmd_draw_indexed_indirect(DvzCommands* cmds, uint32_t idx, DvzBufferRegions indirect);
 
+/**
+ * Multiple indirect draws from consecutive `VkDrawIndirectCommand` structures.
+ *
+ * This is a single draw call if the `multiDrawIndirect` feature has been enabled on the GPU,
+ * otherwise there is one indirect draw call per command.
+ *
+ * @param cmds the set of command buffers to record
+ * @param idx the index of the command buffer to record
+ * @param indirect buffer regions with the indirect draw commands
+ * @param draw_count the number of draw commands
+ */
+DVZ_EXPORT void dvz_cmd_draw_indirect_multi(
+    DvzCommands* cmds, uint32_t idx, DvzBufferRegions indirect, uint32_t draw_count);
+
 /**
  * Copy a GPU buffer to another.
  *
@@ -2327,6 +2610,42 @@ DVZ_EXPORT void dvz_cmd_push(
     DvzCommands* cmds, uint32_t idx, DvzSlots* slots, VkShaderStageFlagBits shaders, //
     VkDeviceSize offset, VkDeviceSize size, const void* data);
 
+/**
+ * Reset a range of queries.
+ *
+ * This command must be recorded outside a render pass, on a graphics or compute queue.
+ *
+ * @param cmds the set of command buffers to record
+ * @param idx the index of the command buffer to record
+ * @param queries the queries
+ * @param first the index of the first query to reset
+ * @param count the number of queries to reset
+ */
+DVZ_EXPORT void dvz_cmd_reset_queries(
+    DvzCommands* cmds, uint32_t idx, DvzQueries* queries, uint32_t first, uint32_t count);
+
+/**
+ * Write a GPU timestamp once the previous commands have reached a given pipeline stage.
+ *
+ * @param cmds the set of command buffers to record
+ * @param idx the index of the command buffer to record
+ * @param queries the timestamp queries
+ * @param query the index of the query to write
+ * @param stage the pipeline stage
+ */
+DVZ_EXPORT void dvz_cmd_timestamp(
+    DvzCommands* cmds, uint32_t idx, DvzQueries* queries, uint32_t query,
+    VkPipelineStageFlagBits stage);
+
+/**
+ * Execute a secondary command buffer.
+ *
+ * @param cmds the set of primary command buffers to record
+ * @param idx the index of the command buffer to record, and of the secondary command buffer
+ * @param secondary the set of secondary command buffers
+ */
+DVZ_EXPORT void dvz_cmd_execute(DvzCommands* cmds, uint32_t idx, DvzCommands* secondary);
+
 
 
 /*************************************************************************************************/
@@ -0,0 +1,112 @@
+/*************************************************************************************************/
+/*  Standalone worker pool, used to run parallel loops                                           */
+/*************************************************************************************************/
+
+#ifndef DVZ_WORKERS_HEADER
+#define DVZ_WORKERS_HEADER
+
+#include "common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_MAX_WORKERS 64
+
+
+
+/*************************************************************************************************/
+/*  Type definitions                                                                             */
+/*************************************************************************************************/
+
+typedef struct DvzWorkers DvzWorkers;
+
+// Callback called once per task, possibly from a background thread.
+typedef void (*DvzWorkerCallback)(void* user_data, uint32_t task_idx);
+
+
+
+/*************************************************************************************************/
+/*  Worker pool                                                                                  */
+/*************************************************************************************************/
+
+// The background threads are only spawned the first time a parallel loop is run, so that the
+// struct can be safely copied after its creation.
+struct DvzWorkers
+{
+    uint32_t thread_count; // total number of threads, including the calling thread
+    uint32_t spawned;      // number of background threads currently running
+    pthread_t threads[DVZ_MAX_WORKERS];
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond_start; // signaled when a new loop starts, or when the pool stops
+    pthread_cond_t cond_done;  // signaled when the last background thread is done with a loop
+
+    // Current loop, only modified by the calling thread while holding the lock.
+    DvzWorkerCallback callback;
+    void* user_data;
+    uint32_t task_count;
+    atomic(uint32_t, next_task); // index of the next task to be picked up by a thread
+    uint32_t busy;               // number of background threads still working on the loop
+    uint64_t generation;         // incremented every time a loop starts
+    uint64_t spawn_generation;   // value of the generation when the threads were spawned
+    bool stop;
+};
+
+
+
+/**
+ * Create a worker pool.
+ *
+ * @param thread_count the total number of threads, including the calling thread; 0 means the
+ *      value of the `DVZ_NUM_THREADS` environment variable if set, or the number of CPU cores
+ * @returns the worker pool
+ */
+DVZ_EXPORT DvzWorkers dvz_workers(uint32_t thread_count);
+
+/**
+ * Change the number of threads of a worker pool.
+ *
+ * Must not be called while a loop is running.
+ *
+ * @param workers the worker pool
+ * @param thread_count the total number of threads, including the calling thread (0: default)
+ */
+DVZ_EXPORT void dvz_workers_resize(DvzWorkers* workers, uint32_t thread_count);
+
+/**
+ * Run a parallel loop.
+ *
+ * The callback is called once for every task index in `[0, task_count)`, in an unspecified
+ * order and from an unspecified thread. The calling thread also processes tasks. The function
+ * returns once all tasks have completed. With a single thread, the tasks run in order on the
+ * calling thread.
+ *
+ * @param workers the worker pool
+ * @param task_count the number of tasks
+ * @param callback the task callback
+ * @param user_data a pointer passed to the callback
+ */
+DVZ_EXPORT void dvz_workers_run(
+    DvzWorkers* workers, uint32_t task_count, DvzWorkerCallback callback, void* user_data);
+
+/**
+ * Destroy a worker pool, joining all background threads.
+ *
+ * @param workers the worker pool
+ */
+DVZ_EXPORT void dvz_workers_destroy(DvzWorkers* workers);
+
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
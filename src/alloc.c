@@ -0,0 +1,689 @@
+#include "../include/datoviz/alloc.h"
+#include "../include/datoviz/vklite.h"
+#include <inttypes.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Utils                                                                                        */
+/*************************************************************************************************/
+
+static inline VkDeviceSize _align(VkDeviceSize size, VkDeviceSize alignment)
+{
+    ASSERT(alignment > 0);
+    return alignment * ((size + alignment - 1) / alignment);
+}
+
+
+
+// Position of the most significant bit.
+static inline uint32_t _msb(uint64_t x)
+{
+    ASSERT(x != 0);
+#if defined(_MSC_VER)
+    unsigned long idx = 0;
+    _BitScanReverse64(&idx, x);
+    return (uint32_t)idx;
+#else
+    return 63 - (uint32_t)__builtin_clzll(x);
+#endif
+}
+
+
+
+// Position of the least significant bit.
+static inline uint32_t _lsb(uint64_t x)
+{
+    ASSERT(x != 0);
+#if defined(_MSC_VER)
+    unsigned long idx = 0;
+    _BitScanForward64(&idx, x);
+    return (uint32_t)idx;
+#else
+    return (uint32_t)__builtin_ctzll(x);
+#endif
+}
+
+
+
+/*************************************************************************************************/
+/*  Size classes                                                                                 */
+/*************************************************************************************************/
+
+// Size class of a free block.
+static inline void _class(VkDeviceSize size, uint32_t* fl, uint32_t* sl)
+{
+    ASSERT(size > 0);
+    if (size < DVZ_ALLOC_SL_COUNT)
+    {
+        *fl = 0;
+        *sl = (uint32_t)size;
+        return;
+    }
+    uint32_t m = _msb(size);
+    *fl = m - DVZ_ALLOC_SL_LOG2 + 1;
+    *sl = (uint32_t)(size >> (m - DVZ_ALLOC_SL_LOG2)) ^ DVZ_ALLOC_SL_COUNT;
+    ASSERT(*fl < DVZ_ALLOC_FL_COUNT);
+    ASSERT(*sl < DVZ_ALLOC_SL_COUNT);
+}
+
+
+
+// Smallest size class whose free blocks are all at least `size` bytes.
+static inline void _class_above(VkDeviceSize size, uint32_t* fl, uint32_t* sl)
+{
+    if (size >= DVZ_ALLOC_SL_COUNT)
+        size += ((VkDeviceSize)1 << (_msb(size) - DVZ_ALLOC_SL_LOG2)) - 1;
+    _class(size, fl, sl);
+}
+
+
+
+static void _free_insert(DvzAlloc* alloc, uint32_t idx)
+{
+    ASSERT(alloc != NULL);
+    DvzAllocBlock* block = &alloc->blocks[idx];
+    ASSERT(!block->used);
+    uint32_t fl = 0, sl = 0;
+    _class(block->size, &fl, &sl);
+
+    uint32_t head = alloc->free_lists[fl][sl];
+    block->prev_free = DVZ_ALLOC_NONE;
+    block->next_free = head;
+    if (head != DVZ_ALLOC_NONE)
+        alloc->blocks[head].prev_free = idx;
+    alloc->free_lists[fl][sl] = idx;
+    alloc->fl_bitmap |= (uint64_t)1 << fl;
+    alloc->sl_bitmap[fl] |= 1u << sl;
+    alloc->free_blocks++;
+}
+
+
+
+static void _free_remove(DvzAlloc* alloc, uint32_t idx)
+{
+    ASSERT(alloc != NULL);
+    DvzAllocBlock* block = &alloc->blocks[idx];
+    ASSERT(!block->used);
+    uint32_t fl = 0, sl = 0;
+    _class(block->size, &fl, &sl);
+
+    if (block->prev_free != DVZ_ALLOC_NONE)
+        alloc->blocks[block->prev_free].next_free = block->next_free;
+    else
+        alloc->free_lists[fl][sl] = block->next_free;
+    if (block->next_free != DVZ_ALLOC_NONE)
+        alloc->blocks[block->next_free].prev_free = block->prev_free;
+
+    if (alloc->free_lists[fl][sl] == DVZ_ALLOC_NONE)
+    {
+        alloc->sl_bitmap[fl] &= ~(1u << sl);
+        if (alloc->sl_bitmap[fl] == 0)
+            alloc->fl_bitmap &= ~((uint64_t)1 << fl);
+    }
+    alloc->free_blocks--;
+}
+
+
+
+// Find a free block of at least `size` bytes, or return DVZ_ALLOC_NONE.
+static uint32_t _free_find(DvzAlloc* alloc, VkDeviceSize size)
+{
+    ASSERT(alloc != NULL);
+    ASSERT(size > 0);
+    uint32_t fl = 0, sl = 0;
+
+    // Any block of the classes above the size fits.
+    _class_above(size, &fl, &sl);
+    if (fl < DVZ_ALLOC_FL_COUNT)
+    {
+        uint32_t sl_map = alloc->sl_bitmap[fl] & (~0u << sl);
+        if (sl_map == 0)
+        {
+            uint64_t fl_map =
+                fl + 1 < DVZ_ALLOC_FL_COUNT ? alloc->fl_bitmap & (~(uint64_t)0 << (fl + 1)) : 0;
+            if (fl_map != 0)
+            {
+                fl = _lsb(fl_map);
+                sl_map = alloc->sl_bitmap[fl];
+            }
+        }
+        if (sl_map != 0)
+            return alloc->free_lists[fl][_lsb(sl_map)];
+    }
+
+    // Otherwise, only some blocks of the class of the size may fit.
+    _class(size, &fl, &sl);
+    for (uint32_t i = alloc->free_lists[fl][sl]; i != DVZ_ALLOC_NONE;
+         i = alloc->blocks[i].next_free)
+    {
+        if (alloc->blocks[i].size >= size)
+            return i;
+    }
+    return DVZ_ALLOC_NONE;
+}
+
+
+
+/*************************************************************************************************/
+/*  Blocks                                                                                       */
+/*************************************************************************************************/
+
+static uint32_t _block_new(DvzAlloc* alloc)
+{
+    ASSERT(alloc != NULL);
+    if (alloc->pool == DVZ_ALLOC_NONE)
+    {
+        uint32_t capacity = alloc->capacity;
+        alloc->capacity *= 2;
+        REALLOC(alloc->blocks, alloc->capacity * sizeof(DvzAllocBlock));
+        for (uint32_t i = capacity; i < alloc->capacity; i++)
+            alloc->blocks[i].next = i + 1 < alloc->capacity ? i + 1 : DVZ_ALLOC_NONE;
+        alloc->pool = capacity;
+    }
+    uint32_t idx = alloc->pool;
+    alloc->pool = alloc->blocks[idx].next;
+    memset(&alloc->blocks[idx], 0, sizeof(DvzAllocBlock));
+    alloc->blocks[idx].prev = alloc->blocks[idx].next = DVZ_ALLOC_NONE;
+    alloc->count++;
+    return idx;
+}
+
+
+
+static void _block_release(DvzAlloc* alloc, uint32_t idx)
+{
+    ASSERT(alloc != NULL);
+    alloc->blocks[idx].next = alloc->pool;
+    alloc->pool = idx;
+    alloc->count--;
+}
+
+
+
+// Split a block that is not in a free list after its first `size` bytes, return the second part.
+static uint32_t _block_split(DvzAlloc* alloc, uint32_t idx, VkDeviceSize size)
+{
+    ASSERT(alloc != NULL);
+    ASSERT(size < alloc->blocks[idx].size);
+    uint32_t rest = _block_new(alloc);
+    DvzAllocBlock* block = &alloc->blocks[idx];
+    DvzAllocBlock* rest_block = &alloc->blocks[rest];
+
+    rest_block->offset = block->offset + size;
+    rest_block->size = block->size - size;
+    rest_block->prev = idx;
+    rest_block->next = block->next;
+    if (block->next != DVZ_ALLOC_NONE)
+        alloc->blocks[block->next].prev = rest;
+    else
+        alloc->last = rest;
+    block->next = rest;
+    block->size = size;
+    return rest;
+}
+
+
+
+// Merge a block with the next one, which is released.
+static void _block_absorb(DvzAlloc* alloc, uint32_t idx)
+{
+    ASSERT(alloc != NULL);
+    uint32_t next = alloc->blocks[idx].next;
+    ASSERT(next != DVZ_ALLOC_NONE);
+    DvzAllocBlock* block = &alloc->blocks[idx];
+    block->size += alloc->blocks[next].size;
+    block->next = alloc->blocks[next].next;
+    if (block->next != DVZ_ALLOC_NONE)
+        alloc->blocks[block->next].prev = idx;
+    else
+        alloc->last = idx;
+    _block_release(alloc, next);
+}
+
+
+
+// Add a block that is not in a free list to the free lists, merging it with its free neighbors.
+static void _block_free(DvzAlloc* alloc, uint32_t idx)
+{
+    ASSERT(alloc != NULL);
+    alloc->blocks[idx].used = false;
+    uint32_t next = alloc->blocks[idx].next;
+    if (next != DVZ_ALLOC_NONE && !alloc->blocks[next].used)
+    {
+        _free_remove(alloc, next);
+        _block_absorb(alloc, idx);
+    }
+    uint32_t prev = alloc->blocks[idx].prev;
+    if (prev != DVZ_ALLOC_NONE && !alloc->blocks[prev].used)
+    {
+        _free_remove(alloc, prev);
+        _block_absorb(alloc, prev);
+        idx = prev;
+    }
+    _free_insert(alloc, idx);
+}
+
+
+
+// Mark the first `size` bytes of a free block as used, and keep the rest free.
+static VkDeviceSize _block_take(DvzAlloc* alloc, uint32_t idx, VkDeviceSize size)
+{
+    ASSERT(alloc != NULL);
+    ASSERT(!alloc->blocks[idx].used);
+    ASSERT(alloc->blocks[idx].size >= size);
+
+    _free_remove(alloc, idx);
+    if (alloc->blocks[idx].size > size)
+        _free_insert(alloc, _block_split(alloc, idx, size));
+
+    DvzAllocBlock* block = &alloc->blocks[idx];
+    block->used = true;
+    dvz_hash_table_set(&alloc->used, block->offset, idx);
+    alloc->used_size += size;
+    alloc->used_blocks++;
+    return block->offset;
+}
+
+
+
+// Index of the used block at an offset, or DVZ_ALLOC_NONE.
+static uint32_t _block_used(DvzAlloc* alloc, VkDeviceSize offset)
+{
+    ASSERT(alloc != NULL);
+    uint64_t idx = 0;
+    if (!dvz_hash_table_get(&alloc->used, offset, &idx))
+        return DVZ_ALLOC_NONE;
+    ASSERT(alloc->blocks[idx].used);
+    return (uint32_t)idx;
+}
+
+
+
+// Enlarge the managed range so that it ends at least at `end`.
+static VkDeviceSize _grow(DvzAlloc* alloc, VkDeviceSize end)
+{
+    ASSERT(alloc != NULL);
+    if (end <= alloc->size)
+        return 0;
+    VkDeviceSize new_size = dvz_next_pow2(end);
+    ASSERT(new_size > alloc->size);
+
+    uint32_t last = alloc->last;
+    if (last != DVZ_ALLOC_NONE && !alloc->blocks[last].used)
+    {
+        _free_remove(alloc, last);
+        alloc->blocks[last].size += new_size - alloc->size;
+    }
+    else
+    {
+        uint32_t tail = _block_new(alloc);
+        alloc->blocks[tail].offset = alloc->size;
+        alloc->blocks[tail].size = new_size - alloc->size;
+        alloc->blocks[tail].prev = last;
+        if (last != DVZ_ALLOC_NONE)
+            alloc->blocks[last].next = tail;
+        else
+            alloc->first = tail;
+        alloc->last = last = tail;
+    }
+    _free_insert(alloc, last);
+    log_trace("enlarge allocator from %s", pretty_size(alloc->size));
+    alloc->size = new_size;
+    return new_size;
+}
+
+
+
+// Reserve a block at a fixed offset in the last free block, used when rebuilding the allocator
+// during compaction.
+static void _block_take_at(DvzAlloc* alloc, VkDeviceSize offset, VkDeviceSize size)
+{
+    ASSERT(alloc != NULL);
+    uint32_t idx = alloc->last;
+    DvzAllocBlock* block = &alloc->blocks[idx];
+    if (block->used || offset < block->offset || offset + size > block->offset + block->size)
+    {
+        log_error("unable to reserve the block at offset %" PRIu64, (uint64_t)offset);
+        return;
+    }
+    // Keep the space before the offset as a free block.
+    if (block->offset < offset)
+    {
+        _free_remove(alloc, idx);
+        uint32_t rest = _block_split(alloc, idx, offset - block->offset);
+        _free_insert(alloc, idx);
+        _free_insert(alloc, rest);
+        idx = rest;
+    }
+    _block_take(alloc, idx, size);
+}
+
+
+
+/*************************************************************************************************/
+/*  Allocator                                                                                    */
+/*************************************************************************************************/
+
+DvzAlloc dvz_alloc(VkDeviceSize size, VkDeviceSize alignment)
+{
+    ASSERT(size > 0);
+    DvzAlloc alloc = {0};
+    alloc.alignment = alignment > 0 ? alignment : 1;
+    alloc.size = size;
+    alloc.capacity = DVZ_ALLOC_DEFAULT_BLOCKS;
+    alloc.blocks = calloc(alloc.capacity, sizeof(DvzAllocBlock));
+    for (uint32_t i = 0; i < alloc.capacity; i++)
+        alloc.blocks[i].next = i + 1 < alloc.capacity ? i + 1 : DVZ_ALLOC_NONE;
+    alloc.pool = 0;
+    memset(alloc.free_lists, 0xff, sizeof(alloc.free_lists)); // DVZ_ALLOC_NONE
+
+    // Initially, a single free block covers the whole range.
+    uint32_t idx = _block_new(&alloc);
+    alloc.blocks[idx].offset = 0;
+    alloc.blocks[idx].size = size;
+    alloc.first = alloc.last = idx;
+    _free_insert(&alloc, idx);
+
+    return alloc;
+}
+
+
+
+VkDeviceSize dvz_alloc_new(DvzAlloc* alloc, VkDeviceSize req_size, VkDeviceSize* resized)
+{
+    ASSERT(alloc != NULL);
+    ASSERT(alloc->blocks != NULL);
+    ASSERT(req_size > 0);
+
+    VkDeviceSize size = _align(req_size, alloc->alignment);
+    if (resized != NULL)
+        *resized = 0;
+
+    uint32_t idx = _free_find(alloc, size);
+    if (idx != DVZ_ALLOC_NONE)
+        return _block_take(alloc, idx, size);
+
+    // No free block large enough: enlarge the range, reusing the free space at the end if any.
+    DvzAllocBlock* last = &alloc->blocks[alloc->last];
+    VkDeviceSize start = last->used ? alloc->size : last->offset;
+    VkDeviceSize new_size = _grow(alloc, start + size);
+    ASSERT(new_size > 0);
+    if (resized != NULL)
+        *resized = new_size;
+
+    ASSERT(!alloc->blocks[alloc->last].used);
+    ASSERT(alloc->blocks[alloc->last].offset == start);
+    return _block_take(alloc, alloc->last, size);
+}
+
+
+
+bool dvz_alloc_fit(
+    DvzAlloc* alloc, VkDeviceSize req_size, VkDeviceSize alignment, VkDeviceSize* offset)
+{
+    ASSERT(alloc != NULL);
+    ASSERT(alloc->blocks != NULL);
+    ASSERT(req_size > 0);
+    ASSERT(offset != NULL);
+
+    VkDeviceSize size = _align(req_size, alloc->alignment);
+    alignment = _align(MAX(alignment, 1), alloc->alignment);
+
+    // A free block large enough for the region and the largest padding before the aligned
+    // offset always fits. As a fallback, the free blocks are searched in address order.
+    uint32_t idx = _free_find(alloc, size + alignment - alloc->alignment);
+    VkDeviceSize start = 0;
+    DvzAllocBlock* block = NULL;
+    if (idx == DVZ_ALLOC_NONE && alignment > alloc->alignment)
+    {
+        for (uint32_t i = alloc->first; i != DVZ_ALLOC_NONE; i = alloc->blocks[i].next)
+        {
+            block = &alloc->blocks[i];
+            if (!block->used &&
+                _align(block->offset, alignment) + size <= block->offset + block->size)
+            {
+                idx = i;
+                break;
+            }
+        }
+    }
+    if (idx == DVZ_ALLOC_NONE)
+        return false;
+
+    // Keep the padding before the aligned offset as a free block.
+    block = &alloc->blocks[idx];
+    start = _align(block->offset, alignment);
+    if (start > block->offset)
+    {
+        _free_remove(alloc, idx);
+        uint32_t rest = _block_split(alloc, idx, start - block->offset);
+        _free_insert(alloc, idx);
+        _free_insert(alloc, rest);
+        idx = rest;
+    }
+    *offset = _block_take(alloc, idx, size);
+    ASSERT(*offset == start);
+    return true;
+}
+
+
+
+VkDeviceSize dvz_alloc_resize(
+    DvzAlloc* alloc, VkDeviceSize offset, VkDeviceSize new_size, VkDeviceSize* resized)
+{
+    ASSERT(alloc != NULL);
+    ASSERT(new_size > 0);
+    if (resized != NULL)
+        *resized = 0;
+
+    uint32_t idx = _block_used(alloc, offset);
+    if (idx == DVZ_ALLOC_NONE)
+    {
+        log_error("no allocated region at offset %" PRIu64, (uint64_t)offset);
+        return offset;
+    }
+
+    VkDeviceSize size = _align(new_size, alloc->alignment);
+    VkDeviceSize old_size = alloc->blocks[idx].size;
+
+    // Shrink in-place.
+    if (size <= old_size)
+    {
+        if (size < old_size)
+        {
+            _block_free(alloc, _block_split(alloc, idx, size));
+            alloc->used_size -= old_size - size;
+        }
+        return offset;
+    }
+
+    // Grow in-place if the next block is free and large enough, or if the region is the last one
+    // in which case the managed range is enlarged.
+    VkDeviceSize extra = size - old_size;
+    uint32_t next = alloc->blocks[idx].next;
+    bool next_free = next != DVZ_ALLOC_NONE && !alloc->blocks[next].used;
+    bool is_last = next == DVZ_ALLOC_NONE || (next_free && next == alloc->last);
+    bool next_fits = next_free && alloc->blocks[next].size >= extra;
+    if (!next_fits && is_last)
+    {
+        VkDeviceSize grown = _grow(alloc, offset + size);
+        if (resized != NULL)
+            *resized = grown;
+        next = alloc->blocks[idx].next;
+        next_fits = true;
+    }
+    if (next_fits)
+    {
+        ASSERT(next != DVZ_ALLOC_NONE);
+        DvzAllocBlock* next_block = &alloc->blocks[next];
+        ASSERT(!next_block->used);
+        ASSERT(next_block->size >= extra);
+        _free_remove(alloc, next);
+        next_block->offset += extra;
+        next_block->size -= extra;
+        alloc->blocks[idx].size = size;
+        if (next_block->size == 0)
+        {
+            // The next block is entirely taken by the region.
+            alloc->blocks[idx].next = next_block->next;
+            if (next_block->next != DVZ_ALLOC_NONE)
+                alloc->blocks[next_block->next].prev = idx;
+            else
+                alloc->last = idx;
+            _block_release(alloc, next);
+        }
+        else
+            _free_insert(alloc, next);
+        alloc->used_size += extra;
+        return offset;
+    }
+
+    // Otherwise, allocate a new region. The old one is kept until the caller frees it.
+    log_trace("unable to resize region in-place, allocating a new region");
+    return dvz_alloc_new(alloc, size, resized);
+}
+
+
+
+void dvz_alloc_free(DvzAlloc* alloc, VkDeviceSize offset)
+{
+    ASSERT(alloc != NULL);
+    uint32_t idx = _block_used(alloc, offset);
+    if (idx == DVZ_ALLOC_NONE)
+    {
+        log_error("no allocated region at offset %" PRIu64, (uint64_t)offset);
+        return;
+    }
+    dvz_hash_table_remove(&alloc->used, offset);
+    alloc->used_size -= alloc->blocks[idx].size;
+    alloc->used_blocks--;
+    _block_free(alloc, idx);
+}
+
+
+
+VkDeviceSize dvz_alloc_size(DvzAlloc* alloc, VkDeviceSize offset)
+{
+    ASSERT(alloc != NULL);
+    uint32_t idx = _block_used(alloc, offset);
+    return idx != DVZ_ALLOC_NONE ? alloc->blocks[idx].size : 0;
+}
+
+
+
+VkDeviceSize dvz_alloc_compact(
+    DvzAlloc* alloc, uint32_t count, const VkDeviceSize* offsets, VkDeviceSize* new_offsets,
+    VkDeviceSize min_size)
+{
+    ASSERT(alloc != NULL);
+    ASSERT(count == 0 || (offsets != NULL && new_offsets != NULL));
+
+    DvzHashTable movable = {0};
+    for (uint32_t i = 0; i < count; i++)
+    {
+        new_offsets[i] = offsets[i];
+        if (_block_used(alloc, offsets[i]) == DVZ_ALLOC_NONE)
+            log_error("no allocated region at offset %" PRIu64, (uint64_t)offsets[i]);
+        else
+            dvz_hash_table_set(&movable, offsets[i], i);
+    }
+
+    // Rebuild the allocator in a single pass in address order: the pinned regions stay at their
+    // current offsets, the movable regions are packed right after the previous region. As the
+    // regions before a movable region all end before it, it never moves forward, and it never
+    // overlaps the next pinned region.
+    DvzAlloc compacted = dvz_alloc(alloc->size, alloc->alignment);
+    DvzAllocBlock* block = NULL;
+    VkDeviceSize cursor = 0, new_offset = 0;
+    uint64_t j = 0;
+    for (uint32_t i = alloc->first; i != DVZ_ALLOC_NONE; i = alloc->blocks[i].next)
+    {
+        block = &alloc->blocks[i];
+        if (!block->used)
+            continue;
+        bool is_movable = dvz_hash_table_get(&movable, block->offset, &j);
+        new_offset = is_movable ? cursor : block->offset;
+        ASSERT(new_offset >= cursor);
+        ASSERT(new_offset <= block->offset);
+        _block_take_at(&compacted, new_offset, block->size);
+        cursor = new_offset + block->size;
+        // Report the new offset to the caller.
+        if (is_movable)
+            new_offsets[j] = new_offset;
+    }
+    // Duplicate offsets share the same region.
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (dvz_hash_table_get(&movable, offsets[i], &j))
+            new_offsets[i] = new_offsets[j];
+    }
+    dvz_hash_table_destroy(&movable);
+
+    // Trim the free space at the end of the range.
+    DvzAllocStats stats = dvz_alloc_stats(&compacted);
+    VkDeviceSize new_size = MAX(dvz_next_pow2(stats.end), min_size);
+    uint32_t last = compacted.last;
+    if (new_size < compacted.size && !compacted.blocks[last].used)
+    {
+        ASSERT(compacted.blocks[last].offset <= new_size);
+        _free_remove(&compacted, last);
+        compacted.blocks[last].size = new_size - compacted.blocks[last].offset;
+        if (compacted.blocks[last].size > 0)
+            _free_insert(&compacted, last);
+        else
+        {
+            compacted.last = compacted.blocks[last].prev;
+            ASSERT(compacted.last != DVZ_ALLOC_NONE);
+            compacted.blocks[compacted.last].next = DVZ_ALLOC_NONE;
+            _block_release(&compacted, last);
+        }
+        compacted.size = new_size;
+    }
+
+    dvz_alloc_destroy(alloc);
+    *alloc = compacted;
+    return alloc->size;
+}
+
+
+
+DvzAllocStats dvz_alloc_stats(DvzAlloc* alloc)
+{
+    ASSERT(alloc != NULL);
+    DvzAllocStats stats = {0};
+    stats.size = alloc->size;
+    stats.used = alloc->used_size;
+    stats.used_blocks = alloc->used_blocks;
+    stats.free_blocks = alloc->free_blocks;
+
+    // Free blocks are merged, so the last free block starts at the end of the last used one.
+    DvzAllocBlock* last = &alloc->blocks[alloc->last];
+    stats.end = last->used ? last->offset + last->size : last->offset;
+
+    // The largest free block is in the highest non-empty size class.
+    if (alloc->fl_bitmap != 0)
+    {
+        uint32_t fl = _msb(alloc->fl_bitmap);
+        uint32_t sl = _msb(alloc->sl_bitmap[fl]);
+        for (uint32_t i = alloc->free_lists[fl][sl]; i != DVZ_ALLOC_NONE;
+             i = alloc->blocks[i].next_free)
+            stats.largest_free = MAX(stats.largest_free, alloc->blocks[i].size);
+    }
+    return stats;
+}
+
+
+
+void dvz_alloc_destroy(DvzAlloc* alloc)
+{
+    ASSERT(alloc != NULL);
+    FREE(alloc->blocks);
+    dvz_hash_table_destroy(&alloc->used);
+    alloc->count = 0;
+    alloc->capacity = 0;
+}
@@ -0,0 +1,424 @@
+#include "../include/datoviz/array.h"
+
+#if (GCC || CLANG) && (defined(__x86_64__) || defined(__i386__))
+#define HAS_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define HAS_X86_SIMD 0
+#endif
+
+
+
+/*************************************************************************************************/
+/*  SIMD detection                                                                               */
+/*************************************************************************************************/
+
+static atomic(int, _simd_level) = -1;
+static atomic(int, _simd_max_level) = DVZ_SIMD_AVX2;
+
+static DvzSimdLevel _simd_detect(void)
+{
+#if HAS_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return DVZ_SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return DVZ_SIMD_SSE2;
+#endif
+    return DVZ_SIMD_NONE;
+}
+
+
+
+DvzSimdLevel dvz_simd_level(void)
+{
+    int level = atomic_load(&_simd_level);
+    if (level < 0)
+    {
+        level = (int)_simd_detect();
+        atomic_store(&_simd_level, level);
+        log_debug("detected SIMD level %d", level);
+    }
+    return (DvzSimdLevel)MIN(level, atomic_load(&_simd_max_level));
+}
+
+
+
+DvzSimdLevel dvz_simd_set_level(DvzSimdLevel max_level)
+{
+    atomic_store(&_simd_max_level, (int)max_level);
+    return dvz_simd_level();
+}
+
+
+
+/*************************************************************************************************/
+/*  Conversion kernels                                                                           */
+/*************************************************************************************************/
+
+static void _cvt_pd_ps_scalar(float* dst, const double* src, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++)
+        dst[i] = (float)src[i];
+}
+
+
+
+// Convert contiguous items with n double components to strided items with n float components.
+static void _cvt_pd_ps_strided_scalar(
+    uint8_t* dst, VkDeviceSize dst_stride, const double* src, uint32_t n, uint32_t count)
+{
+    float item[3] = {0};
+    switch (n)
+    {
+    case 1:
+        for (uint32_t i = 0; i < count; i++)
+        {
+            item[0] = (float)src[i];
+            memcpy(dst + i * dst_stride, item, sizeof(float));
+        }
+        break;
+    case 2:
+        for (uint32_t i = 0; i < count; i++)
+        {
+            item[0] = (float)src[2 * i + 0];
+            item[1] = (float)src[2 * i + 1];
+            memcpy(dst + i * dst_stride, item, 2 * sizeof(float));
+        }
+        break;
+    case 3:
+        for (uint32_t i = 0; i < count; i++)
+        {
+            item[0] = (float)src[3 * i + 0];
+            item[1] = (float)src[3 * i + 1];
+            item[2] = (float)src[3 * i + 2];
+            memcpy(dst + i * dst_stride, item, 3 * sizeof(float));
+        }
+        break;
+    default:
+        log_error("unsupported number of components %d", n);
+        break;
+    }
+}
+
+
+
+#if HAS_X86_SIMD
+
+static void _cvt_pd_ps_sse2(float* dst, const double* src, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(&src[i]));
+        __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(&src[i + 2]));
+        _mm_storeu_ps(&dst[i], _mm_movelh_ps(lo, hi));
+    }
+    _cvt_pd_ps_scalar(&dst[i], &src[i], count - i);
+}
+
+
+
+static void _cvt_pd_ps_strided_sse2(
+    uint8_t* dst, VkDeviceSize dst_stride, const double* src, uint32_t n, uint32_t count)
+{
+    __m128 xy, z;
+    switch (n)
+    {
+    case 2:
+        for (uint32_t i = 0; i < count; i++)
+        {
+            xy = _mm_cvtpd_ps(_mm_loadu_pd(&src[2 * i]));
+            _mm_storel_pi((__m64*)(dst + i * dst_stride), xy);
+        }
+        break;
+    case 3:
+        for (uint32_t i = 0; i < count; i++)
+        {
+            xy = _mm_cvtpd_ps(_mm_loadu_pd(&src[3 * i]));
+            z = _mm_cvtsd_ss(xy, _mm_load_sd(&src[3 * i + 2]));
+            _mm_storel_pi((__m64*)(dst + i * dst_stride), xy);
+            _mm_store_ss((float*)(dst + i * dst_stride + 2 * sizeof(float)), z);
+        }
+        break;
+    default:
+        _cvt_pd_ps_strided_scalar(dst, dst_stride, src, n, count);
+        break;
+    }
+}
+
+
+
+__attribute__((target("avx2"))) static void
+_cvt_pd_ps_avx2(float* dst, const double* src, uint32_t count)
+{
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128 lo = _mm256_cvtpd_ps(_mm256_loadu_pd(&src[i]));
+        __m128 hi = _mm256_cvtpd_ps(_mm256_loadu_pd(&src[i + 4]));
+        _mm256_storeu_ps(&dst[i], _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+    }
+    _cvt_pd_ps_scalar(&dst[i], &src[i], count - i);
+}
+
+#endif
+
+
+
+// Convert contiguous doubles to contiguous floats with the best available instruction set.
+static void _cvt_pd_ps(float* dst, const double* src, uint32_t count)
+{
+#if HAS_X86_SIMD
+    switch (dvz_simd_level())
+    {
+    case DVZ_SIMD_AVX2:
+        _cvt_pd_ps_avx2(dst, src, count);
+        return;
+    case DVZ_SIMD_SSE2:
+        _cvt_pd_ps_sse2(dst, src, count);
+        return;
+    default:
+        break;
+    }
+#endif
+    _cvt_pd_ps_scalar(dst, src, count);
+}
+
+
+
+static void _cvt_pd_ps_strided(
+    uint8_t* dst, VkDeviceSize dst_stride, const double* src, uint32_t n, uint32_t count)
+{
+#if HAS_X86_SIMD
+    // NOTE: the items are scattered one by one, so that AVX2 does not bring anything over SSE2.
+    if (dvz_simd_level() >= DVZ_SIMD_SSE2)
+    {
+        _cvt_pd_ps_strided_sse2(dst, dst_stride, src, n, count);
+        return;
+    }
+#endif
+    _cvt_pd_ps_strided_scalar(dst, dst_stride, src, n, count);
+}
+
+
+
+/*************************************************************************************************/
+/*  Strided copy kernels                                                                         */
+/*************************************************************************************************/
+
+// The item size is a compile-time constant in each instance, so that memcpy() is inlined as a few
+// (vector) moves.
+#define COPY_STRIDED(size)                                                                        \
+    for (uint32_t i = 0; i < count; i++)                                                          \
+        memcpy(dst + i * dst_stride, src + i * src_stride, size);
+
+void dvz_array_copy_strided(
+    void* dst_ptr, VkDeviceSize dst_stride, const void* src_ptr, VkDeviceSize src_stride,
+    VkDeviceSize item_size, uint32_t count)
+{
+    ASSERT(dst_ptr != NULL);
+    ASSERT(src_ptr != NULL);
+    ASSERT(item_size > 0);
+    uint8_t* dst = (uint8_t*)dst_ptr;
+    const uint8_t* src = (const uint8_t*)src_ptr;
+
+    // Both arrays are contiguous.
+    if (dst_stride == item_size && src_stride == item_size)
+    {
+        memcpy(dst, src, item_size * count);
+        return;
+    }
+
+    switch (item_size)
+    {
+    case 1:
+        COPY_STRIDED(1)
+        break;
+    case 2:
+        COPY_STRIDED(2)
+        break;
+    case 4:
+        COPY_STRIDED(4)
+        break;
+    case 8:
+        COPY_STRIDED(8)
+        break;
+    case 12:
+        COPY_STRIDED(12)
+        break;
+    case 16:
+        COPY_STRIDED(16)
+        break;
+    case 24:
+        COPY_STRIDED(24)
+        break;
+    case 32:
+        COPY_STRIDED(32)
+        break;
+    default:
+        COPY_STRIDED(item_size)
+        break;
+    }
+}
+
+
+
+void dvz_array_fill_strided(
+    void* dst, VkDeviceSize dst_stride, const void* item, VkDeviceSize item_size, uint32_t count)
+{
+    // A fill is a strided copy with a null source stride.
+    dvz_array_copy_strided(dst, dst_stride, item, 0, item_size, count);
+}
+
+
+
+void dvz_array_cast_strided(
+    void* dst_ptr, VkDeviceSize dst_stride, DvzDataType target_dtype, //
+    const void* src_ptr, VkDeviceSize src_stride, DvzDataType source_dtype, uint32_t count)
+{
+    ASSERT(dst_ptr != NULL);
+    ASSERT(src_ptr != NULL);
+    uint8_t* dst = (uint8_t*)dst_ptr;
+    const uint8_t* src = (const uint8_t*)src_ptr;
+
+    uint32_t n = 0; // number of components
+    if (source_dtype == DVZ_DTYPE_DOUBLE && target_dtype == DVZ_DTYPE_FLOAT)
+        n = 1;
+    else if (source_dtype == DVZ_DTYPE_DVEC2 && target_dtype == DVZ_DTYPE_VEC2)
+        n = 2;
+    else if (source_dtype == DVZ_DTYPE_DVEC3 && target_dtype == DVZ_DTYPE_VEC3)
+        n = 3;
+
+    // Unsupported casts or non-contiguous source: scalar fallback.
+    if (n == 0 || src_stride != n * sizeof(double))
+    {
+        for (uint32_t i = 0; i < count; i++)
+            _cast(target_dtype, dst + i * dst_stride, source_dtype, (void*)(src + i * src_stride));
+        return;
+    }
+
+    // Contiguous destination: convert all components at once.
+    if (dst_stride == n * sizeof(float))
+    {
+        _cvt_pd_ps((float*)dst, (const double*)src, n * count);
+        return;
+    }
+
+    // Strided destination, typically interleaved in vertex records.
+    _cvt_pd_ps_strided(dst, dst_stride, (const double*)src, n, count);
+}
+
+
+
+/*************************************************************************************************/
+/*  Pixel kernels                                                                                */
+/*************************************************************************************************/
+
+static void _pixels_scalar(
+    uint8_t* dst, const uint8_t* src, uint32_t count, bool swizzle, bool has_alpha)
+{
+    uint32_t r = swizzle ? 2 : 0;
+    uint32_t b = swizzle ? 0 : 2;
+    uint32_t n = has_alpha ? 4 : 3;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        dst[n * i + 0] = src[4 * i + r];
+        dst[n * i + 1] = src[4 * i + 1];
+        dst[n * i + 2] = src[4 * i + b];
+        if (has_alpha)
+            dst[n * i + 3] = 255;
+    }
+}
+
+
+
+#if HAS_X86_SIMD
+
+// NOTE: SSE2 has no byte shuffle, but 4-byte pixels can be swizzled with 32-bit shifts and masks.
+static void _pixels_rgba_sse2(uint8_t* dst, const uint8_t* src, uint32_t count, bool swizzle)
+{
+    const __m128i low = _mm_set1_epi32(0x000000ff);
+    const __m128i green = _mm_set1_epi32(0x0000ff00);
+    const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+    __m128i p;
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        p = _mm_loadu_si128((const __m128i*)(src + 4 * i));
+        if (swizzle)
+            p = _mm_or_si128(
+                _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), low), _mm_and_si128(p, green)),
+                _mm_slli_epi32(_mm_and_si128(p, low), 16));
+        _mm_storeu_si128((__m128i*)(dst + 4 * i), _mm_or_si128(p, alpha));
+    }
+    _pixels_scalar(dst + 4 * i, src + 4 * i, count - i, swizzle, true);
+}
+
+
+
+__attribute__((target("avx2"))) static void
+_pixels_avx2(uint8_t* dst, const uint8_t* src, uint32_t count, bool swizzle, bool has_alpha)
+{
+    const char r = swizzle ? 2 : 0;
+    const char b = swizzle ? 0 : 2;
+    __m256i shuffle, p;
+    // In-lane byte shuffle, -1 clears the byte.
+    if (has_alpha)
+        shuffle = _mm256_setr_epi8(
+            r, 1, b, -1, r + 4, 5, b + 4, -1, r + 8, 9, b + 8, -1, r + 12, 13, b + 12, -1, //
+            r, 1, b, -1, r + 4, 5, b + 4, -1, r + 8, 9, b + 8, -1, r + 12, 13, b + 12, -1);
+    else
+        shuffle = _mm256_setr_epi8(
+            r, 1, b, r + 4, 5, b + 4, r + 8, 9, b + 8, r + 12, 13, b + 12, -1, -1, -1, -1, //
+            r, 1, b, r + 4, 5, b + 4, r + 8, 9, b + 8, r + 12, 13, b + 12, -1, -1, -1, -1);
+    const __m256i alpha = _mm256_set1_epi32((int)0xff000000);
+    // Move the 12 RGB bytes of the upper lane next to the 12 bytes of the lower lane.
+    const __m256i pack = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        p = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(src + 4 * i)), shuffle);
+        if (has_alpha)
+        {
+            _mm256_storeu_si256((__m256i*)(dst + 4 * i), _mm256_or_si256(p, alpha));
+        }
+        else
+        {
+            p = _mm256_permutevar8x32_epi32(p, pack);
+            _mm_storeu_si128((__m128i*)(dst + 3 * i), _mm256_castsi256_si128(p));
+            _mm_storel_epi64((__m128i*)(dst + 3 * i + 16), _mm256_extracti128_si256(p, 1));
+        }
+    }
+    _pixels_scalar(dst + (has_alpha ? 4 : 3) * i, src + 4 * i, count - i, swizzle, has_alpha);
+}
+
+#endif
+
+
+
+void dvz_array_pixels(
+    uint8_t* dst, const uint8_t* src, uint32_t count, bool swizzle, bool has_alpha)
+{
+    ASSERT(dst != NULL);
+    ASSERT(src != NULL);
+#if HAS_X86_SIMD
+    switch (dvz_simd_level())
+    {
+    case DVZ_SIMD_AVX2:
+        _pixels_avx2(dst, src, count, swizzle, has_alpha);
+        return;
+    case DVZ_SIMD_SSE2:
+        if (has_alpha)
+        {
+            _pixels_rgba_sse2(dst, src, count, swizzle);
+            return;
+        }
+        break;
+    default:
+        break;
+    }
+#endif
+    _pixels_scalar(dst, src, count, swizzle, has_alpha);
+}
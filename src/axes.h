@@ -2,6 +2,7 @@
 #define DVZ_AXIS_HEADER
 
 #include "../include/datoviz/canvas.h"
+#include "../include/datoviz/glyphs.h"
 #include "../include/datoviz/panel.h"
 #include "../include/datoviz/scene.h"
 #include "../include/datoviz/ticks_types.h"
@@ -65,7 +66,8 @@ static DvzAxesContext _axes_context(DvzController* controller, DvzAxisCoord coor
 
 
 // Recompute the tick locations as a function of the current axis range in data coordinates.
-static void _axes_ticks(DvzController* controller, DvzAxisCoord coord, dvec2 range)
+// Return whether the ticks changed.
+static bool _axes_ticks(DvzController* controller, DvzAxisCoord coord, dvec2 range)
 {
     ASSERT(controller != NULL);
     ASSERT(controller->type == DVZ_CONTROLLER_AXES_2D);
@@ -84,20 +86,88 @@ static void _axes_ticks(DvzController* controller, DvzAxisCoord coord, dvec2 ran
     double vlen = vmax - vmin;
     ASSERT(vlen > 0);
 
-    // Free the existing ticks.
-    if (axes->ticks[coord].values != NULL)
-        dvz_ticks_destroy(&axes->ticks[coord]);
-
     // Determine the tick number and positions.
-    axes->ticks[coord] = dvz_ticks(vmin, vmax, ctx);
+    DvzAxesTicks ticks = dvz_ticks_cached(&axes->ticks_cache[coord], vmin, vmax, ctx);
 
     // We keep track of the context.
     axes->ctx[coord] = ctx;
+
+    // Keep the existing ticks if they are the same, as the text prop points to their labels.
+    DvzAxesTicks* current = &axes->ticks[coord];
+    if (current->values != NULL && _ticks_equal(current, &ticks))
+    {
+        dvz_ticks_destroy(&ticks);
+        return false;
+    }
+
+    // Free the existing ticks.
+    if (current->values != NULL)
+        dvz_ticks_destroy(current);
+    *current = ticks;
+    return true;
+}
+
+
+
+// Shift the ticks if the view was only panned since the ticks were computed. Return false if the
+// ticks need to be recomputed.
+static bool _axes_pan(DvzController* controller, DvzAxisCoord coord, dvec2 range, bool* changed)
+{
+    ASSERT(controller != NULL);
+    ASSERT(controller->type == DVZ_CONTROLLER_AXES_2D);
+    DvzAxes2D* axes = &controller->u.axes_2D;
+    ASSERT(axes != NULL);
+
+    DvzAxesContext ctx = _axes_context(controller, coord);
+    DvzAxesContext* prev = &axes->ctx[coord];
+    if (ctx.scale_orig != prev->scale_orig || ctx.size_viewport != prev->size_viewport ||
+        ctx.size_glyph != prev->size_glyph)
+        return false;
+    return dvz_ticks_pan(&axes->ticks[coord], range[0], range[1], &ctx, changed);
+}
+
+
+
+// Update a prop of the axes visual from its first modified item. This only limits the copy into
+// the prop array: any change still triggers a bake of the whole axes visual.
+static void _axes_prop_update(
+    DvzVisual* visual, DvzPropType prop_type, uint32_t prop_idx, uint32_t count, const void* data)
+{
+    ASSERT(visual != NULL);
+    ASSERT(count > 0);
+    DvzProp* prop = dvz_prop_get(visual, prop_type, prop_idx);
+    ASSERT(prop != NULL);
+    DvzArray* arr = &prop->arr_orig;
+    VkDeviceSize item_size = arr->item_size;
+    ASSERT(item_size > 0);
+
+    uint32_t first = 0;
+    if (arr->data != NULL)
+    {
+        uint32_t n = MIN(count, arr->item_count);
+        while (first < n && memcmp(
+                                (const char*)arr->data + first * item_size,
+                                (const char*)data + first * item_size, item_size) == 0)
+            first++;
+        if (first == count && count == arr->item_count)
+            return;
+        // The array is only truncated: the last item is written again.
+        if (first == count)
+            first--;
+    }
+    dvz_visual_data_partial(
+        visual, prop_type, prop_idx, first, count - first, count - first,
+        (const char*)data + first * item_size);
 }
 
 
 
 // Update the axes visual's data as a function of the computed ticks.
+//
+// The incremental work stops at the ticks: a pan only formats the labels entering at the edges,
+// but the upload is not incremental. The tick values are shifted along the arrays, so the
+// position props usually change from their first item, the text prop is always set again, and
+// the axes bake rebuilds all segment and glyph vertices, as it has no partial bake path.
 static void _axes_upload(DvzController* controller, DvzAxisCoord coord)
 {
     ASSERT(controller != NULL);
@@ -146,12 +216,14 @@ static void _axes_upload(DvzController* controller, DvzAxisCoord coord)
         // log_info("%f %s", ticks[i], text[i]);
     }
 
-    // Set visual data.
+    // Set visual data, only from the first tick that changed. The labels may have been modified
+    // in place by a pan, and the text prop only holds pointers to them, so it cannot be compared
+    // and is always set again.
     double lim[] = {-1};
-    dvz_visual_data(visual, DVZ_PROP_POS, DVZ_AXES_LEVEL_MINOR, 4 * (N - 1), minor_ticks);
-    dvz_visual_data(visual, DVZ_PROP_POS, DVZ_AXES_LEVEL_MAJOR, N, ticks);
-    dvz_visual_data(visual, DVZ_PROP_POS, DVZ_AXES_LEVEL_GRID, N, ticks);
-    dvz_visual_data(visual, DVZ_PROP_POS, DVZ_AXES_LEVEL_LIM, 1, lim);
+    _axes_prop_update(visual, DVZ_PROP_POS, DVZ_AXES_LEVEL_MINOR, 4 * (N - 1), minor_ticks);
+    _axes_prop_update(visual, DVZ_PROP_POS, DVZ_AXES_LEVEL_MAJOR, N, ticks);
+    _axes_prop_update(visual, DVZ_PROP_POS, DVZ_AXES_LEVEL_GRID, N, ticks);
+    _axes_prop_update(visual, DVZ_PROP_POS, DVZ_AXES_LEVEL_LIM, 1, lim);
     dvz_visual_data(visual, DVZ_PROP_TEXT, 0, N, text);
 
     FREE(minor_ticks);
@@ -338,12 +410,19 @@ static void _axes_refresh(DvzController* controller, bool force)
         update[1] = true;
     }
 
+    bool changed = false;
     for (uint32_t coord = 0; coord < 2; coord++)
     {
         if (!update[coord])
             continue;
-        _axes_ticks(controller, (DvzAxisCoord)coord, range[coord]);
-        _axes_upload(controller, (DvzAxisCoord)coord);
+
+        // When panning, the tick lattice is shifted instead of being recomputed.
+        changed = false;
+        if (canvas->resized || force ||
+            !_axes_pan(controller, (DvzAxisCoord)coord, range[coord], &changed))
+            changed |= _axes_ticks(controller, (DvzAxisCoord)coord, range[coord]);
+        if (changed || canvas->resized || force)
+            _axes_upload(controller, (DvzAxisCoord)coord);
 
         // TODO: what else to do here? update a request??
         // canvas->obj.status = DVZ_OBJECT_STATUS_NEED_UPDATE;
@@ -408,13 +487,11 @@ static void _axes_visual(DvzController* controller, DvzAxisCoord coord)
         (coord == 0 ? DVZ_INTERACT_FIXED_AXIS_Y : DVZ_INTERACT_FIXED_AXIS_X) >> 12;
 
     // Text params.
-    DvzFontAtlas* atlas = &ctx->font_atlas;
-    ASSERT(strlen(atlas->font_str) > 0);
+    DvzGlyphAtlas* atlas = dvz_ctx_glyph_atlas(ctx);
+    ASSERT(atlas->texture != NULL);
     dvz_visual_texture(visual, DVZ_SOURCE_TYPE_FONT_ATLAS, 0, atlas->texture);
 
     DvzGraphicsTextParams params = {0};
-    params.grid_size[0] = (int32_t)atlas->rows;
-    params.grid_size[1] = (int32_t)atlas->cols;
     params.tex_size[0] = (int32_t)atlas->width;
     params.tex_size[1] = (int32_t)atlas->height;
     dvz_visual_data_source(visual, DVZ_SOURCE_TYPE_PARAM, 0, 0, 1, 1, &params);
@@ -467,6 +544,7 @@ static void _axes_destroy(DvzController* controller)
     for (uint32_t i = 0; i < 2; i++)
     {
         dvz_ticks_destroy(&axes->ticks[i]);
+        dvz_ticks_cache_destroy(&axes->ticks_cache[i]);
     }
 }
 
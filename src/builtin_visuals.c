@@ -1,5 +1,6 @@
 #include "../include/datoviz/builtin_visuals.h"
 #include "../include/datoviz/array.h"
+#include "../include/datoviz/glyphs.h"
 #include "../include/datoviz/interact.h"
 #include "../include/datoviz/mesh.h"
 #include "visuals_utils.h"
@@ -1294,6 +1295,7 @@ static void _visual_axes_2D_bake(DvzVisual* visual, DvzVisualDataEvent ev)
     // Text color.
     PARAM(cvec4, str_item.vertex.color, COLOR, 4)
 
+    DvzGraphicsTextItem* str_items = calloc(n_text, sizeof(DvzGraphicsTextItem));
     for (uint32_t i = 0; i < n_text; i++)
     {
         // Add text.
@@ -1308,8 +1310,13 @@ static void _visual_axes_2D_bake(DvzVisual* visual, DvzVisualDataEvent ev)
         ASSERT(x != NULL);
         _tick_pos(*x, DVZ_AXES_LEVEL_MAJOR, coord, str_item.vertex.pos, P);
 
-        dvz_graphics_append(&text_data, &str_item);
+        str_items[i] = str_item;
     }
+    dvz_graphics_append_text(&text_data, n_text, str_items);
+    FREE(str_items);
+
+    // Upload the glyphs rasterized for the new labels.
+    dvz_glyph_atlas_upload(dvz_ctx_glyph_atlas(canvas->gpu->context), canvas);
 }
 
 static void _visual_axes_2D(DvzVisual* visual)
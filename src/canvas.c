@@ -1,7 +1,9 @@
 #include "../include/datoviz/canvas.h"
 #include "../external/video.h"
+#include "../include/datoviz/array.h"
 #include "../include/datoviz/context.h"
 #include "../include/datoviz/controls.h"
+#include "../include/datoviz/graphics.h"
 #include "../include/datoviz/gui.h"
 #include "../include/datoviz/vklite.h"
 #include "../src/canvas_utils.h"
@@ -410,13 +412,14 @@ static int _event_postsend(DvzCanvas* canvas)
 /*  Event utils                                                                                  */
 /*************************************************************************************************/
 
-static void _refill_canvas(DvzCanvas* canvas, uint32_t img_idx)
+static void _refill_canvas(DvzCanvas* canvas, uint32_t img_idx, bool invalidate)
 {
     ASSERT(canvas != NULL);
     log_debug("refill canvas %d", img_idx);
     DvzEvent ev = {0};
     ev.type = DVZ_EVENT_REFILL;
     ev.u.rf.img_idx = img_idx;
+    ev.u.rf.invalidate = invalidate;
 
     // First commands passed is the default cmds_render DvzCommands instance used for rendering.
     uint32_t k = 0;
@@ -450,12 +453,17 @@ static void _refill_canvas(DvzCanvas* canvas, uint32_t img_idx)
     {
         log_debug("complete refill of the canvas");
         for (img_idx = 0; img_idx < img_count; img_idx++)
+        {
+            ev.u.rf.img_idx = img_idx;
             _event_refill(canvas, ev);
+        }
+        dvz_profile_count(canvas->profiler, DVZ_PROFILE_COUNTER_REFILLS, img_count);
     }
     else
     {
         log_trace("refill of the canvas for image idx #%d", img_idx);
         _event_refill(canvas, ev);
+        dvz_profile_count(canvas->profiler, DVZ_PROFILE_COUNTER_REFILLS, 1);
     }
 }
 
@@ -464,6 +472,17 @@ static void _refill_canvas(DvzCanvas* canvas, uint32_t img_idx)
 static void _refill_frame(DvzCanvas* canvas)
 {
     uint32_t img_idx = canvas->swapchain.img_idx;
+
+    // The default buffers shared by all canvases were recreated since the last frame (enlarged
+    // or compacted): all command buffers still bind the destroyed buffers and must be refilled.
+    DvzContext* context = canvas->gpu->context;
+    if (context != NULL && canvas->buffers_generation != context->buffers_generation)
+    {
+        log_debug("context buffers were recreated, refilling the canvas");
+        canvas->buffers_generation = context->buffers_generation;
+        dvz_canvas_to_refill(canvas);
+    }
+
     // Only proceed if the current swapchain image has not been processed yet.
     if (atomic_load(&canvas->refills.status) == DVZ_REFILL_REQUESTED ||
         atomic_load(&canvas->refills.status) == DVZ_REFILL_PROCESSING)
@@ -473,6 +492,11 @@ static void _refill_frame(DvzCanvas* canvas)
         if (atomic_load(&canvas->refills.status) == DVZ_REFILL_REQUESTED)
             memset(canvas->refills.completed, 0, DVZ_MAX_SWAPCHAIN_IMAGES);
 
+        // A complete refill discards the cached command buffers of all swapchain images, even
+        // those that were already refilled after a partial refill request.
+        if (atomic_exchange(&canvas->refills.invalidate, false))
+            memset(canvas->refills.invalidated, 1, DVZ_MAX_SWAPCHAIN_IMAGES);
+
         // Skip this step if the current swapchain image has already been processed.
         if (canvas->refills.completed[img_idx])
             return;
@@ -487,7 +511,8 @@ static void _refill_frame(DvzCanvas* canvas)
         canvas->clock.interval = 0;
 
         // Refill the command buffer for the current swapchain image.
-        _refill_canvas(canvas, img_idx);
+        _refill_canvas(canvas, img_idx, canvas->refills.invalidated[img_idx]);
+        canvas->refills.invalidated[img_idx] = false;
 
         // Mark that command buffer as updated.
         canvas->refills.completed[img_idx] = true;
@@ -587,6 +612,9 @@ _canvas(DvzGpu* gpu, uint32_t width, uint32_t height, bool offscreen, bool overl
     // to the main thread (REFILL or CLOSE events).
     atomic_init(&canvas->to_close, false);
     atomic_init(&canvas->refills.status, DVZ_REFILL_NONE);
+    atomic_init(&canvas->refills.invalidate, false);
+    if (gpu->context != NULL)
+        canvas->buffers_generation = gpu->context->buffers_generation;
 
     // Allocate memory for canvas objects.
     canvas->commands =
@@ -712,7 +740,10 @@ _canvas(DvzGpu* gpu, uint32_t width, uint32_t height, bool offscreen, bool overl
     // Default submit instance.
     canvas->submit = dvz_submit(gpu);
 
-    canvas->transfers = dvz_fifo(DVZ_MAX_FIFO_CAPACITY);
+    canvas->transfers = dvz_fifo_lockfree(DVZ_MAX_FIFO_CAPACITY, DVZ_FIFO_MODE_MPSC);
+    canvas->transfer_pool = dvz_transfer_pool(DVZ_TRANSFER_POOL_SIZE);
+    canvas->staging = dvz_staging_ring(
+        gpu, canvas->fences_render_finished.count, DVZ_STAGING_RING_SIZE);
 
     // Event system.
     {
@@ -758,6 +789,10 @@ _canvas(DvzGpu* gpu, uint32_t width, uint32_t height, bool offscreen, bool overl
                 canvas, DVZ_EVENT_IMGUI, 0, DVZ_EVENT_MODE_SYNC, dvz_gui_callback_fps, NULL);
     }
 
+    // Profiler, enabled with an environment variable.
+    if (getenv("DVZ_PROFILE") != NULL)
+        dvz_canvas_profile(canvas, 0);
+
     ASSERT(canvas->swapchain.images != NULL);
     log_debug(
         "created canvas of size %dx%d", //
@@ -1033,6 +1068,17 @@ void dvz_event_callback(
 /*************************************************************************************************/
 
 void dvz_canvas_to_refill(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    // NOTE: the flag must be raised before the status, which is what the main thread checks.
+    atomic_store(&canvas->refills.invalidate, true);
+    DvzRefillStatus status = DVZ_REFILL_REQUESTED;
+    atomic_store(&canvas->refills.status, status);
+}
+
+
+
+void dvz_canvas_to_refill_cached(DvzCanvas* canvas)
 {
     ASSERT(canvas != NULL);
     DvzRefillStatus status = DVZ_REFILL_REQUESTED;
@@ -1560,42 +1606,149 @@ void dvz_event_stop(DvzCanvas* canvas)
 /*  Screencast                                                                                   */
 /*************************************************************************************************/
 
-static void _screencast_cmds(DvzScreencast* screencast)
+// Host-cached memory makes the CPU reads of the staging buffers much faster, when available.
+static VkMemoryPropertyFlags _screencast_memory(DvzGpu* gpu)
 {
-    ASSERT(screencast != NULL);
-    ASSERT(screencast->canvas != NULL);
-    ASSERT(screencast->canvas->gpu != NULL);
+    ASSERT(gpu != NULL);
+    VkMemoryPropertyFlags coherent =
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkMemoryPropertyFlags cached = coherent | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    for (uint32_t i = 0; i < gpu->memory_properties.memoryTypeCount; i++)
+    {
+        if ((gpu->memory_properties.memoryTypes[i].propertyFlags & cached) == cached)
+            return cached;
+    }
+    return coherent;
+}
+
 
-    DvzImages* images = screencast->canvas->swapchain.images;
-    uint32_t img_count = images->count;
 
-    DvzBarrier barrier = dvz_barrier(screencast->canvas->gpu);
+// Create a permanently-mapped staging buffer for the readback of 4-byte pixels.
+static DvzBuffer _screencast_buffer(DvzGpu* gpu, uint32_t width, uint32_t height)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(width > 0);
+    ASSERT(height > 0);
+
+    DvzBuffer buffer = dvz_buffer(gpu);
+    dvz_buffer_size(&buffer, 4 * width * height);
+    dvz_buffer_usage(&buffer, VK_BUFFER_USAGE_TRANSFER_DST_BIT);
+    dvz_buffer_memory(&buffer, _screencast_memory(gpu));
+    dvz_buffer_create(&buffer);
+    buffer.mmap = dvz_buffer_map(&buffer, 0, VK_WHOLE_SIZE);
+    ASSERT(buffer.mmap != NULL);
+    return buffer;
+}
+
+
+
+// Whether the swapchain pixels need to be swizzled from BGRA to RGBA.
+static bool _screencast_swizzle(DvzImages* images)
+{
+    ASSERT(images != NULL);
+    return images->format == VK_FORMAT_B8G8R8A8_UNORM ||
+           images->format == VK_FORMAT_B8G8R8A8_SRGB;
+}
+
+
+
+// Record the copy of a swapchain image to a staging buffer.
+static void
+_screencast_record(DvzCanvas* canvas, DvzCommands* cmds, uint32_t idx, DvzBuffer* staging)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(cmds != NULL);
+    ASSERT(staging != NULL);
+
+    DvzImages* images = canvas->swapchain.images;
+    ASSERT(staging->size >= 4 * images->width * images->height);
+
+    DvzBarrier barrier = dvz_barrier(canvas->gpu);
     dvz_barrier_stages(&barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
     dvz_barrier_images(&barrier, images);
 
-    for (uint32_t i = 0; i < img_count; i++)
+    // Make the copied pixels visible to the host once the copy fence is signaled.
+    // NOTE: the barrier takes one region per command buffer, all of them spanning the whole buffer.
+    DvzBufferRegions br = dvz_buffer_regions(staging, 1, 0, staging->size, 0);
+    br.count = cmds->count;
+    DvzBarrier host_barrier = dvz_barrier(canvas->gpu);
+    dvz_barrier_stages(&host_barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+    dvz_barrier_buffer(&host_barrier, br);
+    dvz_barrier_buffer_access(&host_barrier, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT);
+
+    dvz_cmd_reset(cmds, idx);
+    dvz_cmd_begin(cmds, idx);
+
+    // Transition to SRC layout
+    dvz_barrier_images_layout(
+        &barrier, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    dvz_barrier_images_access(&barrier, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    dvz_cmd_barrier(cmds, idx, &barrier);
+
+    // Copy swapchain image to the tightly-packed staging buffer
+    dvz_cmd_copy_image_to_buffer(cmds, idx, images, staging);
+
+    // Transition back to previous layout
+    dvz_barrier_images_layout(
+        &barrier, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    dvz_barrier_images_access(&barrier, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    dvz_cmd_barrier(cmds, idx, &barrier);
+
+    dvz_cmd_barrier(cmds, idx, &host_barrier);
+    dvz_cmd_end(cmds, idx);
+}
+
+
+
+static void _screencast_slots_create(DvzScreencast* screencast)
+{
+    ASSERT(screencast != NULL);
+    DvzCanvas* canvas = screencast->canvas;
+    ASSERT(canvas != NULL);
+    DvzGpu* gpu = canvas->gpu;
+    ASSERT(gpu != NULL);
+
+    DvzImages* images = canvas->swapchain.images;
+    screencast->width = images->width;
+    screencast->height = images->height;
+    screencast->head = 0;
+    screencast->tail = 0;
+
+    DvzScreencastSlot* slot = NULL;
+    for (uint32_t i = 0; i < screencast->slot_count; i++)
     {
-        dvz_cmd_reset(&screencast->cmds, i);
-        dvz_cmd_begin(&screencast->cmds, i);
+        slot = &screencast->slots[i];
+        slot->staging = _screencast_buffer(gpu, images->width, images->height);
+
+        slot->fence = dvz_fences(gpu, 1, true);
+        slot->semaphore = dvz_semaphores(gpu, 1);
+
+        // NOTE: we predefine the transfer command buffers, one per swapchain image.
+        slot->cmds = dvz_commands(gpu, DVZ_DEFAULT_QUEUE_TRANSFER, images->count);
+        for (uint32_t j = 0; j < images->count; j++)
+            _screencast_record(canvas, &slot->cmds, j, &slot->staging);
+
+        slot->status = DVZ_SCREENCAST_IDLE;
+    }
+}
 
-        // Transition to SRC layout
-        dvz_barrier_images_layout(
-            &barrier, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-        dvz_barrier_images_access(
-            &barrier, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
-        dvz_cmd_barrier(&screencast->cmds, i, &barrier);
 
-        // Copy swapchain image to screencast image
-        dvz_cmd_copy_image(&screencast->cmds, i, images, &screencast->staging);
 
-        // Transition back to previous layout
-        dvz_barrier_images_layout(
-            &barrier, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
-        dvz_barrier_images_access(
-            &barrier, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
-        dvz_cmd_barrier(&screencast->cmds, i, &barrier);
+static void _screencast_slots_destroy(DvzScreencast* screencast)
+{
+    ASSERT(screencast != NULL);
 
-        dvz_cmd_end(&screencast->cmds, i);
+    DvzScreencastSlot* slot = NULL;
+    for (uint32_t i = 0; i < screencast->slot_count; i++)
+    {
+        slot = &screencast->slots[i];
+        // The in-flight copies must be finished before the staging buffers are destroyed.
+        dvz_fences_wait(&slot->fence, 0);
+        dvz_buffer_destroy(&slot->staging);
+        dvz_commands_destroy(&slot->cmds);
+        dvz_fences_destroy(&slot->fence);
+        dvz_semaphores_destroy(&slot->semaphore);
+        slot->status = DVZ_SCREENCAST_NONE;
     }
 }
 
@@ -1609,27 +1762,110 @@ static void _screencast_timer_callback(DvzCanvas* canvas, DvzEvent ev)
     ASSERT(screencast != NULL);
     ASSERT(screencast->canvas != NULL);
     ASSERT(screencast->canvas->gpu != NULL);
+    ASSERT(screencast->slot_count > 0);
     if (!screencast->is_active)
         return;
 
-    log_trace("screencast timer frame #%d", screencast->frame_idx);
+    // At most one copy per frame.
+    uint32_t n = screencast->slot_count;
+    if (screencast->slots[(screencast->head + n - 1) % n].status == DVZ_SCREENCAST_AWAIT_COPY)
+        return;
 
-    dvz_fences_wait(&screencast->fence, 0);
+    // Never wait for a slot: drop the frame if all slots are still in flight.
+    DvzScreencastSlot* slot = &screencast->slots[screencast->head];
+    if (slot->status != DVZ_SCREENCAST_IDLE)
+    {
+        log_trace("all screencast slots are busy, drop frame");
+        screencast->dropped++;
+        return;
+    }
 
-    DvzSubmit* submit = &screencast->submit;
-    dvz_submit_reset(submit);
-    dvz_submit_commands(submit, &screencast->cmds);
+    log_trace("screencast timer frame #%d in slot #%d", screencast->frame_idx, screencast->head);
+    _clock_set(&screencast->clock);
+    slot->frame_idx = screencast->frame_idx++;
+    slot->interval = screencast->clock.interval;
+
+    // The copy job will be sent right after the render job of the current frame.
+    slot->status = DVZ_SCREENCAST_AWAIT_COPY;
+    screencast->head = (screencast->head + 1) % n;
+}
 
-    // Wait for "image_ready" semaphore
-    dvz_submit_wait_semaphores(
-        submit, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, //
-        &canvas->sem_render_finished, canvas->cur_frame);
 
-    // Signal screencast_finished semaphore
-    dvz_submit_signal_semaphores(submit, &screencast->semaphore, 0);
 
-    // Send screencast cmd buf to transfer queue and signal screencast fence when submitting.
-    screencast->status = DVZ_SCREENCAST_AWAIT_COPY;
+static void _screencast_event(DvzCanvas* canvas, DvzScreencast* screencast, DvzScreencastSlot* slot)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(screencast != NULL);
+    ASSERT(slot != NULL);
+
+    uint32_t count = screencast->width * screencast->height;
+    const uint8_t* pixels = (const uint8_t*)slot->staging.mmap;
+    ASSERT(pixels != NULL);
+
+    DvzEvent sev = {0};
+    sev.type = DVZ_EVENT_SCREENCAST;
+    sev.u.sc.idx = slot->frame_idx;
+    sev.u.sc.interval = slot->interval;
+    sev.u.sc.width = screencast->width;
+    sev.u.sc.height = screencast->height;
+    sev.u.sc.flags = screencast->flags;
+
+    if ((screencast->flags & DVZ_SCREENCAST_FLAGS_RAW) != 0)
+    {
+        // Zero-copy: the callbacks read the staging buffer directly. The asynchronous callbacks
+        // get a copy, as the slot may be reused before they are called.
+        if (!_has_async_callbacks(canvas, DVZ_EVENT_SCREENCAST))
+        {
+            sev.u.sc.rgba = (uint8_t*)pixels;
+        }
+        else
+        {
+            sev.u.sc.rgba = malloc(4 * count);
+            memcpy(sev.u.sc.rgba, pixels, 4 * count);
+            sev.u.sc.flags &= ~DVZ_SCREENCAST_FLAGS_RAW;
+        }
+    }
+    else
+    {
+        bool has_alpha = (screencast->flags & DVZ_SCREENCAST_FLAGS_ALPHA) != 0;
+        // To be freed by the SCREENCAST event callback.
+        sev.u.sc.rgba = malloc(count * (has_alpha ? 4 : 3));
+        dvz_array_pixels(
+            sev.u.sc.rgba, pixels, count, _screencast_swizzle(canvas->swapchain.images),
+            has_alpha);
+    }
+
+    log_trace("send SCREENCAST event #%d", slot->frame_idx);
+    _event_produce(canvas, sev);
+}
+
+
+
+// Wait for the copies in flight and deliver them in frame order. A copy that has not been sent
+// yet is dropped.
+static void _screencast_flush(DvzCanvas* canvas, DvzScreencast* screencast)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(screencast != NULL);
+
+    uint32_t n = screencast->slot_count;
+    DvzScreencastSlot* slot = NULL;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        slot = &screencast->slots[screencast->tail];
+        if (slot->status == DVZ_SCREENCAST_AWAIT_TRANSFER)
+        {
+            dvz_fences_wait(&slot->fence, 0);
+            _screencast_event(canvas, screencast, slot);
+        }
+        else if (slot->status == DVZ_SCREENCAST_AWAIT_COPY)
+            screencast->dropped++;
+        else
+            break;
+        slot->status = DVZ_SCREENCAST_IDLE;
+        screencast->tail = (screencast->tail + 1) % n;
+    }
+    screencast->head = screencast->tail;
 }
 
 
@@ -1642,72 +1878,47 @@ static void _screencast_post_send(DvzCanvas* canvas, DvzEvent ev)
     ASSERT(screencast != NULL);
     ASSERT(screencast->canvas != NULL);
     ASSERT(screencast->canvas->gpu != NULL);
-    if (!screencast->is_active)
-        return;
 
-    uint32_t img_idx = canvas->swapchain.img_idx;
     // Always make sure the present semaphore is reset to its original value.
     canvas->present_semaphores = &canvas->sem_render_finished;
 
-    // Do nothing if the screencast image is not ready.
-    if (screencast->status <= DVZ_SCREENCAST_IDLE)
-        return;
-
-    log_trace("screencast event #%d", screencast->frame_idx);
+    uint32_t n = screencast->slot_count;
+    DvzScreencastSlot* slot = NULL;
 
-    // Send the copy job
-    if (screencast->status == DVZ_SCREENCAST_AWAIT_COPY)
+    // Deliver the completed copies in frame order, without blocking on the fences.
+    while (true)
     {
-        log_trace("screencast send");
-        // The copy job waits for the current image to be ready.
-        // It signals the screencast semaphore when the copy is done.
-        // The present swapchain command must wait for the screencast semaphore rather than
-        // the render_finished semaphore.
-        // HACK: do not wait when submitting at the first frame.
-        dvz_submit_send(&screencast->submit, img_idx, &screencast->fence, 0);
-        // canvas->frame_idx == 0 ? NULL : &screencast->fence, 0);
-
-        canvas->present_semaphores = &screencast->semaphore;
-        screencast->status = DVZ_SCREENCAST_AWAIT_TRANSFER;
+        slot = &screencast->slots[screencast->tail];
+        if (slot->status != DVZ_SCREENCAST_AWAIT_TRANSFER || !dvz_fences_ready(&slot->fence, 0))
+            break;
+        _screencast_event(canvas, screencast, slot);
+        slot->status = DVZ_SCREENCAST_IDLE;
+        screencast->tail = (screencast->tail + 1) % n;
     }
 
-    else if (screencast->status == DVZ_SCREENCAST_AWAIT_TRANSFER)
-    {
-        // if (!dvz_fences_ready(&screencast->fence, 0))
-        // {
-        //     log_trace("screencast await transfer but fence not ready");
-        //     return;
-        // }
-        // else
-        // {
-        //     log_trace("screencast await transfer and fence ready");
-        // }
-        dvz_fences_wait(&screencast->fence, 0);
+    // Send the copy job of the current frame, if any.
+    slot = &screencast->slots[(screencast->head + n - 1) % n];
+    if (slot->status != DVZ_SCREENCAST_AWAIT_COPY)
+        return;
 
-        // To be freed by the SCREENCAST event callback.
-        uint8_t* rgb_a =
-            calloc(screencast->staging.width * screencast->staging.height, 4 * sizeof(uint8_t));
+    log_trace("screencast send frame #%d", slot->frame_idx);
+    DvzSubmit* submit = &screencast->submit;
+    dvz_submit_reset(submit);
+    dvz_submit_commands(submit, &slot->cmds);
 
-        // Copy the image from the staging image to the CPU.
-        log_trace("screencast CPU download");
-        dvz_images_download(&screencast->staging, 0, true, screencast->has_alpha, rgb_a);
+    // The copy job waits for the current image to be rendered.
+    dvz_submit_wait_semaphores(
+        submit, VK_PIPELINE_STAGE_TRANSFER_BIT, //
+        &canvas->sem_render_finished, canvas->cur_frame);
 
-        // Enqueue a special SCREENCAST public event with a pointer to the CPU buffer user
-        DvzEvent sev = {0};
-        sev.type = DVZ_EVENT_SCREENCAST;
-        sev.u.sc.idx = screencast->frame_idx;
-        sev.u.sc.interval = screencast->clock.interval;
-        sev.u.sc.rgba = rgb_a;
-        sev.u.sc.width = screencast->staging.width;
-        sev.u.sc.height = screencast->staging.height;
-        log_trace("send SCREENCAST event");
-        _event_produce(canvas, sev);
+    // It signals the slot semaphore when the copy is done, and the slot fence for the host.
+    dvz_submit_signal_semaphores(submit, &slot->semaphore, 0);
+    dvz_submit_send(submit, canvas->swapchain.img_idx, &slot->fence, 0);
 
-        // Reset screencast status.
-        _clock_set(&screencast->clock);
-        screencast->status = DVZ_SCREENCAST_IDLE;
-        screencast->frame_idx++;
-    }
+    // The present swapchain command must wait for the slot semaphore rather than the
+    // render_finished semaphore.
+    canvas->present_semaphores = &slot->semaphore;
+    slot->status = DVZ_SCREENCAST_AWAIT_TRANSFER;
 }
 
 
@@ -1721,13 +1932,10 @@ static void _screencast_resize(DvzCanvas* canvas, DvzEvent ev)
     ASSERT(screencast->canvas != NULL);
     ASSERT(screencast->canvas->gpu != NULL);
 
-    screencast->status = DVZ_SCREENCAST_NONE;
-    dvz_images_resize(
-        &screencast->staging, canvas->swapchain.images->width, canvas->swapchain.images->height,
-        canvas->swapchain.images->depth);
-    dvz_images_transition(&screencast->staging);
-
-    _screencast_cmds(screencast);
+    // The frames in flight are delivered with the previous size.
+    _screencast_flush(canvas, screencast);
+    _screencast_slots_destroy(screencast);
+    _screencast_slots_create(screencast);
 }
 
 
@@ -1741,40 +1949,40 @@ static void _screencast_destroy(DvzCanvas* canvas, DvzEvent ev)
 
 
 void dvz_screencast(DvzCanvas* canvas, double interval, bool has_alpha)
+{
+    dvz_screencast_readback(
+        canvas, interval, DVZ_SCREENCAST_SLOTS,
+        has_alpha ? DVZ_SCREENCAST_FLAGS_ALPHA : DVZ_SCREENCAST_FLAGS_NONE);
+}
+
+
+
+void dvz_screencast_readback(DvzCanvas* canvas, double interval, uint32_t slot_count, int flags)
 {
     ASSERT(canvas != NULL);
     ASSERT(canvas->gpu != NULL);
-
-    DvzGpu* gpu = canvas->gpu;
-    DvzImages* images = canvas->swapchain.images;
+    if (canvas->screencast != NULL)
+    {
+        log_error("the canvas already has a screencast");
+        return;
+    }
+    ASSERT(slot_count > 0);
+    if (slot_count > DVZ_MAX_SCREENCAST_SLOTS)
+    {
+        log_warn(
+            "clipping the number of screencast slots from %d to %d", slot_count,
+            DVZ_MAX_SCREENCAST_SLOTS);
+        slot_count = DVZ_MAX_SCREENCAST_SLOTS;
+    }
 
     canvas->screencast = calloc(1, sizeof(DvzScreencast));
     DvzScreencast* sc = canvas->screencast;
     sc->is_active = true;
     sc->canvas = canvas;
-    sc->has_alpha = has_alpha;
-
-    sc->staging = dvz_images(canvas->gpu, VK_IMAGE_TYPE_2D, 1);
-    dvz_images_format(&sc->staging, images->format);
-    dvz_images_size(&sc->staging, images->width, images->height, images->depth);
-    dvz_images_tiling(&sc->staging, VK_IMAGE_TILING_LINEAR);
-    dvz_images_usage(&sc->staging, VK_IMAGE_USAGE_TRANSFER_DST_BIT);
-    dvz_images_layout(&sc->staging, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-    dvz_images_memory(
-        &sc->staging, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    dvz_images_create(&sc->staging);
-
-    // Transition the staging image to its layout.
-    dvz_images_transition(&sc->staging);
-
-    sc->fence = dvz_fences(gpu, 1, true);
-    ASSERT(dvz_fences_ready(&sc->fence, 0));
-    sc->semaphore = dvz_semaphores(gpu, 1);
-
-    // NOTE: we predefine the transfer command buffers, one per swapchain image.
-    sc->cmds =
-        dvz_commands(canvas->gpu, DVZ_DEFAULT_QUEUE_TRANSFER, canvas->swapchain.images->count);
-    _screencast_cmds(sc);
+    sc->flags = flags;
+    sc->slot_count = slot_count;
+
+    _screencast_slots_create(sc);
     sc->submit = dvz_submit(canvas->gpu);
 
     _clock_init(&sc->clock);
@@ -1802,9 +2010,10 @@ void dvz_screencast_destroy(DvzCanvas* canvas)
     if (!dvz_obj_is_created(&screencast->obj))
         return;
 
-    dvz_fences_destroy(&screencast->fence);
-    dvz_semaphores_destroy(&screencast->semaphore);
-    dvz_images_destroy(&screencast->staging);
+    _screencast_flush(canvas, screencast);
+    if (screencast->dropped > 0)
+        log_debug("%d screencast frame(s) were dropped", screencast->dropped);
+    _screencast_slots_destroy(screencast);
 
     dvz_obj_destroyed(&screencast->obj);
     FREE(screencast);
@@ -1836,59 +2045,25 @@ uint8_t* dvz_screenshot(DvzCanvas* canvas, bool has_alpha)
     ASSERT(canvas != NULL);
     if (canvas->app->is_running)
     {
-        log_error("cannot do screenshot while the canvas is running for now");
+        log_error("cannot do screenshot while the canvas is running, use a screencast instead");
         return NULL;
     }
 
-    // TODO: more efficient screenshot saving with screencast
     DvzGpu* gpu = canvas->gpu;
+    DvzImages* images = canvas->swapchain.images;
+    DvzBuffer staging = _screencast_buffer(gpu, images->width, images->height);
 
+    // Copy from the swapchain image to the staging buffer, once the rendering is done.
     dvz_gpu_wait(gpu);
-    DvzImages* images = canvas->swapchain.images;
-    DvzImages staging = dvz_images(canvas->gpu, VK_IMAGE_TYPE_2D, 1);
-
-    // Staging images.
-    {
-        dvz_images_format(&staging, images->format);
-        dvz_images_size(&staging, images->width, images->height, images->depth);
-        dvz_images_tiling(&staging, VK_IMAGE_TILING_LINEAR);
-        dvz_images_usage(&staging, VK_IMAGE_USAGE_TRANSFER_DST_BIT);
-        dvz_images_layout(&staging, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        dvz_images_memory(
-            &staging, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        dvz_images_create(&staging);
-        dvz_images_transition(&staging);
-    }
-
-    // Copy from the swapchain image to the staging image.
-    {
-        DvzBarrier barrier = dvz_barrier(canvas->gpu);
-        dvz_barrier_stages(
-            &barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
-        dvz_barrier_images(&barrier, images);
-        DvzCommands* cmds = &canvas->cmds_transfer;
-        dvz_cmd_reset(cmds, 0);
-        dvz_cmd_begin(cmds, 0);
-        dvz_barrier_images_layout(
-            &barrier, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
-        dvz_barrier_images_access(
-            &barrier, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
-        dvz_cmd_barrier(cmds, 0, &barrier);
-        dvz_cmd_copy_image(cmds, 0, images, &staging);
-        dvz_barrier_images_layout(
-            &barrier, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
-        dvz_barrier_images_access(
-            &barrier, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
-        dvz_cmd_barrier(cmds, 0, &barrier);
-        dvz_cmd_end(cmds, 0);
-        dvz_cmd_submit_sync(cmds, 0);
-    }
+    _screencast_record(canvas, &canvas->cmds_transfer, 0, &staging);
+    dvz_cmd_submit_sync(&canvas->cmds_transfer, 0);
 
     // Make the screenshot.
-    uint8_t* rgba = calloc(staging.width * staging.height, (has_alpha ? 4 : 3) * sizeof(uint8_t));
-    dvz_images_download(&staging, 0, true, has_alpha, rgba);
-    dvz_gpu_wait(gpu);
-    dvz_images_destroy(&staging);
+    uint32_t count = images->width * images->height;
+    uint8_t* rgba = malloc(count * (has_alpha ? 4 : 3));
+    dvz_array_pixels(
+        rgba, (const uint8_t*)staging.mmap, count, _screencast_swizzle(images), has_alpha);
+    dvz_buffer_destroy(&staging);
     // NOTE: the caller MUST free the returned pointer.
     return rgba;
 }
@@ -1899,32 +2074,158 @@ uint8_t* dvz_screenshot(DvzCanvas* canvas, bool has_alpha)
 /*  Video screencast                                                                             */
 /*************************************************************************************************/
 
+static void _video_stats_drop(DvzVideo* video)
+{
+    ASSERT(video != NULL);
+    pthread_mutex_lock(&video->lock);
+    video->stats.dropped++;
+    pthread_mutex_unlock(&video->lock);
+}
+
+
+
+static void* _video_thread(void* user_data)
+{
+    DvzVideo* video = (DvzVideo*)user_data;
+    ASSERT(video != NULL);
+    Video* encoder = (Video*)video->encoder;
+    ASSERT(encoder != NULL);
+
+    // NOTE: local copy as _clock_get() modifies the clock.
+    DvzClock clock = video->clock;
+    DvzVideoFrame* frame = NULL;
+    double latency = 0;
+
+    // A NULL frame stops the thread, once all previous frames have been encoded.
+    while ((frame = (DvzVideoFrame*)dvz_fifo_dequeue(&video->queue, true)) != NULL)
+    {
+        // Create the video if needed.
+        if (encoder->ost == NULL)
+            create_video(encoder);
+        if (encoder->ost != NULL)
+            add_frame_at(encoder, frame->pixels, (int64_t)frame->idx);
+
+        latency = _clock_get(&clock) - frame->time;
+        pthread_mutex_lock(&video->lock);
+        video->stats.encoded++;
+        video->latency_sum += latency;
+        video->stats.latency = video->latency_sum / video->stats.encoded;
+        video->stats.latency_max = MAX(video->stats.latency_max, latency);
+        pthread_mutex_unlock(&video->lock);
+
+        // Recycle the frame buffer.
+        dvz_fifo_enqueue(&video->pool, frame);
+    }
+    return NULL;
+}
+
+
+
+static void _video_start(DvzVideo* video, VkDeviceSize frame_size)
+{
+    ASSERT(video != NULL);
+    ASSERT(frame_size > 0);
+    ASSERT(0 < video->frame_count && video->frame_count <= DVZ_MAX_VIDEO_FRAMES);
+    log_debug(
+        "start video encoder thread with %d frame buffers of %s", video->frame_count,
+        pretty_size(frame_size));
+
+    video->frame_size = frame_size;
+    for (uint32_t i = 0; i < video->frame_count; i++)
+    {
+        video->frames[i].pixels = malloc(frame_size);
+        dvz_fifo_enqueue(&video->pool, &video->frames[i]);
+    }
+    video->thread = dvz_thread(_video_thread, video);
+    dvz_obj_created(&video->obj);
+}
+
+
+
+static void _video_stop(DvzVideo* video)
+{
+    ASSERT(video != NULL);
+    Video* encoder = (Video*)video->encoder;
+    ASSERT(encoder != NULL);
+
+    if (dvz_obj_is_created(&video->obj))
+    {
+        // Encode the pending frames and stop the encoder thread.
+        dvz_fifo_enqueue(&video->queue, NULL);
+        dvz_thread_join(&video->thread);
+        for (uint32_t i = 0; i < video->frame_count; i++)
+            FREE(video->frames[i].pixels);
+        log_debug(
+            "video: %d frame(s) encoded, %d dropped, average latency %.1f ms",
+            (int)video->stats.encoded, (int)video->stats.dropped, 1000 * video->stats.latency);
+    }
+
+    // This call frees the encoder.
+    if (encoder->ost != NULL)
+        end_video(encoder);
+    else
+        FREE(encoder);
+
+    dvz_fifo_destroy(&video->queue);
+    dvz_fifo_destroy(&video->pool);
+    pthread_mutex_destroy(&video->lock);
+    dvz_obj_destroyed(&video->obj);
+    FREE(video);
+}
+
+
+
 static void _video_callback(DvzCanvas* canvas, DvzEvent ev)
 {
     ASSERT(canvas != NULL);
     log_debug("video frame #%d", ev.u.sc.idx);
 
-    Video* video = (Video*)canvas->screencast->user_data;
+    if (canvas->screencast == NULL)
+        return;
+    DvzVideo* video = (DvzVideo*)canvas->screencast->user_data;
     if (video == NULL)
         return;
     ASSERT(video != NULL);
 
-    // Create the video if needed.
-    if (video->ost == NULL)
+    // Start the encoder thread at the first frame.
+    VkDeviceSize size = 4 * ev.u.sc.width * ev.u.sc.height;
+    if (!dvz_obj_is_created(&video->obj))
+        _video_start(video, size);
+    if (size != video->frame_size)
+    {
+        log_warn("skip video frame as the canvas has been resized");
+        _video_stats_drop(video);
+        return;
+    }
+
+    // Take a free frame buffer, or drop the frame if the encoder lags behind.
+    DvzVideoFrame* frame =
+        (DvzVideoFrame*)dvz_fifo_dequeue(&video->pool, video->policy == DVZ_VIDEO_POLICY_BLOCK);
+    if (frame == NULL)
     {
-        create_video(video);
+        log_trace("video frame queue full, drop frame #%d", ev.u.sc.idx);
+        _video_stats_drop(video);
+        return;
     }
-    ASSERT(video->ost != NULL);
 
-    add_frame(video, ev.u.sc.rgba);
-    FREE(ev.u.sc.rgba);
+    // NOTE: the raw screencast image is only valid during this callback.
+    DvzClock clock = video->clock;
+    memcpy(frame->pixels, ev.u.sc.rgba, size);
+    frame->idx = ev.u.sc.idx;
+    frame->time = _clock_get(&clock);
+    dvz_fifo_enqueue(&video->queue, frame);
 }
 
 static void _video_destroy(DvzCanvas* canvas, DvzEvent ev)
 {
     ASSERT(canvas != NULL);
     if (canvas->screencast != NULL && canvas->screencast->user_data != NULL)
-        end_video((Video*)canvas->screencast->user_data);
+    {
+        // The last frames are encoded before the encoder stops.
+        _screencast_flush(canvas, canvas->screencast);
+        _video_stop((DvzVideo*)canvas->screencast->user_data);
+        canvas->screencast->user_data = NULL;
+    }
 }
 
 
@@ -1932,17 +2233,37 @@ static void _video_destroy(DvzCanvas* canvas, DvzEvent ev)
 void dvz_canvas_video(DvzCanvas* canvas, int framerate, int bitrate, const char* path, bool record)
 {
     ASSERT(canvas != NULL);
+    if (canvas->screencast != NULL)
+    {
+        log_error("cannot record a video, the canvas already has a screencast");
+        return;
+    }
     uvec2 size;
     dvz_canvas_size(canvas, DVZ_CANVAS_SIZE_FRAMEBUFFER, size);
-    Video* video = init_video(path, (int)size[0], (int)size[1], framerate, bitrate);
-    if (video == NULL)
+    Video* encoder = init_video(path, (int)size[0], (int)size[1], framerate, bitrate);
+    if (encoder == NULL)
         return;
+    // The encoder converts the swapchain images directly.
+    encoder->bgra = _screencast_swizzle(canvas->swapchain.images);
+
+    DvzVideo* video = calloc(1, sizeof(DvzVideo));
+    dvz_obj_init(&video->obj);
+    video->encoder = encoder;
+    video->policy = DVZ_VIDEO_POLICY_DROP;
+    video->frame_count = DVZ_VIDEO_QUEUE_SIZE;
+    video->queue = dvz_fifo_lockfree(DVZ_MAX_VIDEO_FRAMES, DVZ_FIFO_MODE_SPSC);
+    video->pool = dvz_fifo_lockfree(DVZ_MAX_VIDEO_FRAMES, DVZ_FIFO_MODE_SPSC);
+    if (pthread_mutex_init(&video->lock, NULL) != 0)
+        log_error("mutex creation failed");
+    _clock_init(&video->clock);
 
     dvz_event_callback(
         canvas, DVZ_EVENT_SCREENCAST, 0, DVZ_EVENT_MODE_SYNC, _video_callback, NULL);
     dvz_event_callback(canvas, DVZ_EVENT_DESTROY, 0, DVZ_EVENT_MODE_SYNC, _video_destroy, NULL);
 
-    dvz_screencast(canvas, 1. / framerate, true);
+    // Zero-copy readback: the images are copied once, into the recycled frame buffers.
+    dvz_screencast_readback(
+        canvas, 1. / framerate, DVZ_SCREENCAST_SLOTS, DVZ_SCREENCAST_FLAGS_RAW);
     ASSERT(canvas->screencast != NULL);
     canvas->screencast->is_active = record;
     canvas->screencast->user_data = video;
@@ -1950,6 +2271,47 @@ void dvz_canvas_video(DvzCanvas* canvas, int framerate, int bitrate, const char*
 
 
 
+void dvz_canvas_video_policy(DvzCanvas* canvas, uint32_t queue_size, DvzVideoPolicy policy)
+{
+    ASSERT(canvas != NULL);
+    DvzVideo* video =
+        canvas->screencast != NULL ? (DvzVideo*)canvas->screencast->user_data : NULL;
+    if (video == NULL)
+    {
+        log_error("cannot set the video policy, there is no video");
+        return;
+    }
+    video->policy = policy;
+    if (dvz_obj_is_created(&video->obj))
+    {
+        log_warn("cannot change the video frame queue size once the record has started");
+        return;
+    }
+    video->frame_count = CLIP(queue_size, 1, DVZ_MAX_VIDEO_FRAMES);
+}
+
+
+
+DvzVideoStats dvz_canvas_video_stats(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    DvzVideoStats stats = {0};
+    DvzVideo* video =
+        canvas->screencast != NULL ? (DvzVideo*)canvas->screencast->user_data : NULL;
+    if (video == NULL)
+        return stats;
+
+    pthread_mutex_lock(&video->lock);
+    stats = video->stats;
+    pthread_mutex_unlock(&video->lock);
+    if (dvz_obj_is_created(&video->obj))
+        stats.queue_depth = (uint32_t)dvz_fifo_size(&video->queue);
+    stats.dropped += canvas->screencast->dropped;
+    return stats;
+}
+
+
+
 void dvz_canvas_pause(DvzCanvas* canvas, bool record)
 {
     ASSERT(canvas != NULL);
@@ -1977,24 +2339,83 @@ void dvz_canvas_stop(DvzCanvas* canvas)
     ASSERT(canvas->screencast != NULL);
     canvas->screencast->is_active = false;
     ASSERT(canvas->screencast->user_data != NULL);
-    // This call frees the pointer.
+    // This call waits for the pending frames to be encoded and frees the pointer.
     log_info("stop screencast");
-    end_video((Video*)canvas->screencast->user_data);
+    _video_stop((DvzVideo*)canvas->screencast->user_data);
     canvas->screencast->user_data = NULL;
 }
 
 
 
+/*************************************************************************************************/
+/*  Profiling                                                                                    */
+/*************************************************************************************************/
+
+void dvz_canvas_profile(DvzCanvas* canvas, uint32_t capacity)
+{
+    ASSERT(canvas != NULL);
+    if (canvas->profiler != NULL)
+    {
+        log_warn("the profiler is already enabled");
+        return;
+    }
+    log_info("enable the frame profiler");
+
+    DvzProfiler* prof = (DvzProfiler*)calloc(1, sizeof(DvzProfiler));
+    *prof = dvz_profiler(canvas->gpu, capacity);
+    dvz_profiler_render(prof, DVZ_DEFAULT_QUEUE_RENDER, canvas->cmds_render.count);
+    if (dvz_obj_is_created(&canvas->staging.obj) &&
+        dvz_profiler_transfer(prof, DVZ_DEFAULT_QUEUE_TRANSFER))
+        canvas->staging.profiler = prof;
+    canvas->profiler = prof;
+}
+
+
+
+int dvz_canvas_profile_dump(DvzCanvas* canvas, const char* path)
+{
+    ASSERT(canvas != NULL);
+    if (canvas->profiler == NULL)
+    {
+        log_error("the profiler is not enabled, call dvz_canvas_profile() first");
+        return 1;
+    }
+    return dvz_profiler_dump(canvas->profiler, path);
+}
+
+
+
 /*************************************************************************************************/
 /*  Event loop                                                                                   */
 /*************************************************************************************************/
 
+// Record the CPU time of a frame phase, and add it to the profiler if it is enabled.
+static inline double
+_phase_end(DvzCanvas* canvas, DvzFramePhase phase, const char* name, double start)
+{
+    double end = _clock_now();
+    canvas->phase_time[phase] = end - start;
+    if (canvas->profiler != NULL)
+        dvz_profiler_event(canvas->profiler, DVZ_PROFILE_CPU, name, start, end - start);
+    return end;
+}
+
+
+
 void dvz_canvas_frame(DvzCanvas* canvas)
 {
     ASSERT(canvas != NULL);
     ASSERT(canvas->app != NULL);
     ASSERT(canvas->gpu != NULL);
 
+    double t0 = _clock_now(), t = t0;
+    // The scene phase is only measured when the scene FRAME callback runs.
+    canvas->phase_time[DVZ_FRAME_PHASE_SCENE] = 0;
+
+    // Flush the profiler counters of the previous frame and read the GPU timestamps.
+    if (canvas->profiler != NULL)
+        dvz_profiler_frame(canvas->profiler, canvas->frame_idx);
+
     // Update the global and local clocks.
     // These calls update canvas->clock.elapsed and canvas->clock.interval, the latter is
     // the delay since the last frame.
@@ -2015,15 +2436,21 @@ void dvz_canvas_frame(DvzCanvas* canvas)
     // Call TIMER callbacks, in the main thread.
     _event_timer(canvas);
 
+    t = _phase_end(canvas, DVZ_FRAME_PHASE_EVENTS, "events", t);
+
     // Refill all command buffers at the first iteration.
     if (canvas->frame_idx == 0)
         dvz_canvas_to_refill(canvas);
 
     // Pending transfers.
     dvz_process_transfers(canvas);
+    t = _phase_end(canvas, DVZ_FRAME_PHASE_TRANSFERS, "transfers", t);
 
     // Refill if needed, only 1 swapchain command buffer per frame to avoid waiting on the device.
     _refill_frame(canvas);
+    _phase_end(canvas, DVZ_FRAME_PHASE_REFILL, "refill", t);
+
+    _phase_end(canvas, DVZ_FRAME_PHASE_FRAME, "frame", t0);
 }
 
 
@@ -2037,6 +2464,9 @@ void dvz_canvas_frame_submit(DvzCanvas* canvas)
     DvzSubmit* s = &canvas->submit;
     uint32_t f = canvas->cur_frame;
     uint32_t img_idx = canvas->swapchain.img_idx;
+    DvzProfiler* prof = canvas->profiler;
+    bool gpu_timing = prof != NULL && prof->has_gpu[DVZ_PROFILE_GPU_RENDER];
+    double t0 = _clock_now(), t = 0;
 
     // Keep track of the fence associated to the current swapchain image.
     dvz_fences_copy(
@@ -2047,9 +2477,17 @@ void dvz_canvas_frame_submit(DvzCanvas* canvas)
     dvz_submit_reset(s);
 
     // Add the command buffers to the submit instance.
+    // GPU timestamps before the render commands, when profiling.
+    if (gpu_timing)
+        dvz_submit_commands(s, &prof->cmds_begin);
+
     // Default render commands.
     if (canvas->cmds_render.obj.status == DVZ_OBJECT_STATUS_CREATED)
+    {
         dvz_submit_commands(s, &canvas->cmds_render);
+        dvz_profile_count(
+            prof, DVZ_PROFILE_COUNTER_DRAWS, canvas->cmds_render.draw_count[img_idx]);
+    }
 
     // // Extra render commands.
     // DvzCommands* cmds = dvz_container_iter(&canvas->commands);
@@ -2063,11 +2501,22 @@ void dvz_canvas_frame_submit(DvzCanvas* canvas)
     //         dvz_submit_commands(s, cmds);
     //     cmds = dvz_container_iter(&canvas->commands);
     // }
-    if (s->commands_count == 0)
+    if (s->commands_count == (gpu_timing ? 1 : 0))
     {
         log_error("no recorded command buffers");
         return;
     }
+    if (gpu_timing)
+        dvz_submit_commands(s, &prof->cmds_end);
+
+    // Wait for the staged uploads of this frame before rendering.
+    if (canvas->staging.signaled)
+    {
+        dvz_submit_wait_semaphores(
+            s, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, //
+            &canvas->staging.semaphores, canvas->staging.signaled_idx);
+        canvas->staging.signaled = false;
+    }
 
     if (!canvas->offscreen)
     {
@@ -2085,7 +2534,11 @@ void dvz_canvas_frame_submit(DvzCanvas* canvas)
         _event_presend(canvas);
 
         // Send the Submit instance.
+        t = dvz_profile_start(prof);
         dvz_submit_send(s, img_idx, &canvas->fences_render_finished, f);
+        dvz_profile_end(prof, "queue_submit", t);
+        if (gpu_timing)
+            dvz_profiler_gpu_submitted(prof, DVZ_PROFILE_GPU_RENDER, img_idx);
 
         // Call POST_SEND callbacks
         _event_postsend(canvas);
@@ -2095,11 +2548,16 @@ void dvz_canvas_frame_submit(DvzCanvas* canvas)
     // The semaphore used for waiting during presentation may be changed by the canvas
     // callbacks.
     if (!canvas->offscreen)
+    {
+        t = dvz_profile_start(prof);
         dvz_swapchain_present(
             &canvas->swapchain, 1, //
             canvas->present_semaphores, CLIP(f, 0, canvas->present_semaphores->count - 1));
+        dvz_profile_end(prof, "present", t);
+    }
 
     canvas->cur_frame = (f + 1) % canvas->fences_render_finished.count;
+    _phase_end(canvas, DVZ_FRAME_PHASE_SUBMIT, "submit", t0);
 }
 
 
@@ -2188,7 +2646,7 @@ void dvz_app_run(DvzApp* app, uint64_t frame_count)
                     log_error("resizing is not supported during a screencast");
 
                 // Refill the canvas after the DvzViewport has been updated.
-                // _refill_canvas(canvas, UINT32_MAX);
+                // _refill_canvas(canvas, UINT32_MAX, true);
                 dvz_canvas_to_refill(canvas);
 
                 n_canvas_active++;
@@ -2297,18 +2755,37 @@ void dvz_canvas_destroy(DvzCanvas* canvas)
     ASSERT(canvas != NULL);
     ASSERT(canvas->gpu != NULL);
     dvz_gpu_wait(canvas->gpu);
+    // The screencast frames in flight are delivered while the event thread is still running.
+    if (canvas->screencast != NULL && dvz_obj_is_created(&canvas->screencast->obj))
+        _screencast_flush(canvas, canvas->screencast);
     dvz_event_stop(canvas);
     dvz_thread_join(&canvas->event_thread);
     dvz_fifo_destroy(&canvas->event_queue);
 
     // Destroy the transfers queue.
     dvz_fifo_destroy(&canvas->transfers);
+    dvz_transfer_pool_destroy(&canvas->transfer_pool);
+    dvz_staging_ring_destroy(&canvas->staging);
+
+    // Destroy the profiler, and write the trace file if requested.
+    if (canvas->profiler != NULL)
+    {
+        const char* path = getenv("DVZ_PROFILE");
+        if (path != NULL && strlen(path) > 0)
+            dvz_profiler_dump(canvas->profiler, path);
+        dvz_profiler_destroy(canvas->profiler);
+        FREE(canvas->profiler);
+    }
 
     // Destroy callbacks.
     _destroy_callbacks(canvas);
 
     // Destroy the graphics.
     log_trace("canvas destroy graphics pipelines");
+    for (uint32_t i = 0; i < canvas->graphics_ref_count; i++)
+        dvz_graphics_release(canvas->gpu->context, canvas->graphics_refs[i]);
+    FREE(canvas->graphics_refs);
+    canvas->graphics_ref_count = 0;
     CONTAINER_DESTROY_ITEMS(DvzGraphics, canvas->graphics, dvz_graphics_destroy)
     dvz_container_destroy(&canvas->graphics);
 
@@ -1,5 +1,6 @@
 #include "../include/datoviz/context.h"
 #include "../include/datoviz/atlas.h"
+#include "../include/datoviz/glyphs.h"
 #include "vklite_utils.h"
 #include <stdlib.h>
 
@@ -9,6 +10,148 @@
 /*  Context                                                                                      */
 /*************************************************************************************************/
 
+// Header of the pipeline cache files, identifying the device and driver that wrote them.
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint32_t driver_version;
+    uint8_t uuid[VK_UUID_SIZE];
+    uint64_t size; // size of the pipeline cache data following the header
+    uint64_t hash; // hash of the pipeline cache data
+} DvzPipelineCacheHeader;
+
+
+
+// FNV-1a hash, to detect truncated or corrupted cache files.
+static uint64_t _hash(const uint8_t* data, size_t size)
+{
+    return dvz_hash(DVZ_HASH_SEED, data, size);
+}
+
+
+
+static DvzPipelineCacheHeader _pipeline_cache_header(DvzGpu* gpu, size_t size, const void* data)
+{
+    ASSERT(gpu != NULL);
+    DvzPipelineCacheHeader header = {0};
+    header.magic = DVZ_PIPELINE_CACHE_MAGIC;
+    header.version = DVZ_PIPELINE_CACHE_VERSION;
+    header.vendor_id = gpu->device_properties.vendorID;
+    header.device_id = gpu->device_properties.deviceID;
+    header.driver_version = gpu->device_properties.driverVersion;
+    memcpy(header.uuid, gpu->device_properties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.size = size;
+    header.hash = data != NULL ? _hash((const uint8_t*)data, size) : 0;
+    return header;
+}
+
+
+
+// Load the pipeline cache file, return whether it was valid.
+static bool _pipeline_cache_load(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    DvzGpu* gpu = context->gpu;
+    const char* path = context->pipeline_cache_path;
+    ASSERT(strlen(path) > 0);
+
+    // A missing file is expected on the first run.
+    FILE* f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        log_debug("no pipeline cache found at %s", path);
+        return false;
+    }
+
+    DvzPipelineCacheHeader header = {0};
+    DvzPipelineCacheHeader expected = _pipeline_cache_header(gpu, 0, NULL);
+    void* data = NULL;
+    bool valid = fread(&header, sizeof(header), 1, f) == 1 &&
+                 header.magic == expected.magic && header.version == expected.version &&
+                 header.vendor_id == expected.vendor_id &&
+                 header.device_id == expected.device_id &&
+                 header.driver_version == expected.driver_version &&
+                 memcmp(header.uuid, expected.uuid, VK_UUID_SIZE) == 0 && header.size > 0;
+
+    // The data size comes from the file, it must match the number of bytes after the header.
+    if (valid)
+    {
+        long pos = ftell(f);
+        valid = pos >= 0 && fseek(f, 0, SEEK_END) == 0;
+        long end = valid ? ftell(f) : -1;
+        valid = valid && end >= pos && (uint64_t)(end - pos) == (uint64_t)header.size &&
+                fseek(f, pos, SEEK_SET) == 0;
+    }
+    if (valid)
+    {
+        data = malloc(header.size);
+        if (data == NULL)
+            log_error("unable to allocate %d bytes for the pipeline cache", (int)header.size);
+        valid = data != NULL && fread(data, header.size, 1, f) == 1 &&
+                _hash((const uint8_t*)data, header.size) == header.hash;
+    }
+    fclose(f);
+
+    // The invalid file is removed, so that it is never kept if the cache is not saved again.
+    if (!valid)
+    {
+        log_warn("discarding invalid or outdated pipeline cache %s", path);
+        remove(path);
+    }
+    else
+        valid = dvz_gpu_pipeline_cache(gpu, header.size, data);
+    if (valid)
+        log_debug("loaded pipeline cache from %s (%d bytes)", path, (int)header.size);
+    FREE(data);
+    return valid;
+}
+
+
+
+// Save the pipeline cache file. The file is written under a temporary name and renamed, so that
+// concurrent processes sharing the same cache never read a partially written file.
+static void _pipeline_cache_save(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    DvzGpu* gpu = context->gpu;
+    const char* path = context->pipeline_cache_path;
+    ASSERT(strlen(path) > 0);
+
+    size_t size = 0;
+    void* data = dvz_gpu_pipeline_cache_data(gpu, &size);
+    if (data == NULL)
+        return;
+    DvzPipelineCacheHeader header = _pipeline_cache_header(gpu, size, data);
+
+    char tmp[1040] = {0};
+    snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+    FILE* f = fopen(tmp, "wb");
+    if (f == NULL)
+    {
+        log_warn("unable to write the pipeline cache to %s", tmp);
+        FREE(data);
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(data, size, 1, f) == 1;
+    ok = fclose(f) == 0 && ok;
+    // NOTE: rename() does not replace an existing file on Windows.
+    if (ok && rename(tmp, path) != 0)
+        ok = remove(path) == 0 && rename(tmp, path) == 0;
+    if (ok)
+        log_debug("saved pipeline cache to %s (%d bytes)", path, (int)size);
+    else
+    {
+        log_warn("unable to write the pipeline cache to %s", path);
+        remove(tmp);
+    }
+    FREE(data);
+}
+
+
+
 static void _context_default_queues(DvzGpu* gpu, DvzWindow* window)
 {
     dvz_gpu_queue(gpu, DVZ_DEFAULT_QUEUE_TRANSFER, DVZ_QUEUE_TRANSFER);
@@ -89,7 +232,10 @@ static void _context_default_buffers(DvzContext* context)
         ASSERT(buffer != NULL);
         dvz_buffer_type(buffer, DVZ_BUFFER_TYPE_STORAGE);
         dvz_buffer_size(buffer, DVZ_BUFFER_TYPE_STORAGE_SIZE);
-        dvz_buffer_usage(buffer, transferable | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+        // The storage buffer also holds the indirect draw commands.
+        dvz_buffer_usage(
+            buffer, transferable | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
         dvz_buffer_memory(buffer, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
         dvz_buffer_create(buffer);
         ASSERT(dvz_obj_is_created(&buffer->obj));
@@ -113,7 +259,11 @@ static void _context_default_buffers(DvzContext* context)
         ASSERT(buffer != NULL);
         dvz_buffer_type(buffer, DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE);
         dvz_buffer_size(buffer, DVZ_BUFFER_TYPE_UNIFORM_SIZE);
-        dvz_buffer_usage(buffer, transferable | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+        // The mappable buffer also holds the indirect draw commands of the batched visuals,
+        // which are written by the CPU when the command buffers are recorded.
+        dvz_buffer_usage(
+            buffer, transferable | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+                        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
         dvz_buffer_memory(
             buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
         dvz_buffer_create(buffer);
@@ -122,6 +272,18 @@ static void _context_default_buffers(DvzContext* context)
         // Permanently map the buffer.
         buffer->mmap = dvz_buffer_map(buffer, 0, VK_WHOLE_SIZE);
     }
+
+    // Region allocators, uniform buffer regions need to be aligned.
+    VkDeviceSize alignment = 0;
+    for (uint32_t i = 0; i < DVZ_BUFFER_TYPE_COUNT; i++)
+    {
+        buffer = dvz_container_get(&context->buffers, i);
+        ASSERT(buffer != NULL);
+        alignment = 0;
+        if (i == DVZ_BUFFER_TYPE_UNIFORM || i == DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE)
+            alignment = context->gpu->device_properties.limits.minUniformBufferOffsetAlignment;
+        context->allocators[i] = dvz_alloc(buffer->size, alignment);
+    }
 }
 
 
@@ -132,6 +294,8 @@ static void _destroy_resources(DvzContext* context)
 
     log_trace("context destroy buffers");
     CONTAINER_DESTROY_ITEMS(DvzBuffer, context->buffers, dvz_buffer_destroy)
+    for (uint32_t i = 0; i < DVZ_BUFFER_TYPE_COUNT; i++)
+        dvz_alloc_destroy(&context->allocators[i]);
 
     log_trace("context destroy sets of images");
     CONTAINER_DESTROY_ITEMS(DvzImages, context->images, dvz_images_destroy)
@@ -168,6 +332,8 @@ DvzContext* dvz_context(DvzGpu* gpu, DvzWindow* window)
         dvz_container(DVZ_CONTAINER_DEFAULT_COUNT, sizeof(DvzTexture), DVZ_OBJECT_TYPE_TEXTURE);
     context->computes =
         dvz_container(DVZ_CONTAINER_DEFAULT_COUNT, sizeof(DvzCompute), DVZ_OBJECT_TYPE_COMPUTE);
+    context->graphics =
+        dvz_container(DVZ_CONTAINER_DEFAULT_COUNT, sizeof(DvzGraphics), DVZ_OBJECT_TYPE_GRAPHICS);
 
     // Specify the default queues.
     _context_default_queues(gpu, window);
@@ -175,12 +341,21 @@ DvzContext* dvz_context(DvzGpu* gpu, DvzWindow* window)
     // Create the GPU after the default queues have been set.
     if (!dvz_obj_is_created(&gpu->obj))
     {
+        // Multi-draw indirect is used to batch the visuals sharing a graphics pipeline.
+        gpu->requested_features.multiDrawIndirect = gpu->device_features.multiDrawIndirect;
+
         VkSurfaceKHR surface = VK_NULL_HANDLE;
         if (window != NULL)
             surface = window->surface;
         dvz_gpu_create(gpu, surface);
     }
 
+    // Pipeline cache, persisted across runs if a path is given in the environment.
+    dvz_gpu_pipeline_cache(gpu, 0, NULL);
+    const char* cache_path = getenv("DVZ_PIPELINE_CACHE");
+    if (cache_path != NULL && strlen(cache_path) > 0)
+        dvz_context_pipeline_cache(context, cache_path);
+
     // Create the default buffers.
     _context_default_buffers(context);
 
@@ -221,6 +396,26 @@ void dvz_context_reset(DvzContext* context)
 
 
 
+bool dvz_context_pipeline_cache(DvzContext* context, const char* path)
+{
+    ASSERT(context != NULL);
+    ASSERT(context->gpu != NULL);
+    if (path == NULL || strlen(path) == 0)
+    {
+        context->pipeline_cache_path[0] = 0;
+        return false;
+    }
+    if (strlen(path) >= sizeof(context->pipeline_cache_path))
+    {
+        log_error("pipeline cache path too long: %s", path);
+        return false;
+    }
+    strcpy(context->pipeline_cache_path, path);
+    return _pipeline_cache_load(context);
+}
+
+
+
 void dvz_context_destroy(DvzContext* context)
 {
     if (context == NULL)
@@ -232,18 +427,36 @@ void dvz_context_destroy(DvzContext* context)
     ASSERT(context != NULL);
     ASSERT(context->gpu != NULL);
 
-    // Destroy the font atlas.
+    // Persist the pipeline cache for the next runs.
+    if (strlen(context->pipeline_cache_path) > 0)
+        _pipeline_cache_save(context);
+
+    // Destroy the font atlases.
     dvz_font_atlas_destroy(&context->font_atlas);
+    if (context->glyph_atlas != NULL)
+    {
+        dvz_glyph_atlas_destroy(context->glyph_atlas);
+        FREE(context->glyph_atlas);
+    }
 
     // Destroy the buffers, images, samplers, textures, computes.
     _destroy_resources(context);
 
+    // Destroy the builtin graphics pipelines that have not been released by their canvas.
+    DvzGraphicsRegistry* registry = &context->graphics_registry;
+    log_debug(
+        "%d builtin graphics requested, %d pipelines created", (int)registry->requests,
+        (int)registry->created);
+    CONTAINER_DESTROY_ITEMS(DvzGraphics, context->graphics, dvz_graphics_destroy)
+    FREE(registry->entries);
+
     // Free the allocated memory.
     dvz_container_destroy(&context->buffers);
     dvz_container_destroy(&context->images);
     dvz_container_destroy(&context->samplers);
     dvz_container_destroy(&context->textures);
     dvz_container_destroy(&context->computes);
+    dvz_container_destroy(&context->graphics);
 }
 
 
@@ -252,14 +465,9 @@ void dvz_context_destroy(DvzContext* context)
 /*  Buffer allocation                                                                            */
 /*************************************************************************************************/
 
-DvzBufferRegions dvz_ctx_buffers(
-    DvzContext* context, DvzBufferType buffer_type, uint32_t buffer_count, VkDeviceSize size)
+static DvzBuffer* _find_buffer(DvzContext* context, DvzBufferType buffer_type)
 {
     ASSERT(context != NULL);
-    ASSERT(context->gpu != NULL);
-    ASSERT(buffer_count > 0);
-    ASSERT(size > 0);
-    ASSERT(buffer_type < DVZ_BUFFER_TYPE_COUNT);
 
     // Choose the first buffer with the requested type.
     DvzContainerIterator iter = dvz_container_iterator(&context->buffers);
@@ -268,9 +476,43 @@ DvzBufferRegions dvz_ctx_buffers(
     {
         buffer = iter.item;
         if (dvz_obj_is_created(&buffer->obj) && buffer->type == buffer_type)
-            break;
+            return buffer;
         dvz_container_iter(&iter);
     }
+    return NULL;
+}
+
+
+
+// Resize the underlying GPU buffer after the allocator has been enlarged.
+static void _buffer_grow(DvzContext* context, DvzBuffer* buffer, VkDeviceSize resized)
+{
+    ASSERT(context != NULL);
+    ASSERT(buffer != NULL);
+    if (resized > buffer->size)
+    {
+        log_info("reallocating buffer %d to %s", buffer->type, pretty_size(resized));
+        // Make sure the GPU is no longer using the buffer before recreating it.
+        dvz_gpu_wait(context->gpu);
+        dvz_buffer_resize(buffer, resized, &context->transfer_cmd);
+        context->buffers_generation++;
+    }
+    ASSERT(buffer->size >= context->allocators[buffer->type].size);
+    buffer->allocated_size = dvz_alloc_stats(&context->allocators[buffer->type]).end;
+}
+
+
+
+DvzBufferRegions dvz_ctx_buffers(
+    DvzContext* context, DvzBufferType buffer_type, uint32_t buffer_count, VkDeviceSize size)
+{
+    ASSERT(context != NULL);
+    ASSERT(context->gpu != NULL);
+    ASSERT(buffer_count > 0);
+    ASSERT(size > 0);
+    ASSERT(buffer_type < DVZ_BUFFER_TYPE_COUNT);
+
+    DvzBuffer* buffer = _find_buffer(context, buffer_type);
     if (buffer == NULL)
     {
         log_error("could not find buffer with requested type %d", buffer_type);
@@ -280,52 +522,42 @@ DvzBufferRegions dvz_ctx_buffers(
     ASSERT(buffer->type == buffer_type);
     ASSERT(dvz_obj_is_created(&buffer->obj));
 
+    DvzAlloc* alloc = &context->allocators[buffer_type];
     VkDeviceSize alignment = 0;
-    VkDeviceSize offset = buffer->allocated_size;
     bool needs_align =
         buffer_type == DVZ_BUFFER_TYPE_UNIFORM || buffer_type == DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE;
     if (needs_align)
     {
         alignment = context->gpu->device_properties.limits.minUniformBufferOffsetAlignment;
-        ASSERT(offset % alignment == 0); // offset should be already aligned
+        ASSERT(alignment > 0);
     }
-
-    DvzBufferRegions regions = dvz_buffer_regions(buffer, buffer_count, offset, size, alignment);
-    VkDeviceSize alsize = regions.aligned_size;
-    if (alsize == 0)
-        alsize = size;
+    VkDeviceSize alsize = needs_align ? aligned_size(size, alignment) : size;
     ASSERT(alsize > 0);
 
-    if (!dvz_obj_is_created(&buffer->obj))
-    {
-        log_error("invalid buffer %d", buffer_type);
-        return regions;
-    }
+    // The regions of a set are allocated contiguously, in a single allocator block.
+    VkDeviceSize resized = 0;
+    VkDeviceSize offset = dvz_alloc_new(alloc, alsize * buffer_count, &resized);
+    if (needs_align)
+        ASSERT(offset % alignment == 0); // offset should be already aligned
+
+    // Need to reallocate?
+    _buffer_grow(context, buffer, resized);
+
+    DvzBufferRegions regions = dvz_buffer_regions(buffer, buffer_count, offset, size, alignment);
+    ASSERT(regions.offsets[0] == offset);
 
     // Check alignment for uniform buffers.
     if (needs_align)
     {
-        ASSERT(alignment > 0);
-        ASSERT(alsize % alignment == 0);
+        ASSERT(regions.aligned_size == alsize);
         for (uint32_t i = 0; i < buffer_count; i++)
             ASSERT(regions.offsets[i] % alignment == 0);
     }
 
-    // Need to reallocate?
-    if (offset + alsize * buffer_count > regions.buffer->size)
-    {
-        VkDeviceSize new_size = dvz_next_pow2(offset + alsize * buffer_count);
-        log_info("reallocating buffer %d to %s", buffer_type, pretty_size(new_size));
-        dvz_buffer_resize(regions.buffer, new_size, &context->transfer_cmd);
-    }
-
     log_debug(
-        "allocating %d buffers (type %d) with size %s (aligned size %s)", //
-        buffer_count, buffer_type, pretty_size(size), pretty_size(alsize));
+        "allocating %d buffers (type %d) with size %s (aligned size %s) at offset %s", //
+        buffer_count, buffer_type, pretty_size(size), pretty_size(alsize), pretty_size(offset));
     ASSERT(offset + alsize * buffer_count <= regions.buffer->size);
-    buffer->allocated_size += alsize * buffer_count;
-
-    ASSERT(regions.offsets[buffer_count - 1] + alsize == buffer->allocated_size);
     return regions;
 }
 
@@ -333,11 +565,14 @@ DvzBufferRegions dvz_ctx_buffers(
 
 void dvz_ctx_buffers_resize(DvzContext* context, DvzBufferRegions* br, VkDeviceSize new_size)
 {
-    // NOTE: this function tries to resize a buffer region in-place, which only works if
-    // it is the last allocated region in the buffer. Otherwise a brand new region is allocated,
-    // which wastes space. TODO: smarter memory management, defragmentation etc.
+    // NOTE: the region is resized in-place when the following space in the buffer is free.
+    // Otherwise, a new region is allocated, the data is copied on the GPU, and the old region
+    // is freed.
+    ASSERT(context != NULL);
+    ASSERT(br != NULL);
     ASSERT(br->buffer != NULL);
     ASSERT(br->count > 0);
+    ASSERT(new_size > 0);
     if (br->count > 1)
     {
         log_error("dvz_buffer_regions_resize() currently only supports regions with buf count=1");
@@ -345,32 +580,186 @@ void dvz_ctx_buffers_resize(DvzContext* context, DvzBufferRegions* br, VkDeviceS
     }
     ASSERT(br->count == 1);
 
-    // The region is the last allocated in the buffer, we can safely resize it.
+    DvzBuffer* buffer = br->buffer;
+    DvzAlloc* alloc = &context->allocators[buffer->type];
+    VkDeviceSize old_offset = br->offsets[0];
     VkDeviceSize old_size = br->aligned_size > 0 ? br->aligned_size : br->size;
     ASSERT(old_size > 0);
-    if (br->offsets[0] + old_size == br->buffer->allocated_size)
+
+    VkDeviceSize resized = 0;
+    VkDeviceSize offset = dvz_alloc_resize(alloc, old_offset, new_size, &resized);
+
+    // Need to reallocate a new underlying buffer.
+    _buffer_grow(context, buffer, resized);
+
+    // The region could not be resized in-place: copy the data to the new region, then free the
+    // old one.
+    if (offset != old_offset)
+    {
+        log_debug("failed to resize the buffer region in-place, moving it to a new region");
+        DvzCommands* cmds = &context->transfer_cmd;
+        dvz_queue_wait(context->gpu, DVZ_DEFAULT_QUEUE_RENDER);
+        dvz_cmd_reset(cmds, 0);
+        dvz_cmd_begin(cmds, 0);
+        dvz_cmd_copy_buffer(cmds, 0, buffer, old_offset, buffer, offset, MIN(old_size, new_size));
+        dvz_cmd_end(cmds, 0);
+        dvz_cmd_submit_sync(cmds, 0);
+
+        dvz_alloc_free(alloc, old_offset);
+        buffer->allocated_size = dvz_alloc_stats(alloc).end;
+    }
+    else
     {
         log_debug("resize the buffer region in-place");
-        br->size = new_size;
-        if (br->alignment > 0)
-            br->aligned_size = aligned_size(new_size, br->alignment);
-        br->buffer->allocated_size = br->offsets[0] + new_size;
+    }
+
+    *br = dvz_buffer_regions(buffer, 1, offset, new_size, br->alignment);
+}
+
 
-        // Need to reallocate a new underlying buffer.
-        if (br->offsets[0] + old_size > br->buffer->size)
+
+void dvz_ctx_buffers_free(DvzContext* context, DvzBufferRegions* br)
+{
+    ASSERT(context != NULL);
+    ASSERT(br != NULL);
+    if (br->buffer == NULL || br->count == 0)
+    {
+        log_trace("skip freeing of empty buffer regions");
+        return;
+    }
+    ASSERT(br->buffer->type < DVZ_BUFFER_TYPE_COUNT);
+
+    log_debug(
+        "free %d buffer regions (type %d) at offset %s", //
+        br->count, br->buffer->type, pretty_size(br->offsets[0]));
+    DvzAlloc* alloc = &context->allocators[br->buffer->type];
+    dvz_alloc_free(alloc, br->offsets[0]);
+    br->buffer->allocated_size = dvz_alloc_stats(alloc).end;
+
+    memset(br, 0, sizeof(DvzBufferRegions));
+}
+
+
+
+VkDeviceSize dvz_ctx_buffers_compact(
+    DvzContext* context, DvzBufferType buffer_type, uint32_t count, DvzBufferRegions** regions,
+    uint32_t bindings_count, DvzBindings** bindings)
+{
+    ASSERT(context != NULL);
+    ASSERT(buffer_type < DVZ_BUFFER_TYPE_COUNT);
+    ASSERT(count == 0 || regions != NULL);
+    ASSERT(bindings_count == 0 || bindings != NULL);
+
+    DvzBuffer* buffer = _find_buffer(context, buffer_type);
+    if (buffer == NULL)
+    {
+        log_error("could not find buffer with requested type %d", buffer_type);
+        return 0;
+    }
+    DvzAlloc* alloc = &context->allocators[buffer_type];
+
+    // Default buffer size, used as a lower bound when shrinking the buffer.
+    VkDeviceSize min_size = DVZ_BUFFER_TYPE_VERTEX_SIZE;
+    if (buffer_type == DVZ_BUFFER_TYPE_UNIFORM || buffer_type == DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE)
+        min_size = DVZ_BUFFER_TYPE_UNIFORM_SIZE;
+
+    VkDeviceSize* old_offsets = calloc(MAX(1, count), sizeof(VkDeviceSize));
+    VkDeviceSize* new_offsets = calloc(MAX(1, count), sizeof(VkDeviceSize));
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ASSERT(regions[i] != NULL);
+        ASSERT(regions[i]->buffer == buffer);
+        old_offsets[i] = regions[i]->offsets[0];
+    }
+
+    // List all used blocks, either movable or pinned, that need to be kept in the new buffer.
+    uint32_t copy_count = 0;
+    VkBufferCopy* copies = calloc(MAX(1, alloc->used_blocks), sizeof(VkBufferCopy));
+    DvzAllocBlock* block = NULL;
+    for (uint32_t i = alloc->first; i != DVZ_ALLOC_NONE; i = block->next)
+    {
+        block = &alloc->blocks[i];
+        if (!block->used)
+            continue;
+        copies[copy_count].srcOffset = block->offset;
+        copies[copy_count].dstOffset = block->offset;
+        copies[copy_count].size = block->size;
+        copy_count++;
+    }
+    ASSERT(copy_count == alloc->used_blocks);
+
+    // Compute the new offsets of the movable regions.
+    VkDeviceSize new_size = dvz_alloc_compact(alloc, count, old_offsets, new_offsets, min_size);
+    for (uint32_t i = 0; i < copy_count; i++)
+    {
+        for (uint32_t j = 0; j < count; j++)
         {
-            VkDeviceSize bs = dvz_next_pow2(br->offsets[0] + old_size);
-            log_info("reallocating buffer #%d to %s", br->buffer->type, pretty_size(bs));
-            dvz_buffer_resize(br->buffer, bs, &context->transfer_cmd);
+            if (old_offsets[j] == copies[i].srcOffset)
+            {
+                copies[i].dstOffset = new_offsets[j];
+                break;
+            }
         }
     }
 
-    // The region cannot be resized directly, need to make a new region allocation.
-    else
+    log_info(
+        "compacting buffer %d from %s to %s", buffer_type, //
+        pretty_size(buffer->size), pretty_size(new_size));
+
+    // Make sure the GPU is no longer using the buffer before recreating it.
+    dvz_gpu_wait(context->gpu);
+    dvz_buffer_relocate(buffer, new_size, &context->transfer_cmd, copy_count, copies);
+    buffer->allocated_size = dvz_alloc_stats(alloc).end;
+    context->buffers_generation++;
+
+    // Update the buffer regions.
+    for (uint32_t i = 0; i < count; i++)
     {
-        log_debug("failed to resize the buffer region in-place, allocating a new region");
-        *br = dvz_ctx_buffers(context, br->buffer->type, 1, new_size);
+        *regions[i] = dvz_buffer_regions(
+            buffer, regions[i]->count, new_offsets[i], regions[i]->size, regions[i]->alignment);
     }
+
+    // Update the bindings: the underlying VkBuffer has changed, and some offsets may have changed.
+    DvzBindings* b = NULL;
+    DvzBufferRegions* br = NULL;
+    for (uint32_t i = 0; i < bindings_count; i++)
+    {
+        b = bindings[i];
+        ASSERT(b != NULL);
+        ASSERT(b->slots != NULL);
+        bool need_update = false;
+        for (uint32_t k = 0; k < b->slots->slot_count; k++)
+        {
+            br = &b->br[k];
+            if (br->buffer != buffer)
+                continue;
+            need_update = true;
+            for (uint32_t j = 0; j < count; j++)
+            {
+                if (br->offsets[0] == old_offsets[j])
+                {
+                    *br = *regions[j];
+                    break;
+                }
+            }
+        }
+        if (need_update && dvz_obj_is_created(&b->obj))
+            dvz_bindings_update(b);
+    }
+
+    FREE(copies);
+    FREE(old_offsets);
+    FREE(new_offsets);
+    return new_size;
+}
+
+
+
+DvzAllocStats dvz_ctx_buffers_stats(DvzContext* context, DvzBufferType buffer_type)
+{
+    ASSERT(context != NULL);
+    ASSERT(buffer_type < DVZ_BUFFER_TYPE_COUNT);
+    return dvz_alloc_stats(&context->allocators[buffer_type]);
 }
 
 
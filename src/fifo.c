@@ -2,6 +2,226 @@
 
 
 
+/*************************************************************************************************/
+/*  Lock-free segments                                                                           */
+/*************************************************************************************************/
+
+static DvzFifoSegment* _segment(uint32_t capacity)
+{
+    ASSERT(capacity > 0);
+    DvzFifoSegment* seg = calloc(1, sizeof(DvzFifoSegment));
+    seg->capacity = capacity;
+    seg->slots = calloc(capacity, sizeof(DvzFifoSlot));
+    for (uint32_t i = 0; i < capacity; i++)
+        atomic_init(&seg->slots[i].ready, false);
+    atomic_init(&seg->enqueued, 0);
+    atomic_init(&seg->next, NULL);
+    return seg;
+}
+
+
+
+static void _segment_destroy(DvzFifoSegment* seg)
+{
+    ASSERT(seg != NULL);
+    FREE(seg->slots);
+    FREE(seg);
+}
+
+
+
+// Free the retired segments. In MPSC mode, a producer may still hold a pointer to a segment that
+// has been entirely consumed, so that the segments are only freed when there is no producer
+// in dvz_fifo_enqueue(). A producer entering after that point can only see the current write
+// segment, which is never retired.
+static void _segments_collect(DvzFifo* fifo, bool force)
+{
+    ASSERT(fifo != NULL);
+    if (!force && fifo->mode == DVZ_FIFO_MODE_MPSC && atomic_load(&fifo->producers) > 0)
+        return;
+    DvzFifoSegment* seg = fifo->retired;
+    DvzFifoSegment* next = NULL;
+    while (seg != NULL)
+    {
+        next = seg->retired;
+        _segment_destroy(seg);
+        seg = next;
+    }
+    fifo->retired = NULL;
+}
+
+
+
+// Append a new segment after a full one, and return it.
+static DvzFifoSegment* _segment_append(DvzFifo* fifo, DvzFifoSegment* seg)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(seg != NULL);
+    DvzFifoSegment* next = atomic_load(&seg->next);
+    if (next == NULL)
+    {
+        uint32_t capacity = MIN(2 * seg->capacity, DVZ_FIFO_MAX_SEGMENT_SIZE);
+        DvzFifoSegment* new_seg = _segment(capacity);
+        // Several producers may try to append a segment at the same time: the first one wins.
+        if (atomic_compare_exchange_strong(&seg->next, &next, new_seg))
+        {
+            log_trace("lock-free FIFO queue segment is full, appending a new one (%d)", capacity);
+            next = new_seg;
+        }
+        else
+        {
+            _segment_destroy(new_seg);
+        }
+    }
+    ASSERT(next != NULL);
+    // Advance the write segment, unless another producer has already done it.
+    DvzFifoSegmentPtr expected = seg;
+    atomic_compare_exchange_strong(&fifo->write_segment, &expected, next);
+    return next;
+}
+
+
+
+/*************************************************************************************************/
+/*  Lock-free FIFO queue                                                                         */
+/*************************************************************************************************/
+
+static void _lockfree_enqueue(DvzFifo* fifo, void* item)
+{
+    ASSERT(fifo != NULL);
+    bool multi = fifo->mode == DVZ_FIFO_MODE_MPSC;
+    if (multi)
+        atomic_fetch_add(&fifo->producers, 1);
+
+    // Reserve a slot in the write segment.
+    DvzFifoSegment* seg = atomic_load(&fifo->write_segment);
+    uint32_t idx = 0;
+    while (true)
+    {
+        ASSERT(seg != NULL);
+        if (multi)
+        {
+            idx = atomic_fetch_add(&seg->enqueued, 1);
+        }
+        else
+        {
+            // Single producer: no need for a read-modify-write operation.
+            idx = atomic_load_explicit(&seg->enqueued, memory_order_relaxed);
+            if (idx < seg->capacity)
+                atomic_store_explicit(&seg->enqueued, idx + 1, memory_order_relaxed);
+        }
+        if (idx < seg->capacity)
+            break;
+        seg = _segment_append(fifo, seg);
+    }
+
+    // Write the item and publish it.
+    DvzFifoSlot* slot = &seg->slots[idx];
+    slot->item = item;
+    atomic_store_explicit(&slot->ready, true, memory_order_release);
+
+    atomic_fetch_add(&fifo->count, 1);
+    fifo->is_empty = false;
+    if (multi)
+        atomic_fetch_sub(&fifo->producers, 1);
+
+    // Wake up the consumer only if it is blocked.
+    if (atomic_load(&fifo->waiters) > 0)
+    {
+        pthread_mutex_lock(&fifo->lock);
+        pthread_cond_signal(&fifo->cond);
+        pthread_mutex_unlock(&fifo->lock);
+    }
+}
+
+
+
+// Try to dequeue an item, return false if there is none. Only called by the consumer thread.
+static bool _lockfree_pop(DvzFifo* fifo, void** item)
+{
+    ASSERT(fifo != NULL);
+    ASSERT(item != NULL);
+    DvzFifoSegment* seg = fifo->read_segment;
+    DvzFifoSegment* next = NULL;
+    DvzFifoSlot* slot = NULL;
+    while (true)
+    {
+        ASSERT(seg != NULL);
+        if (seg->dequeued < seg->capacity)
+        {
+            // NOTE: in MPSC mode, the next slot may have been reserved by a producer that has
+            // not written it yet, in which case the queue is considered empty for now.
+            slot = &seg->slots[seg->dequeued];
+            if (!atomic_load_explicit(&slot->ready, memory_order_acquire))
+                return false;
+            *item = slot->item;
+            seg->dequeued++;
+            atomic_fetch_sub(&fifo->count, 1);
+            return true;
+        }
+
+        // The read segment has been entirely consumed, move to the next one if there is one.
+        next = atomic_load(&seg->next);
+        if (next == NULL)
+            return false;
+        fifo->read_segment = next;
+        seg->retired = fifo->retired;
+        fifo->retired = seg;
+        _segments_collect(fifo, fifo->mode == DVZ_FIFO_MODE_SPSC);
+        seg = next;
+    }
+    return false;
+}
+
+
+
+// Update the emptiness flag from the consumer thread. A producer may enqueue an item in the
+// meantime, hence the second check.
+static void _lockfree_update_empty(DvzFifo* fifo)
+{
+    ASSERT(fifo != NULL);
+    if (atomic_load(&fifo->count) > 0)
+        return;
+    fifo->is_empty = true;
+    if (atomic_load(&fifo->count) > 0)
+        fifo->is_empty = false;
+}
+
+
+
+static void* _lockfree_dequeue(DvzFifo* fifo, bool wait)
+{
+    ASSERT(fifo != NULL);
+    void* item = NULL;
+    if (_lockfree_pop(fifo, &item))
+    {
+        _lockfree_update_empty(fifo);
+        return item;
+    }
+
+    if (wait)
+    {
+        log_trace("waiting for the queue to be non-empty");
+        pthread_mutex_lock(&fifo->lock);
+        atomic_fetch_add(&fifo->waiters, 1);
+        while (!_lockfree_pop(fifo, &item))
+        {
+            // If the count is positive, a producer is about to publish the next item: retry.
+            if (atomic_load(&fifo->count) == 0)
+                pthread_cond_wait(&fifo->cond, &fifo->lock);
+        }
+        atomic_fetch_sub(&fifo->waiters, 1);
+        pthread_mutex_unlock(&fifo->lock);
+        _lockfree_update_empty(fifo);
+        return item;
+    }
+
+    _lockfree_update_empty(fifo);
+    return NULL;
+}
+
+
+
 /*************************************************************************************************/
 /*  Thread-safe FIFO queue                                                                       */
 /*************************************************************************************************/
@@ -11,7 +231,7 @@ DvzFifo dvz_fifo(int32_t capacity)
     log_trace("creating generic FIFO queue with a capacity of %d items", capacity);
     ASSERT(capacity >= 2);
     DvzFifo fifo = {0};
-    ASSERT(capacity <= DVZ_MAX_FIFO_CAPACITY);
+    fifo.mode = DVZ_FIFO_MODE_MUTEX;
     fifo.capacity = capacity;
     fifo.is_empty = true;
     fifo.items = calloc((uint32_t)capacity, sizeof(void*));
@@ -26,9 +246,40 @@ DvzFifo dvz_fifo(int32_t capacity)
 
 
 
+DvzFifo dvz_fifo_lockfree(int32_t capacity, DvzFifoMode mode)
+{
+    log_trace("creating lock-free FIFO queue with a capacity of %d items", capacity);
+    ASSERT(capacity >= 2);
+    ASSERT(mode == DVZ_FIFO_MODE_SPSC || mode == DVZ_FIFO_MODE_MPSC);
+    DvzFifo fifo = {0};
+    fifo.mode = mode;
+    fifo.capacity = capacity;
+    fifo.is_empty = true;
+
+    fifo.read_segment = _segment((uint32_t)capacity);
+    atomic_init(&fifo.write_segment, fifo.read_segment);
+    atomic_init(&fifo.count, 0);
+    atomic_init(&fifo.producers, 0);
+    atomic_init(&fifo.waiters, 0);
+
+    if (pthread_mutex_init(&fifo.lock, NULL) != 0)
+        log_error("mutex creation failed");
+    if (pthread_cond_init(&fifo.cond, NULL) != 0)
+        log_error("cond creation failed");
+
+    return fifo;
+}
+
+
+
 void dvz_fifo_enqueue(DvzFifo* fifo, void* item)
 {
     ASSERT(fifo != NULL);
+    if (fifo->mode != DVZ_FIFO_MODE_MUTEX)
+    {
+        _lockfree_enqueue(fifo, item);
+        return;
+    }
     pthread_mutex_lock(&fifo->lock);
 
     // Old size
@@ -45,11 +296,6 @@ void dvz_fifo_enqueue(DvzFifo* fifo, void* item)
         ASSERT(fifo->items != NULL);
         ASSERT(size == fifo->capacity - 1);
 
-        // NOTE: we hard-code the maximum size of FIFO queues for now as the canvas has an array of
-        // fixed size for the event objects stored in the FIFO queue.
-        // TODO: fix this by making the canvas event array enlargeable.
-        ASSERT(fifo->capacity <= DVZ_MAX_FIFO_CAPACITY);
-
         fifo->capacity *= 2;
         log_debug("FIFO queue is full, enlarging it to %d", fifo->capacity);
         REALLOC(fifo->items, (uint32_t)fifo->capacity * sizeof(void*));
@@ -88,6 +334,8 @@ void dvz_fifo_enqueue(DvzFifo* fifo, void* item)
 void* dvz_fifo_dequeue(DvzFifo* fifo, bool wait)
 {
     ASSERT(fifo != NULL);
+    if (fifo->mode != DVZ_FIFO_MODE_MUTEX)
+        return _lockfree_dequeue(fifo, wait);
     pthread_mutex_lock(&fifo->lock);
 
     // Wait until the queue is not empty.
@@ -131,6 +379,8 @@ void* dvz_fifo_dequeue(DvzFifo* fifo, bool wait)
 int dvz_fifo_size(DvzFifo* fifo)
 {
     ASSERT(fifo != NULL);
+    if (fifo->mode != DVZ_FIFO_MODE_MUTEX)
+        return MAX(0, atomic_load(&fifo->count));
     pthread_mutex_lock(&fifo->lock);
     // log_debug("head %d tail %d", fifo->head, fifo->tail);
     int size = fifo->head - fifo->tail;
@@ -148,6 +398,18 @@ void dvz_fifo_discard(DvzFifo* fifo, int max_size)
     ASSERT(fifo != NULL);
     if (max_size == 0)
         return;
+    if (fifo->mode != DVZ_FIFO_MODE_MUTEX)
+    {
+        // Drop the oldest items from the consumer thread.
+        int size = dvz_fifo_size(fifo);
+        if (size > max_size)
+            log_trace(
+                "discarding %d items in the FIFO queue which is getting overloaded",
+                size - max_size);
+        for (int i = 0; i < size - max_size; i++)
+            _lockfree_dequeue(fifo, false);
+        return;
+    }
     pthread_mutex_lock(&fifo->lock);
     int size = fifo->head - fifo->tail;
     if (size < 0)
@@ -169,6 +431,14 @@ void dvz_fifo_discard(DvzFifo* fifo, int max_size)
 void dvz_fifo_reset(DvzFifo* fifo)
 {
     ASSERT(fifo != NULL);
+    if (fifo->mode != DVZ_FIFO_MODE_MUTEX)
+    {
+        void* item = NULL;
+        while (_lockfree_pop(fifo, &item))
+            ;
+        _lockfree_update_empty(fifo);
+        return;
+    }
     pthread_mutex_lock(&fifo->lock);
     fifo->head = 0;
     fifo->tail = 0;
@@ -184,6 +454,22 @@ void dvz_fifo_destroy(DvzFifo* fifo)
     pthread_mutex_destroy(&fifo->lock);
     pthread_cond_destroy(&fifo->cond);
 
+    if (fifo->mode != DVZ_FIFO_MODE_MUTEX)
+    {
+        // The queue must not be used by any thread anymore at this point.
+        _segments_collect(fifo, true);
+        DvzFifoSegment* seg = fifo->read_segment;
+        DvzFifoSegment* next = NULL;
+        while (seg != NULL)
+        {
+            next = atomic_load(&seg->next);
+            _segment_destroy(seg);
+            seg = next;
+        }
+        fifo->read_segment = NULL;
+        return;
+    }
+
     ASSERT(fifo->items != NULL);
     FREE(fifo->items);
 }
@@ -2,8 +2,7 @@
 #include "common.glsl"
 
 layout (std140, binding = USER_BINDING) uniform Params {
-    ivec2 grid_size;  // (6, 16)
-    ivec2 tex_size;  // (400, 200)
+    ivec2 tex_size;  // (1024, 1024)
 } params;
 
 layout(binding = (USER_BINDING+1)) uniform sampler2D tex_sampler;
@@ -24,7 +23,6 @@ void main() {
         discard;
 
     float alpha = get_alpha(tex_coords);
-    alpha = supersample(alpha);
     out_color = color;
     out_color.a *= alpha;
 }
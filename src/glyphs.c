@@ -0,0 +1,812 @@
+#include "../include/datoviz/glyphs.h"
+#include "../include/datoviz/canvas.h"
+#include <math.h>
+
+// Optional FreeType support
+#if HAS_FREETYPE
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#endif
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_SKYLINE_DEFAULT_NODES 64
+#define DVZ_GLYPH_CACHE_DEFAULT   256
+#define DVZ_GLYPH_PADDING         1 // gap between two glyphs in the atlas, in pixels
+#define DVZ_SDF_FAR               9999
+
+
+
+/*************************************************************************************************/
+/*  Skyline packer                                                                               */
+/*************************************************************************************************/
+
+DvzSkyline dvz_skyline(uint32_t width, uint32_t height)
+{
+    ASSERT(width > 0);
+    ASSERT(height > 0);
+    DvzSkyline skyline = {0};
+    skyline.width = width;
+    skyline.height = height;
+    skyline.capacity = DVZ_SKYLINE_DEFAULT_NODES;
+    skyline.nodes = (DvzSkylineNode*)calloc(skyline.capacity, sizeof(DvzSkylineNode));
+    skyline.nodes[0].width = width;
+    skyline.count = 1;
+    return skyline;
+}
+
+
+
+// Lowest position of a rectangle whose left edge is on a given node, or UINT32_MAX if it does
+// not fit there.
+static uint32_t _skyline_fit(DvzSkyline* skyline, uint32_t idx, uint32_t width, uint32_t height)
+{
+    ASSERT(skyline != NULL);
+    ASSERT(idx < skyline->count);
+    DvzSkylineNode* nodes = skyline->nodes;
+    if (nodes[idx].x + width > skyline->width)
+        return UINT32_MAX;
+
+    // The rectangle lies on the highest of the nodes it spans.
+    uint32_t y = 0;
+    int64_t width_left = width;
+    for (uint32_t i = idx; width_left > 0; i++)
+    {
+        ASSERT(i < skyline->count);
+        y = MAX(y, nodes[i].y);
+        if (y + height > skyline->height)
+            return UINT32_MAX;
+        width_left -= nodes[i].width;
+    }
+    return y;
+}
+
+
+
+static void _skyline_insert_node(DvzSkyline* skyline, uint32_t idx, DvzSkylineNode node)
+{
+    ASSERT(skyline != NULL);
+    ASSERT(idx <= skyline->count);
+    if (skyline->count == skyline->capacity)
+    {
+        skyline->capacity *= 2;
+        REALLOC(skyline->nodes, skyline->capacity * sizeof(DvzSkylineNode));
+    }
+    memmove(
+        &skyline->nodes[idx + 1], &skyline->nodes[idx],
+        (skyline->count - idx) * sizeof(DvzSkylineNode));
+    skyline->nodes[idx] = node;
+    skyline->count++;
+}
+
+
+
+static void _skyline_remove_node(DvzSkyline* skyline, uint32_t idx)
+{
+    ASSERT(skyline != NULL);
+    ASSERT(idx < skyline->count);
+    memmove(
+        &skyline->nodes[idx], &skyline->nodes[idx + 1],
+        (skyline->count - idx - 1) * sizeof(DvzSkylineNode));
+    skyline->count--;
+}
+
+
+
+bool dvz_skyline_pack(DvzSkyline* skyline, uint32_t width, uint32_t height, uvec2 pos)
+{
+    ASSERT(skyline != NULL);
+    ASSERT(width > 0);
+    ASSERT(height > 0);
+
+    // Bottom-left heuristic: lowest top edge, then narrowest node.
+    uint32_t best_idx = UINT32_MAX;
+    uint32_t best_top = UINT32_MAX;
+    uint32_t best_width = UINT32_MAX;
+    uint32_t y = 0;
+    for (uint32_t i = 0; i < skyline->count; i++)
+    {
+        y = _skyline_fit(skyline, i, width, height);
+        if (y == UINT32_MAX)
+            continue;
+        if (y + height < best_top ||
+            (y + height == best_top && skyline->nodes[i].width < best_width))
+        {
+            best_idx = i;
+            best_top = y + height;
+            best_width = skyline->nodes[i].width;
+        }
+    }
+    if (best_idx == UINT32_MAX)
+        return false;
+
+    pos[0] = skyline->nodes[best_idx].x;
+    pos[1] = best_top - height;
+
+    // The new node covers the rectangle, the nodes below it are shrunk or removed.
+    DvzSkylineNode node = {pos[0], best_top, width};
+    _skyline_insert_node(skyline, best_idx, node);
+    uint32_t end = node.x + node.width;
+    DvzSkylineNode* next = NULL;
+    while (best_idx + 1 < skyline->count)
+    {
+        next = &skyline->nodes[best_idx + 1];
+        if (next->x >= end)
+            break;
+        if (next->x + next->width <= end)
+        {
+            _skyline_remove_node(skyline, best_idx + 1);
+            continue;
+        }
+        next->width -= end - next->x;
+        next->x = end;
+        break;
+    }
+
+    // Merge the neighbouring nodes at the same height.
+    for (uint32_t i = 0; i + 1 < skyline->count;)
+    {
+        if (skyline->nodes[i].y == skyline->nodes[i + 1].y)
+        {
+            skyline->nodes[i].width += skyline->nodes[i + 1].width;
+            _skyline_remove_node(skyline, i + 1);
+        }
+        else
+            i++;
+    }
+
+    skyline->used_area += (uint64_t)width * height;
+    return true;
+}
+
+
+
+void dvz_skyline_destroy(DvzSkyline* skyline)
+{
+    ASSERT(skyline != NULL);
+    FREE(skyline->nodes);
+    skyline->count = 0;
+    skyline->capacity = 0;
+}
+
+
+
+/*************************************************************************************************/
+/*  Unicode                                                                                      */
+/*************************************************************************************************/
+
+uint32_t dvz_utf8_next(const char** str)
+{
+    ASSERT(str != NULL);
+    ASSERT(*str != NULL);
+    const uint8_t* s = (const uint8_t*)*str;
+    if (s[0] == 0)
+        return 0;
+
+    uint32_t n = 0, cp = 0;
+    if (s[0] < 0x80)
+    {
+        n = 1;
+        cp = s[0];
+    }
+    else if ((s[0] & 0xE0) == 0xC0)
+    {
+        n = 2;
+        cp = s[0] & 0x1F;
+    }
+    else if ((s[0] & 0xF0) == 0xE0)
+    {
+        n = 3;
+        cp = s[0] & 0x0F;
+    }
+    else if ((s[0] & 0xF8) == 0xF0)
+    {
+        n = 4;
+        cp = s[0] & 0x07;
+    }
+    else
+    {
+        // Unexpected continuation byte or invalid leading byte.
+        *str += 1;
+        return 0xFFFD;
+    }
+
+    for (uint32_t i = 1; i < n; i++)
+    {
+        // Truncated sequence: the next character starts at the first non-continuation byte.
+        if ((s[i] & 0xC0) != 0x80)
+        {
+            *str += i;
+            return 0xFFFD;
+        }
+        cp = (cp << 6) | (s[i] & 0x3F);
+    }
+    *str += n;
+    return cp;
+}
+
+
+
+/*************************************************************************************************/
+/*  Signed distance field                                                                        */
+/*************************************************************************************************/
+
+// Offset to the nearest seed pixel.
+typedef struct
+{
+    int32_t dx, dy;
+} DvzSdfPoint;
+
+
+
+static inline int32_t _sdf_dist2(DvzSdfPoint p) { return p.dx * p.dx + p.dy * p.dy; }
+
+
+
+static inline void _sdf_compare(
+    DvzSdfPoint* grid, int32_t w, int32_t h, DvzSdfPoint* p, int32_t x, int32_t y, int32_t ox,
+    int32_t oy)
+{
+    int32_t nx = x + ox, ny = y + oy;
+    if (nx < 0 || ny < 0 || nx >= w || ny >= h)
+        return;
+    DvzSdfPoint other = grid[ny * w + nx];
+    other.dx += ox;
+    other.dy += oy;
+    if (_sdf_dist2(other) < _sdf_dist2(*p))
+        *p = other;
+}
+
+
+
+// Two-pass 8-neighbour sequential Euclidean distance transform (8SSEDT).
+static void _sdf_transform(DvzSdfPoint* grid, int32_t w, int32_t h)
+{
+    ASSERT(grid != NULL);
+    DvzSdfPoint p = {0};
+    for (int32_t y = 0; y < h; y++)
+    {
+        for (int32_t x = 0; x < w; x++)
+        {
+            p = grid[y * w + x];
+            _sdf_compare(grid, w, h, &p, x, y, -1, 0);
+            _sdf_compare(grid, w, h, &p, x, y, 0, -1);
+            _sdf_compare(grid, w, h, &p, x, y, -1, -1);
+            _sdf_compare(grid, w, h, &p, x, y, 1, -1);
+            grid[y * w + x] = p;
+        }
+        for (int32_t x = w - 1; x >= 0; x--)
+        {
+            p = grid[y * w + x];
+            _sdf_compare(grid, w, h, &p, x, y, 1, 0);
+            grid[y * w + x] = p;
+        }
+    }
+    for (int32_t y = h - 1; y >= 0; y--)
+    {
+        for (int32_t x = w - 1; x >= 0; x--)
+        {
+            p = grid[y * w + x];
+            _sdf_compare(grid, w, h, &p, x, y, 1, 0);
+            _sdf_compare(grid, w, h, &p, x, y, 0, 1);
+            _sdf_compare(grid, w, h, &p, x, y, -1, 1);
+            _sdf_compare(grid, w, h, &p, x, y, 1, 1);
+            grid[y * w + x] = p;
+        }
+        for (int32_t x = 0; x < w; x++)
+        {
+            p = grid[y * w + x];
+            _sdf_compare(grid, w, h, &p, x, y, -1, 0);
+            grid[y * w + x] = p;
+        }
+    }
+}
+
+
+
+// Compute the SDF of a coverage bitmap, with a margin of DVZ_GLYPH_SDF_SPREAD pixels. The
+// output has (width + 2 * spread) x (height + 2 * spread) pixels, 128 on the glyph outline,
+// larger inside and smaller outside.
+static void _sdf_compute(
+    uint32_t width, uint32_t height, const uint8_t* coverage, uint8_t* out, uint32_t out_stride)
+{
+    ASSERT(coverage != NULL);
+    ASSERT(out != NULL);
+    const int32_t s = DVZ_GLYPH_SDF_SPREAD;
+    const int32_t w = (int32_t)width + 2 * s;
+    const int32_t h = (int32_t)height + 2 * s;
+
+    // Distances to the nearest pixel inside the glyph, and to the nearest pixel outside.
+    DvzSdfPoint* to_in = (DvzSdfPoint*)calloc((size_t)(w * h), sizeof(DvzSdfPoint));
+    DvzSdfPoint* to_out = (DvzSdfPoint*)calloc((size_t)(w * h), sizeof(DvzSdfPoint));
+    const DvzSdfPoint far = {DVZ_SDF_FAR, DVZ_SDF_FAR};
+    bool inside = false;
+    for (int32_t y = 0; y < h; y++)
+    {
+        for (int32_t x = 0; x < w; x++)
+        {
+            inside = x >= s && y >= s && x < w - s && y < h - s &&
+                     coverage[(uint32_t)(y - s) * width + (uint32_t)(x - s)] >= 128;
+            to_in[y * w + x] = inside ? (DvzSdfPoint){0, 0} : far;
+            to_out[y * w + x] = inside ? far : (DvzSdfPoint){0, 0};
+        }
+    }
+    _sdf_transform(to_in, w, h);
+    _sdf_transform(to_out, w, h);
+
+    // The outline lies half a pixel away from the centers of the pixels on both sides.
+    float d = 0;
+    for (int32_t y = 0; y < h; y++)
+    {
+        for (int32_t x = 0; x < w; x++)
+        {
+            d = sqrtf((float)_sdf_dist2(to_out[y * w + x])) -
+                sqrtf((float)_sdf_dist2(to_in[y * w + x]));
+            d += d > 0 ? -.5f : +.5f;
+            d = 128 + d * 127.0f / s;
+            out[(uint32_t)y * out_stride + (uint32_t)x] = (uint8_t)CLIP(d, 0, 255);
+        }
+    }
+    FREE(to_in);
+    FREE(to_out);
+}
+
+
+
+/*************************************************************************************************/
+/*  Glyph cache                                                                                  */
+/*************************************************************************************************/
+
+static inline uint64_t _glyph_key(uint32_t font, uint32_t codepoint)
+{
+    return ((uint64_t)font << 32) | (uint64_t)codepoint;
+}
+
+
+
+// Return the cached glyph, or NULL if it is not in the cache. `missing` is set if no font has the
+// glyph.
+static DvzGlyph* _glyph_get(DvzGlyphAtlas* atlas, uint32_t font, uint32_t codepoint, bool* missing)
+{
+    ASSERT(atlas != NULL);
+    uint64_t idx = 0;
+    bool found = dvz_hash_table_get(&atlas->cache, _glyph_key(font, codepoint), &idx);
+    if (missing != NULL)
+        *missing = found && idx == DVZ_GLYPH_MISSING;
+    if (!found || idx == DVZ_GLYPH_MISSING)
+        return NULL;
+    ASSERT(idx < atlas->glyph_count);
+    return &atlas->glyphs[idx];
+}
+
+
+
+// Rebuild the cache from the glyphs, dropping the entries of the missing glyphs.
+static void _glyph_cache_reset(DvzGlyphAtlas* atlas)
+{
+    ASSERT(atlas != NULL);
+    dvz_hash_table_destroy(&atlas->cache);
+    for (uint32_t i = 0; i < atlas->glyph_count; i++)
+        dvz_hash_table_set(
+            &atlas->cache, _glyph_key(atlas->glyphs[i].font, atlas->glyphs[i].codepoint), i);
+}
+
+
+
+// Add a glyph to the cache.
+static DvzGlyph* _glyph_add(DvzGlyphAtlas* atlas, DvzGlyph* glyph)
+{
+    ASSERT(atlas != NULL);
+    ASSERT(glyph != NULL);
+
+    if (atlas->glyph_count == atlas->glyph_capacity)
+    {
+        atlas->glyph_capacity *= 2;
+        REALLOC(atlas->glyphs, atlas->glyph_capacity * sizeof(DvzGlyph));
+    }
+    uint32_t idx = atlas->glyph_count++;
+    atlas->glyphs[idx] = *glyph;
+    // A glyph inserted after a failed lookup replaces the entry marking it as missing.
+    if (!dvz_hash_table_set(&atlas->cache, _glyph_key(glyph->font, glyph->codepoint), idx))
+        _glyph_cache_reset(atlas);
+    return &atlas->glyphs[idx];
+}
+
+
+
+/*************************************************************************************************/
+/*  Rasterization                                                                                */
+/*************************************************************************************************/
+
+// Bilinear interpolation of the median of the 3 channels of the builtin MSDF font texture.
+static float _builtin_sample(DvzFontAtlas* font_atlas, float x, float y)
+{
+    ASSERT(font_atlas != NULL);
+    ASSERT(font_atlas->font_texture != NULL);
+    int32_t x0 = (int32_t)floorf(x), y0 = (int32_t)floorf(y);
+    float fx = x - x0, fy = y - y0;
+    int32_t xmax = (int32_t)font_atlas->width - 1, ymax = (int32_t)font_atlas->height - 1;
+    const uint8_t* pixel = NULL;
+    float c[3] = {0};
+    float w = 0;
+    for (int32_t j = 0; j < 2; j++)
+    {
+        for (int32_t i = 0; i < 2; i++)
+        {
+            w = (i ? fx : 1 - fx) * (j ? fy : 1 - fy);
+            pixel = &font_atlas->font_texture
+                         [4 * ((uint32_t)CLIP(y0 + j, 0, ymax) * font_atlas->width +
+                               (uint32_t)CLIP(x0 + i, 0, xmax))];
+            for (uint32_t k = 0; k < 3; k++)
+                c[k] += w * pixel[k];
+        }
+    }
+    return MAX(MIN(c[0], c[1]), MIN(MAX(c[0], c[1]), c[2]));
+}
+
+
+
+// Whether the builtin monospace font of the context has a glyph for a code point.
+static bool _glyph_has_builtin(DvzGlyphAtlas* atlas, uint32_t codepoint)
+{
+    ASSERT(atlas != NULL);
+    if (atlas->context == NULL || codepoint == 0 || codepoint >= 256)
+        return false;
+    DvzFontAtlas* font_atlas = &atlas->context->font_atlas;
+    return font_atlas->font_texture != NULL &&
+           font_atlas->glyphs[codepoint] < strlen(font_atlas->font_str);
+}
+
+
+
+// Resample a glyph of the builtin monospace font, the cell covers the whole line box.
+static bool
+_glyph_builtin(DvzGlyphAtlas* atlas, uint32_t font, uint32_t codepoint, DvzGlyph* glyph)
+{
+    ASSERT(atlas != NULL);
+    ASSERT(_glyph_has_builtin(atlas, codepoint));
+    DvzFontAtlas* font_atlas = &atlas->context->font_atlas;
+    ASSERT(font_atlas->cols > 0);
+    ASSERT(font_atlas->glyph_height > 0);
+
+    const uint32_t h = DVZ_GLYPH_SDF_SIZE;
+    const uint32_t w = (uint32_t)roundf(h * font_atlas->glyph_width / font_atlas->glyph_height);
+    uint32_t idx = font_atlas->glyphs[codepoint];
+    float x0 = (idx % font_atlas->cols) * font_atlas->glyph_width;
+    float y0 = (idx / font_atlas->cols) * font_atlas->glyph_height;
+    float scale = font_atlas->glyph_height / h;
+
+    // The median of the MSDF channels is above 128 inside the glyph, as the coverage.
+    uint8_t* coverage = (uint8_t*)calloc(w * h, 1);
+    bool blank = true;
+    float sx = 0, sy = 0;
+    for (uint32_t y = 0; y < h; y++)
+    {
+        sy = y0 + (y + .5f) * scale - .5f;
+        for (uint32_t x = 0; x < w; x++)
+        {
+            sx = x0 + (x + .5f) * scale - .5f;
+            coverage[y * w + x] = (uint8_t)CLIP(_builtin_sample(font_atlas, sx, sy), 0, 255);
+            blank &= coverage[y * w + x] < 128;
+        }
+    }
+    // Blank glyphs such as spaces only have an advance.
+    bool res = dvz_glyph_atlas_insert(
+        atlas, font, codepoint, blank ? 0 : w, blank ? 0 : h, coverage,
+        (vec2){0, DVZ_GLYPH_ASCENT * h}, w, glyph);
+    FREE(coverage);
+    return res;
+}
+
+
+
+#if HAS_FREETYPE
+static bool _glyph_freetype(
+    DvzGlyphAtlas* atlas, uint32_t font, uint32_t codepoint, FT_Face face, uint32_t glyph_idx,
+    DvzGlyph* glyph)
+{
+    ASSERT(atlas != NULL);
+    ASSERT(face != NULL);
+    if (FT_Load_Glyph(face, glyph_idx, FT_LOAD_RENDER) != 0)
+    {
+        log_warn("unable to rasterize glyph U+%04X", codepoint);
+        atlas->stats.failures++;
+        return false;
+    }
+
+    FT_GlyphSlot slot = face->glyph;
+    FT_Bitmap* bitmap = &slot->bitmap;
+    if (bitmap->pixel_mode != FT_PIXEL_MODE_GRAY && bitmap->rows > 0)
+    {
+        log_warn("unsupported pixel mode %d for glyph U+%04X", bitmap->pixel_mode, codepoint);
+        atlas->stats.failures++;
+        return false;
+    }
+
+    // Copy the bitmap as the pitch may be larger than the width, or negative.
+    uint8_t* coverage = (uint8_t*)calloc(MAX(1, bitmap->width * bitmap->rows), 1);
+    for (uint32_t y = 0; y < bitmap->rows; y++)
+        memcpy(
+            &coverage[y * bitmap->width], &bitmap->buffer[(int32_t)y * bitmap->pitch],
+            bitmap->width);
+    vec2 bearing = {(float)slot->bitmap_left, (float)slot->bitmap_top};
+    bool res = dvz_glyph_atlas_insert(
+        atlas, font, codepoint, bitmap->width, bitmap->rows, coverage, bearing,
+        slot->advance.x / 64.0f, glyph);
+    FREE(coverage);
+    return res;
+}
+#endif
+
+
+
+// Rasterize a glyph with the first font that has it, starting with the requested font, and
+// falling back to the builtin font.
+static bool
+_glyph_rasterize(DvzGlyphAtlas* atlas, uint32_t font, uint32_t codepoint, DvzGlyph* glyph)
+{
+    ASSERT(atlas != NULL);
+#if HAS_FREETYPE
+    for (uint32_t i = 0; i < atlas->font_count; i++)
+    {
+        FT_Face face = (FT_Face)atlas->faces[(font + i) % atlas->font_count];
+        uint32_t glyph_idx = FT_Get_Char_Index(face, codepoint);
+        if (glyph_idx != 0)
+            return _glyph_freetype(atlas, font, codepoint, face, glyph_idx, glyph);
+    }
+#endif
+    if (_glyph_has_builtin(atlas, codepoint))
+        return _glyph_builtin(atlas, font, codepoint, glyph);
+
+    log_debug("no font has a glyph for U+%04X", codepoint);
+    dvz_hash_table_set(&atlas->cache, _glyph_key(font, codepoint), DVZ_GLYPH_MISSING);
+    atlas->stats.failures++;
+    return false;
+}
+
+
+
+/*************************************************************************************************/
+/*  Glyph atlas                                                                                  */
+/*************************************************************************************************/
+
+DvzGlyphAtlas dvz_glyph_atlas(DvzContext* context, uint32_t width, uint32_t height)
+{
+    ASSERT(width > 0);
+    ASSERT(height > 0);
+    log_debug("create glyph atlas %dx%d", width, height);
+
+    DvzGlyphAtlas atlas = {0};
+    atlas.context = context;
+    atlas.width = width;
+    atlas.height = height;
+    atlas.pixels = (uint8_t*)calloc(width * height, sizeof(uint8_t));
+    atlas.skyline = dvz_skyline(width, height);
+
+    // The whole texture is uploaded the first time.
+    atlas.dirty_min = 0;
+    atlas.dirty_max = height;
+
+    atlas.glyph_capacity = DVZ_GLYPH_CACHE_DEFAULT;
+    atlas.glyphs = (DvzGlyph*)calloc(atlas.glyph_capacity, sizeof(DvzGlyph));
+
+    if (context != NULL)
+    {
+        atlas.texture =
+            dvz_ctx_texture(context, 2, (uvec3){width, height, 1}, VK_FORMAT_R8_UNORM);
+        // NOTE: the distance field must be interpolated
+        dvz_texture_filter(atlas.texture, DVZ_FILTER_MAG, VK_FILTER_LINEAR);
+        dvz_texture_filter(atlas.texture, DVZ_FILTER_MIN, VK_FILTER_LINEAR);
+    }
+
+#if HAS_FREETYPE
+    FT_Library library = NULL;
+    if (FT_Init_FreeType(&library) != 0)
+        log_error("unable to initialize FreeType");
+    atlas.library = library;
+#endif
+
+    dvz_obj_created(&atlas.obj);
+    return atlas;
+}
+
+
+
+DvzGlyphAtlas* dvz_ctx_glyph_atlas(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    if (context->glyph_atlas == NULL)
+    {
+        context->glyph_atlas = (DvzGlyphAtlas*)calloc(1, sizeof(DvzGlyphAtlas));
+        *context->glyph_atlas =
+            dvz_glyph_atlas(context, DVZ_GLYPH_ATLAS_SIZE, DVZ_GLYPH_ATLAS_SIZE);
+    }
+    return context->glyph_atlas;
+}
+
+
+
+int dvz_glyph_atlas_font(DvzGlyphAtlas* atlas, const char* path)
+{
+    ASSERT(atlas != NULL);
+    ASSERT(path != NULL);
+    if (atlas->font_count >= DVZ_GLYPH_MAX_FONTS)
+    {
+        log_error("maximum number of fonts %d reached", DVZ_GLYPH_MAX_FONTS);
+        return -1;
+    }
+#if HAS_FREETYPE
+    if (atlas->library == NULL)
+        return -1;
+    FT_Face face = NULL;
+    if (FT_New_Face((FT_Library)atlas->library, path, 0, &face) != 0)
+    {
+        log_error("unable to load font %s", path);
+        return -1;
+    }
+    if (FT_Set_Pixel_Sizes(face, 0, DVZ_GLYPH_SDF_SIZE) != 0)
+    {
+        log_error("unable to set the size of font %s", path);
+        FT_Done_Face(face);
+        return -1;
+    }
+    log_debug("load font %s with %d glyphs", path, (int)face->num_glyphs);
+    atlas->faces[atlas->font_count] = face;
+    // The new font may have the glyphs missing from the other fonts.
+    _glyph_cache_reset(atlas);
+    return (int)atlas->font_count++;
+#else
+    log_error("unable to load font %s, datoviz was built without FreeType support", path);
+    return -1;
+#endif
+}
+
+
+
+bool dvz_glyph_atlas_glyph(DvzGlyphAtlas* atlas, uint32_t font, uint32_t codepoint, DvzGlyph* glyph)
+{
+    ASSERT(atlas != NULL);
+    ASSERT(glyph != NULL);
+
+    bool missing = false;
+    DvzGlyph* cached = _glyph_get(atlas, font, codepoint, &missing);
+    if (cached != NULL || missing)
+    {
+        atlas->stats.hits++;
+        if (cached != NULL)
+            *glyph = *cached;
+        return cached != NULL;
+    }
+
+    atlas->stats.misses++;
+    // Without any loaded font, all glyphs come from the builtin font.
+    if (atlas->font_count > 0 && font >= atlas->font_count)
+    {
+        log_error("unknown font %d", font);
+        atlas->stats.failures++;
+        return false;
+    }
+    return _glyph_rasterize(atlas, font, codepoint, glyph);
+}
+
+
+
+bool dvz_glyph_atlas_insert(
+    DvzGlyphAtlas* atlas, uint32_t font, uint32_t codepoint, uint32_t width, uint32_t height,
+    const uint8_t* coverage, vec2 bearing, float advance, DvzGlyph* glyph)
+{
+    ASSERT(atlas != NULL);
+    ASSERT(glyph != NULL);
+    ASSERT(_glyph_get(atlas, font, codepoint, NULL) == NULL);
+
+    DvzGlyph g = {0};
+    g.font = font;
+    g.codepoint = codepoint;
+    g.bearing[0] = bearing[0];
+    g.bearing[1] = bearing[1];
+    g.advance = advance;
+
+    // Blank glyphs such as spaces only have an advance.
+    if (width > 0 && height > 0)
+    {
+        ASSERT(coverage != NULL);
+        const uint32_t s = DVZ_GLYPH_SDF_SPREAD;
+        uvec2 pos = {0};
+        if (!dvz_skyline_pack(
+                &atlas->skyline, width + 2 * s + DVZ_GLYPH_PADDING,
+                height + 2 * s + DVZ_GLYPH_PADDING, pos))
+        {
+            if (!atlas->is_full)
+                log_warn(
+                    "glyph atlas %dx%d is full, cannot add glyph U+%04X", //
+                    atlas->width, atlas->height, codepoint);
+            atlas->is_full = true;
+            atlas->stats.failures++;
+            return false;
+        }
+
+        g.x = pos[0];
+        g.y = pos[1];
+        g.width = width + 2 * s;
+        g.height = height + 2 * s;
+        g.uv[0] = g.x / (float)atlas->width;
+        g.uv[1] = g.y / (float)atlas->height;
+        g.uv[2] = (g.x + g.width) / (float)atlas->width;
+        g.uv[3] = (g.y + g.height) / (float)atlas->height;
+        g.bearing[0] -= s;
+        g.bearing[1] += s;
+
+        _sdf_compute(
+            width, height, coverage, &atlas->pixels[g.y * atlas->width + g.x], atlas->width);
+        atlas->dirty_min = MIN(atlas->dirty_min, g.y);
+        atlas->dirty_max = MAX(atlas->dirty_max, g.y + g.height);
+    }
+
+    *glyph = *_glyph_add(atlas, &g);
+    return true;
+}
+
+
+
+void dvz_glyph_atlas_upload(DvzGlyphAtlas* atlas, DvzCanvas* canvas)
+{
+    ASSERT(atlas != NULL);
+    ASSERT(canvas != NULL);
+    if (atlas->texture == NULL || atlas->dirty_min >= atlas->dirty_max)
+        return;
+
+    // The rows are contiguous in the CPU copy, which stays alive until the transfer is done.
+    uint32_t rows = atlas->dirty_max - atlas->dirty_min;
+    VkDeviceSize size = (VkDeviceSize)atlas->width * rows;
+    log_debug("upload %d rows of the glyph atlas", rows);
+    dvz_upload_texture(
+        canvas, atlas->texture, (uvec3){0, atlas->dirty_min, 0}, (uvec3){atlas->width, rows, 1},
+        size, &atlas->pixels[atlas->dirty_min * atlas->width]);
+    atlas->stats.uploaded_bytes += size;
+
+    atlas->dirty_min = atlas->height;
+    atlas->dirty_max = 0;
+}
+
+
+
+DvzGlyphAtlasStats dvz_glyph_atlas_stats(DvzGlyphAtlas* atlas)
+{
+    ASSERT(atlas != NULL);
+    DvzGlyphAtlasStats stats = atlas->stats;
+    stats.glyph_count = atlas->glyph_count;
+    stats.font_count = atlas->font_count;
+    stats.occupancy =
+        atlas->skyline.used_area / ((float)atlas->skyline.width * atlas->skyline.height);
+    return stats;
+}
+
+
+
+void dvz_glyph_atlas_destroy(DvzGlyphAtlas* atlas)
+{
+    ASSERT(atlas != NULL);
+    if (!dvz_obj_is_created(&atlas->obj))
+    {
+        log_trace("skip destruction of already-destroyed glyph atlas");
+        return;
+    }
+    log_trace("destroy glyph atlas");
+
+#if HAS_FREETYPE
+    for (uint32_t i = 0; i < atlas->font_count; i++)
+        FT_Done_Face((FT_Face)atlas->faces[i]);
+    if (atlas->library != NULL)
+        FT_Done_FreeType((FT_Library)atlas->library);
+#endif
+
+    dvz_skyline_destroy(&atlas->skyline);
+    FREE(atlas->pixels);
+    dvz_hash_table_destroy(&atlas->cache);
+    FREE(atlas->glyphs);
+    dvz_obj_destroyed(&atlas->obj);
+}
@@ -3,6 +3,8 @@
 #include "../include/datoviz/atlas.h"
 #include "../include/datoviz/canvas.h"
 #include "../include/datoviz/context.h"
+#include "../include/datoviz/glyphs.h"
+#include "vklite_utils.h"
 
 
 /*************************************************************************************************/
@@ -15,16 +17,41 @@
 /*  Utils                                                                                       */
 /*************************************************************************************************/
 
+// Record the SPIRV code of a builtin shader, the shader module is created by _create_shaders()
+// only if the registry has no matching pipeline.
 static inline void _load_shader(
     DvzGraphics* graphics, VkShaderStageFlagBits stage, //
     VkDeviceSize size, const unsigned char* buffer)
 {
+    ASSERT(graphics != NULL);
     ASSERT(buffer != NULL);
-    uint32_t* code = (uint32_t*)calloc(size, 1);
-    memcpy(code, buffer, size);
     ASSERT(size % 4 == 0);
-    dvz_graphics_shader_spirv(graphics, stage, size, code);
-    FREE(code);
+    ASSERT(graphics->shader_count < DVZ_MAX_SHADERS_PER_GRAPHICS);
+    uint32_t i = graphics->shader_count++;
+    graphics->shader_stages[i] = stage;
+    graphics->shader_spirv[i] = buffer;
+    graphics->shader_spirv_size[i] = size;
+    graphics->shader_hash =
+        dvz_hash(dvz_hash(graphics->shader_hash, &stage, sizeof(stage)), buffer, size);
+}
+
+static void _create_shaders(DvzGraphics* graphics)
+{
+    ASSERT(graphics != NULL);
+    ASSERT(graphics->gpu != NULL);
+    uint32_t* code = NULL;
+    VkDeviceSize size = 0;
+    for (uint32_t i = 0; i < graphics->shader_count; i++)
+    {
+        if (graphics->shader_modules[i] != VK_NULL_HANDLE || graphics->shader_spirv[i] == NULL)
+            continue;
+        // The resource may not be aligned on 4 bytes.
+        size = graphics->shader_spirv_size[i];
+        code = (uint32_t*)calloc(size, 1);
+        memcpy(code, graphics->shader_spirv[i], size);
+        graphics->shader_modules[i] = create_shader_module(graphics->gpu->device, size, code);
+        FREE(code);
+    }
 }
 
 #define SHADER(stage, x)                                                                          \
@@ -42,8 +69,6 @@ static inline void _load_shader(
     dvz_graphics_polygon_mode(graphics, VK_POLYGON_MODE_FILL);
 
 
-#define CREATE dvz_graphics_create(graphics);
-
 #define ATTR_BEGIN(t)                                                                             \
     dvz_graphics_vertex_binding(graphics, 0, sizeof(t));                                          \
     uint32_t attr_idx = 0;
@@ -89,8 +114,6 @@ static void _graphics_point(DvzCanvas* canvas, DvzGraphics* graphics)
 
     _common_slots(graphics);
     dvz_graphics_slot(graphics, DVZ_USER_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-
-    CREATE
 }
 
 static void _graphics_basic(DvzCanvas* canvas, DvzGraphics* graphics, VkPrimitiveTopology topology)
@@ -111,8 +134,6 @@ static void _graphics_basic(DvzCanvas* canvas, DvzGraphics* graphics, VkPrimitiv
     ATTR_COL(DvzVertex, color)
 
     _common_slots(graphics);
-
-    CREATE
 }
 
 
@@ -141,8 +162,6 @@ static void _graphics_marker(DvzCanvas* canvas, DvzGraphics* graphics)
 
     _common_slots(graphics);
     dvz_graphics_slot(graphics, DVZ_USER_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-
-    CREATE
 }
 
 
@@ -202,8 +221,6 @@ static void _graphics_segment(DvzCanvas* canvas, DvzGraphics* graphics)
 
     _common_slots(graphics);
     dvz_graphics_callback(graphics, _graphics_segment_callback);
-
-    CREATE
 }
 
 
@@ -252,8 +269,6 @@ static void _graphics_path(DvzCanvas* canvas, DvzGraphics* graphics)
     dvz_graphics_slot(graphics, DVZ_USER_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
 
     dvz_graphics_callback(graphics, _graphics_path_callback);
-
-    CREATE
 }
 
 
@@ -262,6 +277,81 @@ static void _graphics_path(DvzCanvas* canvas, DvzGraphics* graphics)
 /*  Text graphics                                                                             */
 /*************************************************************************************************/
 
+// Write the 4 identical vertices of each glyph of a string, return the number of glyph slots,
+// one per byte of the string. The slots left by the multibyte characters are empty glyphs.
+static uint32_t _text_glyphs(
+    DvzGlyphAtlas* atlas, const DvzGraphicsTextItem* str_item, uint32_t group,
+    DvzGraphicsTextVertex* out)
+{
+    ASSERT(atlas != NULL);
+    ASSERT(str_item != NULL);
+    ASSERT(str_item->string != NULL);
+    ASSERT(out != NULL);
+
+    const char* str = str_item->string;
+    uint32_t n = strlen(str);
+    ASSERT(n > 0);
+
+    // The string attributes are the same for all glyphs.
+    DvzGraphicsTextVertex vertex = str_item->vertex;
+    vertex.glyph[2] = n;     // str len
+    vertex.glyph[3] = group; // str idx
+
+    // The glyph metrics are scaled from the rasterization size to the font size.
+    const float font_size = str_item->font_size;
+    const float k = font_size / DVZ_GLYPH_SDF_SIZE;
+    DvzGlyph glyph = {0};
+    float pen = 0;
+    uint32_t codepoint = 0;
+    uint32_t i = 0;
+    for (; (codepoint = dvz_utf8_next(&str)) != 0; i++)
+    {
+        ASSERT(i < n);
+        vertex.glyph[0] = (uint16_t)MIN(codepoint, UINT16_MAX); // char
+        vertex.glyph[1] = i;                                    // char idx
+
+        // Missing glyphs are replaced by a question mark.
+        if (!dvz_glyph_atlas_glyph(atlas, 0, codepoint, &glyph) &&
+            !dvz_glyph_atlas_glyph(atlas, 0, '?', &glyph))
+            memset(&glyph, 0, sizeof(glyph));
+
+        // Glyph quad, from the top of the line box.
+        vertex.glyph_shift[0] = pen + glyph.bearing[0] * k;
+        vertex.glyph_shift[1] = DVZ_GLYPH_ASCENT * font_size - glyph.bearing[1] * k;
+        vertex.glyph_size[0] = glyph.width * k;
+        vertex.glyph_size[1] = glyph.height * k;
+        memcpy(vertex.uv, glyph.uv, sizeof(vec4));
+        pen += glyph.advance * k;
+
+        // Glyph colors.
+        if (str_item->glyph_colors != NULL)
+            memcpy(vertex.color, str_item->glyph_colors[i], sizeof(cvec4));
+
+        // The 4 vertices of the glyph are identical, the vertex shader computes the corners.
+        out[4 * i + 0] = vertex;
+        out[4 * i + 1] = vertex;
+        out[4 * i + 2] = vertex;
+        out[4 * i + 3] = vertex;
+    }
+
+    // Empty glyphs in the remaining slots.
+    vertex.glyph_size[0] = vertex.glyph_size[1] = 0;
+    for (uint32_t j = i; j < n; j++)
+    {
+        vertex.glyph[1] = j;
+        for (uint32_t v = 0; v < 4; v++)
+            out[4 * j + v] = vertex;
+    }
+
+    // The string size is only known once all glyphs have been laid out.
+    for (uint32_t j = 0; j < 4 * n; j++)
+    {
+        out[j].string_size[0] = pen;
+        out[j].string_size[1] = font_size;
+    }
+    return n;
+}
+
 static void _graphics_text_callback(DvzGraphicsData* data, uint32_t item_count, const void* item)
 {
     // NOTE: item_count is the total number of glyphs
@@ -271,7 +361,7 @@ static void _graphics_text_callback(DvzGraphicsData* data, uint32_t item_count,
 
     ASSERT(item_count > 0);
     dvz_array_resize(data->vertices, 4 * item_count);
-    DvzFontAtlas* atlas = &data->graphics->gpu->context->font_atlas;
+    DvzGlyphAtlas* atlas = dvz_ctx_glyph_atlas(data->graphics->gpu->context);
     ASSERT(atlas != NULL);
 
     if (item == NULL)
@@ -279,35 +369,12 @@ static void _graphics_text_callback(DvzGraphicsData* data, uint32_t item_count,
     ASSERT(item != NULL);
     ASSERT(data->current_idx < item_count);
 
-    // const char* str = item;
     const DvzGraphicsTextItem* str_item = item;
-    uint32_t n = strlen(str_item->string);
-    DvzGraphicsTextVertex vertex = {0};
-    vertex = str_item->vertex;
-    ASSERT(n > 0);
-    ASSERT(data->current_idx + n <= item_count);
-    for (uint32_t i = 0; i < n; i++)
-    {
-        size_t g = _font_atlas_glyph(atlas, str_item->string, i);
-
-        // Glyph size.
-        _font_atlas_glyph_size(atlas, str_item->font_size, vertex.glyph_size);
-
-        // Glyph.
-        vertex.glyph[0] = g;                   // char
-        vertex.glyph[1] = i;                   // char idx
-        vertex.glyph[2] = n;                   // str len
-        vertex.glyph[3] = data->current_group; // str idx
-
-        // Glyph colors.
-        if (str_item->glyph_colors != NULL)
-            memcpy(vertex.color, str_item->glyph_colors[i], sizeof(cvec4));
-
-        // Fill the vertices array by simply repeating them 4 times.
-        dvz_array_data(data->vertices, 4 * data->current_idx, 4, 1, &vertex);
-        data->current_idx++; // glyph index
-    }
-    data->current_group++; // glyph index
+    ASSERT(data->current_idx + strlen(str_item->string) <= item_count);
+    DvzGraphicsTextVertex* vertices = (DvzGraphicsTextVertex*)data->vertices->data;
+    data->current_idx += // glyph index
+        _text_glyphs(atlas, str_item, data->current_group, &vertices[4 * data->current_idx]);
+    data->current_group++; // string index
 }
 
 static void _graphics_text(DvzCanvas* canvas, DvzGraphics* graphics)
@@ -325,14 +392,15 @@ static void _graphics_text(DvzCanvas* canvas, DvzGraphics* graphics)
     ATTR(DvzGraphicsTextVertex, VK_FORMAT_R32_SFLOAT, angle)
     ATTR(DvzGraphicsTextVertex, VK_FORMAT_R16G16B16A16_UINT, glyph)
     ATTR(DvzGraphicsTextVertex, VK_FORMAT_R8_UINT, transform)
+    ATTR(DvzGraphicsTextVertex, VK_FORMAT_R32G32_SFLOAT, glyph_shift)
+    ATTR(DvzGraphicsTextVertex, VK_FORMAT_R32G32_SFLOAT, string_size)
+    ATTR(DvzGraphicsTextVertex, VK_FORMAT_R32G32B32A32_SFLOAT, uv)
 
     _common_slots(graphics);
     dvz_graphics_slot(graphics, DVZ_USER_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
     dvz_graphics_slot(graphics, DVZ_USER_BINDING + 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 
     dvz_graphics_callback(graphics, _graphics_text_callback);
-
-    CREATE
 }
 
 
@@ -393,8 +461,6 @@ static void _graphics_image(DvzCanvas* canvas, DvzGraphics* graphics)
         dvz_graphics_slot(
             graphics, DVZ_USER_BINDING + i, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 
-    CREATE
-
     dvz_graphics_callback(graphics, _graphics_image_callback);
 }
 
@@ -421,8 +487,6 @@ static void _graphics_image_cmap(DvzCanvas* canvas, DvzGraphics* graphics)
     // Scalar image.
     dvz_graphics_slot(graphics, DVZ_USER_BINDING + 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 
-    CREATE
-
     dvz_graphics_callback(graphics, _graphics_image_callback);
 }
 
@@ -485,8 +549,6 @@ static void _graphics_volume_slice(DvzCanvas* canvas, DvzGraphics* graphics)
     dvz_graphics_slot(graphics, DVZ_USER_BINDING + 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
     dvz_graphics_slot(graphics, DVZ_USER_BINDING + 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 
-    CREATE
-
     dvz_graphics_callback(graphics, _graphics_volume_slice_callback);
 }
 
@@ -594,8 +656,6 @@ static void _graphics_volume(DvzCanvas* canvas, DvzGraphics* graphics)
     dvz_graphics_slot(graphics, DVZ_USER_BINDING + 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
     dvz_graphics_slot(graphics, DVZ_USER_BINDING + 2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 
-    CREATE
-
     dvz_graphics_callback(graphics, _graphics_volume_callback);
 }
 
@@ -625,8 +685,6 @@ static void _graphics_mesh(DvzCanvas* canvas, DvzGraphics* graphics)
     for (uint32_t i = 1; i <= 4; i++)
         dvz_graphics_slot(
             graphics, DVZ_USER_BINDING + i, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-
-    CREATE
 }
 
 
@@ -714,48 +772,171 @@ void dvz_graphics_append(DvzGraphicsData* data, const void* item)
 
 
 
+void dvz_graphics_append_text(
+    DvzGraphicsData* data, uint32_t count, const DvzGraphicsTextItem* items)
+{
+    ASSERT(data != NULL);
+    ASSERT(data->vertices != NULL);
+    ASSERT(items != NULL || count == 0);
+    DvzGraphics* graphics = data->graphics;
+    ASSERT(graphics != NULL);
+    ASSERT(graphics->type == DVZ_GRAPHICS_TEXT);
+    ASSERT(data->vertices->item_count >= 4 * data->item_count);
+
+    DvzGlyphAtlas* atlas = dvz_ctx_glyph_atlas(graphics->gpu->context);
+    DvzGraphicsTextVertex* vertices = (DvzGraphicsTextVertex*)data->vertices->data;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ASSERT(data->current_idx + strlen(items[i].string) <= data->item_count);
+        data->current_idx +=
+            _text_glyphs(atlas, &items[i], data->current_group++, &vertices[4 * data->current_idx]);
+    }
+}
+
+
+
 /*************************************************************************************************/
 /*  Graphics builtin                                                                             */
 /*************************************************************************************************/
 
-static DvzGraphics* _find_graphics(DvzCanvas* canvas, DvzGraphicsType type, int flags)
+// Pipeline state compared to find an existing graphics pipeline.
+static DvzGraphicsKey _graphics_key(DvzGraphics* graphics)
 {
-    ASSERT(canvas != NULL);
-    ASSERT(type != DVZ_GRAPHICS_CUSTOM);
+    ASSERT(graphics != NULL);
+    ASSERT(graphics->renderpass != NULL);
+
+    DvzGraphicsKey key = {0};
+    key.type = graphics->type;
+    key.flags = graphics->flags;
+    key.subpass = graphics->subpass;
+    key.topology = graphics->topology;
+    key.blend_type = graphics->blend_type;
+    key.depth_test = graphics->depth_test;
+    key.polygon_mode = graphics->polygon_mode;
+    key.cull_mode = graphics->cull_mode;
+    key.front_face = graphics->front_face;
+
+    // A pipeline can be used with any render pass with the same formats and subpasses.
+    DvzRenderpass* renderpass = graphics->renderpass;
+    uint64_t h = DVZ_HASH_SEED;
+    for (uint32_t i = 0; i < renderpass->attachment_count; i++)
+        h = dvz_hash(h, &renderpass->attachments[i].format, sizeof(VkFormat));
+    h = dvz_hash(
+        h, renderpass->subpasses, renderpass->subpass_count * sizeof(DvzRenderpassSubpass));
+    key.renderpass = h;
+
+    // The vertex structs are hashed field by field as they have padding bytes.
+    h = DVZ_HASH_SEED;
+    for (uint32_t i = 0; i < graphics->vertex_binding_count; i++)
+    {
+        DvzVertexBinding* vb = &graphics->vertex_bindings[i];
+        h = dvz_hash(h, &vb->binding, sizeof(vb->binding));
+        h = dvz_hash(h, &vb->stride, sizeof(vb->stride));
+    }
+    for (uint32_t i = 0; i < graphics->vertex_attr_count; i++)
+    {
+        DvzVertexAttr* va = &graphics->vertex_attrs[i];
+        h = dvz_hash(h, &va->binding, sizeof(va->binding));
+        h = dvz_hash(h, &va->location, sizeof(va->location));
+        h = dvz_hash(h, &va->format, sizeof(va->format));
+        h = dvz_hash(h, &va->offset, sizeof(va->offset));
+    }
+    key.vertex = h;
+
+    DvzSlots* slots = &graphics->slots;
+    h = DVZ_HASH_SEED;
+    h = dvz_hash(h, slots->types, slots->slot_count * sizeof(VkDescriptorType));
+    h = dvz_hash(h, slots->push_offsets, slots->push_count * sizeof(VkDeviceSize));
+    h = dvz_hash(h, slots->push_sizes, slots->push_count * sizeof(VkDeviceSize));
+    h = dvz_hash(h, slots->push_shaders, slots->push_count * sizeof(VkShaderStageFlags));
+    key.slots = h;
+
+    key.shaders = graphics->shader_hash;
+    return key;
+}
+
+
+
+static bool _graphics_key_equal(DvzGraphicsKey* k0, DvzGraphicsKey* k1)
+{
+    ASSERT(k0 != NULL);
+    ASSERT(k1 != NULL);
+    return k0->type == k1->type && k0->flags == k1->flags && k0->renderpass == k1->renderpass &&
+           k0->subpass == k1->subpass && k0->topology == k1->topology &&
+           k0->blend_type == k1->blend_type && k0->depth_test == k1->depth_test &&
+           k0->polygon_mode == k1->polygon_mode && k0->cull_mode == k1->cull_mode &&
+           k0->front_face == k1->front_face && k0->vertex == k1->vertex &&
+           k0->slots == k1->slots && k0->shaders == k1->shaders;
+}
+
+
 
-    DvzContainerIterator iter = dvz_container_iterator(&canvas->graphics);
-    DvzGraphics* graphics = NULL;
-    if (iter.item != NULL)
+static DvzGraphicsEntry* _find_graphics(DvzGraphicsRegistry* registry, DvzGraphicsKey* key)
+{
+    ASSERT(registry != NULL);
+    ASSERT(key != NULL);
+    for (uint32_t i = 0; i < registry->count; i++)
     {
-        graphics = iter.item;
-        if (graphics->type == type && graphics->flags == flags)
-            return graphics;
-        dvz_container_iter(&iter);
+        if (_graphics_key_equal(&registry->entries[i].key, key))
+            return &registry->entries[i];
     }
     return NULL;
 }
 
 
 
-DvzGraphics* dvz_graphics_builtin(DvzCanvas* canvas, DvzGraphicsType type, int flags)
+// Keep track of the builtin graphics requested by a canvas, to release them with the canvas.
+static void _graphics_ref(DvzCanvas* canvas, DvzGraphics* graphics)
 {
     ASSERT(canvas != NULL);
-    ASSERT(canvas->gpu != NULL);
-    ASSERT(type != DVZ_GRAPHICS_NONE);
-    ASSERT(canvas->graphics.capacity > 0);
+    if (canvas->graphics_ref_count >= canvas->graphics_ref_capacity)
+    {
+        canvas->graphics_ref_capacity = MAX(16, 2 * canvas->graphics_ref_capacity);
+        REALLOC(canvas->graphics_refs, canvas->graphics_ref_capacity * sizeof(DvzGraphics*));
+    }
+    canvas->graphics_refs[canvas->graphics_ref_count++] = graphics;
+}
 
-    // Try to find an existing graphics with the requested type and flags.
-    DvzGraphics* graphics = _find_graphics(canvas, type, flags);
-    if (graphics != NULL)
-        return graphics;
 
-    // If there is none, create a new one.
-    graphics = dvz_container_alloc(&canvas->graphics);
+
+// Create the pipeline of a new graphics and add it to the registry.
+static DvzGraphicsEntry*
+_graphics_register(DvzContext* context, DvzGraphics* specified, DvzGraphicsKey* key)
+{
+    ASSERT(context != NULL);
+    ASSERT(specified != NULL);
+    DvzGraphicsRegistry* registry = &context->graphics_registry;
+
+    DvzGraphics* graphics = dvz_container_alloc(&context->graphics);
     ASSERT(graphics != NULL);
     ASSERT(!dvz_obj_is_created(&graphics->obj));
-    *graphics = dvz_graphics(canvas->gpu);
-    graphics->type = type;
-    graphics->flags = flags;
+    *graphics = *specified;
+    _create_shaders(graphics);
+    dvz_graphics_create(graphics);
+    registry->created++;
+    log_debug(
+        "create graphics pipeline #%d (type %d, flags %d), %d requests", registry->count,
+        graphics->type, graphics->flags, (int)registry->requests);
+
+    if (registry->count >= registry->capacity)
+    {
+        registry->capacity = MAX(16, 2 * registry->capacity);
+        REALLOC(registry->entries, registry->capacity * sizeof(DvzGraphicsEntry));
+    }
+    DvzGraphicsEntry* entry = &registry->entries[registry->count++];
+    entry->key = *key;
+    entry->graphics = graphics;
+    entry->ref_count = 0;
+    return entry;
+}
+
+
+
+static void _graphics_build(DvzCanvas* canvas, DvzGraphics* graphics)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(graphics != NULL);
+    DvzGraphicsType type = graphics->type;
 
     switch (type)
     {
@@ -830,15 +1011,93 @@ DvzGraphics* dvz_graphics_builtin(DvzCanvas* canvas, DvzGraphicsType type, int f
         _graphics_mesh(canvas, graphics);
         break;
 
-    case DVZ_GRAPHICS_CUSTOM:
-        break;
-
     default:
         log_error("no graphics type specified");
         break;
     }
+}
+
+
+
+DvzGraphics* dvz_graphics_builtin(DvzCanvas* canvas, DvzGraphicsType type, int flags)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(canvas->gpu != NULL);
+    ASSERT(type != DVZ_GRAPHICS_NONE);
+    ASSERT(canvas->graphics.capacity > 0);
+    DvzContext* context = canvas->gpu->context;
+    ASSERT(context != NULL);
+
+    // Custom graphics are not shared as they are specified after their creation.
+    if (type == DVZ_GRAPHICS_CUSTOM)
+    {
+        DvzGraphics* graphics = dvz_container_alloc(&canvas->graphics);
+        ASSERT(graphics != NULL);
+        *graphics = dvz_graphics(canvas->gpu);
+        graphics->type = type;
+        graphics->flags = flags;
+        return graphics;
+    }
+
+    // Specify the graphics, without creating the shader modules and the pipeline yet.
+    DvzGraphics tmp = dvz_graphics(canvas->gpu);
+    tmp.type = type;
+    tmp.flags = flags;
+    _graphics_build(canvas, &tmp);
+
+    // Try to find an existing pipeline with the same state.
+    DvzGraphicsRegistry* registry = &context->graphics_registry;
+    registry->requests++;
+    DvzGraphicsKey key = _graphics_key(&tmp);
+    DvzGraphicsEntry* entry = _find_graphics(registry, &key);
 
-    return graphics;
+    // If there is none, create a new one.
+    if (entry == NULL)
+        entry = _graphics_register(context, &tmp, &key);
+
+    ASSERT(entry != NULL);
+    entry->ref_count++;
+    _graphics_ref(canvas, entry->graphics);
+    return entry->graphics;
+}
+
+
+
+void dvz_graphics_release(DvzContext* context, DvzGraphics* graphics)
+{
+    ASSERT(context != NULL);
+    ASSERT(graphics != NULL);
+    DvzGraphicsRegistry* registry = &context->graphics_registry;
+    for (uint32_t i = 0; i < registry->count; i++)
+    {
+        DvzGraphicsEntry* entry = &registry->entries[i];
+        if (entry->graphics != graphics)
+            continue;
+        ASSERT(entry->ref_count > 0);
+        if (--entry->ref_count > 0)
+            return;
+
+        // The GPU must be idle as the pipeline may be used by another canvas.
+        log_trace("destroy unused graphics pipeline");
+        dvz_gpu_wait(context->gpu);
+        dvz_graphics_destroy(graphics);
+        registry->entries[i] = registry->entries[--registry->count];
+        return;
+    }
+    log_warn("graphics pipeline not found in the registry");
+}
+
+
+
+DvzGraphicsStats dvz_graphics_stats(DvzContext* context)
+{
+    ASSERT(context != NULL);
+    DvzGraphicsRegistry* registry = &context->graphics_registry;
+    DvzGraphicsStats stats = {0};
+    stats.requests = registry->requests;
+    stats.created = registry->created;
+    stats.count = registry->count;
+    return stats;
 }
 
 
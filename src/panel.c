@@ -224,14 +224,11 @@ DvzPanel* dvz_panel(DvzGrid* grid, uint32_t row, uint32_t col)
     panel->data_coords.transform = DVZ_TRANSFORM_CARTESIAN;
     panel->data_coords.transpose = DVZ_CDS_TRANSPOSE_NONE;
 
-    // NOTE: for now just use a single command buffer, as using multiple command buffers
-    // is complicated since we need to use multiple render passes and framebuffers.
-    panel->cmds = &grid->canvas->cmds_render;
-    // Tag the DvzCommands instance with the panel index, so that the REFILL callback knows
-    // which DvzCommands corresponds to which panel.
-    // panel->cmds = dvz_canvas_commands(
-    //     grid->canvas, DVZ_DEFAULT_QUEUE_RENDER, DVZ_COMMANDS_GROUP_PANELS, grid->panel_count -
-    //     1);
+    // Secondary command buffers executed by the canvas render command buffers, within the
+    // canvas render pass. They are recorded at the first refill.
+    panel->cmds =
+        dvz_commands_secondary(canvas->gpu, DVZ_DEFAULT_QUEUE_RENDER, canvas->cmds_render.count);
+    memset(panel->cmds_dirty, 1, DVZ_MAX_SWAPCHAIN_IMAGES);
 
     // MVP uniform buffer.
     uint32_t n = canvas->swapchain.img_count;
@@ -270,6 +267,36 @@ void dvz_panel_update(DvzPanel* panel)
 
 
 
+void dvz_panel_to_refill(DvzPanel* panel)
+{
+    ASSERT(panel != NULL);
+    ASSERT(panel->grid != NULL);
+    memset(panel->cmds_dirty, 1, DVZ_MAX_SWAPCHAIN_IMAGES);
+    dvz_canvas_to_refill_cached(panel->grid->canvas);
+}
+
+
+
+void dvz_panel_batch(DvzPanel* panel, bool batch)
+{
+    ASSERT(panel != NULL);
+    DvzCanvas* canvas = panel->grid->canvas;
+    ASSERT(canvas != NULL);
+    if (panel->batch == batch)
+        return;
+
+    // The indirect draw commands are written by the CPU when recording the command buffers.
+    if (batch && panel->br_draws.buffer == NULL)
+        panel->br_draws = dvz_ctx_buffers(
+            canvas->gpu->context, DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE, panel->cmds.count,
+            DVZ_MAX_BATCH_DRAWS * sizeof(VkDrawIndirectCommand));
+
+    panel->batch = batch;
+    dvz_panel_to_refill(panel);
+}
+
+
+
 void dvz_panel_margins(DvzPanel* panel, vec4 margins)
 {
     ASSERT(panel != NULL);
@@ -302,6 +329,7 @@ void dvz_panel_visual(DvzPanel* panel, DvzVisual* visual)
     ASSERT(panel != NULL);
     ASSERT(visual != NULL);
     panel->visuals[panel->visual_count++] = visual;
+    memset(panel->cmds_dirty, 1, DVZ_MAX_SWAPCHAIN_IMAGES);
 }
 
 
@@ -433,5 +461,6 @@ void dvz_panel_destroy(DvzPanel* panel)
     {
         dvz_visual_destroy(panel->visuals[i]);
     }
+    dvz_commands_destroy(&panel->cmds);
     dvz_obj_destroyed(&panel->obj);
 }
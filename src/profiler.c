@@ -0,0 +1,267 @@
+#include "../include/datoviz/profiler.h"
+#include <inttypes.h>
+
+
+
+/*************************************************************************************************/
+/*  Utils                                                                                        */
+/*************************************************************************************************/
+
+static const char* GPU_RANGE_NAMES[] = {"gpu_render", "gpu_transfer"};
+static const char* COUNTER_NAMES[] = {"upload_bytes", "draws", "refills", "secondaries"};
+
+
+
+// Index of the first query of a pair.
+static inline uint32_t _query_idx(DvzProfileGpuRange range, uint32_t slot)
+{
+    ASSERT(slot < DVZ_MAX_SWAPCHAIN_IMAGES);
+    return 2 * (range * DVZ_MAX_SWAPCHAIN_IMAGES + slot);
+}
+
+
+
+// Read a pair of timestamps if they are available, and add the corresponding GPU event.
+static void _poll_gpu(DvzProfiler* prof, DvzProfileGpuRange range, uint32_t slot)
+{
+    ASSERT(prof != NULL);
+    if (!prof->pending[range][slot])
+        return;
+
+    uint64_t ts[2] = {0};
+    if (!dvz_queries_results(&prof->queries, _query_idx(range, slot), 2, ts))
+        return;
+    prof->pending[range][slot] = false;
+
+    // GPU ticks cannot be compared to the CPU clock, so the GPU events are placed at the time of
+    // their submission.
+    double duration = (ts[1] - ts[0]) * prof->queries.period * 1e-9;
+    DvzProfileEvent* ev = &prof->events[prof->count++ % prof->capacity];
+    ev->type = DVZ_PROFILE_GPU;
+    ev->name = GPU_RANGE_NAMES[range];
+    ev->frame_idx = prof->submitted_frame[range][slot];
+    ev->start = prof->submitted[range][slot];
+    ev->value = duration;
+}
+
+
+
+/*************************************************************************************************/
+/*  Profiler                                                                                     */
+/*************************************************************************************************/
+
+DvzProfiler dvz_profiler(DvzGpu* gpu, uint32_t capacity)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(dvz_obj_is_created(&gpu->obj));
+
+    DvzProfiler prof = {0};
+    prof.gpu = gpu;
+    prof.origin = _clock_now();
+    prof.capacity = capacity > 0 ? capacity : DVZ_PROFILER_CAPACITY;
+    prof.events = (DvzProfileEvent*)calloc(prof.capacity, sizeof(DvzProfileEvent));
+    log_debug("create profiler with %d events", prof.capacity);
+
+    if (gpu->device_properties.limits.timestampComputeAndGraphics)
+        prof.queries = dvz_queries(
+            gpu, VK_QUERY_TYPE_TIMESTAMP, 2 * DVZ_PROFILE_GPU_COUNT * DVZ_MAX_SWAPCHAIN_IMAGES);
+    else
+        log_warn("the GPU does not support timestamp queries, only the CPU will be profiled");
+
+    dvz_obj_created(&prof.obj);
+    return prof;
+}
+
+
+
+void dvz_profiler_render(DvzProfiler* prof, uint32_t queue_idx, uint32_t img_count)
+{
+    ASSERT(prof != NULL);
+    ASSERT(img_count > 0);
+    ASSERT(img_count <= DVZ_MAX_SWAPCHAIN_IMAGES);
+    if (!dvz_obj_is_created(&prof->queries.obj))
+        return;
+
+    // The render command buffers are only recorded when the canvas is refilled, so the
+    // timestamps are written by small command buffers submitted with them, recorded once.
+    DvzGpu* gpu = prof->gpu;
+    prof->cmds_begin = dvz_commands(gpu, queue_idx, img_count);
+    prof->cmds_end = dvz_commands(gpu, queue_idx, img_count);
+    for (uint32_t i = 0; i < img_count; i++)
+    {
+        dvz_cmd_begin(&prof->cmds_begin, i);
+        dvz_profiler_gpu_begin(prof, DVZ_PROFILE_GPU_RENDER, &prof->cmds_begin, i);
+        dvz_cmd_end(&prof->cmds_begin, i);
+
+        dvz_cmd_begin(&prof->cmds_end, i);
+        dvz_profiler_gpu_end(prof, DVZ_PROFILE_GPU_RENDER, &prof->cmds_end, i);
+        dvz_cmd_end(&prof->cmds_end, i);
+    }
+    prof->has_gpu[DVZ_PROFILE_GPU_RENDER] = true;
+}
+
+
+
+bool dvz_profiler_transfer(DvzProfiler* prof, uint32_t queue_idx)
+{
+    ASSERT(prof != NULL);
+    if (!dvz_obj_is_created(&prof->queries.obj))
+        return false;
+
+    // Queries can only be reset on graphics and compute queues.
+    DvzQueues* queues = &prof->gpu->queues;
+    ASSERT(queue_idx < queues->queue_count);
+    uint32_t family = queues->queue_families[queue_idx];
+    if (!queues->support_graphics[family] && !queues->support_compute[family])
+    {
+        log_debug("the transfer queue does not support timestamp query resets");
+        return false;
+    }
+    prof->has_gpu[DVZ_PROFILE_GPU_TRANSFER] = true;
+    return true;
+}
+
+
+
+void dvz_profiler_event(
+    DvzProfiler* prof, DvzProfileEventType type, const char* name, double start, double value)
+{
+    ASSERT(prof != NULL);
+    ASSERT(prof->events != NULL);
+    DvzProfileEvent* ev = &prof->events[prof->count++ % prof->capacity];
+    ev->type = type;
+    ev->name = name;
+    ev->frame_idx = prof->frame_idx;
+    ev->start = start - prof->origin;
+    ev->value = value;
+}
+
+
+
+void dvz_profiler_frame(DvzProfiler* prof, uint64_t frame_idx)
+{
+    ASSERT(prof != NULL);
+
+    // Counters of the previous frame.
+    if (frame_idx > 0)
+    {
+        double now = _clock_now();
+        for (uint32_t i = 0; i < DVZ_PROFILE_COUNTER_COUNT; i++)
+            dvz_profiler_event(
+                prof, DVZ_PROFILE_COUNTER, COUNTER_NAMES[i], now, prof->counters[i]);
+    }
+    memset(prof->counters, 0, sizeof(prof->counters));
+    prof->frame_idx = frame_idx;
+
+    // GPU timestamps of the previous frames.
+    for (uint32_t r = 0; r < DVZ_PROFILE_GPU_COUNT; r++)
+    {
+        if (!prof->has_gpu[r])
+            continue;
+        for (uint32_t i = 0; i < DVZ_MAX_SWAPCHAIN_IMAGES; i++)
+            _poll_gpu(prof, (DvzProfileGpuRange)r, i);
+    }
+}
+
+
+
+void dvz_profiler_gpu_begin(
+    DvzProfiler* prof, DvzProfileGpuRange range, DvzCommands* cmds, uint32_t idx)
+{
+    ASSERT(prof != NULL);
+    ASSERT(cmds != NULL);
+    uint32_t query = _query_idx(range, idx);
+    dvz_cmd_reset_queries(cmds, idx, &prof->queries, query, 2);
+    dvz_cmd_timestamp(cmds, idx, &prof->queries, query, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+}
+
+
+
+void dvz_profiler_gpu_end(
+    DvzProfiler* prof, DvzProfileGpuRange range, DvzCommands* cmds, uint32_t idx)
+{
+    ASSERT(prof != NULL);
+    ASSERT(cmds != NULL);
+    uint32_t query = _query_idx(range, idx) + 1;
+    dvz_cmd_timestamp(cmds, idx, &prof->queries, query, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+}
+
+
+
+void dvz_profiler_gpu_submitted(DvzProfiler* prof, DvzProfileGpuRange range, uint32_t idx)
+{
+    ASSERT(prof != NULL);
+    ASSERT(idx < DVZ_MAX_SWAPCHAIN_IMAGES);
+    // The results of the previous submission are lost if they have not been read yet.
+    _poll_gpu(prof, range, idx);
+    prof->pending[range][idx] = true;
+    prof->submitted[range][idx] = _clock_now() - prof->origin;
+    prof->submitted_frame[range][idx] = prof->frame_idx;
+}
+
+
+
+int dvz_profiler_dump(DvzProfiler* prof, const char* path)
+{
+    ASSERT(prof != NULL);
+    ASSERT(path != NULL);
+    FILE* fp = fopen(path, "w");
+    if (fp == NULL)
+    {
+        log_error("unable to open %s", path);
+        return 1;
+    }
+
+    // The oldest events have been overwritten if the ring buffer is full.
+    uint64_t n = MIN(prof->count, (uint64_t)prof->capacity);
+    uint64_t first = prof->count - n;
+    log_info("write %d profiler events to %s", (int)n, path);
+
+    // CPU events on thread 0, GPU events on thread 1, times in microseconds.
+    fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(
+        fp, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 0, "
+            "\"args\": {\"name\": \"CPU\"}},\n");
+    fprintf(
+        fp, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 1, "
+            "\"args\": {\"name\": \"GPU\"}}");
+    DvzProfileEvent* ev = NULL;
+    for (uint64_t i = first; i < prof->count; i++)
+    {
+        ev = &prof->events[i % prof->capacity];
+        if (ev->type == DVZ_PROFILE_COUNTER)
+            fprintf(
+                fp,
+                ",\n{\"name\": \"%s\", \"ph\": \"C\", \"ts\": %.3f, \"pid\": 0, \"tid\": 0, "
+                "\"args\": {\"%s\": %.0f}}",
+                ev->name, ev->start * 1e6, ev->name, ev->value);
+        else
+            fprintf(
+                fp,
+                ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, "
+                "\"dur\": %.3f, \"pid\": 0, \"tid\": %d, \"args\": {\"frame\": %" PRIu64 "}}",
+                ev->name, ev->type == DVZ_PROFILE_GPU ? "gpu" : "cpu", ev->start * 1e6,
+                ev->value * 1e6, ev->type == DVZ_PROFILE_GPU ? 1 : 0, ev->frame_idx);
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    return 0;
+}
+
+
+
+void dvz_profiler_destroy(DvzProfiler* prof)
+{
+    ASSERT(prof != NULL);
+    if (!dvz_obj_is_created(&prof->obj))
+    {
+        log_trace("skip destruction of already-destroyed profiler");
+        return;
+    }
+    log_trace("destroy profiler");
+    dvz_commands_destroy(&prof->cmds_begin);
+    dvz_commands_destroy(&prof->cmds_end);
+    dvz_queries_destroy(&prof->queries);
+    FREE(prof->events);
+    dvz_obj_destroyed(&prof->obj);
+}
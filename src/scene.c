@@ -32,7 +32,7 @@ DvzScene* dvz_scene(DvzCanvas* canvas, uint32_t n_rows, uint32_t n_cols)
         DVZ_CONTAINER_DEFAULT_COUNT, sizeof(DvzController), DVZ_OBJECT_TYPE_CONTROLLER);
 
     // Scene update FIFO queue.
-    canvas->scene->update_fifo = dvz_fifo(DVZ_MAX_FIFO_CAPACITY);
+    canvas->scene->update_fifo = dvz_fifo_lockfree(DVZ_MAX_FIFO_CAPACITY, DVZ_FIFO_MODE_SPSC);
 
     // INIT callback
     dvz_event_callback(canvas, DVZ_EVENT_INIT, 0, DVZ_EVENT_MODE_SYNC, _scene_init, canvas->scene);
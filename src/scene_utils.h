@@ -31,6 +31,10 @@ static bool _has_item_count_changed(DvzVisual* visual)
 {
     ASSERT(visual != NULL);
 
+    // In streaming mode, the draw ranges are read from the GPU and appends require no refill.
+    if (visual->stream != NULL)
+        return false;
+
     bool has_changed = false;
     DvzSource* source = NULL;
     for (uint32_t pidx = 0; pidx < visual->graphics_count; pidx++)
@@ -91,18 +95,42 @@ static void _viewport_print(DvzViewport v)
 
 
 
-// Return the box surrounding all POS props of a visual.
+// Whether a visual has POS items. A streamed visual has none on the CPU once its last batch has
+// been uploaded, but the box of its streamed items is kept.
+static bool _visual_has_pos(DvzVisual* visual)
+{
+    ASSERT(visual != NULL);
+    if (visual->stream != NULL && visual->stream->box_valid)
+        return true;
+    DvzProp* prop = NULL;
+    for (uint32_t i = 0; i < 32; i++)
+    {
+        prop = dvz_prop_get(visual, DVZ_PROP_POS, i);
+        if (prop == NULL)
+            break;
+        if (prop->arr_orig.item_count > 0)
+            return true;
+    }
+    return false;
+}
+
+
+
+// Return the box surrounding all POS props of a visual, merged from the cached prop boxes and the
+// box of the streamed items. Only the props whose cached box is invalid are scanned.
 static DvzBox _visual_box(DvzVisual* visual)
 {
     ASSERT(visual != NULL);
 
     DvzProp* prop = NULL;
-    DvzArray* arr = NULL;
 
     // The POS props that will need to be transformed.
     uint32_t n_pos_props = 0;
 
-    DvzBox boxes[32] = {0}; // max number of props of the same type
+    DvzBox boxes[33] = {0}; // max number of props of the same type, and the streamed items
+
+    if (visual->stream != NULL && visual->stream->box_valid)
+        boxes[n_pos_props++] = visual->stream->box;
 
     // Gather all non-empty POS props, and get the bounding box on each.
     for (uint32_t i = 0; i < 32; i++)
@@ -110,11 +138,9 @@ static DvzBox _visual_box(DvzVisual* visual)
         prop = dvz_prop_get(visual, DVZ_PROP_POS, i);
         if (prop == NULL)
             break;
-        arr = &prop->arr_orig;
-        ASSERT(arr != NULL);
-        if (arr->item_count == 0)
+        if (prop->arr_orig.item_count == 0)
             continue;
-        boxes[n_pos_props++] = _box_bounding(arr);
+        boxes[n_pos_props++] = _prop_box(visual, prop);
     }
 
     if (n_pos_props == 0)
@@ -127,9 +153,50 @@ static DvzBox _visual_box(DvzVisual* visual)
 
 
 
-// Renormalize a POS prop.
-static void _transform_pos_prop(DvzDataCoords coords, DvzProp* prop)
+// Whether the positions of a POS prop were normalized with the same coordinates.
+static bool _trans_coords_equal(DvzDataCoords* a, DvzDataCoords* b)
+{
+    ASSERT(a != NULL);
+    ASSERT(b != NULL);
+    if (a->transform != b->transform)
+        return false;
+    for (uint32_t j = 0; j < 3; j++)
+    {
+        if (a->box.p0[j] != b->box.p0[j] || a->box.p1[j] != b->box.p1[j])
+            return false;
+    }
+    return true;
+}
+
+
+
+// Bounding box of a POS prop after its positions from `first` have been normalized, the box of
+// these positions being `box`.
+static DvzBox _trans_range_box(DvzVisual* visual, DvzProp* prop, uint32_t first, DvzBox box)
+{
+    ASSERT(visual != NULL);
+    ASSERT(prop != NULL);
+    if (first == 0)
+        return box;
+    // NOTE: the cached box already includes the new positions when it is valid.
+    if (!prop->box_valid)
+        return _prop_box(visual, prop);
+    for (uint32_t j = 0; j < 3; j++)
+    {
+        box.p0[j] = MIN(box.p0[j], prop->box.p0[j]);
+        box.p1[j] = MAX(box.p1[j], prop->box.p1[j]);
+    }
+    return box;
+}
+
+
+
+// Renormalize a POS prop, and return the bounding box of its original positions. Only the
+// positions appended since the last normalization are processed when the coordinates have not
+// changed.
+static DvzBox _transform_pos_prop(DvzDataCoords coords, DvzVisual* visual, DvzProp* prop)
 {
+    ASSERT(visual != NULL);
     ASSERT(prop != NULL);
     ASSERT(prop->prop_type == DVZ_PROP_POS);
 
@@ -138,17 +205,85 @@ static void _transform_pos_prop(DvzDataCoords coords, DvzProp* prop)
 
     arr = &prop->arr_orig;
     arr_tr = &prop->arr_trans;
-    if (arr->item_count == 0)
+    uint32_t n = arr->item_count;
+    if (n == 0)
     {
         log_warn("empty POS prop, skipping renormalization");
-        return;
+        prop->trans_count = 0;
+        return DVZ_BOX_INF;
+    }
+    uint32_t first = MIN(prop->trans_count, n);
+    DvzBox box = {0};
+
+    // GPU data normalization: the positions are only uploaded when they change, the compute pass
+    // runs after the vertex buffer upload.
+    DvzTransformGpu* tg = (visual->flags & DVZ_VISUAL_FLAGS_TRANSFORM_GPU) != 0
+                              ? dvz_prop_transform_gpu(visual, prop)
+                              : NULL;
+    if (tg != NULL)
+    {
+        // The array transformed on the CPU, if any, is obsolete.
+        if (arr_tr->item_count > 0)
+        {
+            dvz_array_destroy(arr_tr);
+            *arr_tr = (DvzArray){0};
+        }
+        // NOTE: the split does not depend on the coordinates.
+        if (prop->arr_split.item_count < first)
+            first = 0;
+        log_trace("normalizing POS prop on the GPU, items %d to %d", first, n);
+        if (first < n)
+        {
+            box = dvz_transform_split_range(
+                _visual_workers(visual), arr, &prop->arr_split, first, n - first);
+            visual->pos_normalized += n - first;
+            box = _trans_range_box(visual, prop, first, box);
+        }
+        else
+            box = _prop_box(visual, prop);
+        dvz_transform_gpu_data_range(tg, &prop->arr_split, first, n - first);
+        dvz_transform_gpu_params(tg, dvz_transform_params(coords));
+        prop->trans_count = n;
+        prop->trans_coords = coords;
+        return box;
+    }
+
+    // The double-float split, if any, is obsolete.
+    if (prop->arr_split.item_count > 0)
+    {
+        dvz_array_destroy(&prop->arr_split);
+        prop->arr_split = (DvzArray){0};
     }
 
-    // Create the transformed prop array.
-    log_trace("normalizing POS prop, %d items", arr->item_count);
-    // _box_print(coords.box);
-    *arr_tr = dvz_array(arr->item_count, arr->dtype);
-    dvz_transform_pos(coords, arr, arr_tr, false);
+    // Appended positions of a cartesian prop are normalized alone, the transformed prop array
+    // being resized with its data kept.
+    bool append = first > 0 && coords.transform != DVZ_TRANSFORM_EARTH_MERCATOR_WEB &&
+                  _trans_coords_equal(&coords, &prop->trans_coords) &&
+                  dvz_obj_is_created(&arr_tr->obj) && arr_tr->dtype == arr->dtype &&
+                  arr_tr->item_count >= first;
+    if (append && first == n)
+    {
+        log_trace("POS prop already normalized");
+        return _prop_box(visual, prop);
+    }
+    if (append)
+    {
+        log_trace("normalizing POS prop, items %d to %d", first, n);
+        box = dvz_transform_normalize_range(
+            _visual_workers(visual), coords.box, arr, arr_tr, first, n - first);
+        visual->pos_normalized += n - first;
+        box = _trans_range_box(visual, prop, first, box);
+    }
+    else
+    {
+        // The transformed prop array is created or resized if needed, and reused otherwise.
+        log_trace("normalizing POS prop, %d items", n);
+        box = dvz_transform_pos_parallel(_visual_workers(visual), coords, arr, arr_tr, false);
+        visual->pos_normalized += n;
+    }
+    prop->trans_count = n;
+    prop->trans_coords = coords;
+    return box;
 }
 
 
@@ -169,13 +304,20 @@ static DvzBox _compute_panel_box(DvzPanel* panel)
     {
         ASSERT(panel->visuals[i] != NULL);
 
-        // NOTE: skip visuals that should not be transformed.
-        if (_is_visual_to_transform(panel->visuals[i]))
+        // NOTE: skip visuals that should not be transformed, and visuals without positions.
+        if (_is_visual_to_transform(panel->visuals[i]) && _visual_has_pos(panel->visuals[i]))
         {
             boxes[count++] = _visual_box(panel->visuals[i]);
         }
     }
 
+    // The panel box is kept when no visual has positions.
+    if (count == 0)
+    {
+        FREE(boxes);
+        return coords->box;
+    }
+
     // Merge the visual box with the existing box.
     DvzBox box = _box_merge(count, boxes);
     // _box_print(box);
@@ -411,16 +553,17 @@ static void _process_prop_changed(DvzSceneUpdate up)
     ASSERT(up.visual != NULL);
     if (up.prop->prop_type == DVZ_PROP_POS && _is_visual_to_transform(up.visual))
     {
-        _transform_pos_prop(coords, up.prop);
-
-        if ((up.visual->flags & DVZ_VISUAL_FLAGS_TRANSFORM_BOX_INIT) == 0)
+        // The bounding box of the prop is computed in the same pass as the normalization.
+        if (up.prop->arr_orig.item_count > 0)
+            _prop_box_set(up.prop, _transform_pos_prop(coords, up.visual, up.prop));
+
+        // Streamed items are normalized with the current panel box, as the previous items are
+        // no longer available on the CPU for renormalization.
+        if ((up.visual->flags & DVZ_VISUAL_FLAGS_TRANSFORM_BOX_INIT) == 0 &&
+            up.visual->stream == NULL)
         {
-            // Recompute the visual box.
-            DvzBox box = _visual_box(up.visual);
-
-            // Make the box square if needed.
-            if (_is_aspect_fixed(&coords))
-                box = _box_cube(box);
+            // Merge the cached boxes of all visuals in the panel.
+            DvzBox box = _compute_panel_box(up.panel);
 
             // If the new box has changed, renormalize all visuals.
             if (_has_coords_changed(&coords, &box))
@@ -474,8 +617,15 @@ static void _process_coords_changed(DvzSceneUpdate up)
             prop = iter.item;
             ASSERT(prop != NULL);
 
-            // Transform all POS props with the panel data coordinates.
-            if (prop->prop_type == DVZ_PROP_POS)
+            // Transform all POS props with the panel data coordinates. The props normalized on
+            // the GPU only need a new compute pass, without any data upload.
+            if (prop->prop_type == DVZ_PROP_POS && prop->transform_gpu != NULL)
+            {
+                dvz_transform_gpu_params(
+                    prop->transform_gpu, dvz_transform_params(panel->data_coords));
+                dvz_transform_gpu_run(prop->transform_gpu);
+            }
+            else if (prop->prop_type == DVZ_PROP_POS)
             {
                 _enqueue_prop_changed(panel, visual, prop);
             }
@@ -504,7 +654,7 @@ static void _process_visual_added(DvzSceneUpdate up)
     ASSERT(visual != NULL);
 
     // Compute box of the new visual, taking visual transform flags into account
-    if (!_is_visual_to_transform(visual))
+    if (!_is_visual_to_transform(visual) || !_visual_has_pos(visual))
         return;
 
     DvzPanel* panel = up.panel;
@@ -566,12 +716,23 @@ static void _process_visual_changed(DvzSceneUpdate up)
 
 
 
+// Re-record the command buffers of the updated panel only, or of all panels if it is unknown.
+static void _panel_to_refill(DvzSceneUpdate up)
+{
+    ASSERT(up.canvas != NULL);
+    if (up.panel != NULL)
+        dvz_panel_to_refill(up.panel);
+    else
+        dvz_canvas_to_refill(up.canvas);
+}
+
+
+
 // Called when the visibility of a visual has changed.
 static void _process_visibility_changed(DvzSceneUpdate up)
 {
-    ASSERT(up.canvas != NULL);
     // Refill command buffer.
-    dvz_canvas_to_refill(up.canvas);
+    _panel_to_refill(up);
 }
 
 
@@ -579,9 +740,8 @@ static void _process_visibility_changed(DvzSceneUpdate up)
 // Called when the number of vertices/indices has changed.
 static void _process_item_count_changed(DvzSceneUpdate up)
 {
-    ASSERT(up.canvas != NULL);
     // Refill command buffer.
-    dvz_canvas_to_refill(up.canvas);
+    _panel_to_refill(up);
 }
 
 
@@ -602,8 +762,7 @@ static void _process_panel_changed(DvzSceneUpdate up)
         _update_visual_viewport(panel, panel->visuals[k]);
 
     // Refill command buffer.
-    ASSERT(up.canvas != NULL);
-    dvz_canvas_to_refill(up.canvas);
+    _panel_to_refill(up);
 }
 
 
@@ -825,6 +984,40 @@ static void _process_scene_updates(DvzScene* scene)
 
 
 
+// Collect the number of POS items scanned for the bounding boxes since the last frame.
+static void _scene_box_stats(DvzScene* scene)
+{
+    ASSERT(scene != NULL);
+    DvzGrid* grid = &scene->grid;
+
+    DvzPanel* panel = NULL;
+    DvzVisual* visual = NULL;
+    DvzContainerIterator iter = dvz_container_iterator(&grid->panels);
+    scene->box_scanned = 0;
+    scene->pos_normalized = 0;
+    while (iter.item != NULL)
+    {
+        panel = iter.item;
+        for (uint32_t j = 0; j < panel->visual_count; j++)
+        {
+            visual = panel->visuals[j];
+            scene->box_scanned += visual->box_scanned;
+            visual->box_scanned = 0;
+            scene->pos_normalized += visual->pos_normalized;
+            visual->pos_normalized = 0;
+        }
+        dvz_container_iter(&iter);
+    }
+    scene->box_scanned_total += scene->box_scanned;
+    if (scene->box_scanned > 0)
+        log_trace("%d POS items scanned for the bounding boxes", (int)scene->box_scanned);
+    scene->pos_normalized_total += scene->pos_normalized;
+    if (scene->pos_normalized > 0)
+        log_trace("%d POS items normalized", (int)scene->pos_normalized);
+}
+
+
+
 /*************************************************************************************************/
 /*  Scene callbacks                                                                              */
 /*************************************************************************************************/
@@ -864,7 +1057,55 @@ static void _scene_init(DvzCanvas* canvas, DvzEvent ev)
 
 
 
-// Refill the command buffer with all panels and visuals.
+// Record the secondary command buffer of a panel with all its visuals.
+static void _panel_fill(DvzPanel* panel, VkClearColorValue clear_color, uint32_t img_idx)
+{
+    ASSERT(panel != NULL);
+    DvzCanvas* canvas = panel->grid->canvas;
+    ASSERT(canvas != NULL);
+    DvzCommands* cmds = &panel->cmds;
+
+    dvz_cmd_reset(cmds, img_idx);
+    dvz_cmd_begin_secondary(cmds, img_idx, &canvas->renderpass);
+
+    // The dynamic viewport is not inherited from the primary command buffer.
+    DvzViewport viewport = dvz_panel_viewport(panel);
+    dvz_cmd_viewport(cmds, img_idx, viewport.viewport);
+
+    // Go through all visuals in the panel, in drawing order.
+    DvzVisual* visuals[DVZ_MAX_VISUALS_PER_PANEL] = {0};
+    uint32_t n = 0;
+    DvzVisual* visual = NULL;
+    for (int priority = -panel->prority_max; priority <= panel->prority_max; priority++)
+    {
+        for (uint32_t k = 0; k < panel->visual_count; k++)
+        {
+            visual = panel->visuals[k];
+            if (visual->priority == priority)
+                visuals[n++] = visual;
+        }
+    }
+
+    if (panel->batch)
+    {
+        panel->batched = dvz_visual_fill_batch(
+            n, visuals, clear_color, cmds, img_idx, viewport, &panel->br_draws);
+    }
+    else
+    {
+        for (uint32_t k = 0; k < n; k++)
+            dvz_visual_fill_event(visuals[k], clear_color, cmds, img_idx, viewport, NULL);
+    }
+
+    dvz_cmd_end(cmds, img_idx);
+    panel->cmds_dirty[img_idx] = false;
+}
+
+
+
+// Refill the command buffer with all panels and visuals. Only the panels that have changed are
+// re-recorded, the primary command buffer just executes the secondary command buffers of the
+// panels.
 // NOTE: the panel viewports must have been updated first.
 static void _scene_fill(DvzCanvas* canvas, DvzEvent ev)
 {
@@ -875,46 +1116,50 @@ static void _scene_fill(DvzCanvas* canvas, DvzEvent ev)
     ASSERT(scene != NULL);
     DvzGrid* grid = &scene->grid;
 
-    DvzViewport viewport = {0};
     DvzCommands* cmds = NULL;
     DvzPanel* panel = NULL;
     DvzContainerIterator iter;
-    DvzVisual* visual = NULL;
-    uint32_t img_idx = 0;
+    uint32_t img_idx = ev.u.rf.img_idx;
+
+    // Re-record the panels that have changed. The command buffer of the panels for this
+    // swapchain image are not in use as the canvas waits for the corresponding fence before
+    // refilling.
+    uint32_t recorded = 0, panel_count = 0;
+    iter = dvz_container_iterator(&grid->panels);
+    while (iter.item != NULL)
+    {
+        panel = iter.item;
+        ASSERT(img_idx < panel->cmds.count);
+        if (ev.u.rf.invalidate || panel->cmds_dirty[img_idx])
+        {
+            _panel_fill(panel, ev.u.rf.clear_color, img_idx);
+            recorded++;
+        }
+        panel_count++;
+        dvz_container_iter(&iter);
+    }
+    log_debug(
+        "%d/%d panel command buffer(s) re-recorded for image #%d", recorded, panel_count,
+        img_idx);
+    scene->cmds_recorded = recorded;
+    scene->cmds_recorded_total += recorded;
+    dvz_profile_count(canvas->profiler, DVZ_PROFILE_COUNTER_SECONDARIES, recorded);
 
     // Go through all the current command buffers.
     for (uint32_t i = 0; i < ev.u.rf.cmd_count; i++)
     {
         cmds = ev.u.rf.cmds[i];
-        img_idx = ev.u.rf.img_idx;
 
         log_trace("visual fill cmd %d begin %d", i, img_idx);
-        dvz_visual_fill_begin(canvas, cmds, img_idx);
+        dvz_cmd_begin(cmds, img_idx);
+        dvz_cmd_begin_renderpass_secondary(
+            cmds, img_idx, &canvas->renderpass, &canvas->framebuffers);
 
         iter = dvz_container_iterator(&grid->panels);
         while (iter.item != NULL)
         {
             panel = iter.item;
-
-            // Find the panel viewport.
-            viewport = dvz_panel_viewport(panel);
-            dvz_cmd_viewport(cmds, img_idx, viewport.viewport);
-
-            // Go through all visuals in the panel.
-            visual = NULL;
-            for (int priority = -panel->prority_max; priority <= panel->prority_max; priority++)
-            {
-                for (uint32_t k = 0; k < panel->visual_count; k++)
-                {
-                    visual = panel->visuals[k];
-                    if (visual->priority != priority)
-                        continue;
-
-                    dvz_visual_fill_event(
-                        visual, ev.u.rf.clear_color, cmds, img_idx, viewport, NULL);
-                }
-            }
-
+            dvz_cmd_execute(cmds, img_idx, &panel->cmds);
             dvz_container_iter(&iter);
         }
         dvz_visual_fill_end(canvas, cmds, img_idx);
@@ -959,12 +1204,23 @@ static void _scene_frame(DvzCanvas* canvas, DvzEvent ev)
 
     DvzScene* scene = (DvzScene*)ev.user_data;
     ASSERT(scene != NULL);
+    double t = _clock_now();
 
     // Call the controller callbacks of all panels.
     _callback_controllers(scene);
 
     // Process the scene updates.
+    double t_updates = dvz_profile_start(canvas->profiler);
     _process_scene_updates(scene);
+    dvz_profile_end(canvas->profiler, "scene_updates", t_updates);
+
+    // Bounding box statistics.
+    _scene_box_stats(scene);
+
+    double dt = _clock_now() - t;
+    canvas->phase_time[DVZ_FRAME_PHASE_SCENE] += dt;
+    if (canvas->profiler != NULL)
+        dvz_profiler_event(canvas->profiler, DVZ_PROFILE_CPU, "scene", t, dt);
 }
 
 
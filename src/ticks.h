@@ -20,6 +20,7 @@ https://github.com/quantenschaum/ctplot/blob/master/ctplot/ticks.py
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "../include/datoviz/common.h"
 
@@ -700,4 +701,197 @@ static void dvz_ticks_destroy(DvzAxesTicks* ticks)
 
 
 
+/*************************************************************************************************/
+/*  Cached and incremental ticks                                                                 */
+/*************************************************************************************************/
+
+static DvzAxesTicks _ticks_copy(DvzAxesTicks* ticks)
+{
+    ASSERT(ticks != NULL);
+    uint32_t n = ticks->value_count;
+    ASSERT(n > 0);
+    DvzAxesTicks copy = *ticks;
+    copy.values = (double*)calloc(n, sizeof(double));
+    copy.labels = (char*)calloc(n * MAX_GLYPHS_PER_TICK, sizeof(char));
+    memcpy(copy.values, ticks->values, n * sizeof(double));
+    memcpy(copy.labels, ticks->labels, n * MAX_GLYPHS_PER_TICK);
+    return copy;
+}
+
+
+
+// Whether two tick computations gave the same ticks and labels.
+static bool _ticks_equal(DvzAxesTicks* t0, DvzAxesTicks* t1)
+{
+    ASSERT(t0 != NULL);
+    ASSERT(t1 != NULL);
+    return t0->value_count == t1->value_count && t0->lstep == t1->lstep &&
+           t0->lmin_ex == t1->lmin_ex && t0->lmax_ex == t1->lmax_ex &&
+           t0->format == t1->format && t0->precision == t1->precision &&
+           memcmp(t0->values, t1->values, t0->value_count * sizeof(double)) == 0;
+}
+
+
+
+// Quantize the range to a fraction of its order of magnitude, so that close ranges share the same
+// key and the same ticks. Return false if the bounds are too large compared to the range.
+static bool _ticks_key(double* dmin, double* dmax, DvzAxesContext* ctx, DvzAxesTicksKey* key)
+{
+    ASSERT(dmin != NULL);
+    ASSERT(dmax != NULL);
+    ASSERT(ctx != NULL);
+    ASSERT(key != NULL);
+    ASSERT(*dmin < *dmax);
+
+    int32_t exponent = (int32_t)floor(log2(*dmax - *dmin));
+    double q = ldexp(1.0, exponent) / DVZ_TICKS_CACHE_QUANTUM;
+    double qmin = floor(*dmin / q);
+    double qmax = ceil(*dmax / q);
+    if (fabs(qmin) > 1e15 || fabs(qmax) > 1e15)
+        return false;
+
+    key->qmin = (int64_t)qmin;
+    key->qmax = (int64_t)qmax;
+    key->exponent = exponent;
+    key->size_viewport = (uint32_t)round(ctx->size_viewport);
+    key->size_glyph = (uint32_t)round(16 * ctx->size_glyph);
+    key->extensions = ctx->extensions;
+
+    *dmin = qmin * q;
+    *dmax = qmax * q;
+    return true;
+}
+
+
+
+static bool _ticks_key_equal(DvzAxesTicksKey* k0, DvzAxesTicksKey* k1)
+{
+    ASSERT(k0 != NULL);
+    ASSERT(k1 != NULL);
+    return k0->qmin == k1->qmin && k0->qmax == k1->qmax && k0->exponent == k1->exponent &&
+           k0->size_viewport == k1->size_viewport && k0->size_glyph == k1->size_glyph &&
+           k0->extensions == k1->extensions;
+}
+
+
+
+// Same as dvz_ticks(), but the ticks are computed on the quantized range and memoized. The
+// returned ticks are owned by the caller.
+static DvzAxesTicks
+dvz_ticks_cached(DvzAxesTicksCache* cache, double dmin, double dmax, DvzAxesContext ctx)
+{
+    ASSERT(cache != NULL);
+    DvzAxesTicksKey key = {0};
+    if (!_ticks_key(&dmin, &dmax, &ctx, &key))
+        return dvz_ticks(dmin, dmax, ctx);
+
+    for (uint32_t i = 0; i < cache->count; i++)
+    {
+        if (_ticks_key_equal(&cache->keys[i], &key))
+        {
+            cache->hits++;
+            return _ticks_copy(&cache->ticks[i]);
+        }
+    }
+    cache->misses++;
+
+    DvzAxesTicks ticks = dvz_ticks(dmin, dmax, ctx);
+    uint32_t idx = 0;
+    if (cache->count < DVZ_TICKS_CACHE_SIZE)
+        idx = cache->count++;
+    else
+    {
+        idx = cache->next;
+        cache->next = (cache->next + 1) % DVZ_TICKS_CACHE_SIZE;
+        dvz_ticks_destroy(&cache->ticks[idx]);
+    }
+    cache->keys[idx] = key;
+    cache->ticks[idx] = _ticks_copy(&ticks);
+    return ticks;
+}
+
+
+
+// Shift the tick lattice by a whole number of steps so that it is centered on a new range, and
+// only format the labels that appear at the edges. `changed` is set if the ticks were modified.
+// Return false if the shifted ticks do not fit the new range, in which case they should be
+// recomputed.
+static bool
+dvz_ticks_pan(DvzAxesTicks* ticks, double dmin, double dmax, DvzAxesContext* ctx, bool* changed)
+{
+    ASSERT(ticks != NULL);
+    ASSERT(ctx != NULL);
+    ASSERT(changed != NULL);
+    ASSERT(ticks->values != NULL);
+    ASSERT(ticks->labels != NULL);
+    ASSERT(ticks->lstep > 0);
+    ASSERT(dmin < dmax);
+
+    double lstep = ticks->lstep;
+    double shift = round((.5 * (dmin + dmax) - .5 * (ticks->lmin_ex + ticks->lmax_ex)) / lstep);
+    if (fabs(shift) > MAX_LABELS)
+        return false;
+    int32_t k = (int32_t)shift;
+    if (k != 0)
+    {
+        uint32_t n = ticks->value_count;
+        uint32_t m = (uint32_t)abs(k);
+        uint32_t kept = m < n ? n - m : 0;
+        double offset = k * lstep;
+
+        // Move the labels that are still visible, and format the new ones.
+        uint32_t first_new = 0;
+        if (k > 0)
+        {
+            memmove(ticks->values, &ticks->values[n - kept], kept * sizeof(double));
+            memmove(
+                ticks->labels, &ticks->labels[(n - kept) * MAX_GLYPHS_PER_TICK],
+                kept * MAX_GLYPHS_PER_TICK);
+            first_new = kept;
+        }
+        else
+        {
+            memmove(&ticks->values[n - kept], ticks->values, kept * sizeof(double));
+            memmove(
+                &ticks->labels[(n - kept) * MAX_GLYPHS_PER_TICK], ticks->labels,
+                kept * MAX_GLYPHS_PER_TICK);
+        }
+
+        ticks->dmin += offset;
+        ticks->dmax += offset;
+        ticks->lmin_in += offset;
+        ticks->lmax_in += offset;
+        ticks->lmin_ex += offset;
+        ticks->lmax_ex += offset;
+
+        char tick_format[12] = {0};
+        _get_tick_format(ticks->format, ticks->precision, tick_format);
+        for (uint32_t i = first_new; i < first_new + n - kept; i++)
+        {
+            ticks->values[i] = ticks->lmin_in + i * lstep;
+            _tick_label(ticks->values[i], tick_format, &ticks->labels[i * MAX_GLYPHS_PER_TICK]);
+        }
+        *changed = true;
+    }
+
+    // The shifted ticks must cover the new range, and the new labels may be wider than the old
+    // ones and overlap.
+    if (dmin <= ticks->lmin_in || dmax >= ticks->lmax_in)
+        return false;
+    return min_distance_labels(ticks, ctx) > 0;
+}
+
+
+
+static void dvz_ticks_cache_destroy(DvzAxesTicksCache* cache)
+{
+    ASSERT(cache != NULL);
+    for (uint32_t i = 0; i < cache->count; i++)
+        dvz_ticks_destroy(&cache->ticks[i]);
+    cache->count = 0;
+    cache->next = 0;
+}
+
+
+
 #endif
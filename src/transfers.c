@@ -5,32 +5,516 @@
 
 
 
+/*************************************************************************************************/
+/*  Transfer pool                                                                                */
+/*************************************************************************************************/
+
+DvzTransferPool dvz_transfer_pool(uint32_t capacity)
+{
+    ASSERT(capacity > 0);
+    log_trace("creating pool of %d transfer descriptors", capacity);
+    DvzTransferPool pool = {0};
+    pool.capacity = capacity;
+    pool.items = (DvzTransfer*)calloc(capacity, sizeof(DvzTransfer));
+    pool.free = (uint32_t*)calloc(capacity, sizeof(uint32_t));
+    for (uint32_t i = 0; i < capacity; i++)
+        pool.free[i] = capacity - 1 - i;
+    pool.free_count = capacity;
+
+    if (pthread_mutex_init(&pool.lock, NULL) != 0)
+        log_error("mutex creation failed");
+    return pool;
+}
+
+
+
+static DvzTransfer* _pool_take(DvzTransferPool* pool)
+{
+    ASSERT(pool != NULL);
+    DvzTransfer* tr = NULL;
+    pthread_mutex_lock(&pool->lock);
+    if (pool->free_count > 0)
+        tr = &pool->items[pool->free[--pool->free_count]];
+    pthread_mutex_unlock(&pool->lock);
+
+    // Fallback to the heap if the pool is exhausted.
+    if (tr == NULL)
+    {
+        log_trace("transfer pool exhausted, allocating the transfer descriptor on the heap");
+        tr = (DvzTransfer*)calloc(1, sizeof(DvzTransfer));
+    }
+    return tr;
+}
+
+
+
+static void _pool_release(DvzTransferPool* pool, DvzTransfer* tr)
+{
+    ASSERT(pool != NULL);
+    ASSERT(tr != NULL);
+    if (pool->items <= tr && tr < pool->items + pool->capacity)
+    {
+        pthread_mutex_lock(&pool->lock);
+        ASSERT(pool->free_count < pool->capacity);
+        pool->free[pool->free_count++] = (uint32_t)(tr - pool->items);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    else
+    {
+        FREE(tr);
+    }
+}
+
+
+
+void dvz_transfer_pool_destroy(DvzTransferPool* pool)
+{
+    ASSERT(pool != NULL);
+    if (pool->items == NULL)
+        return;
+    pthread_mutex_destroy(&pool->lock);
+    FREE(pool->items);
+    FREE(pool->free);
+}
+
+
+
 /*************************************************************************************************/
 /*  FIFO                                                                                         */
 /*************************************************************************************************/
 
-static void _transfer_enqueue(DvzFifo* fifo, DvzTransfer transfer)
+static void _transfer_enqueue(DvzCanvas* canvas, DvzTransfer transfer)
 {
+    ASSERT(canvas != NULL);
+    DvzFifo* fifo = &canvas->transfers;
     ASSERT(fifo->capacity > 0);
-    ASSERT(0 <= fifo->head && fifo->head < fifo->capacity);
-    DvzTransfer* tr = (DvzTransfer*)calloc(1, sizeof(DvzTransfer));
+    DvzTransfer* tr = _pool_take(&canvas->transfer_pool);
     *tr = transfer;
     dvz_fifo_enqueue(fifo, tr);
 }
 
 
 
-static DvzTransfer _transfer_dequeue(DvzFifo* fifo, bool wait)
+/*************************************************************************************************/
+/*  Staging ring                                                                                 */
+/*************************************************************************************************/
+
+DvzStagingRing dvz_staging_ring(DvzGpu* gpu, uint32_t frame_count, VkDeviceSize size)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(0 < frame_count && frame_count <= DVZ_MAX_FRAMES_IN_FLIGHT);
+    ASSERT(size > 0);
+    log_trace("creating staging ring of %s", pretty_size(size));
+
+    DvzStagingRing ring = {0};
+    ring.gpu = gpu;
+    ring.frame_count = frame_count;
+
+    ring.buffer = dvz_buffer(gpu);
+    dvz_buffer_size(&ring.buffer, size);
+    dvz_buffer_usage(&ring.buffer, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+    dvz_buffer_memory(
+        &ring.buffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    dvz_buffer_queue_access(&ring.buffer, DVZ_DEFAULT_QUEUE_TRANSFER);
+    dvz_buffer_create(&ring.buffer);
+
+    // Permanently map the buffer.
+    ring.buffer.mmap = dvz_buffer_map(&ring.buffer, 0, VK_WHOLE_SIZE);
+
+    ring.cmds = dvz_commands(gpu, DVZ_DEFAULT_QUEUE_TRANSFER, frame_count);
+    ring.fences = dvz_fences(gpu, frame_count, true);
+    ring.semaphores = dvz_semaphores(gpu, frame_count);
+    ring.semaphores_release = dvz_semaphores(gpu, frame_count);
+    ring.same_queue = gpu->queues.queues[DVZ_DEFAULT_QUEUE_TRANSFER] ==
+                      gpu->queues.queues[DVZ_DEFAULT_QUEUE_RENDER];
+
+    ring.batch = (DvzStagedUpload*)calloc(DVZ_TRANSFER_POOL_SIZE, sizeof(DvzStagedUpload));
+    ring.copies = (VkBufferCopy*)calloc(DVZ_TRANSFER_POOL_SIZE, sizeof(VkBufferCopy));
+
+    dvz_obj_created(&ring.obj);
+    return ring;
+}
+
+
+
+// Wait until the copies of a frame have completed, and release the corresponding ring space.
+static void _ring_retire(DvzStagingRing* ring, uint32_t frame)
+{
+    ASSERT(ring != NULL);
+    ASSERT(frame < ring->frame_count);
+    if (ring->frame_size[frame] == 0)
+        return;
+
+    if (!dvz_fences_ready(&ring->fences, frame))
+    {
+        ring->stats.stalls++;
+        dvz_fences_wait(&ring->fences, frame);
+    }
+
+    // Frames are retired in order, so the tail moves to the end of this frame's allocations.
+    ASSERT(ring->used >= ring->frame_size[frame]);
+    ring->used -= ring->frame_size[frame];
+    ring->tail = ring->frame_end[frame];
+    ring->frame_size[frame] = 0;
+    if (ring->used == 0)
+    {
+        ring->head = 0;
+        ring->tail = 0;
+    }
+}
+
+
+
+// Wait until the copies of all frames have completed, and release the whole ring. The frames are
+// retired from the oldest one, the current frame being the most recent.
+static void _ring_retire_all(DvzStagingRing* ring)
+{
+    ASSERT(ring != NULL);
+    for (uint32_t i = 1; i <= ring->frame_count; i++)
+        _ring_retire(ring, (ring->cur_frame + i) % ring->frame_count);
+    ASSERT(ring->used == 0);
+    ASSERT(ring->head == 0 && ring->tail == 0);
+}
+
+
+
+// Suballocate a region in the ring buffer, return false if there is not enough space.
+static bool _ring_alloc(DvzStagingRing* ring, VkDeviceSize req_size, VkDeviceSize* offset)
+{
+    ASSERT(ring != NULL);
+    ASSERT(offset != NULL);
+    VkDeviceSize size = DVZ_STAGING_RING_ALIGNMENT *
+                        ((req_size + DVZ_STAGING_RING_ALIGNMENT - 1) / DVZ_STAGING_RING_ALIGNMENT);
+    VkDeviceSize ring_size = ring->buffer.size;
+    VkDeviceSize waste = 0;
+
+    if (ring->used == 0 || ring->head > ring->tail)
+    {
+        // Free space between head and the end of the ring, and then between 0 and tail.
+        if (ring->head + size <= ring_size)
+            *offset = ring->head;
+        else if (size < ring->tail)
+        {
+            waste = ring_size - ring->head;
+            *offset = 0;
+        }
+        else
+            return false;
+    }
+    else
+    {
+        // Free space between head and tail.
+        if (ring->head + size < ring->tail)
+            *offset = ring->head;
+        else
+            return false;
+    }
+
+    ring->head = *offset + size;
+    ring->used += size + waste;
+    ring->frame_size[ring->cur_frame] += size + waste;
+    ring->frame_end[ring->cur_frame] = ring->head;
+    return true;
+}
+
+
+
+// Record copies from the ring buffer, with one VkBufferCopy array per destination buffer.
+static void _ring_record(
+    DvzStagingRing* ring, uint32_t count, DvzBuffer** buffers, const VkBufferCopy* copies)
+{
+    ASSERT(ring != NULL);
+    if (count == 0)
+        return;
+    ASSERT(buffers != NULL);
+    ASSERT(copies != NULL);
+
+    uint32_t f = ring->cur_frame;
+    if (!ring->recording)
+    {
+        dvz_cmd_reset(&ring->cmds, f);
+        dvz_cmd_begin(&ring->cmds, f);
+        if (ring->profiler != NULL)
+            dvz_profiler_gpu_begin(ring->profiler, DVZ_PROFILE_GPU_TRANSFER, &ring->cmds, f);
+        // On a single queue, the barrier orders the copies after all commands submitted
+        // before, in particular the render submissions of the frames in flight, which may still
+        // read the buffers the copies write to.
+        if (ring->same_queue)
+        {
+            DvzBarrier barrier = dvz_barrier(ring->gpu);
+            dvz_barrier_stages(
+                &barrier, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+            dvz_cmd_barrier(&ring->cmds, f, &barrier);
+        }
+        ring->recording = true;
+    }
+
+    // The copies are sorted by destination buffer.
+    uint32_t first = 0;
+    for (uint32_t i = 1; i <= count; i++)
+    {
+        if (i < count && buffers[i] == buffers[first])
+            continue;
+        vkCmdCopyBuffer(
+            ring->cmds.cmds[f], ring->buffer.buffer, buffers[first]->buffer, i - first,
+            &copies[first]);
+        first = i;
+    }
+    ring->stats.copies += count;
+}
+
+
+
+// Submit the recorded copies of the current frame. In synchronous mode, or if the semaphore of the
+// previous submission has not been consumed yet, wait for the copies to complete.
+static void _ring_submit(DvzStagingRing* ring, bool sync)
+{
+    ASSERT(ring != NULL);
+    if (!ring->recording)
+        return;
+    uint32_t f = ring->cur_frame;
+    if (ring->profiler != NULL)
+        dvz_profiler_gpu_end(ring->profiler, DVZ_PROFILE_GPU_TRANSFER, &ring->cmds, f);
+    dvz_cmd_end(&ring->cmds, f);
+    ring->recording = false;
+
+    sync = sync || ring->signaled;
+
+    DvzSubmit submit = dvz_submit(ring->gpu);
+    dvz_submit_commands(&submit, &ring->cmds);
+
+    // The frames in flight may still read the buffers the copies write to. With separate queues,
+    // the copies wait on a semaphore signaled on the render queue after all render submissions
+    // so far. The semaphore was last waited on by the frame's previous copies, which have
+    // completed once the fence is signaled, so that it can be signaled again.
+    if (!ring->same_queue)
+    {
+        if (!dvz_fences_ready(&ring->fences, f))
+        {
+            ring->stats.stalls++;
+            dvz_fences_wait(&ring->fences, f);
+        }
+        dvz_queue_signal(ring->gpu, DVZ_DEFAULT_QUEUE_RENDER, &ring->semaphores_release, f);
+        dvz_submit_wait_semaphores(
+            &submit, VK_PIPELINE_STAGE_TRANSFER_BIT, &ring->semaphores_release, f);
+    }
+    if (!sync)
+        dvz_submit_signal_semaphores(&submit, &ring->semaphores, f);
+    log_debug("submit %s of staged uploads", pretty_size(ring->frame_size[f]));
+    dvz_submit_send(&submit, f, &ring->fences, f);
+    ring->stats.submissions++;
+    if (ring->profiler != NULL)
+        dvz_profiler_gpu_submitted(ring->profiler, DVZ_PROFILE_GPU_TRANSFER, f);
+
+    // In synchronous mode, the other frames' copies are also waited for, so that the whole ring
+    // is released and the head and tail positions remain consistent.
+    if (sync)
+    {
+        ring->stats.stalls++;
+        dvz_fences_wait(&ring->fences, f);
+        _ring_retire_all(ring);
+    }
+    else
+    {
+        ring->signaled = true;
+        ring->signaled_idx = f;
+    }
+}
+
+
+
+void dvz_staging_ring_destroy(DvzStagingRing* ring)
 {
-    DvzTransfer* item = (DvzTransfer*)dvz_fifo_dequeue(fifo, wait);
-    DvzTransfer out;
-    out.type = DVZ_TRANSFER_NONE;
-    if (item == NULL)
-        return out;
-    ASSERT(item != NULL);
-    out = *item;
-    FREE(item);
-    return out;
+    ASSERT(ring != NULL);
+    if (!dvz_obj_is_created(&ring->obj))
+    {
+        log_trace("skip destruction of already-destroyed staging ring");
+        return;
+    }
+    log_trace("destroy staging ring");
+    dvz_buffer_destroy(&ring->buffer);
+    dvz_commands_destroy(&ring->cmds);
+    dvz_fences_destroy(&ring->fences);
+    dvz_semaphores_destroy(&ring->semaphores);
+    dvz_semaphores_destroy(&ring->semaphores_release);
+    FREE(ring->batch);
+    FREE(ring->copies);
+    dvz_obj_destroyed(&ring->obj);
+}
+
+
+
+/*************************************************************************************************/
+/*  Upload batching                                                                              */
+/*************************************************************************************************/
+
+static int _compare_staged(const void* a, const void* b)
+{
+    const DvzStagedUpload* ua = (const DvzStagedUpload*)a;
+    const DvzStagedUpload* ub = (const DvzStagedUpload*)b;
+    if (ua->buffer != ub->buffer)
+        return (uintptr_t)ua->buffer < (uintptr_t)ub->buffer ? -1 : +1;
+    if (ua->start != ub->start)
+        return ua->start < ub->start ? -1 : +1;
+    return ua->order < ub->order ? -1 : (ua->order > ub->order ? +1 : 0);
+}
+
+
+
+static int _compare_order(const void* a, const void* b)
+{
+    const DvzStagedUpload* ua = (const DvzStagedUpload*)a;
+    const DvzStagedUpload* ub = (const DvzStagedUpload*)b;
+    return ua->order < ub->order ? -1 : (ua->order > ub->order ? +1 : 0);
+}
+
+
+
+// Number of bytes uploaded to the GPU by a transfer.
+static VkDeviceSize _upload_size(DvzTransfer* tr)
+{
+    ASSERT(tr != NULL);
+    if (tr->type == DVZ_TRANSFER_BUFFER_UPLOAD)
+        return tr->u.buf.size;
+    if (tr->type == DVZ_TRANSFER_TEXTURE_UPLOAD)
+        return tr->u.tex.size;
+    return 0;
+}
+
+
+
+static bool _is_staged_upload(DvzTransfer* tr)
+{
+    ASSERT(tr != NULL);
+    if (tr->type != DVZ_TRANSFER_BUFFER_UPLOAD)
+        return false;
+    DvzBufferType type = tr->u.buf.regions.buffer->type;
+    return type != DVZ_BUFFER_TYPE_UNIFORM_MAPPABLE && type != DVZ_BUFFER_TYPE_STAGING;
+}
+
+
+
+// Upload without the staging ring, with hard synchronization.
+static void _upload_sync(DvzContext* context, DvzStagedUpload* up)
+{
+    ASSERT(context != NULL);
+    ASSERT(up != NULL);
+    VkDeviceSize size = up->end - up->start;
+    DvzBuffer* staging = staging_buffer(context, size);
+    dvz_buffer_upload(staging, 0, size, up->data);
+
+    DvzBufferRegions br = {0};
+    br.buffer = up->buffer;
+    br.count = 1;
+    br.size = size;
+    _copy_buffer_from_staging(context, br, up->start, size);
+}
+
+
+
+// Stage a run of consecutive uploads to non-mappable buffers.
+static void _stage_uploads(DvzCanvas* canvas, uint32_t count, DvzTransfer** uploads)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(count <= DVZ_TRANSFER_POOL_SIZE);
+    if (count == 0)
+        return;
+    DvzStagingRing* ring = &canvas->staging;
+    DvzContext* context = canvas->gpu->context;
+    DvzStagedUpload* batch = ring->batch;
+    DvzBuffer* buffers[DVZ_TRANSFER_POOL_SIZE] = {0};
+    VkBufferCopy* copies = ring->copies;
+    uint32_t copy_count = 0;
+
+    // Absolute destination ranges of the uploads.
+    DvzTransferBuffer* tb = NULL;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        tb = &uploads[i]->u.buf;
+        ASSERT(tb->regions.count == 1);
+        batch[i].buffer = tb->regions.buffer;
+        batch[i].start = tb->regions.offsets[0] + tb->offset;
+        batch[i].end = batch[i].start + tb->size;
+        batch[i].order = i;
+        batch[i].data = tb->data;
+    }
+    ring->stats.uploads += count;
+    ring->stats.stalls_avoided += count;
+
+    // Sort by destination buffer and start offset, so that adjacent or overlapping uploads are
+    // consecutive.
+    qsort(batch, count, sizeof(DvzStagedUpload), _compare_staged);
+
+    uint32_t g0 = 0, g1 = 0, written = 0;
+    VkDeviceSize start = 0, end = 0, ring_offset = 0;
+    bool covered = false;
+    while (g0 < count)
+    {
+        // Find the group of uploads whose union is a contiguous range.
+        start = batch[g0].start;
+        end = batch[g0].end;
+        for (g1 = g0 + 1; g1 < count; g1++)
+        {
+            if (batch[g1].buffer != batch[g0].buffer || batch[g1].start > end)
+                break;
+            end = MAX(end, batch[g1].end);
+        }
+
+        // Suballocate the group in the ring. If the ring is full, submit the copies recorded so
+        // far, wait for them, and try again.
+        if (!_ring_alloc(ring, end - start, &ring_offset))
+        {
+            _ring_record(ring, copy_count, buffers, copies);
+            copy_count = 0;
+            _ring_submit(ring, true);
+            // Also release the space used by the frames in flight when nothing was recorded yet.
+            _ring_retire_all(ring);
+            if (!_ring_alloc(ring, end - start, &ring_offset))
+            {
+                // The group is larger than the ring.
+                log_debug("upload of %s does not fit in the staging ring", //
+                          pretty_size(end - start));
+                qsort(&batch[g0], g1 - g0, sizeof(DvzStagedUpload), _compare_order);
+                for (uint32_t i = g0; i < g1; i++)
+                    _upload_sync(context, &batch[i]);
+                g0 = g1;
+                continue;
+            }
+        }
+
+        // Write the uploads in the queue order, skipping those fully overwritten by a later one.
+        qsort(&batch[g0], g1 - g0, sizeof(DvzStagedUpload), _compare_order);
+        written = 0;
+        for (uint32_t i = g0; i < g1; i++)
+        {
+            covered = false;
+            for (uint32_t j = i + 1; j < g1 && !covered; j++)
+                covered = batch[j].start <= batch[i].start && batch[i].end <= batch[j].end;
+            if (covered)
+            {
+                ring->stats.dropped++;
+                continue;
+            }
+            dvz_buffer_upload(
+                &ring->buffer, ring_offset + batch[i].start - start,
+                batch[i].end - batch[i].start, batch[i].data);
+            ring->stats.bytes_staged += batch[i].end - batch[i].start;
+            written++;
+        }
+        ASSERT(written > 0);
+        ring->stats.merged += written - 1;
+
+        // A single copy region for the whole group.
+        buffers[copy_count] = batch[g0].buffer;
+        copies[copy_count].srcOffset = ring_offset;
+        copies[copy_count].dstOffset = start;
+        copies[copy_count].size = end - start;
+        copy_count++;
+
+        g0 = g1;
+    }
+
+    _ring_record(ring, copy_count, buffers, copies);
 }
 
 
@@ -252,14 +736,61 @@ void dvz_process_transfers(DvzCanvas* canvas)
     if (fifo->is_empty)
         return;
 
+    // Release the staging ring space used by the copies of this frame's previous submission.
+    DvzStagingRing* ring = &canvas->staging;
+    bool has_ring = dvz_obj_is_created(&ring->obj);
+    bool sync = !canvas->app->is_running;
+    if (has_ring)
+    {
+        ring->cur_frame = canvas->cur_frame % ring->frame_count;
+        _ring_retire(ring, ring->cur_frame);
+    }
+
     // Process all pending transfer tasks.
+    DvzTransfer* uploads[DVZ_TRANSFER_POOL_SIZE] = {0};
+    uint32_t upload_count = 0;
+    DvzTransfer* item = NULL;
     DvzTransfer tr = {0};
     while (true)
     {
-        tr = _transfer_dequeue(fifo, false);
-        if (tr.type == DVZ_TRANSFER_NONE)
+        item = (DvzTransfer*)dvz_fifo_dequeue(fifo, false);
+        if (item == NULL)
             break;
         fifo->is_processing = true;
+        if (canvas->profiler != NULL)
+            dvz_profile_count(
+                canvas->profiler, DVZ_PROFILE_COUNTER_UPLOAD_BYTES, _upload_size(item));
+
+        // Consecutive uploads to non-mappable buffers are batched in the staging ring.
+        if (has_ring && _is_staged_upload(item))
+        {
+            uploads[upload_count++] = item;
+            if (upload_count == DVZ_TRANSFER_POOL_SIZE)
+            {
+                _stage_uploads(canvas, upload_count, uploads);
+                for (uint32_t i = 0; i < upload_count; i++)
+                    _pool_release(&canvas->transfer_pool, uploads[i]);
+                upload_count = 0;
+                // Copies recorded in two batches may overlap: submit the first batch.
+                _ring_submit(ring, true);
+            }
+            fifo->is_processing = false;
+            continue;
+        }
+        tr = *item;
+        _pool_release(&canvas->transfer_pool, item);
+
+        // All other transfers except mappable uploads may depend on the staged uploads: stage
+        // the pending uploads and flush them first.
+        if (has_ring && tr.type != DVZ_TRANSFER_BUFFER_UPLOAD)
+        {
+            _stage_uploads(canvas, upload_count, uploads);
+            for (uint32_t i = 0; i < upload_count; i++)
+                _pool_release(&canvas->transfer_pool, uploads[i]);
+            upload_count = 0;
+            if (ring->recording)
+                _ring_submit(ring, true);
+        }
 
         // Process buffer transfers.
         if (tr.type == DVZ_TRANSFER_BUFFER_UPLOAD)
@@ -281,8 +812,38 @@ void dvz_process_transfers(DvzCanvas* canvas)
                 tr.u.tex_copy.src, tr.u.tex_copy.src_offset, tr.u.tex_copy.dst,
                 tr.u.tex_copy.dst_offset, tr.u.tex_copy.shape);
 
+        // Process callbacks.
+        if (tr.type == DVZ_TRANSFER_CALLBACK)
+        {
+            ASSERT(tr.u.call.callback != NULL);
+            tr.u.call.callback(canvas, tr.u.call.user_data);
+        }
+
         fifo->is_processing = false;
     }
+
+    // Stage the remaining uploads.
+    if (upload_count > 0)
+    {
+        _stage_uploads(canvas, upload_count, uploads);
+        for (uint32_t i = 0; i < upload_count; i++)
+            _pool_release(&canvas->transfer_pool, uploads[i]);
+    }
+
+    if (has_ring && ring->recording)
+    {
+        // Submit all copies of this frame at once. The render submission will wait on the
+        // semaphore.
+        _ring_submit(ring, sync);
+    }
+}
+
+
+
+DvzTransferStats dvz_transfer_stats(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    return canvas->staging.stats;
 }
 
 
@@ -318,7 +879,7 @@ static void _enqueue_buffers_transfer(
     // buffers that are not continuously updated in each frame.
     tr.u.buf.update_all_buffers = !canvas->app->is_running;
 
-    _transfer_enqueue(&canvas->transfers, tr);
+    _transfer_enqueue(canvas, tr);
 }
 
 
@@ -368,7 +929,25 @@ void dvz_copy_buffers(
     tr.u.buf_copy.dst_offset = dst_offset;
     tr.u.buf_copy.size = size;
 
-    _transfer_enqueue(&canvas->transfers, tr);
+    _transfer_enqueue(canvas, tr);
+
+    if (!canvas->app->is_running)
+        dvz_process_transfers(canvas);
+}
+
+
+
+void dvz_transfer_callback(DvzCanvas* canvas, DvzTransferCallback callback, void* user_data)
+{
+    ASSERT(canvas != NULL);
+    ASSERT(callback != NULL);
+
+    DvzTransfer tr = {0};
+    tr.type = DVZ_TRANSFER_CALLBACK;
+    tr.u.call.callback = callback;
+    tr.u.call.user_data = user_data;
+
+    _transfer_enqueue(canvas, tr);
 
     if (!canvas->app->is_running)
         dvz_process_transfers(canvas);
@@ -413,7 +992,7 @@ static void _enqueue_texture_transfer(
     tr.u.tex.data = data;
     tr.u.tex.texture = texture;
 
-    _transfer_enqueue(&canvas->transfers, tr);
+    _transfer_enqueue(canvas, tr);
 }
 
 
@@ -468,7 +1047,7 @@ void dvz_copy_texture(
     memcpy(tr.u.tex_copy.dst_offset, dst_offset, sizeof(uvec3));
     memcpy(tr.u.tex_copy.shape, shape, sizeof(uvec3));
 
-    _transfer_enqueue(&canvas->transfers, tr);
+    _transfer_enqueue(canvas, tr);
 
     if (!canvas->app->is_running)
         dvz_process_transfers(canvas);
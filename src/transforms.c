@@ -2,63 +2,565 @@
 #include "../include/datoviz/panel.h"
 #include "transforms_utils.h"
 
+#if (GCC || CLANG) && (defined(__x86_64__) || defined(__i386__))
+#define HAS_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define HAS_X86_SIMD 0
+#endif
+
 
 
 /*************************************************************************************************/
-/*  Functions                                                                                    */
+/*  Normalization kernels                                                                        */
 /*************************************************************************************************/
 
-void dvz_transform_pos(DvzDataCoords coords, DvzArray* pos_in, DvzArray* pos_out, bool inverse)
+typedef struct DvzNormalizeJob DvzNormalizeJob;
+
+// Linear rescaling of an array of positions, and computation of their bounding box. The arrays
+// are seen as flat arrays of scalars, with `components` scalars per position. The input positions
+// may be strided, for example when borrowed from an interleaved external buffer.
+struct DvzNormalizeJob
+{
+    const void* src;
+    VkDeviceSize src_stride; // number of bytes between two input positions
+    void* dst;               // NULL when only computing the bounding box
+    uint32_t components;
+    bool is_double;
+    bool split; // write the double-float split of the positions to dst instead of rescaling them
+    dvec3 scale, offset; // out = in * scale + offset, for each component
+
+    uint32_t item_count;
+    uint32_t chunk; // number of positions per task
+    DvzBox* boxes;  // bounding box of each task
+};
+
+
+
+// Return the number of components of a position dtype, or 0 if the dtype is not supported.
+static uint32_t _pos_components(DvzDataType dtype, bool* is_double)
+{
+    ASSERT(is_double != NULL);
+    *is_double = dtype == DVZ_DTYPE_DOUBLE || dtype == DVZ_DTYPE_DVEC2 || dtype == DVZ_DTYPE_DVEC3;
+    switch (dtype)
+    {
+    case DVZ_DTYPE_DOUBLE:
+    case DVZ_DTYPE_FLOAT:
+        return 1;
+    case DVZ_DTYPE_DVEC2:
+    case DVZ_DTYPE_VEC2:
+        return 2;
+    case DVZ_DTYPE_DVEC3:
+    case DVZ_DTYPE_VEC3:
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+
+
+// NOTE: all kernels compute in double precision, with a separate multiplication and addition, so
+// that the results do not depend on the SIMD level nor on the number of threads.
+#define MAKE_NORMALIZE_SCALAR(T)                                                                  \
+    static void _normalize_scalar_##T(                                                            \
+        const DvzNormalizeJob* job, const uint8_t* src, T* dst, uint32_t count, DvzBox* box)      \
+    {                                                                                             \
+        uint32_t c = job->components;                                                             \
+        const T* p = NULL;                                                                        \
+        double x = 0;                                                                             \
+        for (uint32_t i = 0; i < count; i++)                                                      \
+        {                                                                                         \
+            p = (const T*)(src + i * job->src_stride);                                            \
+            for (uint32_t j = 0; j < c; j++)                                                      \
+            {                                                                                     \
+                x = (double)p[j];                                                                 \
+                box->p0[j] = MIN(box->p0[j], x);                                                  \
+                box->p1[j] = MAX(box->p1[j], x);                                                  \
+                if (dst != NULL)                                                                  \
+                    dst[i * c + j] = (T)(x * job->scale[j] + job->offset[j]);                     \
+            }                                                                                     \
+        }                                                                                         \
+    }
+
+MAKE_NORMALIZE_SCALAR(double)
+MAKE_NORMALIZE_SCALAR(float)
+
+
+
+// Each position is written as 6 floats, the high parts (x, y, z) followed by the low parts, so
+// that hi + lo represents the original value with about 48 bits of mantissa. Missing components
+// are set to 0.
+#define MAKE_SPLIT_SCALAR(T)                                                                      \
+    static void _split_scalar_##T(                                                                \
+        const DvzNormalizeJob* job, const uint8_t* src, float* dst, uint32_t count, DvzBox* box)  \
+    {                                                                                             \
+        uint32_t c = job->components;                                                             \
+        const T* p = NULL;                                                                        \
+        double x = 0;                                                                             \
+        float hi = 0;                                                                             \
+        for (uint32_t i = 0; i < count; i++)                                                      \
+        {                                                                                         \
+            p = (const T*)(src + i * job->src_stride);                                            \
+            for (uint32_t j = 0; j < 3; j++)                                                      \
+            {                                                                                     \
+                x = j < c ? (double)p[j] : 0;                                                     \
+                if (j < c)                                                                        \
+                {                                                                                 \
+                    box->p0[j] = MIN(box->p0[j], x);                                              \
+                    box->p1[j] = MAX(box->p1[j], x);                                              \
+                }                                                                                 \
+                hi = (float)x;                                                                    \
+                dst[6 * i + j] = hi;                                                              \
+                dst[6 * i + 3 + j] = (float)(x - (double)hi);                                     \
+            }                                                                                     \
+        }                                                                                         \
+    }
+
+MAKE_SPLIT_SCALAR(double)
+MAKE_SPLIT_SCALAR(float)
+
+
+
+#if HAS_X86_SIMD
+
+static inline __m128d _load2_ps(const float* p)
+{
+    return _mm_cvtps_pd(_mm_castpd_ps(_mm_load_sd((const double*)p)));
+}
+
+static inline void _store2_ps(float* p, __m128d v)
+{
+    _mm_store_sd((double*)p, _mm_castps_pd(_mm_cvtpd_ps(v)));
+}
+
+__attribute__((target("avx2"))) static inline __m256d _load4_ps(const float* p)
+{
+    return _mm256_cvtps_pd(_mm_loadu_ps(p));
+}
+
+__attribute__((target("avx2"))) static inline void _store4_ps(float* p, __m256d v)
+{
+    _mm_storeu_ps(p, _mm256_cvtpd_ps(v));
+}
+
+
+
+// A block of W positions spans exactly C vectors of W lanes, lane l of vector k holding the
+// component (k * W + l) % C. The scale, offset, min and max vectors follow the same pattern.
+#define MAKE_NORMALIZE_SIMD(name, attr, T, W, V, LOAD, STORE, P, SET1, LOADD, STORED)             \
+    attr static inline void _normalize_##name##_c(                                                \
+        const DvzNormalizeJob* job, const T* src, T* dst, uint32_t count, DvzBox* box,            \
+        const uint32_t C)                                                                         \
+    {                                                                                             \
+        V a[3], b[3], lo[3], hi[3], v;                                                            \
+        double tmp[W];                                                                            \
+        for (uint32_t k = 0; k < C; k++)                                                          \
+        {                                                                                         \
+            for (uint32_t l = 0; l < W; l++)                                                      \
+                tmp[l] = job->scale[(k * W + l) % C];                                             \
+            a[k] = LOADD(tmp);                                                                    \
+            for (uint32_t l = 0; l < W; l++)                                                      \
+                tmp[l] = job->offset[(k * W + l) % C];                                            \
+            b[k] = LOADD(tmp);                                                                    \
+            lo[k] = SET1(+INFINITY);                                                              \
+            hi[k] = SET1(-INFINITY);                                                              \
+        }                                                                                         \
+                                                                                                  \
+        uint32_t n = count / W * W;                                                               \
+        for (uint32_t i = 0; i < n * C; i += W * C)                                               \
+        {                                                                                         \
+            for (uint32_t k = 0; k < C; k++)                                                      \
+            {                                                                                     \
+                v = LOAD(&src[i + k * W]);                                                        \
+                lo[k] = P##_min_pd(lo[k], v);                                                     \
+                hi[k] = P##_max_pd(hi[k], v);                                                     \
+                if (dst != NULL)                                                                  \
+                    STORE(&dst[i + k * W], P##_add_pd(P##_mul_pd(v, a[k]), b[k]));                \
+            }                                                                                     \
+        }                                                                                         \
+                                                                                                  \
+        for (uint32_t k = 0; k < C; k++)                                                          \
+        {                                                                                         \
+            STORED(tmp, lo[k]);                                                                   \
+            for (uint32_t l = 0; l < W; l++)                                                      \
+                box->p0[(k * W + l) % C] = MIN(box->p0[(k * W + l) % C], tmp[l]);                 \
+            STORED(tmp, hi[k]);                                                                   \
+            for (uint32_t l = 0; l < W; l++)                                                      \
+                box->p1[(k * W + l) % C] = MAX(box->p1[(k * W + l) % C], tmp[l]);                 \
+        }                                                                                         \
+                                                                                                  \
+        _normalize_scalar_##T(                                                                    \
+            job, (const uint8_t*)&src[n * C], dst != NULL ? &dst[n * C] : NULL, count - n, box);  \
+    }                                                                                             \
+                                                                                                  \
+    attr static void _normalize_##name(                                                           \
+        const DvzNormalizeJob* job, const T* src, T* dst, uint32_t count, DvzBox* box)            \
+    {                                                                                             \
+        switch (job->components)                                                                  \
+        {                                                                                         \
+        case 1:                                                                                   \
+            _normalize_##name##_c(job, src, dst, count, box, 1);                                  \
+            break;                                                                                \
+        case 2:                                                                                   \
+            _normalize_##name##_c(job, src, dst, count, box, 2);                                  \
+            break;                                                                                \
+        case 3:                                                                                   \
+            _normalize_##name##_c(job, src, dst, count, box, 3);                                  \
+            break;                                                                                \
+        default:                                                                                  \
+            log_error("unsupported number of components %d", job->components);                    \
+            break;                                                                                \
+        }                                                                                         \
+    }
+
+#define NO_ATTR
+#define AVX2_ATTR __attribute__((target("avx2")))
+
+MAKE_NORMALIZE_SIMD(
+    sse2_double, NO_ATTR, double, 2, __m128d, _mm_loadu_pd, _mm_storeu_pd, _mm, _mm_set1_pd,
+    _mm_loadu_pd, _mm_storeu_pd)
+MAKE_NORMALIZE_SIMD(
+    sse2_float, NO_ATTR, float, 2, __m128d, _load2_ps, _store2_ps, _mm, _mm_set1_pd,
+    _mm_loadu_pd, _mm_storeu_pd)
+MAKE_NORMALIZE_SIMD(
+    avx2_double, AVX2_ATTR, double, 4, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256,
+    _mm256_set1_pd, _mm256_loadu_pd, _mm256_storeu_pd)
+MAKE_NORMALIZE_SIMD(
+    avx2_float, AVX2_ATTR, float, 4, __m256d, _load4_ps, _store4_ps, _mm256, _mm256_set1_pd,
+    _mm256_loadu_pd, _mm256_storeu_pd)
+
+#endif
+
+
+
+// Normalize a range of positions with the best available kernel.
+static void _normalize_range(
+    const DvzNormalizeJob* job, uint32_t first, uint32_t count, DvzBox* box)
+{
+    ASSERT(job != NULL);
+    ASSERT(box != NULL);
+    *box = DVZ_BOX_INF;
+    if (count == 0)
+        return;
+
+    uint32_t c = job->components;
+    const uint8_t* src = (const uint8_t*)job->src + first * job->src_stride;
+    if (job->split)
+    {
+        ASSERT(job->dst != NULL);
+        float* dst = (float*)job->dst + 6 * first;
+        if (job->is_double)
+            _split_scalar_double(job, src, dst, count, box);
+        else
+            _split_scalar_float(job, src, dst, count, box);
+        return;
+    }
+
+    // The SIMD kernels require packed input positions.
+    DvzSimdLevel level = dvz_simd_level();
+    if (job->src_stride != c * (job->is_double ? sizeof(double) : sizeof(float)))
+        level = DVZ_SIMD_NONE;
+    (void)level;
+    if (job->is_double)
+    {
+        double* dst = job->dst != NULL ? (double*)job->dst + first * c : NULL;
+#if HAS_X86_SIMD
+        if (level >= DVZ_SIMD_AVX2)
+            _normalize_avx2_double(job, (const double*)src, dst, count, box);
+        else if (level >= DVZ_SIMD_SSE2)
+            _normalize_sse2_double(job, (const double*)src, dst, count, box);
+        else
+#endif
+            _normalize_scalar_double(job, src, dst, count, box);
+    }
+    else
+    {
+        float* dst = job->dst != NULL ? (float*)job->dst + first * c : NULL;
+#if HAS_X86_SIMD
+        if (level >= DVZ_SIMD_AVX2)
+            _normalize_avx2_float(job, (const float*)src, dst, count, box);
+        else if (level >= DVZ_SIMD_SSE2)
+            _normalize_sse2_float(job, (const float*)src, dst, count, box);
+        else
+#endif
+            _normalize_scalar_float(job, src, dst, count, box);
+    }
+}
+
+
+
+static void _normalize_task(void* user_data, uint32_t task_idx)
+{
+    DvzNormalizeJob* job = (DvzNormalizeJob*)user_data;
+    ASSERT(job != NULL);
+    uint32_t first = task_idx * job->chunk;
+    ASSERT(first < job->item_count);
+    _normalize_range(job, first, MIN(job->chunk, job->item_count - first), &job->boxes[task_idx]);
+}
+
+
+
+// Run a normalization job, in parallel if there are enough positions, and return the bounding
+// box of the input positions.
+static DvzBox _normalize(DvzWorkers* workers, DvzNormalizeJob* job)
 {
-    // NOTE: this CPU transformation function is not optimized at all
+    ASSERT(job != NULL);
+    ASSERT(job->item_count > 0);
 
+    uint32_t task_count = 1;
+    if (workers != NULL && workers->thread_count > 1)
+    {
+        job->chunk = MAX(
+            DVZ_TRANSFORM_CHUNK_SIZE, (job->item_count + workers->thread_count - 1) /
+                                          workers->thread_count);
+        task_count = (job->item_count + job->chunk - 1) / job->chunk;
+    }
+    if (task_count <= 1)
+    {
+        job->chunk = job->item_count;
+        task_count = 1;
+    }
+
+    DvzBox box = DVZ_BOX_INF;
+    job->boxes = &box;
+    if (task_count == 1)
+        _normalize_task(job, 0);
+    else
+    {
+        job->boxes = calloc(task_count, sizeof(DvzBox));
+        dvz_workers_run(workers, task_count, _normalize_task, job);
+        for (uint32_t i = 0; i < task_count; i++)
+        {
+            for (uint32_t j = 0; j < 3; j++)
+            {
+                box.p0[j] = MIN(box.p0[j], job->boxes[i].p0[j]);
+                box.p1[j] = MAX(box.p1[j], job->boxes[i].p1[j]);
+            }
+        }
+        FREE(job->boxes);
+    }
+
+    // Missing components.
+    for (uint32_t j = job->components; j < 3; j++)
+    {
+        box.p0[j] = 0;
+        box.p1[j] = 0;
+    }
+    return box;
+}
+
+
+
+// Create or resize the output array so that it matches the input array.
+static void _pos_out_prepare(DvzArray* pos_in, DvzArray* pos_out)
+{
     ASSERT(pos_in != NULL);
     ASSERT(pos_out != NULL);
+    if (pos_out == pos_in)
+        return;
+    if (!dvz_obj_is_created(&pos_out->obj) || pos_out->dtype != pos_in->dtype)
+    {
+        dvz_array_destroy(pos_out);
+        *pos_out = dvz_array(pos_in->item_count, pos_in->dtype);
+    }
+    else
+    {
+        dvz_array_resize(pos_out, pos_in->item_count);
+    }
     ASSERT(pos_out->item_count == pos_in->item_count);
     ASSERT(pos_out->item_size == pos_in->item_size);
-    ASSERT(pos_out->dtype == pos_in->dtype);
+}
+
+
+
+/*************************************************************************************************/
+/*  Functions                                                                                    */
+/*************************************************************************************************/
+
+DvzBox dvz_box_bounding(DvzWorkers* workers, DvzArray* pos)
+{
+    ASSERT(pos != NULL);
+    return dvz_box_bounding_range(workers, pos, 0, pos->item_count);
+}
+
+
+
+DvzBox
+dvz_box_bounding_range(DvzWorkers* workers, DvzArray* pos, uint32_t first_item, uint32_t count)
+{
+    ASSERT(pos != NULL);
+    ASSERT(count > 0);
+    ASSERT(first_item + count <= pos->item_count);
+
+    DvzNormalizeJob job = {0};
+    job.components = _pos_components(pos->dtype, &job.is_double);
+    if (job.components == 0)
+    {
+        log_error("unsupported dtype %d for a bounding box", pos->dtype);
+        return DVZ_BOX_NDC;
+    }
+    job.src_stride = dvz_array_stride(pos);
+    job.src = (const uint8_t*)pos->data + first_item * job.src_stride;
+    job.item_count = count;
+    return _normalize(workers, &job);
+}
+
+
+
+DvzBox
+dvz_transform_normalize(DvzWorkers* workers, DvzBox box, DvzArray* pos_in, DvzArray* pos_out)
+{
+    ASSERT(pos_in != NULL);
+    return dvz_transform_normalize_range(workers, box, pos_in, pos_out, 0, pos_in->item_count);
+}
+
+
+
+DvzBox dvz_transform_normalize_range(
+    DvzWorkers* workers, DvzBox box, DvzArray* pos_in, DvzArray* pos_out, uint32_t first_item,
+    uint32_t count)
+{
+    ASSERT(pos_in != NULL);
+    ASSERT(pos_out != NULL);
+    ASSERT(count > 0);
+    ASSERT(first_item + count <= pos_in->item_count);
+
+    DvzNormalizeJob job = {0};
+    job.components = _pos_components(pos_in->dtype, &job.is_double);
+    if (job.components == 0)
+    {
+        log_error("unsupported dtype %d for data normalization", pos_in->dtype);
+        return DVZ_BOX_NDC;
+    }
+
+    _pos_out_prepare(pos_in, pos_out);
+
+    // Linear rescaling to NDC.
+    DvzTransform tr = _transform_interp(box, DVZ_BOX_NDC);
+    for (uint32_t j = 0; j < 3; j++)
+    {
+        job.scale[j] = tr.mat[j][j];
+        job.offset[j] = tr.mat[3][j];
+    }
+
+    job.src_stride = dvz_array_stride(pos_in);
+    job.src = (const uint8_t*)pos_in->data + first_item * job.src_stride;
+    job.dst = (uint8_t*)pos_out->data + first_item * pos_out->item_size;
+    job.item_count = count;
+    return _normalize(workers, &job);
+}
+
+
+
+DvzBox dvz_transform_split(DvzWorkers* workers, DvzArray* pos_in, DvzArray* pos_out)
+{
+    ASSERT(pos_in != NULL);
+    return dvz_transform_split_range(workers, pos_in, pos_out, 0, pos_in->item_count);
+}
+
+
+
+DvzBox dvz_transform_split_range(
+    DvzWorkers* workers, DvzArray* pos_in, DvzArray* pos_out, uint32_t first_item, uint32_t count)
+{
+    ASSERT(pos_in != NULL);
+    ASSERT(pos_out != NULL);
+    ASSERT(pos_in != pos_out);
+    ASSERT(count > 0);
+    ASSERT(first_item + count <= pos_in->item_count);
+
+    DvzNormalizeJob job = {0};
+    job.components = _pos_components(pos_in->dtype, &job.is_double);
+    if (job.components == 0)
+    {
+        log_error("unsupported dtype %d for the double-float split", pos_in->dtype);
+        return DVZ_BOX_NDC;
+    }
+    job.split = true;
+
+    // The output array is a structured array with 6 floats per position.
+    VkDeviceSize item_size = 6 * sizeof(float);
+    if (!dvz_obj_is_created(&pos_out->obj) || pos_out->item_size != item_size)
+    {
+        dvz_array_destroy(pos_out);
+        *pos_out = dvz_array_struct(pos_in->item_count, item_size);
+    }
+    else
+    {
+        dvz_array_resize(pos_out, pos_in->item_count);
+    }
+
+    job.src_stride = dvz_array_stride(pos_in);
+    job.src = (const uint8_t*)pos_in->data + first_item * job.src_stride;
+    job.dst = (uint8_t*)pos_out->data + first_item * item_size;
+    job.item_count = count;
+    return _normalize(workers, &job);
+}
+
+
+
+DvzTransformParams dvz_transform_params(DvzDataCoords coords)
+{
+    DvzTransformParams params = {0};
+    params.transform = (int32_t)coords.transform;
+
+    DvzBox box = coords.box;
+    if (coords.transform == DVZ_TRANSFORM_EARTH_MERCATOR_WEB)
+    {
+        // The positions are projected on the GPU, before being rescaled with the transformed
+        // box, as in dvz_transform_pos().
+        DvzTransform tr = _transform(coords.transform);
+        _transform_apply(&tr, coords.box.p0, box.p0);
+        _transform_apply(&tr, coords.box.p1, box.p1);
+    }
+    else if (coords.transform != DVZ_TRANSFORM_NONE && coords.transform != DVZ_TRANSFORM_CARTESIAN)
+    {
+        log_error("transform %d is not supported on the GPU", coords.transform);
+    }
+
+    // NDC = scale * (pos - center), where the box center is split into two floats.
+    double center = 0;
+    for (uint32_t j = 0; j < 3; j++)
+    {
+        center = .5 * (box.p0[j] + box.p1[j]);
+        params.center_hi[j] = (float)center;
+        params.center_lo[j] = (float)(center - (double)params.center_hi[j]);
+        params.scale[j] = (float)(2.0 / (box.p1[j] - box.p0[j]));
+    }
+    return params;
+}
+
+
+
+DvzBox dvz_transform_pos_parallel(
+    DvzWorkers* workers, DvzDataCoords coords, DvzArray* pos_in, DvzArray* pos_out, bool inverse)
+{
+    ASSERT(pos_in != NULL);
+    ASSERT(pos_out != NULL);
 
     log_debug(
         "data normalization on %d position elements, transform %d", pos_in->item_count,
         coords.transform);
 
-    // Default transform.
-    DvzTransform tr = _transform(DVZ_TRANSFORM_CARTESIAN);
-
-    // // HACK: for now we only support DVEC3. For axes we need support for FLOAT just for linear
-    // so
-    // // we do that here.
-    // if (pos_out->dtype == DVZ_DTYPE_DOUBLE && coords.transform == DVZ_TRANSFORM_CARTESIAN)
-    // {
-    //     _box_print(coords.box);
-    //     double a = 2. / (coords.box.p1[0] - coords.box.p0[0]);
-    //     double b = -1 - 2 * coords.box.p0[0] / (coords.box.p1[0] - coords.box.p0[0]);
-    //     double x = 0;
-    //     for (uint32_t i = 0; i < pos_in->item_count; i++)
-    //     {
-    //         x = ((double*)pos_in->data)[i];
-    //         ((double*)pos_out->data)[i] = a * x + b;
-    //         log_debug("%f %f", x, ((double*)pos_out->data)[i]);
-    //     }
-    //     return;
-    //     // -1 + 2 * (t - u) / (v - u);
-    // }
-
-    // TODO: support other dtypes
-    ASSERT(pos_out->dtype == DVZ_DTYPE_DVEC3);
-
-    DvzArray* pos_temp = pos_in;
-
-    // First, handle non-cartesian transforms.
-    if (coords.transform == DVZ_TRANSFORM_EARTH_MERCATOR_WEB)
+    // Cartesian transform: linear rescaling to NDC, fused with the bounding box computation.
+    if (coords.transform != DVZ_TRANSFORM_EARTH_MERCATOR_WEB)
+        return dvz_transform_normalize(workers, coords.box, pos_in, pos_out);
+
+    // Non-cartesian transforms.
+    // TODO: more non-cartesian transforms.
+    if (pos_in->dtype != DVZ_DTYPE_DVEC3)
     {
-        tr = _transform(coords.transform);
-        if (inverse)
-            tr = _transform_inv(&tr);
-        _transform_array(&tr, pos_in, pos_out);
-        pos_temp = pos_out;
+        log_error("non-cartesian transforms only support dvec3 positions");
+        return DVZ_BOX_NDC;
     }
-    // TODO: more non-cartesian transforms.
+    DvzBox bounds = dvz_box_bounding(workers, pos_in);
+
+    DvzTransform tr = _transform(coords.transform);
+    if (inverse)
+        tr = _transform_inv(&tr);
+    _pos_out_prepare(pos_in, pos_out);
+    _transform_array(&tr, pos_in, pos_out);
 
     // Transform the box.
     // NOTE: assuming a box is transformed to a box...
@@ -67,12 +569,15 @@ void dvz_transform_pos(DvzDataCoords coords, DvzArray* pos_in, DvzArray* pos_out
     _transform_apply(&tr, coords.box.p1, box.p1);
 
     // Then, linearly rescale to NDC, using the transformed box.
-    tr = _transform_interp(box, DVZ_BOX_NDC);
+    dvz_transform_normalize(workers, box, pos_out, pos_out);
+    return bounds;
+}
+
+
 
-    // Apply the transformation.
-    _transform_array(&tr, pos_temp, pos_out);
-    // dvz_array_print(pos_temp);
-    // dvz_array_print(pos_out);
+void dvz_transform_pos(DvzDataCoords coords, DvzArray* pos_in, DvzArray* pos_out, bool inverse)
+{
+    dvz_transform_pos_parallel(NULL, coords, pos_in, pos_out, inverse);
 }
 
 
@@ -0,0 +1,316 @@
+#include "../include/datoviz/transforms_gpu.h"
+#include "../include/datoviz/canvas.h"
+#include "../include/datoviz/context.h"
+#include "../include/datoviz/transfers.h"
+
+
+
+/*************************************************************************************************/
+/*  Constants                                                                                    */
+/*************************************************************************************************/
+
+#define DVZ_TRANSFORM_GPU_WORKGROUP_SIZE 64 // must match the compute shader
+#define DVZ_TRANSFORM_GPU_MAX_GROUPS     65535
+
+
+
+/*************************************************************************************************/
+/*  Utils                                                                                        */
+/*************************************************************************************************/
+
+// Buffer region covering the bytes [start, end), starting at an aligned offset as required for
+// storage buffers. The unaligned reads and writes of the shader may touch one more word.
+static DvzBufferRegions
+_bound_region(DvzBuffer* buffer, VkDeviceSize start, VkDeviceSize end, VkDeviceSize alignment)
+{
+    ASSERT(buffer != NULL);
+    ASSERT(start < end);
+    VkDeviceSize base = alignment > 0 ? start / alignment * alignment : start;
+    VkDeviceSize size = MIN((end - base + 4 + 3) / 4 * 4, buffer->size - base);
+    return dvz_buffer_regions(buffer, 1, base, size, 0);
+}
+
+
+
+// Bind only the regions accessed by the compute pass, as the shared buffers may exceed
+// maxStorageBufferRange. The offsets of the returned push constants are relative to the bound
+// ranges, whereas the offsets of tg->push are absolute.
+static DvzTransformGpuPush _bind_regions(DvzTransformGpu* tg)
+{
+    ASSERT(tg != NULL);
+    ASSERT(tg->br_split.buffer != NULL);
+    ASSERT(tg->br_dst.buffer != NULL);
+    DvzGpu* gpu = tg->canvas->gpu;
+    VkDeviceSize alignment = gpu->device_properties.limits.minStorageBufferOffsetAlignment;
+
+    DvzTransformGpuPush push = tg->push;
+    VkDeviceSize start = push.src_offset;
+    VkDeviceSize end = start + 6 * sizeof(float) * MAX(push.data_count, 1);
+    DvzBufferRegions src = _bound_region(tg->br_split.buffer, start, end, alignment);
+    push.src_offset -= (uint32_t)src.offsets[0];
+
+    start = push.dst_offset;
+    end = start + (VkDeviceSize)(MAX(push.item_count, 1) - 1) * push.dst_stride +
+          sizeof(float) * push.components;
+    DvzBufferRegions dst = _bound_region(tg->br_dst.buffer, start, end, alignment);
+    push.dst_offset -= (uint32_t)dst.offsets[0];
+
+    dvz_bindings_buffer(&tg->bindings, 0, src);
+    dvz_bindings_buffer(&tg->bindings, 1, dst);
+    dvz_bindings_update(&tg->bindings);
+    return push;
+}
+
+
+
+static void _load_shader(DvzCompute* compute)
+{
+    ASSERT(compute != NULL);
+    unsigned long size = 0;
+    const unsigned char* buffer = dvz_resource_shader("transform_pos_comp", &size);
+    ASSERT(size > 0);
+    ASSERT(buffer != NULL);
+    ASSERT(size % 4 == 0);
+    uint32_t* code = (uint32_t*)calloc(size, 1);
+    memcpy(code, buffer, size);
+    dvz_compute_spirv(compute, size, code);
+    FREE(code);
+}
+
+
+
+// Transfer callback, called once the previous uploads have completed.
+static void _transform_gpu_run(DvzCanvas* canvas, void* user_data)
+{
+    ASSERT(canvas != NULL);
+    DvzTransformGpu* tg = (DvzTransformGpu*)user_data;
+    ASSERT(tg != NULL);
+    // Only the last enqueued pass runs, so that it comes after all uploads to the vertex buffer.
+    ASSERT(tg->pending > 0);
+    tg->pending--;
+    if (tg->pending > 0)
+        return;
+
+    if (tg->push.item_count == 0 || tg->push.data_count == 0)
+    {
+        log_debug("skip GPU data normalization, no data or no target");
+        return;
+    }
+    DvzGpu* gpu = canvas->gpu;
+    ASSERT(gpu != NULL);
+
+    // The command buffer and the descriptor set may still be used by the previous pass, which
+    // has normally completed long ago.
+    dvz_fences_wait(&tg->fences, 0);
+
+    // The underlying buffers may have been reallocated since the last pass.
+    DvzTransformGpuPush push = _bind_regions(tg);
+
+    // 2D dispatch when there are too many vertices for a single dimension.
+    uint32_t groups = (push.item_count + DVZ_TRANSFORM_GPU_WORKGROUP_SIZE - 1) /
+                      DVZ_TRANSFORM_GPU_WORKGROUP_SIZE;
+    uint32_t gx = MIN(groups, DVZ_TRANSFORM_GPU_MAX_GROUPS);
+    uint32_t gy = (groups + gx - 1) / gx;
+
+    // The pass is submitted to the render queue: this barrier orders it after the render
+    // submissions of the frames in flight, which may still read the vertex buffer, and after
+    // the uploads of the positions.
+    DvzBarrier barrier_in = dvz_barrier(gpu);
+    dvz_barrier_stages(
+        &barrier_in, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    dvz_barrier_buffer(&barrier_in, tg->br_split);
+    dvz_barrier_buffer_access(&barrier_in, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+    dvz_barrier_buffer(&barrier_in, tg->br_dst);
+    dvz_barrier_buffer_access(
+        &barrier_in, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    // The vertex buffer is read by the next render submissions.
+    DvzBarrier barrier = dvz_barrier(gpu);
+    dvz_barrier_stages(
+        &barrier, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT);
+    dvz_barrier_buffer(&barrier, tg->br_dst);
+    dvz_barrier_buffer_access(
+        &barrier, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT |
+            VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    DvzCommands* cmds = &tg->cmds;
+    dvz_cmd_reset(cmds, 0);
+    dvz_cmd_begin(cmds, 0);
+    dvz_cmd_barrier(cmds, 0, &barrier_in);
+    dvz_cmd_push(
+        cmds, 0, &tg->compute.slots, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DvzTransformGpuPush),
+        &push);
+    dvz_cmd_compute(cmds, 0, &tg->compute, (uvec3){gx, gy, 1});
+    dvz_cmd_barrier(cmds, 0, &barrier);
+    dvz_cmd_end(cmds, 0);
+
+    log_debug("GPU data normalization of %d vertices", push.item_count);
+    DvzSubmit submit = dvz_submit(gpu);
+    dvz_submit_commands(&submit, cmds);
+    dvz_submit_send(&submit, 0, &tg->fences, 0);
+
+    // With a separate transfer queue, the barriers do not order the next staged uploads, which
+    // may write to the same vertex buffer, after this pass.
+    if (!canvas->staging.same_queue)
+        dvz_fences_wait(&tg->fences, 0);
+}
+
+
+
+/*************************************************************************************************/
+/*  GPU data normalization                                                                       */
+/*************************************************************************************************/
+
+DvzTransformGpu dvz_transform_gpu(DvzCanvas* canvas)
+{
+    ASSERT(canvas != NULL);
+    DvzGpu* gpu = canvas->gpu;
+    ASSERT(gpu != NULL);
+
+    DvzTransformGpu tg = {0};
+    tg.canvas = canvas;
+
+    tg.compute = dvz_compute(gpu, NULL);
+    dvz_compute_slot(&tg.compute, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    dvz_compute_slot(&tg.compute, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+    dvz_compute_push(&tg.compute, 0, sizeof(DvzTransformGpuPush), VK_SHADER_STAGE_COMPUTE_BIT);
+
+    // The compute pass writes to the vertex buffer, so it is submitted to the render queue.
+    tg.cmds = dvz_commands(gpu, DVZ_DEFAULT_QUEUE_RENDER, 1);
+    tg.fences = dvz_fences(gpu, 1, true);
+
+    dvz_obj_init(&tg.obj);
+    return tg;
+}
+
+
+
+void dvz_transform_gpu_data(DvzTransformGpu* tg, DvzArray* split)
+{
+    ASSERT(split != NULL);
+    dvz_transform_gpu_data_range(tg, split, 0, split->item_count);
+}
+
+
+
+void dvz_transform_gpu_data_range(
+    DvzTransformGpu* tg, DvzArray* split, uint32_t first_item, uint32_t count)
+{
+    ASSERT(tg != NULL);
+    ASSERT(split != NULL);
+    ASSERT(split->item_size == 6 * sizeof(float));
+    ASSERT(first_item + count <= split->item_count);
+    if (split->item_count == 0)
+        return;
+    DvzCanvas* canvas = tg->canvas;
+    ASSERT(canvas != NULL);
+    DvzContext* context = canvas->gpu->context;
+    ASSERT(context != NULL);
+
+    // NOTE: resizing the buffer region keeps its data, so that only the range is uploaded.
+    VkDeviceSize size = split->item_count * split->item_size;
+    if (tg->br_split.buffer == NULL)
+    {
+        tg->br_split = dvz_ctx_buffers(context, DVZ_BUFFER_TYPE_STORAGE, 1, size);
+        first_item = 0;
+        count = split->item_count;
+    }
+    else if (tg->br_split.size != size)
+        dvz_ctx_buffers_resize(context, &tg->br_split, size);
+    ASSERT(tg->br_split.size >= size);
+
+    tg->push.data_count = split->item_count;
+    tg->push.src_offset = (uint32_t)tg->br_split.offsets[0];
+    if (count == 0)
+        return;
+    VkDeviceSize offset = first_item * split->item_size;
+    dvz_upload_buffers(
+        canvas, tg->br_split, offset, count * split->item_size,
+        (uint8_t*)split->data + offset);
+}
+
+
+
+void dvz_transform_gpu_target(
+    DvzTransformGpu* tg, DvzBufferRegions br, VkDeviceSize offset, VkDeviceSize stride,
+    uint32_t components, uint32_t item_count, uint32_t reps, bool single)
+{
+    ASSERT(tg != NULL);
+    ASSERT(br.buffer != NULL);
+    ASSERT(br.count == 1);
+    ASSERT(1 <= components && components <= 3);
+    ASSERT(stride > 0);
+    ASSERT(item_count == 0 || (item_count - 1) * stride + offset + 4 * components <= br.size);
+
+    tg->br_dst = br;
+    tg->push.components = components;
+    tg->push.item_count = item_count;
+    tg->push.reps = MAX(reps, 1);
+    tg->push.single = single ? 1 : 0;
+    tg->push.dst_offset = (uint32_t)(br.offsets[0] + offset);
+    tg->push.dst_stride = (uint32_t)stride;
+}
+
+
+
+void dvz_transform_gpu_params(DvzTransformGpu* tg, DvzTransformParams params)
+{
+    ASSERT(tg != NULL);
+    tg->push.params = params;
+}
+
+
+
+void dvz_transform_gpu_run(DvzTransformGpu* tg)
+{
+    ASSERT(tg != NULL);
+    ASSERT(tg->canvas != NULL);
+
+    // The compute pipeline is created lazily, once the bindings can be set.
+    if (!dvz_obj_is_created(&tg->obj))
+    {
+        if (tg->br_split.buffer == NULL || tg->br_dst.buffer == NULL)
+        {
+            log_debug("GPU data normalization not ready yet, skipping");
+            return;
+        }
+        _load_shader(&tg->compute);
+        tg->bindings = dvz_bindings(&tg->compute.slots, 1);
+        _bind_regions(tg);
+        dvz_compute_bindings(&tg->compute, &tg->bindings);
+        dvz_compute_create(&tg->compute);
+        dvz_obj_created(&tg->obj);
+    }
+
+    tg->pending++;
+    dvz_transfer_callback(tg->canvas, _transform_gpu_run, tg);
+}
+
+
+
+void dvz_transform_gpu_destroy(DvzTransformGpu* tg)
+{
+    ASSERT(tg != NULL);
+    ASSERT(tg->canvas != NULL);
+
+    // Process the pending passes, which refer to this object.
+    if (tg->pending > 0)
+        dvz_process_transfers(tg->canvas);
+    ASSERT(tg->pending == 0);
+
+    // The last pass may still be running.
+    dvz_fences_wait(&tg->fences, 0);
+
+    if (tg->br_split.buffer != NULL && dvz_obj_is_created(&tg->br_split.buffer->obj))
+        dvz_ctx_buffers_free(tg->canvas->gpu->context, &tg->br_split);
+
+    if (dvz_obj_is_created(&tg->obj))
+        dvz_bindings_destroy(&tg->bindings);
+    dvz_compute_destroy(&tg->compute);
+    dvz_commands_destroy(&tg->cmds);
+    dvz_fences_destroy(&tg->fences);
+    dvz_obj_destroyed(&tg->obj);
+}
@@ -37,25 +37,14 @@ static void _box_enlarge(DvzBox* box, float rel_increase)
 
 
 
-// Return the bounding box of a set of dvec3 points.
+// Return the bounding box of a set of points.
 static DvzBox _box_bounding(DvzArray* points_in)
 {
     ASSERT(points_in != NULL);
     ASSERT(points_in->item_count > 0);
     ASSERT(points_in->item_size > 0);
 
-    dvec3* pos = NULL;
-    DvzBox box = DVZ_BOX_INF;
-    for (uint32_t i = 0; i < points_in->item_count; i++)
-    {
-        pos = (dvec3*)dvz_array_item(points_in, i);
-        ASSERT(pos != NULL);
-        for (uint32_t j = 0; j < 3; j++)
-        {
-            box.p0[j] = MIN(box.p0[j], (*pos)[j]);
-            box.p1[j] = MAX(box.p1[j], (*pos)[j]);
-        }
-    }
+    DvzBox box = dvz_box_bounding(NULL, points_in);
 
     // Enlarge the box by 10%.
     // _box_enlarge(&box, .1);
@@ -245,11 +234,12 @@ static inline void _transform_earth_mercator_web(DvzTransform* tr, dvec3 in, dve
     {                                                                                             \
         ASSERT(arr_in->dtype == DVZ_DTYPE_DVEC3);                                                 \
         ASSERT(arr_out->dtype == DVZ_DTYPE_DVEC3);                                                \
-        dvec3* pos_in = (dvec3*)arr_in->data;                                                     \
+        const uint8_t* pos_in = (const uint8_t*)arr_in->data;                                     \
+        VkDeviceSize stride = dvz_array_stride(arr_in);                                           \
         dvec3* pos_out = (dvec3*)arr_out->data;                                                   \
         for (uint32_t i = 0; i < arr_in->item_count; i++)                                         \
         {                                                                                         \
-            _transform_##func(tr, pos_in[i], pos_out[i]);                                         \
+            _transform_##func(tr, *(dvec3*)(pos_in + i * stride), pos_out[i]);                    \
         }                                                                                         \
     }
 
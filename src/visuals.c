@@ -47,6 +47,12 @@ void dvz_visual_destroy(DvzVisual* visual)
         dvz_array_destroy(&prop->arr_orig);
         dvz_array_destroy(&prop->arr_trans);
         dvz_array_destroy(&prop->arr_staging);
+        dvz_array_destroy(&prop->arr_split);
+        if (prop->transform_gpu != NULL)
+        {
+            dvz_transform_gpu_destroy(prop->transform_gpu);
+            FREE(prop->transform_gpu);
+        }
         if (prop->default_value != NULL)
         {
             FREE(prop->default_value)
@@ -63,14 +69,32 @@ void dvz_visual_destroy(DvzVisual* visual)
     {
         source = iter.item;
         dvz_array_destroy(&source->arr);
+        // Free the buffer regions allocated by datoviz.
+        if (_source_is_buffer(source->source_kind) && source->u.br.buffer != NULL &&
+            dvz_obj_is_created(&source->u.br.buffer->obj) &&
+            (source->origin == DVZ_SOURCE_ORIGIN_LIB ||
+             source->origin == DVZ_SOURCE_ORIGIN_NOBAKE))
+            dvz_ctx_buffers_free(visual->canvas->gpu->context, &source->u.br);
         dvz_obj_destroyed(&source->obj);
         dvz_container_iter(&iter);
     }
     dvz_container_destroy(&visual->sources);
 
+    dvz_hash_table_destroy(&visual->source_lookup);
+    dvz_hash_table_destroy(&visual->pipeline_lookup);
+    dvz_hash_table_destroy(&visual->prop_lookup);
+
     CONTAINER_DESTROY_ITEMS(DvzBindings, visual->bindings, dvz_bindings_destroy)
     CONTAINER_DESTROY_ITEMS(DvzBindings, visual->bindings_comp, dvz_bindings_destroy)
 
+    // Free the indirect draw commands of the streaming mode. The ring buffer is the VERTEX source
+    // buffer, it has been freed with the sources.
+    if (visual->stream != NULL)
+    {
+        dvz_ctx_buffers_free(visual->canvas->gpu->context, &visual->stream->br_indirect);
+        FREE(visual->stream);
+    }
+
     dvz_obj_destroyed(&visual->obj);
 }
 
@@ -99,6 +123,10 @@ void dvz_visual_source(
     source->slot_idx = slot_idx;
     source->flags = flags;
 
+    _lookup_set(&visual->source_lookup, source_type, source_idx, source);
+    // Only the first source of a given type is kept for each pipeline.
+    _lookup_set(&visual->pipeline_lookup, source_type, pipeline_idx, source);
+
     if (source->source_kind < DVZ_SOURCE_KIND_TEXTURE_1D)
         source->arr = dvz_array_struct(0, item_size);
     else
@@ -146,6 +174,10 @@ DvzProp* dvz_visual_prop(
     prop->prop_idx = prop_idx;
     prop->dtype = dtype;
     prop->dpi_scaling = 1;
+
+    // There can be only 1 prop with a given type and idx.
+    if (!_lookup_set(&visual->prop_lookup, prop_type, prop_idx, prop))
+        log_error("prop of type %d #%d already exists", prop_type, prop_idx);
     prop->source = dvz_source_get(visual, source_type, source_idx);
     if (prop->source == NULL && source_type != DVZ_SOURCE_TYPE_NONE)
     {
@@ -310,12 +342,24 @@ void dvz_visual_data_partial(
         count = 1;
     }
 
+    // The items after the first item are overwritten or removed.
+    uint32_t old_count = prop->arr_orig.item_count;
+    if (prop_type == DVZ_PROP_POS)
+        _prop_box_discard(visual, prop, first_item);
+
+    // A borrowed buffer is released, the prop owns its data from now on.
+    _prop_unborrow(prop, first_item);
+
     // Make sure the array has the right size.
     dvz_array_resize(&prop->arr_orig, count);
 
     // Copy the specified array to the prop array.
     dvz_array_data(&prop->arr_orig, first_item, item_count, data_item_count, data);
 
+    // Update the cached bounding box with the new items only.
+    if (prop_type == DVZ_PROP_POS)
+        _prop_box_extend(visual, prop, MIN(first_item, old_count));
+
     prop->obj.request = DVZ_VISUAL_REQUEST_UPLOAD;
 
     if (source != NULL)
@@ -337,11 +381,162 @@ void dvz_visual_data_append(
     DvzProp* prop = dvz_prop_get(visual, prop_type, prop_idx);
     ASSERT(prop != NULL);
     uint32_t first_item = prop->arr_orig.item_count;
+
+    // In streaming mode, the prop only contains the items appended since the last upload.
+    if (visual->stream != NULL && prop->source == visual->stream->source)
+        prop->streamed = true;
+
     dvz_visual_data_partial(visual, prop_type, prop_idx, first_item, count, count, data);
 }
 
 
 
+void dvz_visual_data_borrow(
+    DvzVisual* visual, DvzPropType prop_type, uint32_t prop_idx, uint32_t count,
+    DvzDataType dtype, VkDeviceSize stride, const void* data, DvzArrayRelease release,
+    void* user_data)
+{
+    ASSERT(visual != NULL);
+    ASSERT(count > 0);
+    ASSERT(data != NULL);
+
+    DvzProp* prop = dvz_prop_get(visual, prop_type, prop_idx);
+    ASSERT(prop != NULL);
+    DvzSource* source = prop->source;
+
+    if (visual->stream != NULL && source == visual->stream->source)
+    {
+        log_error("streamed visuals cannot borrow prop data");
+        return;
+    }
+
+    // Only the default baking reads the prop arrays through their stride, and only the POS props
+    // are converted to the dtype of the vertex attribute.
+    bool float_pos = prop_type == DVZ_PROP_POS && dtype == prop->target_dtype &&
+                     visual->callback_bake == _default_visual_bake;
+    if (dtype != prop->dtype && !float_pos)
+    {
+        log_error(
+            "cannot borrow data with dtype %d for prop %d with dtype %d", dtype, prop_type,
+            prop->dtype);
+        return;
+    }
+
+    DvzArray* arr = &prop->arr_orig;
+    if (arr->borrowed && arr->data == data)
+    {
+        // Same buffer: its content has changed.
+        ASSERT(arr->dtype == dtype);
+        arr->item_count = count;
+        arr->buffer_size = count * arr->item_size;
+        arr->stride = stride == arr->item_size ? 0 : stride;
+        arr->release = release;
+        arr->release_data = user_data;
+    }
+    else
+    {
+        // The previous data is freed, or the previous borrowed buffer is released.
+        dvz_array_destroy(arr);
+        *arr = dvz_array_borrow(count, dtype, stride, data, release, user_data);
+    }
+
+    // All positions are replaced.
+    if (prop_type == DVZ_PROP_POS)
+        _prop_box_discard(visual, prop, 0);
+
+    prop->obj.request = DVZ_VISUAL_REQUEST_UPLOAD;
+
+    if (source != NULL)
+    {
+        source->origin = DVZ_SOURCE_ORIGIN_LIB;
+        _source_set_changed(source, true);
+    }
+}
+
+
+
+void dvz_visual_stream(DvzVisual* visual, uint32_t history)
+{
+    ASSERT(visual != NULL);
+    ASSERT(history > 0);
+    DvzCanvas* canvas = visual->canvas;
+    ASSERT(canvas != NULL);
+    DvzContext* ctx = canvas->gpu->context;
+    ASSERT(ctx != NULL);
+
+    DvzSource* source = dvz_source_get(visual, DVZ_SOURCE_TYPE_VERTEX, 0);
+    if (source == NULL || source->origin == DVZ_SOURCE_ORIGIN_USER ||
+        visual->graphics_count != 1 || dvz_source_get(visual, DVZ_SOURCE_TYPE_INDEX, 0) != NULL ||
+        visual->callback_fill != _default_visual_fill)
+    {
+        log_error("streaming mode is not supported by this visual");
+        return;
+    }
+
+    // Number of vertices per item.
+    uint32_t reps = 1;
+    DvzProp* prop = NULL;
+    DvzContainerIterator iter = dvz_container_iterator(&visual->props);
+    while (iter.item != NULL)
+    {
+        prop = iter.item;
+        if (prop->source == source)
+        {
+            if (prop->transform_gpu != NULL)
+            {
+                log_error("streaming mode is not supported with GPU data normalization");
+                return;
+            }
+            reps = MAX(reps, prop->reps);
+        }
+        dvz_container_iter(&iter);
+    }
+
+    DvzVisualStream* stream = visual->stream;
+    if (stream == NULL)
+    {
+        stream = calloc(1, sizeof(DvzVisualStream));
+        stream->br_indirect =
+            dvz_ctx_buffers(ctx, DVZ_BUFFER_TYPE_STORAGE, 1, sizeof(stream->draws));
+        visual->stream = stream;
+    }
+    stream->source = source;
+    stream->reps = reps;
+    stream->capacity = history * reps;
+    stream->head = 0;
+    stream->count = 0;
+    stream->mirror = visual->graphics[0]->topology == VK_PRIMITIVE_TOPOLOGY_LINE_STRIP;
+    stream->stats = (DvzVisualStreamStats){0};
+    stream->box_valid = false;
+    _clock_init(&stream->clock);
+
+    // The ring buffer is allocated once and for all.
+    log_debug(
+        "streaming mode with a history of %d items (%d vertices)", history, stream->capacity);
+    if (source->u.br.buffer != NULL)
+        dvz_ctx_buffers_free(ctx, &source->u.br);
+    _create_source_buffer(
+        canvas, source, (stream->capacity + (stream->mirror ? 1 : 0)) * source->arr.item_size);
+    source->origin = DVZ_SOURCE_ORIGIN_LIB;
+
+    // Empty draw ranges, the command buffers do not change afterwards.
+    _stream_draws(stream);
+    dvz_upload_buffers(canvas, stream->br_indirect, 0, sizeof(stream->draws), stream->draws);
+    dvz_canvas_to_refill(canvas);
+}
+
+
+
+DvzVisualStreamStats dvz_visual_stream_stats(DvzVisual* visual)
+{
+    ASSERT(visual != NULL);
+    if (visual->stream == NULL)
+        return (DvzVisualStreamStats){0};
+    return visual->stream->stats;
+}
+
+
+
 static DvzSource*
 _assert_source_exists(DvzVisual* visual, DvzSourceType source_type, uint32_t source_idx)
 {
@@ -504,6 +699,100 @@ void dvz_visual_fill_event(
 
 
 
+uint32_t dvz_visual_fill_batch(
+    uint32_t visual_count, DvzVisual** visuals, VkClearColorValue clear_color, DvzCommands* cmds,
+    uint32_t cmd_idx, DvzViewport viewport, DvzBufferRegions* indirect)
+{
+    ASSERT(visuals != NULL);
+    ASSERT(cmds != NULL);
+    ASSERT(indirect != NULL);
+    ASSERT(indirect->buffer != NULL);
+    ASSERT(indirect->buffer->mmap != NULL);
+
+    VkDrawIndirectCommand draws[DVZ_MAX_BATCH_DRAWS] = {0};
+    ASSERT(indirect->size == sizeof(draws));
+    uint32_t draw_count = 0; // number of draw commands written so far
+    uint32_t first = 0;      // first draw command of the current batch
+    uint32_t batched = 0;    // number of visuals drawn in a batch of at least two visuals
+
+    DvzVisual* leader = NULL; // first visual of the current batch
+    DvzSource* leader_source = NULL;
+    DvzGraphics* bound = NULL; // last bound graphics pipeline
+
+    DvzVisual* visual = NULL;
+    DvzSource* source = NULL;
+    DvzBindings* bindings = NULL;
+    DvzBufferRegions br = {0};
+    for (uint32_t i = 0; i <= visual_count; i++)
+    {
+        visual = i < visual_count ? visuals[i] : NULL;
+        source = NULL;
+        if (visual != NULL && draw_count < DVZ_MAX_BATCH_DRAWS)
+            source = _batch_source(visual, cmd_idx);
+
+        // Draw the current batch with a single indirect draw call.
+        if (leader != NULL &&
+            (source == NULL || !_batch_compatible(leader, leader_source, visual, source)))
+        {
+            br = *indirect;
+            for (uint32_t k = 0; k < br.count; k++)
+                br.offsets[k] += first * sizeof(VkDrawIndirectCommand);
+            dvz_cmd_draw_indirect_multi(cmds, cmd_idx, br, draw_count - first);
+            if (draw_count - first > 1)
+                batched += draw_count - first;
+            leader = NULL;
+        }
+        if (visual == NULL)
+            break;
+
+        // The visuals that cannot be batched are filled as usual, and may bind any pipeline.
+        if (source == NULL)
+        {
+            dvz_visual_fill_event(visual, clear_color, cmds, cmd_idx, viewport, NULL);
+            bound = NULL;
+            continue;
+        }
+
+        // Start a new batch: bind the pipeline if needed, the bindings, and the whole vertex
+        // buffer.
+        if (leader == NULL)
+        {
+            leader = visual;
+            leader_source = source;
+            first = draw_count;
+
+            bindings = dvz_container_get(&visual->bindings, 0);
+            ASSERT(dvz_obj_is_created(&bindings->obj));
+            if (bound != visual->graphics[0])
+                dvz_cmd_bind_graphics(cmds, cmd_idx, visual->graphics[0], bindings, 0);
+            else
+                dvz_cmd_bind_descriptors(cmds, cmd_idx, visual->graphics[0], bindings, 0);
+            bound = visual->graphics[0];
+
+            br = source->u.br;
+            memset(br.offsets, 0, sizeof(br.offsets));
+            dvz_cmd_bind_vertex_buffer(cmds, cmd_idx, br, 0);
+        }
+
+        // Add the draw command of the visual to the batch.
+        ASSERT(source->u.br.size >= source->arr.item_count * source->arr.item_size);
+        draws[draw_count++] = (VkDrawIndirectCommand){
+            source->arr.item_count, 1,
+            (uint32_t)(source->u.br.offsets[_region_idx(&source->u.br, cmd_idx)] /
+                       source->arr.item_size),
+            0};
+    }
+
+    // The indirect buffer is mappable: the draw commands are written right away, the command
+    // buffer is not in use while it is being recorded.
+    if (draw_count > 0)
+        dvz_buffer_regions_upload(indirect, cmd_idx, draws);
+    log_trace("%d/%d visual(s) batched", batched, visual_count);
+    return batched;
+}
+
+
+
 void dvz_visual_fill_begin(DvzCanvas* canvas, DvzCommands* cmds, uint32_t idx)
 {
     ASSERT(canvas != NULL);
@@ -529,21 +818,7 @@ void dvz_visual_fill_end(DvzCanvas* canvas, DvzCommands* cmds, uint32_t idx)
 DvzSource* dvz_source_get(DvzVisual* visual, DvzSourceType source_type, uint32_t source_idx)
 {
     ASSERT(visual != NULL);
-    DvzSource* source = NULL;
-    DvzContainerIterator iter = dvz_container_iterator(&visual->sources);
-    DvzSource* out = NULL;
-    while (iter.item != NULL)
-    {
-        source = iter.item;
-        if (source->source_type == source_type && source->source_idx == source_idx)
-        {
-            // Check there is only 1 source with a given type and idx.
-            ASSERT(out == NULL);
-            out = source;
-        }
-        dvz_container_iter(&iter);
-    }
-    return out;
+    return (DvzSource*)_lookup_get(&visual->source_lookup, source_type, source_idx);
 }
 
 
@@ -560,19 +835,7 @@ DvzArray* dvz_source_array(DvzVisual* visual, DvzSourceType source_type, uint32_
 DvzProp* dvz_prop_get(DvzVisual* visual, DvzPropType prop_type, uint32_t prop_idx)
 {
     ASSERT(visual != NULL);
-    DvzProp* prop = NULL;
-    DvzContainerIterator iter = dvz_container_iterator(&visual->props);
-    DvzProp* out = NULL;
-    while (iter.item != NULL)
-    {
-        prop = iter.item;
-        if (prop->prop_type == prop_type && prop->prop_idx == prop_idx)
-        {
-            ASSERT(out == NULL);
-            out = prop;
-        }
-        dvz_container_iter(&iter);
-    }
+    DvzProp* out = (DvzProp*)_lookup_get(&visual->prop_lookup, prop_type, prop_idx);
     if (out == NULL)
         log_trace("prop with type %d #%d not found", prop_type, prop_idx);
     // ASSERT(out != NULL);
@@ -614,6 +877,34 @@ void* dvz_prop_item(DvzProp* prop, uint32_t prop_idx)
 
 
 
+DvzTransformGpu* dvz_prop_transform_gpu(DvzVisual* visual, DvzProp* prop)
+{
+    ASSERT(visual != NULL);
+    ASSERT(prop != NULL);
+    if (prop->transform_gpu != NULL)
+        return prop->transform_gpu;
+
+    // In streaming mode, the previous positions are no longer available on the CPU.
+    if (visual->stream != NULL)
+        return NULL;
+
+    // The compute pass writes directly into the vertex buffer, at the position of the prop
+    // within the vertex struct, so that the layout must be known.
+    if (visual->callback_bake != _default_visual_bake || prop->prop_type != DVZ_PROP_POS ||
+        prop->copy_type == DVZ_ARRAY_COPY_NONE || prop->dpi_scaling != 1 ||
+        prop->source == NULL || prop->source->source_type != DVZ_SOURCE_TYPE_VERTEX)
+        return NULL;
+    if (_transform_gpu_components(prop) == 0)
+        return NULL;
+
+    log_debug("normalizing POS prop #%d on the GPU", prop->prop_idx);
+    prop->transform_gpu = calloc(1, sizeof(DvzTransformGpu));
+    *prop->transform_gpu = dvz_transform_gpu(visual->canvas);
+    return prop->transform_gpu;
+}
+
+
+
 /*************************************************************************************************/
 /*  Data update                                                                                  */
 /*************************************************************************************************/
@@ -629,7 +920,10 @@ void dvz_visual_update(
     ev.coords = coords;
     ev.user_data = user_data;
 
-    if (visual->callback_bake != NULL)
+    // In streaming mode, only the items appended since the last upload are baked.
+    uint32_t stream_pending = visual->stream != NULL ? _stream_pending(visual) : 0;
+
+    if (visual->callback_bake != NULL && (visual->stream == NULL || stream_pending > 0))
     {
         log_trace("visual bake callback");
 
@@ -638,7 +932,9 @@ void dvz_visual_update(
         // 2. Resize the VERTEX and INDEX array sources accordingly.
         // 3. Possibly resize other sources.
         // 4. Take the props and fill the array sources.
+        double t = dvz_profile_start(visual->canvas->profiler);
         visual->callback_bake(visual, ev);
+        dvz_profile_end(visual->canvas->profiler, "bake", t);
     }
     // NOTE: we bake the UNIFORM sources here.
     _bake_uniforms(visual);
@@ -746,8 +1042,19 @@ void dvz_visual_update(
 
         arr = &source->arr;
 
+        // Streaming mode: upload the appended items to the ring buffer.
+        if (_source_is_stream(visual, source))
+        {
+            if (stream_pending > 0)
+            {
+                _stream_upload(visual, source);
+                _stream_clear(visual);
+            }
+            _source_set(source);
+        }
+
         // Update buffer sources.
-        if (_source_is_buffer(source->source_kind))
+        else if (_source_is_buffer(source->source_kind))
         {
             if (arr->item_count == 0)
             {
@@ -780,6 +1087,7 @@ void dvz_visual_update(
                 arr->item_count, br->size, source->source_type, source->source_idx);
 
             dvz_upload_buffers(canvas, *br, 0, size, arr->data);
+            _source_transform_gpu(visual, source);
             _source_set(source);
             // source->obj.status = DVZ_OBJECT_STATUS_CREATED;
             // visual->obj.status = DVZ_OBJECT_STATUS_CREATED;
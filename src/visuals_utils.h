@@ -240,6 +240,171 @@ static DvzArray* _prop_array(DvzProp* prop)
 
 
 
+// Replace a borrowed prop array by an array owning its data, keeping its first items, and release
+// the borrowed buffer.
+static void _prop_unborrow(DvzProp* prop, uint32_t keep)
+{
+    ASSERT(prop != NULL);
+    DvzArray* arr = &prop->arr_orig;
+    if (!arr->borrowed)
+        return;
+    keep = MIN(keep, arr->item_count);
+    log_debug("stop borrowing the data of prop %d, keeping %d items", prop->prop_type, keep);
+
+    DvzArray arr_new = dvz_array(keep, prop->dtype);
+    if (keep > 0 && arr->dtype == prop->dtype)
+        dvz_array_copy_strided(
+            arr_new.data, arr_new.item_size, arr->data, dvz_array_stride(arr), arr->item_size,
+            keep);
+    else if (keep > 0)
+        dvz_array_cast_strided(
+            arr_new.data, arr_new.item_size, prop->dtype, arr->data, dvz_array_stride(arr),
+            arr->dtype, keep);
+    dvz_array_destroy(arr);
+    *arr = arr_new;
+}
+
+
+
+/*************************************************************************************************/
+/*  Source and prop lookups                                                                      */
+/*************************************************************************************************/
+
+static inline uint64_t _lookup_key(uint32_t type, uint32_t idx)
+{
+    return ((uint64_t)type << 32) | (uint64_t)idx;
+}
+
+
+
+static void* _lookup_get(DvzHashTable* lookup, uint32_t type, uint32_t idx)
+{
+    ASSERT(lookup != NULL);
+    uint64_t value = 0;
+    if (!dvz_hash_table_get(lookup, _lookup_key(type, idx), &value))
+        return NULL;
+    return (void*)(uintptr_t)value;
+}
+
+
+
+// Insert a value if the key is not already present, return whether it was inserted.
+static bool _lookup_set(DvzHashTable* lookup, uint32_t type, uint32_t idx, void* value)
+{
+    ASSERT(lookup != NULL);
+    ASSERT(value != NULL);
+    return dvz_hash_table_set(lookup, _lookup_key(type, idx), (uint64_t)(uintptr_t)value);
+}
+
+
+
+/*************************************************************************************************/
+/*  Prop bounding boxes                                                                          */
+/*************************************************************************************************/
+
+// Return the worker pool of the app of a visual, if any.
+static DvzWorkers* _visual_workers(DvzVisual* visual)
+{
+    ASSERT(visual != NULL);
+    if (visual->canvas == NULL || visual->canvas->app == NULL)
+        return NULL;
+    return &visual->canvas->app->workers;
+}
+
+
+
+// Bounding box of a range of original positions, counted in the visual statistics.
+static DvzBox _prop_box_scan(DvzVisual* visual, DvzProp* prop, uint32_t first, uint32_t count)
+{
+    ASSERT(visual != NULL);
+    ASSERT(prop != NULL);
+    ASSERT(count > 0);
+    visual->box_scanned += count;
+    return dvz_box_bounding_range(_visual_workers(visual), &prop->arr_orig, first, count);
+}
+
+
+
+// Return the bounding box of a POS prop, only scanning its positions if the cache is invalid.
+static DvzBox _prop_box(DvzVisual* visual, DvzProp* prop)
+{
+    ASSERT(visual != NULL);
+    ASSERT(prop != NULL);
+    ASSERT(prop->arr_orig.item_count > 0);
+    if (!prop->box_valid)
+    {
+        prop->box = _prop_box_scan(visual, prop, 0, prop->arr_orig.item_count);
+        prop->box_valid = true;
+    }
+    return prop->box;
+}
+
+
+
+// Set the cached bounding box of a POS prop, when it has been computed by another pass.
+static void _prop_box_set(DvzProp* prop, DvzBox box)
+{
+    ASSERT(prop != NULL);
+    prop->box = box;
+    prop->box_valid = true;
+}
+
+
+
+// Called before the items from `first_item` up to the end of a POS prop are overwritten or
+// removed. These items will need to be normalized again. The cached box remains valid if none
+// of these items lies on its boundary, as the remaining items still reach the same extrema.
+static void _prop_box_discard(DvzVisual* visual, DvzProp* prop, uint32_t first_item)
+{
+    ASSERT(visual != NULL);
+    ASSERT(prop != NULL);
+    uint32_t count = prop->arr_orig.item_count;
+    prop->trans_count = MIN(prop->trans_count, first_item);
+    if (!prop->box_valid || first_item >= count)
+        return;
+
+    // All positions are replaced.
+    if (first_item == 0)
+    {
+        prop->box_valid = false;
+        return;
+    }
+
+    DvzBox box = _prop_box_scan(visual, prop, first_item, count - first_item);
+    for (uint32_t j = 0; j < 3; j++)
+    {
+        // NOTE: a flat component is reached by the remaining items, and missing components are 0.
+        if (prop->box.p0[j] == prop->box.p1[j])
+            continue;
+        if (box.p0[j] <= prop->box.p0[j] || box.p1[j] >= prop->box.p1[j])
+        {
+            prop->box_valid = false;
+            return;
+        }
+    }
+}
+
+
+
+// Called after new items have been written to a POS prop, extend the cached box with them.
+static void _prop_box_extend(DvzVisual* visual, DvzProp* prop, uint32_t first_item)
+{
+    ASSERT(visual != NULL);
+    ASSERT(prop != NULL);
+    uint32_t count = prop->arr_orig.item_count;
+    if (!prop->box_valid || first_item >= count)
+        return;
+
+    DvzBox box = _prop_box_scan(visual, prop, first_item, count - first_item);
+    for (uint32_t j = 0; j < 3; j++)
+    {
+        prop->box.p0[j] = MIN(prop->box.p0[j], box.p0[j]);
+        prop->box.p1[j] = MAX(prop->box.p1[j], box.p1[j]);
+    }
+}
+
+
+
 static uint32_t _source_size(DvzVisual* visual, DvzSource* source)
 {
     ASSERT(visual != NULL);
@@ -343,6 +508,9 @@ static void _source_buffer(DvzVisual* visual, DvzSource* source)
         log_debug(
             "need to %sallocate new buffer region to fit %d elements (%d bytes)",
             source->u.br.size > 0 ? "re" : "", count, size);
+        // Free the old region so that its space can be reused.
+        if (source->u.br.buffer != NULL)
+            dvz_ctx_buffers_free(canvas->gpu->context, &source->u.br);
         _create_source_buffer(canvas, source, size);
         // Set the pipeline bindings with the source buffer.
         _set_source_bindings(visual, source);
@@ -403,34 +571,248 @@ static void _source_texture(DvzVisual* visual, DvzSource* source)
 
 
 
+/*************************************************************************************************/
+/*  Streaming                                                                                    */
+/*************************************************************************************************/
+
+// Return whether a source is the ring buffer of a visual in streaming mode.
+static inline bool _source_is_stream(DvzVisual* visual, DvzSource* source)
+{
+    ASSERT(visual != NULL);
+    return visual->stream != NULL && visual->stream->source == source;
+}
+
+
+
+// Number of vertices appended since the last upload.
+static uint32_t _stream_pending(DvzVisual* visual)
+{
+    ASSERT(visual != NULL);
+    ASSERT(visual->stream != NULL);
+
+    uint32_t count = 0;
+    DvzProp* prop = NULL;
+    DvzContainerIterator iter = dvz_container_iterator(&visual->props);
+    while (iter.item != NULL)
+    {
+        prop = iter.item;
+        if (prop->streamed && prop->source == visual->stream->source)
+            count = MAX(count, _prop_array(prop)->item_count * MAX(1, prop->reps));
+        dvz_container_iter(&iter);
+    }
+    return count;
+}
+
+
+
+// Extend the bounding box of the streamed positions with the box of a POS prop.
+static void _stream_box_extend(DvzVisualStream* stream, DvzBox box)
+{
+    ASSERT(stream != NULL);
+    if (!stream->box_valid)
+    {
+        stream->box = box;
+        stream->box_valid = true;
+        return;
+    }
+    for (uint32_t j = 0; j < 3; j++)
+    {
+        stream->box.p0[j] = MIN(stream->box.p0[j], box.p0[j]);
+        stream->box.p1[j] = MAX(stream->box.p1[j], box.p1[j]);
+    }
+}
+
+
+
+// Empty the props appended since the last upload. Their memory is kept for the next appends, and
+// the box of their positions is kept in the stream.
+static void _stream_clear(DvzVisual* visual)
+{
+    ASSERT(visual != NULL);
+    ASSERT(visual->stream != NULL);
+
+    DvzProp* prop = NULL;
+    DvzContainerIterator iter = dvz_container_iterator(&visual->props);
+    while (iter.item != NULL)
+    {
+        prop = iter.item;
+        if (prop->streamed)
+        {
+            if (prop->prop_type == DVZ_PROP_POS && prop->arr_orig.item_count > 0)
+                _stream_box_extend(visual->stream, _prop_box(visual, prop));
+            prop->box_valid = false;
+            prop->arr_orig.item_count = 0;
+            prop->arr_trans.item_count = 0;
+            prop->arr_staging.item_count = 0;
+            prop->trans_count = 0;
+        }
+        dvz_container_iter(&iter);
+    }
+}
+
+
+
+// Compute the two draw ranges of the ring buffer, the oldest vertices being drawn first.
+static void _stream_draws(DvzVisualStream* stream)
+{
+    ASSERT(stream != NULL);
+    ASSERT(stream->capacity > 0);
+    ASSERT(stream->count <= stream->capacity);
+
+    uint32_t first = (stream->head + stream->capacity - stream->count) % stream->capacity;
+    uint32_t n0 = MIN(stream->count, stream->capacity - first);
+    uint32_t n1 = stream->count - n0;
+
+    // The mirror vertex connects the end of the first range to the start of the second one.
+    uint32_t mirror = stream->mirror && n1 > 0 ? 1 : 0;
+    stream->draws[0] = (VkDrawIndirectCommand){n0 + mirror, 1, first, 0};
+    stream->draws[1] = (VkDrawIndirectCommand){n1, 1, 0, 0};
+}
+
+
+
+// Upload the vertices baked since the last upload after the last written vertex of the ring
+// buffer, and update the draw ranges. Only the new bytes are uploaded.
+static void _stream_upload(DvzVisual* visual, DvzSource* source)
+{
+    ASSERT(visual != NULL);
+    ASSERT(source != NULL);
+    DvzVisualStream* stream = visual->stream;
+    ASSERT(stream != NULL);
+    DvzCanvas* canvas = visual->canvas;
+    ASSERT(canvas != NULL);
+
+    DvzArray* arr = &source->arr;
+    ASSERT(arr->item_count > 0);
+    ASSERT(source->u.br.buffer != NULL);
+
+    VkDeviceSize item_size = arr->item_size;
+    uint32_t capacity = stream->capacity;
+    uint8_t* data = (uint8_t*)arr->data;
+    uint32_t n = arr->item_count;
+
+    // Only the last vertices fit in the ring buffer.
+    uint32_t skipped = 0;
+    if (n > capacity)
+    {
+        skipped = n - capacity;
+        data += skipped * item_size;
+        n = capacity;
+    }
+    uint32_t overwritten = stream->count + n > capacity ? stream->count + n - capacity : 0;
+
+    // Upload the new vertices, in two chunks when wrapping around the end of the ring buffer.
+    uint32_t n0 = MIN(n, capacity - stream->head);
+    dvz_upload_buffers(canvas, source->u.br, stream->head * item_size, n0 * item_size, data);
+    if (n0 < n)
+        dvz_upload_buffers(canvas, source->u.br, 0, (n - n0) * item_size, data + n0 * item_size);
+
+    // Update the mirror vertex whenever the first vertex has been written.
+    if (stream->mirror && (stream->head == 0 || n0 < n))
+        dvz_upload_buffers(
+            canvas, source->u.br, capacity * item_size, item_size,
+            data + (stream->head == 0 ? 0 : n0) * item_size);
+
+    stream->head = (stream->head + n) % capacity;
+    stream->count = MIN(stream->count + n, capacity);
+    _stream_draws(stream);
+    dvz_upload_buffers(canvas, stream->br_indirect, 0, sizeof(stream->draws), stream->draws);
+
+    // Statistics.
+    DvzVisualStreamStats* stats = &stream->stats;
+    stats->uploads++;
+    stats->items += (n + skipped) / stream->reps;
+    stats->discarded += (overwritten + skipped) / stream->reps;
+    stats->bytes += n * item_size;
+    double elapsed = _clock_get(&stream->clock);
+    if (elapsed > 0)
+        stats->throughput = stats->items / elapsed;
+    log_trace(
+        "stream %d new vertices at %d, %d vertices in the ring buffer, %.0f items/s", n,
+        stream->head, stream->count, stats->throughput);
+}
+
+
+
+// Draw the ring buffer of a visual in streaming mode.
+static void _stream_fill(DvzVisualStream* stream, DvzCommands* cmds, uint32_t idx)
+{
+    ASSERT(stream != NULL);
+
+    // The draw ranges are read from the GPU, so that appends do not require a refill.
+    DvzBufferRegions br = stream->br_indirect;
+    dvz_cmd_draw_indirect(cmds, idx, br);
+    for (uint32_t i = 0; i < br.count; i++)
+        br.offsets[i] += sizeof(VkDrawIndirectCommand);
+    dvz_cmd_draw_indirect(cmds, idx, br);
+}
+
+
+
 /*************************************************************************************************/
 /*  Visual baking helpers                                                                        */
 /*************************************************************************************************/
 
-static void _prop_copy(DvzVisual* visual, DvzProp* prop)
+// Baking is split into tasks of at least this number of items.
+#define DVZ_BAKE_CHUNK_SIZE 65536
+
+// Below this total number of items, the tasks run serially on the calling thread.
+#define DVZ_BAKE_PARALLEL_THRESHOLD 262144
+
+typedef struct DvzBakeTask DvzBakeTask;
+typedef struct DvzBakeTasks DvzBakeTasks;
+
+// Copy of a range of items of a prop to its source array.
+struct DvzBakeTask
+{
+    DvzProp* prop;
+    DvzArray* arr; // prop array, or its DPI-scaled copy
+    uint32_t first_item;
+    uint32_t item_count;
+};
+
+struct DvzBakeTasks
+{
+    uint32_t count;
+    uint32_t capacity;
+    DvzBakeTask* tasks;
+    uint64_t item_count; // total number of items to copy
+};
+
+
+
+
+// Return the array to copy to the source array, or NULL if the prop should not be copied.
+// This function is not thread-safe, it must be called before _prop_copy_range().
+static DvzArray* _prop_copy_prepare(DvzVisual* visual, DvzProp* prop)
 {
     ASSERT(prop != NULL);
 
     DvzSource* source = prop->source;
     ASSERT(source != NULL);
 
-    VkDeviceSize col_size = _get_dtype_size(prop->dtype);
-    ASSERT(col_size > 0);
-
     DvzArray* arr = _prop_array(prop);
     if (arr->data == NULL)
     {
         log_debug("visual prop %d #%d not set", prop->prop_type, prop->prop_idx);
-        return;
+        return NULL;
     }
 
     // Do not copy props that have no automatic copy set up.
     if (prop->copy_type == DVZ_ARRAY_COPY_NONE)
-        return;
+        return NULL;
+
+    // Streamed props are empty once uploaded.
+    if (arr->item_count == 0)
+        return NULL;
+
+    // Props normalized on the GPU are written directly into the vertex buffer.
+    if (prop->transform_gpu != NULL)
+        return NULL;
 
     ASSERT(arr->data != NULL);
     ASSERT(source->arr.data != NULL);
-    ASSERT(arr->item_count <= source->arr.item_count);
+    ASSERT(arr->item_count <= source->arr.item_count || _source_is_stream(visual, source));
 
     // Implement DPI scaling here.
     if (prop->dpi_scaling != 1)
@@ -440,16 +822,62 @@ static void _prop_copy(DvzVisual* visual, DvzProp* prop)
         dvz_array_scale(arr, prop->dpi_scaling);
     }
 
-    log_debug("copy prop type %d to source buffer", prop->prop_type);
-    dvz_array_column(
-        &source->arr, prop->offset, col_size, 0, source->arr.item_count, //
-        arr->item_count, arr->data,                                      //
-        prop->arr_orig.dtype, prop->target_dtype,                        // optional cast
+    return arr;
+}
+
+
+
+// Copy a prop array to the items [first_item, first_item + item_count) of the source array.
+// The first item must be a multiple of the number of repeats. Calls on disjoint ranges, or on
+// props of different columns, write to disjoint bytes and can run in parallel.
+static void
+_prop_copy_range(DvzProp* prop, DvzArray* arr, uint32_t first_item, uint32_t item_count)
+{
+    ASSERT(prop != NULL);
+    ASSERT(arr != NULL);
+    ASSERT(arr->item_count > 0);
+    if (item_count == 0)
+        return;
+
+    DvzSource* source = prop->source;
+    ASSERT(source != NULL);
+
+    // The original prop array may be borrowed from a strided external buffer, possibly in the
+    // dtype of the vertex attribute rather than in the dtype of the prop.
+    VkDeviceSize col_size = _get_dtype_size(prop->arr_orig.dtype);
+    VkDeviceSize src_stride = arr->stride > 0 ? arr->stride : col_size;
+    ASSERT(col_size > 0);
+
+    uint32_t reps = MAX(prop->reps, 1);
+    ASSERT(first_item % reps == 0);
+
+    // Index of the prop item copied to the first item of the range. Past the end of the prop
+    // array, the last item is repeated.
+    uint32_t first_data = MIN(first_item / reps, arr->item_count - 1);
+
+    dvz_array_column_strided(
+        &source->arr, prop->offset, col_size, src_stride, first_item, item_count, //
+        arr->item_count - first_data,                                             //
+        (const uint8_t*)arr->data + first_data * src_stride,                      //
+        prop->arr_orig.dtype, prop->target_dtype,                                 // optional cast
         prop->copy_type, prop->reps);
 }
 
 
 
+static void _prop_copy(DvzVisual* visual, DvzProp* prop)
+{
+    ASSERT(prop != NULL);
+    DvzArray* arr = _prop_copy_prepare(visual, prop);
+    if (arr == NULL)
+        return;
+
+    log_debug("copy prop type %d to source buffer", prop->prop_type);
+    _prop_copy_range(prop, arr, 0, prop->source->arr.item_count);
+}
+
+
+
 static void _source_alloc(DvzVisual* visual, DvzSource* source, uint32_t count)
 {
     ASSERT(visual != NULL);
@@ -465,75 +893,172 @@ static void _source_alloc(DvzVisual* visual, DvzSource* source, uint32_t count)
 
 
 
-static void _source_fill(DvzVisual* visual, DvzSource* source)
+static void _bake_tasks_add(DvzBakeTasks* tasks, DvzBakeTask task)
+{
+    ASSERT(tasks != NULL);
+    if (tasks->count == tasks->capacity)
+    {
+        tasks->capacity = MAX(2 * tasks->capacity, 16);
+        REALLOC(tasks->tasks, tasks->capacity * sizeof(DvzBakeTask));
+    }
+    tasks->tasks[tasks->count++] = task;
+    tasks->item_count += task.item_count;
+}
+
+
+
+// Split the copy of all props associated to a source into tasks covering disjoint item ranges.
+static void _source_tasks(DvzVisual* visual, DvzSource* source, DvzBakeTasks* tasks)
 {
     ASSERT(visual != NULL);
     ASSERT(source != NULL);
+    ASSERT(tasks != NULL);
 
-    // Copy all associated props to the source array.
+    uint32_t item_count = source->arr.item_count;
     DvzProp* prop = NULL;
+    DvzArray* arr = NULL;
+    uint32_t chunk = 0;
     DvzContainerIterator iter = dvz_container_iterator(&visual->props);
     while (iter.item != NULL)
     {
         prop = iter.item;
-        if (prop->source == source)
-            _prop_copy(visual, prop);
+        arr = prop->source == source ? _prop_copy_prepare(visual, prop) : NULL;
+        if (arr != NULL)
+        {
+            log_debug("copy prop type %d to source buffer", prop->prop_type);
+            // The chunks must start at a multiple of the number of repeats.
+            chunk = MAX(prop->reps, 1);
+            chunk = ((DVZ_BAKE_CHUNK_SIZE + chunk - 1) / chunk) * chunk;
+            for (uint32_t first = 0; first < item_count; first += chunk)
+                _bake_tasks_add(
+                    tasks, (DvzBakeTask){prop, arr, first, MIN(chunk, item_count - first)});
+        }
         dvz_container_iter(&iter);
     }
 }
 
 
 
+static void _bake_task(void* user_data, uint32_t task_idx)
+{
+    DvzBakeTasks* tasks = (DvzBakeTasks*)user_data;
+    ASSERT(tasks != NULL);
+    ASSERT(task_idx < tasks->count);
+    DvzBakeTask* task = &tasks->tasks[task_idx];
+    _prop_copy_range(task->prop, task->arr, task->first_item, task->item_count);
+}
+
+
+
+// Run the tasks in the app worker pool, and free them. The tasks write to disjoint bytes so that
+// the result does not depend on the number of threads.
+static void _bake_tasks_run(DvzVisual* visual, DvzBakeTasks* tasks)
+{
+    ASSERT(visual != NULL);
+    ASSERT(tasks != NULL);
+
+    DvzWorkers* workers = NULL;
+    if (visual->canvas != NULL && visual->canvas->app != NULL &&
+        tasks->item_count >= DVZ_BAKE_PARALLEL_THRESHOLD)
+        workers = &visual->canvas->app->workers;
+
+    if (workers != NULL)
+    {
+        log_trace("baking %d tasks in parallel", tasks->count);
+        dvz_workers_run(workers, tasks->count, _bake_task, tasks);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < tasks->count; i++)
+            _bake_task(tasks, i);
+    }
+
+    FREE(tasks->tasks);
+    *tasks = (DvzBakeTasks){0};
+}
+
+
+
+static void _source_fill(DvzVisual* visual, DvzSource* source)
+{
+    ASSERT(visual != NULL);
+    ASSERT(source != NULL);
+
+    // Copy all associated props to the source array.
+    DvzBakeTasks tasks = {0};
+    _source_tasks(visual, source, &tasks);
+    _bake_tasks_run(visual, &tasks);
+}
+
+
+
 // Get the first source of a given type for the given pipeline, or none.
 static DvzSource*
 _get_pipeline_source(DvzVisual* visual, DvzSourceType source_type, uint32_t pipeline_idx)
 {
     ASSERT(visual != NULL);
-    DvzSource* source = NULL;
-    DvzContainerIterator iter = dvz_container_iterator(&visual->sources);
-    while (iter.item != NULL)
-    {
-        source = iter.item;
-        if (source->source_type == source_type && source->pipeline_idx == pipeline_idx)
-            return source;
-        dvz_container_iter(&iter);
-    }
-    return NULL;
+    return (DvzSource*)_lookup_get(&visual->pipeline_lookup, source_type, pipeline_idx);
 }
 
 
 
-static void _bake_source(DvzVisual* visual, DvzSource* source)
+// Allocate a source array before baking, return whether the source needs to be filled.
+static bool _bake_source_alloc(DvzVisual* visual, DvzSource* source)
 {
     ASSERT(visual != NULL);
     if (source == NULL)
-        return;
+        return false;
 
     // The baking function doesn't run if the VERTEX source is handled by the user.
     if (source->origin != DVZ_SOURCE_ORIGIN_LIB)
-        return;
+        return false;
     if (source->obj.request != DVZ_VISUAL_REQUEST_UPLOAD)
     {
         log_trace(
             "skip bake source for source %d that doesn't need updating", source->source_kind);
-        return;
+        return false;
     }
 
-    // The number of vertices corresponds to the largest prop.
-    uint32_t count = _source_size(visual, source);
+    // The number of vertices corresponds to the largest prop, or to the appended items only in
+    // streaming mode.
+    uint32_t count = _source_is_stream(visual, source) ? _stream_pending(visual)
+                                                       : _source_size(visual, source);
     if (count == 0)
     {
         log_debug("empty source %d", source->source_type);
-        return;
+        return false;
     }
 
     log_debug("baking source %d", source->source_kind);
 
     // Allocate the source array.
     _source_alloc(visual, source, count);
+    return true;
+}
+
 
-    // Copy all corresponding props to the array.
-    _source_fill(visual, source);
+
+// Bake several sources at once, the copies of all their props are run in parallel.
+static void _bake_sources(DvzVisual* visual, uint32_t count, DvzSource** sources)
+{
+    ASSERT(visual != NULL);
+    ASSERT(sources != NULL);
+
+    DvzBakeTasks tasks = {0};
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (_bake_source_alloc(visual, sources[i]))
+            _source_tasks(visual, sources[i], &tasks);
+    }
+    _bake_tasks_run(visual, &tasks);
+}
+
+
+
+static void _bake_source(DvzVisual* visual, DvzSource* source)
+{
+    ASSERT(visual != NULL);
+    _bake_sources(visual, 1, &source);
 }
 
 
@@ -570,6 +1095,53 @@ static void _bake_uniforms(DvzVisual* visual)
 
 
 
+// Number of float components written by the GPU data normalization, or 0 if not supported.
+static uint32_t _transform_gpu_components(DvzProp* prop)
+{
+    ASSERT(prop != NULL);
+    DvzDataType dtype = prop->target_dtype != DVZ_DTYPE_NONE ? prop->target_dtype : prop->dtype;
+    switch (dtype)
+    {
+    case DVZ_DTYPE_FLOAT:
+        return 1;
+    case DVZ_DTYPE_VEC2:
+        return 2;
+    case DVZ_DTYPE_VEC3:
+        return 3;
+    default:
+        break;
+    }
+    return 0;
+}
+
+
+
+// Run the GPU data normalization of the props of a buffer source that has just been uploaded.
+static void _source_transform_gpu(DvzVisual* visual, DvzSource* source)
+{
+    ASSERT(visual != NULL);
+    ASSERT(source != NULL);
+
+    DvzArray* arr = &source->arr;
+    DvzProp* prop = NULL;
+    DvzContainerIterator iter = dvz_container_iterator(&visual->props);
+    while (iter.item != NULL)
+    {
+        prop = iter.item;
+        if (prop->source == source && prop->transform_gpu != NULL)
+        {
+            dvz_transform_gpu_target(
+                prop->transform_gpu, source->u.br, prop->offset, arr->item_size,
+                _transform_gpu_components(prop), arr->item_count, prop->reps,
+                prop->copy_type == DVZ_ARRAY_COPY_SINGLE);
+            dvz_transform_gpu_run(prop->transform_gpu);
+        }
+        dvz_container_iter(&iter);
+    }
+}
+
+
+
 /*************************************************************************************************/
 /*  Visual default callbacks                                                                     */
 /*************************************************************************************************/
@@ -578,13 +1150,12 @@ static void _default_visual_bake(DvzVisual* visual, DvzVisualDataEvent ev)
 {
     ASSERT(visual != NULL);
 
-    // VERTEX source.
-    DvzSource* source = dvz_source_get(visual, DVZ_SOURCE_TYPE_VERTEX, 0);
-    _bake_source(visual, source);
-
-    // INDEX source.
-    source = dvz_source_get(visual, DVZ_SOURCE_TYPE_INDEX, 0);
-    _bake_source(visual, source);
+    // VERTEX and INDEX sources.
+    DvzSource* sources[] = {
+        dvz_source_get(visual, DVZ_SOURCE_TYPE_VERTEX, 0),
+        dvz_source_get(visual, DVZ_SOURCE_TYPE_INDEX, 0),
+    };
+    _bake_sources(visual, 2, sources);
 }
 
 
@@ -616,6 +1187,15 @@ static void _default_visual_fill(DvzVisual* visual, DvzVisualFillEvent ev)
         ASSERT(vertex_source != NULL);
         ASSERT(vertex_source->pipeline_idx == pipeline_idx);
 
+        // Streaming mode: the ring buffer is drawn with two indirect draw ranges.
+        if (_source_is_stream(visual, vertex_source))
+        {
+            dvz_cmd_bind_vertex_buffer(cmds, idx, vertex_source->u.br, 0);
+            dvz_cmd_bind_graphics(cmds, idx, visual->graphics[pipeline_idx], bindings, 0);
+            _stream_fill(visual->stream, cmds, idx);
+            continue;
+        }
+
         uint32_t vertex_count = vertex_source->arr.item_count;
         if (vertex_count == 0)
         {
@@ -667,4 +1247,88 @@ static void _default_visual_fill(DvzVisual* visual, DvzVisualFillEvent ev)
 
 
 
+/*************************************************************************************************/
+/*  Visual batching                                                                              */
+/*************************************************************************************************/
+
+// Index of the buffer region used with a given command buffer.
+static inline uint32_t _region_idx(DvzBufferRegions* br, uint32_t idx)
+{
+    ASSERT(br != NULL);
+    ASSERT(br->count > 0);
+    return br->count == 1 ? 0 : MIN(idx, br->count - 1);
+}
+
+
+
+// Return the vertex source of a visual if it can be drawn in a batch, NULL otherwise.
+static DvzSource* _batch_source(DvzVisual* visual, uint32_t idx)
+{
+    ASSERT(visual != NULL);
+    if (visual->callback_fill != _default_visual_fill || visual->graphics_count != 1)
+        return NULL;
+
+    DvzSource* source = _get_pipeline_source(visual, DVZ_SOURCE_TYPE_VERTEX, 0);
+    if (source == NULL || _source_is_stream(visual, source) || source->arr.item_count == 0)
+        return NULL;
+
+    // Indexed visuals are drawn individually.
+    DvzSource* index_source = _get_pipeline_source(visual, DVZ_SOURCE_TYPE_INDEX, 0);
+    if (index_source != NULL && index_source->arr.item_count > 0)
+        return NULL;
+
+    // In a batch, the vertices are addressed with a first vertex index in the whole buffer.
+    DvzBufferRegions* br = &source->u.br;
+    VkDeviceSize item_size = source->arr.item_size;
+    if (br->buffer == NULL || item_size == 0 || br->offsets[_region_idx(br, idx)] % item_size != 0)
+        return NULL;
+    return source;
+}
+
+
+
+// Whether two sets of buffer regions refer to the same memory.
+static bool _same_regions(DvzBufferRegions* a, DvzBufferRegions* b)
+{
+    ASSERT(a != NULL);
+    ASSERT(b != NULL);
+    if (a->buffer != b->buffer || a->count != b->count || a->size != b->size)
+        return false;
+    for (uint32_t i = 0; i < a->count; i++)
+    {
+        if (a->offsets[i] != b->offsets[i])
+            return false;
+    }
+    return true;
+}
+
+
+
+// Whether two batchable visuals share their pipeline, vertex buffer and bound resources. The
+// bindings must be identical: a batch is drawn with the descriptors of its first visual.
+static bool _batch_compatible(DvzVisual* a, DvzSource* sa, DvzVisual* b, DvzSource* sb)
+{
+    ASSERT(a != NULL);
+    ASSERT(b != NULL);
+    if (a->graphics[0] != b->graphics[0])
+        return false;
+    if (sa->u.br.buffer != sb->u.br.buffer || sa->arr.item_size != sb->arr.item_size)
+        return false;
+
+    DvzBindings* ba = dvz_container_get(&a->bindings, 0);
+    DvzBindings* bb = dvz_container_get(&b->bindings, 0);
+    ASSERT(ba != NULL);
+    ASSERT(bb != NULL);
+    DvzSlots* slots = &a->graphics[0]->slots;
+    for (uint32_t i = 0; i < slots->slot_count; i++)
+    {
+        if (!_same_regions(&ba->br[i], &bb->br[i]) || ba->images[i] != bb->images[i] ||
+            ba->samplers[i] != bb->samplers[i])
+            return false;
+    }
+    return true;
+}
+
+
+
 #endif
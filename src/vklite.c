@@ -1,6 +1,8 @@
 #include "../include/datoviz/vklite.h"
+#include "../include/datoviz/array.h"
 #include "spirv.h"
 #include "vklite_utils.h"
+#include <inttypes.h>
 #include <stdlib.h>
 
 
@@ -25,6 +27,9 @@ DvzApp* dvz_app(DvzBackend backend)
     app->windows =
         dvz_container(DVZ_CONTAINER_DEFAULT_COUNT, sizeof(DvzWindow), DVZ_OBJECT_TYPE_WINDOW);
 
+    // Worker pool, the threads are only spawned when needed.
+    app->workers = dvz_workers(0);
+
     // Which extensions are required? Depends on the backend.
     uint32_t required_extension_count = 0;
     const char** required_extensions = backend_extensions(backend, &required_extension_count);
@@ -103,6 +108,9 @@ int dvz_app_destroy(DvzApp* app)
         app->instance = 0;
     }
 
+    // Join the worker threads.
+    dvz_workers_destroy(&app->workers);
+
     // Free the App memory.
     int res = (int)app->n_errors;
     FREE(app);
@@ -113,6 +121,14 @@ int dvz_app_destroy(DvzApp* app)
 
 
 
+void dvz_app_threads(DvzApp* app, uint32_t thread_count)
+{
+    ASSERT(app != NULL);
+    dvz_workers_resize(&app->workers, thread_count);
+}
+
+
+
 /*************************************************************************************************/
 /*  GPU                                                                                          */
 /*************************************************************************************************/
@@ -180,12 +196,123 @@ void dvz_gpu_create(DvzGpu* gpu, VkSurfaceKHR surface)
     // Create descriptor pool.
     create_descriptor_pool(gpu->device, &gpu->dset_pool);
 
+    // Device memory suballocator.
+    memory_init(gpu);
+
     dvz_obj_created(&gpu->obj);
     log_trace("GPU #%d created", gpu->idx);
 }
 
 
 
+bool dvz_gpu_pipeline_cache(DvzGpu* gpu, size_t size, const void* data)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(gpu->device != VK_NULL_HANDLE);
+
+    // Discard initial data produced by another device or driver.
+    bool valid = size > 0 && data != NULL;
+    if (valid && !check_pipeline_cache(&gpu->device_properties, size, data))
+    {
+        log_warn("discarding pipeline cache data that does not match the current device");
+        valid = false;
+    }
+
+    VkPipelineCache cache = VK_NULL_HANDLE;
+    create_pipeline_cache(gpu->device, valid ? size : 0, valid ? data : NULL, &cache);
+
+    // Keep the pipelines already compiled in this session.
+    if (gpu->pipeline_cache != VK_NULL_HANDLE)
+    {
+        vkMergePipelineCaches(gpu->device, cache, 1, &gpu->pipeline_cache);
+        vkDestroyPipelineCache(gpu->device, gpu->pipeline_cache, NULL);
+    }
+    gpu->pipeline_cache = cache;
+    log_trace("pipeline cache created with %d bytes of initial data", valid ? (int)size : 0);
+    return valid;
+}
+
+
+
+void* dvz_gpu_pipeline_cache_data(DvzGpu* gpu, size_t* size)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(size != NULL);
+    *size = 0;
+    if (gpu->pipeline_cache == VK_NULL_HANDLE)
+        return NULL;
+
+    VK_CHECK_RESULT(vkGetPipelineCacheData(gpu->device, gpu->pipeline_cache, size, NULL));
+    if (*size == 0)
+        return NULL;
+    void* data = malloc(*size);
+    VK_CHECK_RESULT(vkGetPipelineCacheData(gpu->device, gpu->pipeline_cache, size, data));
+    return data;
+}
+
+
+
+DvzMemoryStats dvz_gpu_memory_stats(DvzGpu* gpu, uint32_t type_idx)
+{
+    ASSERT(gpu != NULL);
+    DvzMemoryStats stats = {0};
+    VkDeviceSize free_size = 0;
+    DvzMemoryPool* pool = NULL;
+    DvzMemoryBlock* block = NULL;
+    DvzAllocStats block_stats = {0};
+    for (uint32_t i = 0; i < gpu->memory_properties.memoryTypeCount; i++)
+    {
+        if (type_idx != DVZ_MEMORY_TYPE_ALL && type_idx != i)
+            continue;
+        for (uint32_t j = 0; j < 2; j++)
+        {
+            pool = &gpu->memory.pools[i][j];
+            stats.dedicated_count += pool->dedicated_count;
+            stats.allocated += pool->dedicated_size;
+            stats.used += pool->dedicated_size;
+            for (uint32_t k = 0; k < pool->block_count; k++)
+            {
+                block = &pool->blocks[k];
+                if (block->memory == VK_NULL_HANDLE)
+                    continue;
+                block_stats = dvz_alloc_stats(&block->alloc);
+                stats.block_count++;
+                stats.alloc_count += block->alloc_count;
+                stats.allocated += block_stats.size;
+                stats.used += block_stats.used;
+                stats.largest_free = MAX(stats.largest_free, block_stats.largest_free);
+                stats.free_ranges += block_stats.free_blocks;
+                free_size += block_stats.size - block_stats.used;
+            }
+        }
+    }
+    if (free_size > 0)
+        stats.fragmentation = 1 - stats.largest_free / (double)free_size;
+    return stats;
+}
+
+
+
+void dvz_gpu_memory_print(DvzGpu* gpu)
+{
+    ASSERT(gpu != NULL);
+    DvzMemoryStats stats = {0};
+    for (uint32_t i = 0; i < gpu->memory_properties.memoryTypeCount; i++)
+    {
+        stats = dvz_gpu_memory_stats(gpu, i);
+        if (stats.allocated == 0)
+            continue;
+        log_info(
+            "memory type %d: %d block(s), %d region(s), %d dedicated, %s allocated, "
+            "%.0f%% used, %.0f%% fragmentation",
+            i, stats.block_count, stats.alloc_count, stats.dedicated_count,
+            pretty_size(stats.allocated), 100.0 * stats.used / stats.allocated,
+            100.0 * stats.fragmentation);
+    }
+}
+
+
+
 void dvz_queue_wait(DvzGpu* gpu, uint32_t queue_idx)
 {
     ASSERT(gpu != NULL);
@@ -196,6 +323,23 @@ void dvz_queue_wait(DvzGpu* gpu, uint32_t queue_idx)
 
 
 
+void dvz_queue_signal(DvzGpu* gpu, uint32_t queue_idx, DvzSemaphores* semaphores, uint32_t idx)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(queue_idx < gpu->queues.queue_count);
+    ASSERT(semaphores != NULL);
+    ASSERT(idx < semaphores->count);
+
+    // The signal operation is ordered after all commands submitted before to the queue.
+    VkSubmitInfo submit_info = {0};
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &semaphores->semaphores[idx];
+    VK_CHECK_RESULT(vkQueueSubmit(gpu->queues.queues[queue_idx], 1, &submit_info, VK_NULL_HANDLE));
+}
+
+
+
 void dvz_gpu_wait(DvzGpu* gpu)
 {
     ASSERT(gpu != NULL);
@@ -254,6 +398,14 @@ void dvz_gpu_destroy(DvzGpu* gpu)
     }
 
 
+    if (gpu->pipeline_cache != VK_NULL_HANDLE)
+    {
+        log_trace("destroy pipeline cache");
+        vkDestroyPipelineCache(gpu->device, gpu->pipeline_cache, NULL);
+        gpu->pipeline_cache = VK_NULL_HANDLE;
+    }
+
+
     if (gpu->dset_pool != VK_NULL_HANDLE)
     {
         log_trace("destroy descriptor pool");
@@ -262,6 +414,10 @@ void dvz_gpu_destroy(DvzGpu* gpu)
     }
 
 
+    // Free the device memory blocks.
+    log_trace("destroy memory blocks");
+    memory_destroy(gpu);
+
     // Destroy the device.
     log_trace("destroy device");
     if (gpu->device != VK_NULL_HANDLE)
@@ -617,7 +773,37 @@ DvzCommands dvz_commands(DvzGpu* gpu, uint32_t queue, uint32_t count)
     commands.gpu = gpu;
     commands.queue_idx = queue;
     commands.count = count;
-    allocate_command_buffers(gpu->device, gpu->queues.cmd_pools[qf], count, commands.cmds);
+    commands.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate_command_buffers(
+        gpu->device, gpu->queues.cmd_pools[qf], commands.level, count, commands.cmds);
+
+    dvz_obj_init(&commands.obj);
+
+    return commands;
+}
+
+
+
+DvzCommands dvz_commands_secondary(DvzGpu* gpu, uint32_t queue, uint32_t count)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(dvz_obj_is_created(&gpu->obj));
+
+    ASSERT(count <= DVZ_MAX_COMMAND_BUFFERS_PER_SET);
+    ASSERT(queue < gpu->queues.queue_count);
+    ASSERT(count > 0);
+    uint32_t qf = gpu->queues.queue_families[queue];
+    ASSERT(qf < gpu->queues.queue_family_count);
+    ASSERT(gpu->queues.cmd_pools[qf] != VK_NULL_HANDLE);
+    log_trace("creating secondary commands on queue #%d, queue family #%d", queue, qf);
+
+    DvzCommands commands = {0};
+    commands.gpu = gpu;
+    commands.queue_idx = queue;
+    commands.count = count;
+    commands.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocate_command_buffers(
+        gpu->device, gpu->queues.cmd_pools[qf], commands.level, count, commands.cmds);
 
     dvz_obj_init(&commands.obj);
 
@@ -634,6 +820,32 @@ void dvz_cmd_begin(DvzCommands* cmds, uint32_t idx)
     VkCommandBufferBeginInfo begin_info = {0};
     begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     VK_CHECK_RESULT(vkBeginCommandBuffer(cmds->cmds[idx], &begin_info));
+    cmds->draw_count[idx] = 0;
+}
+
+
+
+void dvz_cmd_begin_secondary(DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass)
+{
+    ASSERT(cmds != NULL);
+    ASSERT(cmds->count > 0);
+    ASSERT(cmds->level == VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    ASSERT(renderpass != NULL);
+    ASSERT(renderpass->renderpass != VK_NULL_HANDLE);
+
+    // The framebuffer is left unspecified, so that the command buffer remains valid when the
+    // framebuffers are recreated.
+    VkCommandBufferInheritanceInfo inheritance = {0};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.renderPass = renderpass->renderpass;
+    inheritance.subpass = 0;
+
+    VkCommandBufferBeginInfo begin_info = {0};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    begin_info.pInheritanceInfo = &inheritance;
+    VK_CHECK_RESULT(vkBeginCommandBuffer(cmds->cmds[idx], &begin_info));
+    cmds->draw_count[idx] = 0;
 }
 
 
@@ -778,10 +990,9 @@ void dvz_buffer_queue_access(DvzBuffer* buffer, uint32_t queue_idx)
 static void _buffer_create(DvzBuffer* buffer)
 {
     create_buffer2(
-        buffer->gpu->device,                                           //
-        &buffer->gpu->queues, buffer->queue_count, buffer->queues,     //
-        buffer->usage, buffer->memory, buffer->gpu->memory_properties, //
-        buffer->size, &buffer->buffer, &buffer->device_memory);
+        buffer->gpu, buffer->queue_count, buffer->queues, //
+        buffer->usage, buffer->memory, buffer->size,      //
+        &buffer->buffer, &buffer->allocation);
 }
 
 
@@ -800,14 +1011,9 @@ static void _buffer_destroy(DvzBuffer* buffer)
         vkDestroyBuffer(buffer->gpu->device, buffer->buffer, NULL);
         buffer->buffer = VK_NULL_HANDLE;
     }
-    if (buffer->device_memory != VK_NULL_HANDLE)
-    {
-        vkFreeMemory(buffer->gpu->device, buffer->device_memory, NULL);
-        buffer->device_memory = VK_NULL_HANDLE;
-    }
+    memory_free(buffer->gpu, &buffer->allocation);
 
     buffer->buffer = VK_NULL_HANDLE;
-    buffer->device_memory = VK_NULL_HANDLE;
 }
 
 
@@ -848,6 +1054,24 @@ void dvz_buffer_resize(DvzBuffer* buffer, VkDeviceSize size, DvzCommands* cmds)
 {
     ASSERT(buffer != NULL);
     log_debug("[SLOW] resize buffer to size %d", size);
+    ASSERT(size >= buffer->size);
+
+    // Keep the whole contents of the old buffer at the same location.
+    VkBufferCopy region = {0};
+    region.size = buffer->size;
+    dvz_buffer_relocate(buffer, size, cmds, 1, &region);
+}
+
+
+
+void dvz_buffer_relocate(
+    DvzBuffer* buffer, VkDeviceSize size, DvzCommands* cmds, //
+    uint32_t region_count, const VkBufferCopy* regions)
+{
+    ASSERT(buffer != NULL);
+    log_debug(
+        "[SLOW] relocate %d regions in a new buffer with size %" PRIu64, region_count,
+        (uint64_t)size);
     DvzGpu* gpu = buffer->gpu;
 
     // Create the new buffer with the new size.
@@ -877,16 +1101,22 @@ void dvz_buffer_resize(DvzBuffer* buffer, VkDeviceSize size, DvzCommands* cmds)
 
     // If a DvzCommands object was passed for the data transfer, transfer the data from the
     // old buffer to the new, by flushing the corresponding queue and waiting for completion.
-    if (cmds != NULL)
+    if (cmds != NULL && region_count > 0)
     {
         uint32_t queue_idx = cmds->queue_idx;
         log_debug("copying data from the old buffer to the new one before destroying the old one");
         ASSERT(queue_idx < gpu->queues.queue_count);
-        ASSERT(size >= buffer->size);
+        ASSERT(regions != NULL);
+        for (uint32_t i = 0; i < region_count; i++)
+        {
+            ASSERT(regions[i].srcOffset + regions[i].size <= buffer->size);
+            ASSERT(regions[i].dstOffset + regions[i].size <= size);
+        }
 
         dvz_cmd_reset(cmds, 0);
         dvz_cmd_begin(cmds, 0);
-        dvz_cmd_copy_buffer(cmds, 0, buffer, 0, &new_buffer, 0, buffer->size);
+        // All regions are copied with a single command.
+        vkCmdCopyBuffer(cmds->cmds[0], buffer->buffer, new_buffer.buffer, region_count, regions);
         dvz_cmd_end(cmds, 0);
 
         VkQueue queue = gpu->queues.queues[queue_idx];
@@ -903,9 +1133,9 @@ void dvz_buffer_resize(DvzBuffer* buffer, VkDeviceSize size, DvzCommands* cmds)
 
     // Update the existing DvzBuffer struct with the newly-created Vulkan objects.
     buffer->buffer = new_buffer.buffer;
-    buffer->device_memory = new_buffer.device_memory;
+    buffer->allocation = new_buffer.allocation;
     ASSERT(buffer->buffer != VK_NULL_HANDLE);
-    ASSERT(buffer->device_memory != VK_NULL_HANDLE);
+    ASSERT(buffer->allocation.memory != VK_NULL_HANDLE);
 
     // If the existing buffer was already mapped, we need to remap the new buffer.
     if (old_mmap != NULL)
@@ -932,10 +1162,7 @@ void* dvz_buffer_map(DvzBuffer* buffer, VkDeviceSize offset, VkDeviceSize size)
 
     log_debug("memmap buffer %d", buffer->type);
     ASSERT(buffer->mmap == NULL);
-    void* cdata = NULL;
-    VK_CHECK_RESULT(
-        vkMapMemory(buffer->gpu->device, buffer->device_memory, offset, size, 0, &cdata));
-    return cdata;
+    return memory_map(buffer->gpu, &buffer->allocation, offset, size);
 }
 
 
@@ -952,7 +1179,7 @@ void dvz_buffer_unmap(DvzBuffer* buffer)
         (buffer->memory & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
 
     log_debug("unmap buffer %d", buffer->type);
-    vkUnmapMemory(buffer->gpu->device, buffer->device_memory);
+    memory_unmap(buffer->gpu, &buffer->allocation);
 }
 
 
@@ -1114,7 +1341,7 @@ void dvz_buffer_regions_upload(DvzBufferRegions* br, uint32_t idx, const void* d
     }
     else
     {
-        mapped = buffer->mmap;
+        mapped = (void*)((int64_t)buffer->mmap + (int64_t)br->offsets[idx]);
         need_unmap = false;
     }
     ASSERT(mapped != NULL);
@@ -1234,10 +1461,9 @@ static void _images_create(DvzImages* images)
     {
         if (!images->is_swapchain)
             create_image2(
-                gpu->device, &gpu->queues, images->queue_count, images->queues, images->image_type,
-                images->width, images->height, images->depth, images->format, images->tiling,
-                images->usage, images->memory, gpu->memory_properties, &images->images[i],
-                &images->memories[i]);
+                gpu, images->queue_count, images->queues, images->image_type, images->width,
+                images->height, images->depth, images->format, images->tiling, images->usage,
+                images->memory, &images->images[i], &images->allocations[i]);
 
         // HACK: staging images do not require an image view
         if (images->tiling != VK_IMAGE_TILING_LINEAR)
@@ -1263,11 +1489,7 @@ static void _images_destroy(DvzImages* images)
             vkDestroyImage(images->gpu->device, images->images[i], NULL);
             images->images[i] = VK_NULL_HANDLE;
         }
-        if (images->memories[i] != VK_NULL_HANDLE)
-        {
-            vkFreeMemory(images->gpu->device, images->memories[i], NULL);
-            images->memories[i] = VK_NULL_HANDLE;
-        }
+        memory_free(images->gpu, &images->allocations[i]);
     }
 }
 
@@ -1336,7 +1558,7 @@ void dvz_images_download(
 
     // Map image memory so we can start copying from it
     void* data = NULL;
-    vkMapMemory(staging->gpu->device, staging->memories[idx], 0, VK_WHOLE_SIZE, 0, &data);
+    data = memory_map(staging->gpu, &staging->allocations[idx], 0, VK_WHOLE_SIZE);
     ASSERT(data != NULL);
     VkDeviceSize offset = subResourceLayout.offset;
     VkDeviceSize row_pitch = subResourceLayout.rowPitch;
@@ -1348,45 +1570,12 @@ void dvz_images_download(
     ASSERT(h > 0);
     ASSERT(row_pitch >= w * 4);
 
-    // First, memcopy from the GPU to the CPU.
-    uint8_t* image = calloc(row_pitch * h, 1);
-    uint8_t* image_orig = image;
-    memcpy(image, data, row_pitch * h);
-    vkUnmapMemory(staging->gpu->device, staging->memories[idx]);
-
-    // Then, swizzle.
-    image += offset;
-    uint32_t src_offset = 0;
-    uint32_t dst_offset = 0;
+    // Convert the rows straight from the mapped memory, without an intermediate copy.
+    const uint8_t* image = (const uint8_t*)data + offset;
+    uint32_t n = has_alpha ? 4 : 3;
     for (uint32_t y = 0; y < h; y++)
-    {
-        src_offset = 0;
-        for (uint32_t x = 0; x < w; x++)
-        {
-            ASSERT(src_offset + 2 < w * h * 4);
-            if (swizzle)
-            {
-                out[dst_offset + 0] = image[src_offset + 2];
-                out[dst_offset + 1] = image[src_offset + 1];
-                out[dst_offset + 2] = image[src_offset + 0];
-                if (has_alpha)
-                    out[dst_offset + 3] = 255;
-            }
-            else
-            {
-                out[dst_offset + 0] = image[src_offset + 0];
-                out[dst_offset + 1] = image[src_offset + 1];
-                out[dst_offset + 2] = image[src_offset + 2];
-                if (has_alpha)
-                    out[dst_offset + 3] = 255;
-            }
-            src_offset += 4;
-            dst_offset += has_alpha ? 4 : 3;
-        }
-        image += row_pitch;
-    }
-    ASSERT(dst_offset == w * h * (has_alpha ? 4 : 3));
-    FREE(image_orig);
+        dvz_array_pixels(out + y * w * n, image + y * row_pitch, w, swizzle, has_alpha);
+    memory_unmap(staging->gpu, &staging->allocations[idx]);
 }
 
 
@@ -1732,6 +1921,18 @@ void dvz_compute_code(DvzCompute* compute, const char* code)
 
 
 
+void dvz_compute_spirv(DvzCompute* compute, VkDeviceSize size, const uint32_t* buffer)
+{
+    ASSERT(compute != NULL);
+    ASSERT(compute->gpu != NULL);
+    ASSERT(compute->gpu->device != VK_NULL_HANDLE);
+    ASSERT(size > 0);
+    ASSERT(buffer != NULL);
+    compute->shader_module = create_shader_module(compute->gpu->device, size, buffer);
+}
+
+
+
 void dvz_compute_slot(DvzCompute* compute, uint32_t idx, VkDescriptorType type)
 {
     ASSERT(compute != NULL);
@@ -1775,7 +1976,11 @@ void dvz_compute_create(DvzCompute* compute)
 
     log_trace("starting creation of compute...");
 
-    if (compute->shader_code != NULL)
+    if (compute->shader_module != VK_NULL_HANDLE)
+    {
+        log_trace("compute shader module already created from SPIRV code");
+    }
+    else if (compute->shader_code != NULL)
     {
         compute->shader_module =
             dvz_shader_compile(compute->gpu, compute->shader_code, VK_SHADER_STAGE_COMPUTE_BIT);
@@ -1787,7 +1992,7 @@ void dvz_compute_create(DvzCompute* compute)
     }
 
     create_compute_pipeline(
-        compute->gpu->device, compute->shader_module, //
+        compute->gpu->device, compute->gpu->pipeline_cache, compute->shader_module, //
         compute->slots.pipeline_layout, &compute->pipeline);
 
     dvz_obj_created(&compute->obj);
@@ -1890,6 +2095,8 @@ void dvz_graphics_shader(
     graphics->shader_stages[graphics->shader_count] = stage;
     graphics->shader_modules[graphics->shader_count++] =
         create_shader_module_from_file(graphics->gpu->device, shader_path);
+    graphics->shader_hash = dvz_hash(
+        dvz_hash(graphics->shader_hash, &stage, sizeof(stage)), shader_path, strlen(shader_path));
 }
 
 
@@ -1905,6 +2112,8 @@ void dvz_graphics_shader_spirv(
     graphics->shader_stages[graphics->shader_count] = stage;
     graphics->shader_modules[graphics->shader_count++] =
         create_shader_module(graphics->gpu->device, size, buffer);
+    graphics->shader_hash =
+        dvz_hash(dvz_hash(graphics->shader_hash, &stage, sizeof(stage)), buffer, size);
 }
 
 
@@ -2077,7 +2286,8 @@ void dvz_graphics_create(DvzGraphics* graphics)
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
     VK_CHECK_RESULT(vkCreateGraphicsPipelines(
-        graphics->gpu->device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, &graphics->pipeline));
+        graphics->gpu->device, graphics->gpu->pipeline_cache, 1, &pipelineInfo, NULL,
+        &graphics->pipeline));
     if (graphics->pipeline != VK_NULL_HANDLE)
     {
         log_trace("graphics pipeline created");
@@ -2414,6 +2624,69 @@ void dvz_fences_destroy(DvzFences* fences)
 
 
 
+/*************************************************************************************************/
+/*  Queries                                                                                      */
+/*************************************************************************************************/
+
+DvzQueries dvz_queries(DvzGpu* gpu, VkQueryType type, uint32_t count)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(dvz_obj_is_created(&gpu->obj));
+
+    ASSERT(count > 0);
+    log_trace("create pool of %d queries", count);
+
+    DvzQueries queries = {0};
+    queries.gpu = gpu;
+    queries.type = type;
+    queries.count = count;
+    queries.period = gpu->device_properties.limits.timestampPeriod;
+
+    VkQueryPoolCreateInfo info = {0};
+    info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    info.queryType = type;
+    info.queryCount = count;
+    VK_CHECK_RESULT(vkCreateQueryPool(gpu->device, &info, NULL, &queries.pool));
+
+    dvz_obj_created(&queries.obj);
+    return queries;
+}
+
+
+
+bool dvz_queries_results(DvzQueries* queries, uint32_t first, uint32_t count, uint64_t* values)
+{
+    ASSERT(queries != NULL);
+    ASSERT(values != NULL);
+    ASSERT(first + count <= queries->count);
+    // Non-blocking: VK_NOT_READY is returned if any of the results is not available yet.
+    VkResult res = vkGetQueryPoolResults(
+        queries->gpu->device, queries->pool, first, count, count * sizeof(uint64_t), values,
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    return res == VK_SUCCESS;
+}
+
+
+
+void dvz_queries_destroy(DvzQueries* queries)
+{
+    ASSERT(queries != NULL);
+    if (!dvz_obj_is_created(&queries->obj))
+    {
+        log_trace("skip destruction of already-destroyed queries");
+        return;
+    }
+    log_trace("destroy pool of %d queries", queries->count);
+    if (queries->pool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(queries->gpu->device, queries->pool, NULL);
+        queries->pool = VK_NULL_HANDLE;
+    }
+    dvz_obj_destroyed(&queries->obj);
+}
+
+
+
 /*************************************************************************************************/
 /*  Renderpass                                                                                   */
 /*************************************************************************************************/
@@ -2909,8 +3182,9 @@ void dvz_submit_reset(DvzSubmit* submit)
 /*  Command buffer filling                                                                       */
 /*************************************************************************************************/
 
-void dvz_cmd_begin_renderpass(
-    DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass, DvzFramebuffers* framebuffers)
+static void _begin_renderpass(
+    DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass, DvzFramebuffers* framebuffers,
+    VkSubpassContents contents)
 {
     ASSERT(renderpass != NULL);
     ASSERT(framebuffers != NULL);
@@ -2929,12 +3203,29 @@ void dvz_cmd_begin_renderpass(
     ASSERT(framebuffers->framebuffers[iclip] != VK_NULL_HANDLE);
     begin_render_pass(
         renderpass->renderpass, cb, framebuffers->framebuffers[iclip], //
-        width, height, renderpass->clear_count, renderpass->clear_values);
+        width, height, renderpass->clear_count, renderpass->clear_values, contents);
     CMD_END
 }
 
 
 
+void dvz_cmd_begin_renderpass(
+    DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass, DvzFramebuffers* framebuffers)
+{
+    _begin_renderpass(cmds, idx, renderpass, framebuffers, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+
+
+void dvz_cmd_begin_renderpass_secondary(
+    DvzCommands* cmds, uint32_t idx, DvzRenderpass* renderpass, DvzFramebuffers* framebuffers)
+{
+    _begin_renderpass(
+        cmds, idx, renderpass, framebuffers, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+}
+
+
+
 void dvz_cmd_end_renderpass(DvzCommands* cmds, uint32_t idx)
 {
     CMD_START
@@ -2979,7 +3270,7 @@ void dvz_cmd_barrier(DvzCommands* cmds, uint32_t idx, DvzBarrier* barrier)
         buffer_barrier = &buffer_barriers[j];
         buffer_info = &barrier->buffer_barriers[j];
 
-        buffer_barrier->sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        buffer_barrier->sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
         buffer_barrier->buffer = buffer_info->br.buffer->buffer;
         buffer_barrier->size = buffer_info->br.size;
         ASSERT(i < buffer_info->br.count);
@@ -3159,7 +3450,7 @@ void dvz_cmd_viewport(DvzCommands* cmds, uint32_t idx, VkViewport viewport)
 
 
 
-void dvz_cmd_bind_graphics(
+void dvz_cmd_bind_descriptors(
     DvzCommands* cmds, uint32_t idx, DvzGraphics* graphics, //
     DvzBindings* bindings, uint32_t dynamic_idx)
 {
@@ -3182,8 +3473,6 @@ void dvz_cmd_bind_graphics(
     }
 
     CMD_START_CLIP(bindings->dset_count)
-    if (dvz_obj_is_created(&graphics->obj))
-        vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics->pipeline);
     vkCmdBindDescriptorSets(
         cb, VK_PIPELINE_BIND_POINT_GRAPHICS, slots->pipeline_layout, //
         0, 1, &bindings->dsets[iclip], dyn_count, dyn_offsets);
@@ -3192,6 +3481,22 @@ void dvz_cmd_bind_graphics(
 
 
 
+void dvz_cmd_bind_graphics(
+    DvzCommands* cmds, uint32_t idx, DvzGraphics* graphics, //
+    DvzBindings* bindings, uint32_t dynamic_idx)
+{
+    ASSERT(graphics != NULL);
+
+    CMD_START
+    if (dvz_obj_is_created(&graphics->obj))
+        vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, graphics->pipeline);
+    CMD_END
+
+    dvz_cmd_bind_descriptors(cmds, idx, graphics, bindings, dynamic_idx);
+}
+
+
+
 void dvz_cmd_bind_vertex_buffer(
     DvzCommands* cmds, uint32_t idx, DvzBufferRegions br, VkDeviceSize offset)
 {
@@ -3218,6 +3523,7 @@ void dvz_cmd_draw(DvzCommands* cmds, uint32_t idx, uint32_t first_vertex, uint32
     ASSERT(vertex_count > 0);
     CMD_START
     vkCmdDraw(cb, vertex_count, 1, first_vertex, 0);
+    cmds->draw_count[i]++;
     CMD_END
 }
 
@@ -3230,6 +3536,7 @@ void dvz_cmd_draw_indexed(
     ASSERT(index_count > 0);
     CMD_START
     vkCmdDrawIndexed(cb, index_count, 1, first_index, (int32_t)vertex_offset, 0);
+    cmds->draw_count[i]++;
     CMD_END
 }
 
@@ -3239,6 +3546,7 @@ void dvz_cmd_draw_indirect(DvzCommands* cmds, uint32_t idx, DvzBufferRegions ind
 {
     CMD_START_CLIP(indirect.count)
     vkCmdDrawIndirect(cb, indirect.buffer->buffer, indirect.offsets[iclip], 1, 0);
+    cmds->draw_count[i]++;
     CMD_END
 }
 
@@ -3248,6 +3556,34 @@ void dvz_cmd_draw_indexed_indirect(DvzCommands* cmds, uint32_t idx, DvzBufferReg
 {
     CMD_START_CLIP(indirect.count)
     vkCmdDrawIndexedIndirect(cb, indirect.buffer->buffer, indirect.offsets[iclip], 1, 0);
+    cmds->draw_count[i]++;
+    CMD_END
+}
+
+
+
+void dvz_cmd_draw_indirect_multi(
+    DvzCommands* cmds, uint32_t idx, DvzBufferRegions indirect, uint32_t draw_count)
+{
+    ASSERT(draw_count > 0);
+    ASSERT(cmds->gpu != NULL);
+    const uint32_t stride = sizeof(VkDrawIndirectCommand);
+    ASSERT(draw_count * stride <= indirect.size);
+
+    CMD_START_CLIP(indirect.count)
+    if (draw_count == 1 || cmds->gpu->requested_features.multiDrawIndirect)
+    {
+        vkCmdDrawIndirect(
+            cb, indirect.buffer->buffer, indirect.offsets[iclip], draw_count, stride);
+        cmds->draw_count[i]++;
+    }
+    else
+    {
+        for (uint32_t k = 0; k < draw_count; k++)
+            vkCmdDrawIndirect(
+                cb, indirect.buffer->buffer, indirect.offsets[iclip] + k * stride, 1, 0);
+        cmds->draw_count[i] += draw_count;
+    }
     CMD_END
 }
 
@@ -3285,3 +3621,43 @@ void dvz_cmd_push(
     vkCmdPushConstants(cb, slots->pipeline_layout, shaders, offset, size, data);
     CMD_END
 }
+
+
+
+void dvz_cmd_reset_queries(
+    DvzCommands* cmds, uint32_t idx, DvzQueries* queries, uint32_t first, uint32_t count)
+{
+    ASSERT(queries != NULL);
+    ASSERT(first + count <= queries->count);
+    CMD_START
+    vkCmdResetQueryPool(cb, queries->pool, first, count);
+    CMD_END
+}
+
+
+
+void dvz_cmd_timestamp(
+    DvzCommands* cmds, uint32_t idx, DvzQueries* queries, uint32_t query,
+    VkPipelineStageFlagBits stage)
+{
+    ASSERT(queries != NULL);
+    ASSERT(queries->type == VK_QUERY_TYPE_TIMESTAMP);
+    ASSERT(query < queries->count);
+    CMD_START
+    vkCmdWriteTimestamp(cb, stage, queries->pool, query);
+    CMD_END
+}
+
+
+
+void dvz_cmd_execute(DvzCommands* cmds, uint32_t idx, DvzCommands* secondary)
+{
+    ASSERT(secondary != NULL);
+    ASSERT(secondary->level == VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    ASSERT(idx < secondary->count);
+    CMD_START
+    vkCmdExecuteCommands(cb, 1, &secondary->cmds[idx]);
+    // The draw calls of the secondary command buffer are counted in the primary one.
+    cmds->draw_count[i] += secondary->draw_count[idx];
+    CMD_END
+}
@@ -979,7 +979,8 @@ static void create_swapchain(
 /*************************************************************************************************/
 
 static void allocate_command_buffers(
-    VkDevice device, VkCommandPool command_pool, uint32_t count, VkCommandBuffer* cmd_bufs)
+    VkDevice device, VkCommandPool command_pool, VkCommandBufferLevel level, uint32_t count,
+    VkCommandBuffer* cmd_bufs)
 {
     ASSERT(count > 0);
     log_trace("allocate %d command buffer(s)", count);
@@ -989,7 +990,7 @@ static void allocate_command_buffers(
     VkCommandBufferAllocateInfo alloc_info = {0};
     alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     alloc_info.commandPool = command_pool;
-    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.level = level;
     alloc_info.commandBufferCount = count;
     VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &alloc_info, cmd_bufs));
 }
@@ -1016,6 +1017,247 @@ static uint32_t find_memory_type(
 
 
 
+/*************************************************************************************************/
+/*  Device memory                                                                                */
+/*************************************************************************************************/
+
+// Round a region size up to its size class: powers of 2 split in 4 steps, so that freed regions
+// are easily reused by resources of a similar size, with at most 25% of wasted memory.
+static VkDeviceSize memory_size_class(VkDeviceSize size)
+{
+    if (size <= DVZ_MEMORY_MIN_SIZE_CLASS)
+        return DVZ_MEMORY_MIN_SIZE_CLASS;
+    VkDeviceSize step = dvz_next_pow2(size) / 8;
+    ASSERT(step > 0);
+    return step * ((size + step - 1) / step);
+}
+
+
+
+static void memory_init(DvzGpu* gpu)
+{
+    ASSERT(gpu != NULL);
+    VkPhysicalDeviceMemoryProperties* props = &gpu->memory_properties;
+    VkDeviceSize heap_size = 0;
+    for (uint32_t i = 0; i < props->memoryTypeCount; i++)
+    {
+        // Smaller blocks for small heaps, such as the host-visible device-local heap.
+        heap_size = props->memoryHeaps[props->memoryTypes[i].heapIndex].size;
+        gpu->memory.block_size[i] = MIN(DVZ_MEMORY_BLOCK_SIZE, dvz_next_pow2(heap_size / 16));
+    }
+}
+
+
+
+static DvzMemoryPool* memory_pool(DvzGpu* gpu, DvzMemoryAlloc* allocation)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(allocation != NULL);
+    ASSERT(allocation->type_idx < VK_MAX_MEMORY_TYPES);
+    ASSERT(allocation->pool_idx < 2);
+    return &gpu->memory.pools[allocation->type_idx][allocation->pool_idx];
+}
+
+
+
+// Allocate a new memory block in a pool, reusing a released block slot if any.
+static uint32_t
+memory_block(DvzGpu* gpu, DvzMemoryPool* pool, uint32_t type_idx, VkDeviceSize block_size)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(pool != NULL);
+    uint32_t idx = 0;
+    for (idx = 0; idx < pool->block_count; idx++)
+        if (pool->blocks[idx].memory == VK_NULL_HANDLE)
+            break;
+    if (idx == pool->block_count)
+    {
+        pool->block_count++;
+        REALLOC(pool->blocks, pool->block_count * sizeof(DvzMemoryBlock));
+    }
+    DvzMemoryBlock* block = &pool->blocks[idx];
+    memset(block, 0, sizeof(DvzMemoryBlock));
+
+    VkMemoryAllocateInfo alloc_info = {0};
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize = block_size;
+    alloc_info.memoryTypeIndex = type_idx;
+    log_trace("allocate memory block of %s for memory type %d", pretty_size(block_size), type_idx);
+    VK_CHECK_RESULT(vkAllocateMemory(gpu->device, &alloc_info, NULL, &block->memory));
+    block->alloc = dvz_alloc(block_size, DVZ_MEMORY_MIN_SIZE_CLASS);
+    return idx;
+}
+
+
+
+static void memory_alloc(
+    DvzGpu* gpu, VkMemoryRequirements* req, VkMemoryPropertyFlags properties, bool linear,
+    DvzMemoryAlloc* allocation)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(req != NULL);
+    ASSERT(req->size > 0);
+    ASSERT(allocation != NULL);
+
+    memset(allocation, 0, sizeof(DvzMemoryAlloc));
+    allocation->type_idx =
+        find_memory_type(req->memoryTypeBits, properties, gpu->memory_properties);
+    allocation->pool_idx =
+        linear || gpu->device_properties.limits.bufferImageGranularity <= 1 ? 0 : 1;
+    DvzMemoryPool* pool = memory_pool(gpu, allocation);
+    VkDeviceSize block_size = gpu->memory.block_size[allocation->type_idx];
+    VkDeviceSize size = memory_size_class(req->size);
+
+    // Large resources get a dedicated allocation.
+    if (size > block_size / 2)
+    {
+        VkMemoryAllocateInfo alloc_info = {0};
+        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        alloc_info.allocationSize = req->size;
+        alloc_info.memoryTypeIndex = allocation->type_idx;
+        VK_CHECK_RESULT(vkAllocateMemory(gpu->device, &alloc_info, NULL, &allocation->memory));
+        allocation->size = req->size;
+        allocation->block_idx = UINT32_MAX;
+        pool->dedicated_count++;
+        pool->dedicated_size += req->size;
+        return;
+    }
+
+    // Otherwise, suballocate the region in the first block with enough free space.
+    DvzMemoryBlock* block = NULL;
+    uint32_t idx = 0;
+    for (idx = 0; idx < pool->block_count; idx++)
+    {
+        block = &pool->blocks[idx];
+        if (block->memory != VK_NULL_HANDLE &&
+            dvz_alloc_fit(&block->alloc, size, req->alignment, &allocation->offset))
+            break;
+    }
+    if (idx == pool->block_count)
+    {
+        idx = memory_block(gpu, pool, allocation->type_idx, block_size);
+        block = &pool->blocks[idx];
+        bool fit = dvz_alloc_fit(&block->alloc, size, req->alignment, &allocation->offset);
+        ASSERT(fit);
+    }
+    block->alloc_count++;
+    allocation->memory = block->memory;
+    allocation->size = size;
+    allocation->block_idx = idx;
+}
+
+
+
+static void memory_free(DvzGpu* gpu, DvzMemoryAlloc* allocation)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(allocation != NULL);
+    if (allocation->memory == VK_NULL_HANDLE)
+        return;
+    DvzMemoryPool* pool = memory_pool(gpu, allocation);
+
+    if (allocation->block_idx == UINT32_MAX)
+    {
+        vkFreeMemory(gpu->device, allocation->memory, NULL);
+        ASSERT(pool->dedicated_count > 0);
+        pool->dedicated_count--;
+        pool->dedicated_size -= allocation->size;
+    }
+    else
+    {
+        ASSERT(allocation->block_idx < pool->block_count);
+        DvzMemoryBlock* block = &pool->blocks[allocation->block_idx];
+        ASSERT(block->memory == allocation->memory);
+        ASSERT(block->alloc_count > 0);
+        dvz_alloc_free(&block->alloc, allocation->offset);
+        block->alloc_count--;
+
+        // Release an empty block, unless it is the last one of the pool.
+        uint32_t live = 0;
+        for (uint32_t i = 0; i < pool->block_count; i++)
+            live += pool->blocks[i].memory != VK_NULL_HANDLE ? 1 : 0;
+        if (block->alloc_count == 0 && live > 1)
+        {
+            log_trace("release empty memory block");
+            if (block->mmap != NULL)
+                vkUnmapMemory(gpu->device, block->memory);
+            vkFreeMemory(gpu->device, block->memory, NULL);
+            dvz_alloc_destroy(&block->alloc);
+            memset(block, 0, sizeof(DvzMemoryBlock));
+        }
+    }
+    memset(allocation, 0, sizeof(DvzMemoryAlloc));
+}
+
+
+
+// Map a host-visible region. Memory blocks are mapped once and for all, as a device memory object
+// cannot be mapped several times concurrently.
+static void*
+memory_map(DvzGpu* gpu, DvzMemoryAlloc* allocation, VkDeviceSize offset, VkDeviceSize size)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(allocation != NULL);
+    ASSERT(allocation->memory != VK_NULL_HANDLE);
+    void* data = NULL;
+    if (allocation->block_idx == UINT32_MAX)
+    {
+        VK_CHECK_RESULT(
+            vkMapMemory(gpu->device, allocation->memory, offset, size, 0, &data));
+        return data;
+    }
+    DvzMemoryBlock* block = &memory_pool(gpu, allocation)->blocks[allocation->block_idx];
+    if (block->mmap == NULL)
+        VK_CHECK_RESULT(vkMapMemory(gpu->device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mmap));
+    ASSERT(block->mmap != NULL);
+    return (uint8_t*)block->mmap + allocation->offset + offset;
+}
+
+
+
+static void memory_unmap(DvzGpu* gpu, DvzMemoryAlloc* allocation)
+{
+    ASSERT(gpu != NULL);
+    ASSERT(allocation != NULL);
+    // Memory blocks remain mapped until they are released.
+    if (allocation->block_idx == UINT32_MAX)
+        vkUnmapMemory(gpu->device, allocation->memory);
+}
+
+
+
+static void memory_destroy(DvzGpu* gpu)
+{
+    ASSERT(gpu != NULL);
+    DvzMemoryPool* pool = NULL;
+    DvzMemoryBlock* block = NULL;
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++)
+    {
+        for (uint32_t j = 0; j < 2; j++)
+        {
+            pool = &gpu->memory.pools[i][j];
+            if (pool->dedicated_count > 0)
+                log_warn("%d dedicated allocations were not freed", pool->dedicated_count);
+            for (uint32_t k = 0; k < pool->block_count; k++)
+            {
+                block = &pool->blocks[k];
+                if (block->memory == VK_NULL_HANDLE)
+                    continue;
+                if (block->alloc_count > 0)
+                    log_warn("%d regions of a memory block were not freed", block->alloc_count);
+                if (block->mmap != NULL)
+                    vkUnmapMemory(gpu->device, block->memory);
+                vkFreeMemory(gpu->device, block->memory, NULL);
+                dvz_alloc_destroy(&block->alloc);
+            }
+            FREE(pool->blocks);
+            memset(pool, 0, sizeof(DvzMemoryPool));
+        }
+    }
+}
+
+
+
 static void make_shared(
     DvzQueues* queues, uint32_t queue_count, const uint32_t* queue_indices, //
     VkSharingMode* sharing_mode, uint32_t* queue_family_count, uint32_t* queue_families)
@@ -1063,12 +1305,13 @@ static void make_shared(
 
 
 static void create_buffer2(
-    VkDevice device, DvzQueues* queues, uint32_t queue_count, uint32_t* queue_indices, //
-    VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
-    VkPhysicalDeviceMemoryProperties memory_properties, VkDeviceSize size, //
-    VkBuffer* buffer, VkDeviceMemory* bufferMemory)
+    DvzGpu* gpu, uint32_t queue_count, uint32_t* queue_indices,                       //
+    VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkDeviceSize size, //
+    VkBuffer* buffer, DvzMemoryAlloc* allocation)
 {
-    ASSERT(queues != NULL);
+    ASSERT(gpu != NULL);
+    VkDevice device = gpu->device;
+    DvzQueues* queues = &gpu->queues;
 
     VkBufferCreateInfo binfo = {0};
     binfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -1090,15 +1333,8 @@ static void create_buffer2(
     VkMemoryRequirements memRequirements = {0};
     vkGetBufferMemoryRequirements(device, *buffer, &memRequirements);
 
-    VkMemoryAllocateInfo alloc_info = {0};
-    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    alloc_info.allocationSize = memRequirements.size;
-    alloc_info.memoryTypeIndex =
-        find_memory_type(memRequirements.memoryTypeBits, properties, memory_properties);
-
-    VK_CHECK_RESULT(vkAllocateMemory(device, &alloc_info, NULL, bufferMemory));
-
-    vkBindBufferMemory(device, *buffer, *bufferMemory, 0);
+    memory_alloc(gpu, &memRequirements, properties, true, allocation);
+    vkBindBufferMemory(device, *buffer, allocation->memory, allocation->offset);
 }
 
 
@@ -1133,12 +1369,14 @@ static void check_dims(VkImageType image_type, uint32_t width, uint32_t height,
 
 
 static void create_image2(
-    VkDevice device, DvzQueues* queues, uint32_t queue_count, uint32_t* queue_indices,        //
+    DvzGpu* gpu, uint32_t queue_count, uint32_t* queue_indices,                               //
     VkImageType image_type, uint32_t width, uint32_t height, uint32_t depth, VkFormat format, //
     VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties,          //
-    VkPhysicalDeviceMemoryProperties memory_properties,                                       //
-    VkImage* image, VkDeviceMemory* imageMemory)                                              //
+    VkImage* image, DvzMemoryAlloc* allocation)                                               //
 {
+    ASSERT(gpu != NULL);
+    VkDevice device = gpu->device;
+    DvzQueues* queues = &gpu->queues;
     log_trace("create image %dD %dx%dx%d", image_type + 1, width, height, depth);
     ASSERT(width > 0);
 
@@ -1168,15 +1406,9 @@ static void create_image2(
     VkMemoryRequirements memRequirements = {0};
     vkGetImageMemoryRequirements(device, *image, &memRequirements);
 
-    VkMemoryAllocateInfo alloc_info = {0};
-    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    alloc_info.allocationSize = memRequirements.size;
-    alloc_info.memoryTypeIndex =
-        find_memory_type(memRequirements.memoryTypeBits, properties, memory_properties);
-
-    VK_CHECK_RESULT(vkAllocateMemory(device, &alloc_info, NULL, imageMemory));
-
-    vkBindImageMemory(device, *image, *imageMemory, 0);
+    memory_alloc(
+        gpu, &memRequirements, properties, tiling == VK_IMAGE_TILING_LINEAR, allocation);
+    vkBindImageMemory(device, *image, allocation->memory, allocation->offset);
 }
 
 
@@ -1470,13 +1702,52 @@ static VkShaderModule create_shader_module_from_file(VkDevice device, const char
 
 
 
+/*************************************************************************************************/
+/*  Pipeline cache                                                                               */
+/*************************************************************************************************/
+
+// Check the header of pipeline cache data against the current device. The driver rejects
+// mismatching data anyway, but some drivers are known to crash on it.
+static bool check_pipeline_cache(
+    VkPhysicalDeviceProperties* properties, size_t size, const void* data)
+{
+    ASSERT(properties != NULL);
+    // Header: size, version, vendor ID, device ID (4 bytes each), then the cache UUID.
+    const uint32_t header_size = 16 + VK_UUID_SIZE;
+    if (size < header_size || data == NULL)
+        return false;
+
+    uint32_t header[4] = {0};
+    memcpy(header, data, sizeof(header));
+    return header[0] >= header_size &&                          //
+           header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && //
+           header[2] == properties->vendorID &&                 //
+           header[3] == properties->deviceID &&                 //
+           memcmp(
+               (const uint8_t*)data + 16, properties->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+
+
+static void
+create_pipeline_cache(VkDevice device, size_t size, const void* data, VkPipelineCache* cache)
+{
+    VkPipelineCacheCreateInfo info = {0};
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    info.initialDataSize = size;
+    info.pInitialData = data;
+    VK_CHECK_RESULT(vkCreatePipelineCache(device, &info, NULL, cache));
+}
+
+
+
 /*************************************************************************************************/
 /*  Compute                                                                                      */
 /*************************************************************************************************/
 
 static void create_compute_pipeline(
-    VkDevice device, VkShaderModule shader_module, VkPipelineLayout pipeline_layout,
-    VkPipeline* pipeline)
+    VkDevice device, VkPipelineCache cache, VkShaderModule shader_module,
+    VkPipelineLayout pipeline_layout, VkPipeline* pipeline)
 {
     // Create the shader and pipeline.
     VkComputePipelineCreateInfo pipelineInfo = {0};
@@ -1488,7 +1759,7 @@ static void create_compute_pipeline(
     pipelineInfo.stage.module = shader_module;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     VK_CHECK_RESULT(
-        vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, NULL, pipeline));
+        vkCreateComputePipelines(device, cache, 1, &pipelineInfo, NULL, pipeline));
 }
 
 
@@ -1642,7 +1913,8 @@ static VkAttachmentReference create_attachment_ref(uint32_t attachment, VkImageL
 
 static void begin_render_pass(
     VkRenderPass renderpass, VkCommandBuffer cmd_buf, VkFramebuffer framebuffer, //
-    uint32_t width, uint32_t height, uint32_t clear_count, VkClearValue* clear_colors)
+    uint32_t width, uint32_t height, uint32_t clear_count, VkClearValue* clear_colors,
+    VkSubpassContents contents)
 {
     ASSERT(renderpass != VK_NULL_HANDLE);
     ASSERT(framebuffer != VK_NULL_HANDLE);
@@ -1657,7 +1929,7 @@ static void begin_render_pass(
     render_pass_info.renderArea = renderArea;
     render_pass_info.clearValueCount = clear_count;
     render_pass_info.pClearValues = clear_colors;
-    vkCmdBeginRenderPass(cmd_buf, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBeginRenderPass(cmd_buf, &render_pass_info, contents);
 }
 
 #endif
@@ -0,0 +1,209 @@
+#include "../include/datoviz/workers.h"
+#include <stdlib.h>
+
+
+
+/*************************************************************************************************/
+/*  Utils                                                                                        */
+/*************************************************************************************************/
+
+static uint32_t _cpu_count(void)
+{
+#if OS_WIN32
+    SYSTEM_INFO info = {0};
+    GetSystemInfo(&info);
+    return (uint32_t)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (uint32_t)n : 1;
+#endif
+}
+
+
+
+static uint32_t _default_thread_count(void)
+{
+    const char* env = getenv("DVZ_NUM_THREADS");
+    uint32_t n = 0;
+    if (env != NULL)
+        n = (uint32_t)strtol(env, NULL, 10);
+    if (n == 0)
+        n = _cpu_count();
+    return n;
+}
+
+
+
+// Process the tasks of the current loop until there are none left.
+static void _run_tasks(DvzWorkers* workers)
+{
+    ASSERT(workers != NULL);
+    uint32_t idx = 0;
+    while ((idx = atomic_fetch_add(&workers->next_task, 1)) < workers->task_count)
+        workers->callback(workers->user_data, idx);
+}
+
+
+
+static void* _worker(void* user_data)
+{
+    DvzWorkers* workers = (DvzWorkers*)user_data;
+    ASSERT(workers != NULL);
+
+    pthread_mutex_lock(&workers->lock);
+    uint64_t generation = workers->spawn_generation;
+    while (true)
+    {
+        while (!workers->stop && workers->generation == generation)
+            pthread_cond_wait(&workers->cond_start, &workers->lock);
+        if (workers->stop)
+            break;
+        generation = workers->generation;
+        pthread_mutex_unlock(&workers->lock);
+
+        _run_tasks(workers);
+
+        pthread_mutex_lock(&workers->lock);
+        ASSERT(workers->busy > 0);
+        workers->busy--;
+        if (workers->busy == 0)
+            pthread_cond_signal(&workers->cond_done);
+    }
+    pthread_mutex_unlock(&workers->lock);
+    return NULL;
+}
+
+
+
+static void _spawn(DvzWorkers* workers)
+{
+    ASSERT(workers != NULL);
+    ASSERT(workers->thread_count >= 1);
+    uint32_t count = workers->thread_count - 1;
+
+    // The new threads must not miss the next loop, even if they start after it.
+    workers->spawn_generation = workers->generation;
+    for (uint32_t i = workers->spawned; i < count; i++)
+    {
+        if (pthread_create(&workers->threads[i], NULL, _worker, workers) != 0)
+        {
+            log_error("thread creation failed, using %d worker threads", workers->spawned + 1);
+            break;
+        }
+        workers->spawned++;
+    }
+}
+
+
+
+static void _join(DvzWorkers* workers)
+{
+    ASSERT(workers != NULL);
+    if (workers->spawned == 0)
+        return;
+
+    pthread_mutex_lock(&workers->lock);
+    workers->stop = true;
+    pthread_cond_broadcast(&workers->cond_start);
+    pthread_mutex_unlock(&workers->lock);
+
+    for (uint32_t i = 0; i < workers->spawned; i++)
+        pthread_join(workers->threads[i], NULL);
+    workers->spawned = 0;
+    workers->stop = false;
+}
+
+
+
+/*************************************************************************************************/
+/*  Worker pool                                                                                  */
+/*************************************************************************************************/
+
+DvzWorkers dvz_workers(uint32_t thread_count)
+{
+    DvzWorkers workers = {0};
+    if (pthread_mutex_init(&workers.lock, NULL) != 0)
+        log_error("mutex creation failed");
+    if (pthread_cond_init(&workers.cond_start, NULL) != 0)
+        log_error("condition variable creation failed");
+    if (pthread_cond_init(&workers.cond_done, NULL) != 0)
+        log_error("condition variable creation failed");
+    atomic_init(&workers.next_task, 0);
+    dvz_workers_resize(&workers, thread_count);
+    return workers;
+}
+
+
+
+void dvz_workers_resize(DvzWorkers* workers, uint32_t thread_count)
+{
+    ASSERT(workers != NULL);
+    if (thread_count == 0)
+        thread_count = _default_thread_count();
+    thread_count = CLIP(thread_count, 1, DVZ_MAX_WORKERS);
+    if (thread_count == workers->thread_count)
+        return;
+
+    // The threads will be respawned at the next loop.
+    _join(workers);
+    workers->thread_count = thread_count;
+    log_debug("worker pool with %d thread(s)", thread_count);
+}
+
+
+
+void dvz_workers_run(
+    DvzWorkers* workers, uint32_t task_count, DvzWorkerCallback callback, void* user_data)
+{
+    ASSERT(workers != NULL);
+    ASSERT(callback != NULL);
+    if (task_count == 0)
+        return;
+
+    // Serial path.
+    if (workers->thread_count <= 1 || task_count == 1)
+    {
+        for (uint32_t i = 0; i < task_count; i++)
+            callback(user_data, i);
+        return;
+    }
+
+    if (workers->spawned < workers->thread_count - 1)
+        _spawn(workers);
+
+    // Start the loop in the background threads.
+    pthread_mutex_lock(&workers->lock);
+    ASSERT(workers->busy == 0);
+    workers->callback = callback;
+    workers->user_data = user_data;
+    workers->task_count = task_count;
+    atomic_store(&workers->next_task, 0);
+    workers->busy = workers->spawned;
+    workers->generation++;
+    pthread_cond_broadcast(&workers->cond_start);
+    pthread_mutex_unlock(&workers->lock);
+
+    // The calling thread participates.
+    _run_tasks(workers);
+
+    // Wait until all background threads are done.
+    pthread_mutex_lock(&workers->lock);
+    while (workers->busy > 0)
+        pthread_cond_wait(&workers->cond_done, &workers->lock);
+    workers->callback = NULL;
+    workers->user_data = NULL;
+    workers->task_count = 0;
+    pthread_mutex_unlock(&workers->lock);
+}
+
+
+
+void dvz_workers_destroy(DvzWorkers* workers)
+{
+    ASSERT(workers != NULL);
+    _join(workers);
+    pthread_cond_destroy(&workers->cond_start);
+    pthread_cond_destroy(&workers->cond_done);
+    pthread_mutex_destroy(&workers->lock);
+    workers->thread_count = 0;
+}